@@ -147,18 +147,34 @@ void AbsCell::Draw(wxPoint point, int fontsize)
 
 wxString AbsCell::ToString()
 {
-  if (m_isBroken)
-    return wxEmptyString;
   wxString s;
-  s = wxT("abs(") + m_innerCell->ListToString() + wxT(")");
+  WriteString(s);
   return s;
 }
 
+void AbsCell::WriteString(wxString &out)
+{
+  if (m_isBroken)
+    return;
+  out += wxT("abs(");
+  m_innerCell->ListWriteString(out);
+  out += wxT(")");
+}
+
 wxString AbsCell::ToTeX()
+{
+  wxString s;
+  WriteTeX(s);
+  return s;
+}
+
+void AbsCell::WriteTeX(wxString &out)
 {
   if (m_isBroken)
-    return wxEmptyString;
-  return wxT("\\left| ") + m_innerCell->ListToTeX() + wxT("\\right| ");
+    return;
+  out += wxT("\\left| ");
+  m_innerCell->ListWriteTeX(out);
+  out += wxT("\\right| ");
 }
 
 wxString AbsCell::ToMathML()
@@ -176,12 +192,21 @@ wxString AbsCell::ToOMML()
 }
 
 wxString AbsCell::ToXML()
+{
+  wxString s;
+  WriteXML(s);
+  return s;
+}
+
+void AbsCell::WriteXML(wxString &out)
 {
   wxString flags;
   if (m_forceBreakLine)
     flags += wxT(" breakline=\"true\"");
   
-  return wxT("<a") +flags + wxT(">") + m_innerCell->ListToXML() + wxT("</a>");
+  out += wxT("<a") + flags + wxT(">");
+  m_innerCell->ListWriteXML(out);
+  out += wxT("</a>");
 }
 
 bool AbsCell::BreakUp()
@@ -88,12 +88,18 @@ protected:
 
   wxString ToString();
 
+  void WriteString(wxString &out);
+
   wxString ToTeX();
 
+  void WriteTeX(wxString &out);
+
   wxString ToMathML();
 
   wxString ToXML();
 
+  void WriteXML(wxString &out);
+
   wxString ToOMML();
 };
 
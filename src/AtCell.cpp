@@ -134,20 +134,36 @@ void AtCell::Draw(wxPoint point, int fontsize)
 
 wxString AtCell::ToString()
 {
-  wxString s = wxT("at(");
-  s += m_baseCell->ListToString();
-  s += wxT(",") + m_indexCell->ListToString() + wxT(")");
+  wxString s;
+  WriteString(s);
   return s;
 }
 
+void AtCell::WriteString(wxString &out)
+{
+  out += wxT("at(");
+  m_baseCell->ListWriteString(out);
+  out += wxT(",");
+  m_indexCell->ListWriteString(out);
+  out += wxT(")");
+}
+
 wxString AtCell::ToTeX()
 {
-  wxString s = wxT("\\left. ");
-  s += m_baseCell->ListToTeX();
-  s += wxT("\\right|_{") + m_indexCell->ListToTeX() + wxT("}");
+  wxString s;
+  WriteTeX(s);
   return s;
 }
 
+void AtCell::WriteTeX(wxString &out)
+{
+  out += wxT("\\left. ");
+  m_baseCell->ListWriteTeX(out);
+  out += wxT("\\right|_{");
+  m_indexCell->ListWriteTeX(out);
+  out += wxT("}");
+}
+
 wxString AtCell::ToMathML()
 {
   return wxT("<msub>") + m_baseCell->ListToMathML() +
@@ -162,11 +178,21 @@ wxString AtCell::ToOMML()
 
 
 wxString AtCell::ToXML()
+{
+  wxString s;
+  WriteXML(s);
+  return s;
+}
+
+void AtCell::WriteXML(wxString &out)
 {
   wxString flags;
   if (m_forceBreakLine)
     flags += wxT(" breakline=\"true\"");
   
-  return wxT("<at") + flags + wxT("><r>") + m_baseCell->ListToXML() + wxT("</r><r>") +
-         m_indexCell->ListToXML() + wxT("</r></at>");
+  out += wxT("<at") + flags + wxT("><r>");
+  m_baseCell->ListWriteXML(out);
+  out += wxT("</r><r>");
+  m_indexCell->ListWriteXML(out);
+  out += wxT("</r></at>");
 }
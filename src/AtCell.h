@@ -45,10 +45,16 @@ public:
 
   wxString ToString();
 
+  void WriteString(wxString &out);
+
   wxString ToTeX();
 
+  void WriteTeX(wxString &out);
+
   wxString ToXML();
 
+  void WriteXML(wxString &out);
+
   wxString ToOMML();
 
   wxString ToMathML();
@@ -28,15 +28,147 @@
 
 #include "Autocomplete.h"
 #include "Dirstructure.h"
+#include "StartupTrace.h"
+#include "AutocompleteSymbols.h"
 
 #include <wx/textfile.h>
 #include <wx/filename.h>
 
+//! The thread AutoComplete::LoadSymbolsInBackground() loads the symbol lists in
+class SymbolLoaderThread : public wxThread
+{
+public:
+  SymbolLoaderThread(AutoComplete *autocomplete) :
+    wxThread(wxTHREAD_JOINABLE)
+  {
+    m_autocomplete = autocomplete;
+  }
+
+protected:
+  ExitCode Entry()
+  {
+    m_autocomplete->LoadSymbols();
+    StartupTrace::Phase(wxT("autocompletion symbols loaded"));
+    return 0;
+  }
+
+private:
+  AutoComplete *m_autocomplete;
+};
+
+//! The thread AutoComplete::IndexDirectoryInBackground() lists directories in
+class DirectoryIndexThread : public wxThread
+{
+public:
+  DirectoryIndexThread(DirectoryIndex *index, const wxString &dir) :
+    wxThread(wxTHREAD_JOINABLE)
+  {
+    m_index = index;
+    m_pending.Add(dir);
+    m_done = false;
+  }
+
+  /*! Queue dir for being listed after the directories queued before
+
+    \return false, if the thread has already run out of work and is about to
+    end: Then the caller has to start a new one.
+   */
+  bool Enqueue(const wxString &dir)
+  {
+    wxCriticalSectionLocker lock(m_lock);
+    if (m_done)
+      return false;
+    if (m_pending.Index(dir) == wxNOT_FOUND)
+      m_pending.Add(dir);
+    return true;
+  }
+
+protected:
+  ExitCode Entry()
+  {
+    wxString dir;
+    while (NextDir(dir))
+      m_index->Update(dir);
+    return 0;
+  }
+
+private:
+  //! Takes the next directory from the queue; Marks the thread as done if there is none.
+  bool NextDir(wxString &dir)
+  {
+    wxCriticalSectionLocker lock(m_lock);
+    if (m_pending.IsEmpty())
+    {
+      m_done = true;
+      return false;
+    }
+    dir = m_pending[0];
+    m_pending.RemoveAt(0);
+    return true;
+  }
+
+  DirectoryIndex *m_index;
+  //! The directories that still wait for being listed
+  wxArrayString m_pending;
+  //! true = Entry() won't look at m_pending any more
+  bool m_done;
+  wxCriticalSection m_lock;
+};
+
 AutoComplete::AutoComplete()
 {
+  m_symbolLoader = NULL;
+  m_directoryIndexer = NULL;
   wxASSERT(m_args.Compile(wxT("[[]<([^>]*)>[]]")));
 }
 
+AutoComplete::~AutoComplete()
+{
+  WaitForSymbols();
+  if (m_directoryIndexer != NULL)
+  {
+    m_directoryIndexer->Wait();
+    wxDELETE(m_directoryIndexer);
+  }
+}
+
+void AutoComplete::IndexDirectoryInBackground(wxString dir)
+{
+  if (m_directoryIndexer != NULL)
+  {
+    // Listing a slow directory mustn't block the GUI => if the last one is
+    // still being listed we hand the new one to the same thread.
+    if (m_directoryIndexer->Enqueue(dir))
+      return;
+    // The thread has finished its queue => Wait() returns immediately.
+    m_directoryIndexer->Wait();
+    wxDELETE(m_directoryIndexer);
+  }
+
+  m_directoryIndexer = new DirectoryIndexThread(&m_directoryIndex, dir);
+  if (m_directoryIndexer->Run() != wxTHREAD_NO_ERROR)
+    wxDELETE(m_directoryIndexer);
+}
+
+void AutoComplete::LoadSymbolsInBackground()
+{
+  WaitForSymbols();
+  m_symbolLoader = new SymbolLoaderThread(this);
+  if (m_symbolLoader->Run() != wxTHREAD_NO_ERROR)
+  {
+    wxDELETE(m_symbolLoader);
+    LoadSymbols();
+  }
+}
+
+void AutoComplete::WaitForSymbols()
+{
+  if (m_symbolLoader == NULL)
+    return;
+  m_symbolLoader->Wait();
+  wxDELETE(m_symbolLoader);
+}
+
 void AutoComplete::ClearWorksheetWords()
 {
   m_worksheetWords.clear();
@@ -52,11 +184,8 @@ void AutoComplete::AddWorksheetWords(wxArrayString wordlist)
   }
 }
 
-bool AutoComplete::LoadSymbols(wxString file)
+void AutoComplete::LoadSymbols()
 {
-  if (!wxFileExists(file))
-    return false;
-
   for (int i = command; i <= unit; i++)
   {
     if (m_wordList[i].GetCount() != 0)
@@ -64,23 +193,19 @@ bool AutoComplete::LoadSymbols(wxString file)
   }
 
   wxString line;
-  wxString rest, function;
-  wxTextFile index(file);
-
-  index.Open();
-
-  for (line = index.GetFirstLine(); !index.Eof(); line = index.GetNextLine())
-  {
-    if (line.StartsWith(wxT("FUNCTION: ")) ||
-        line.StartsWith(wxT("OPTION  : ")))
-      m_wordList[command].Add(line.Mid(10));
-    else if (line.StartsWith(wxT("TEMPLATE: ")))
-      m_wordList[tmplte].Add(FixTemplate(line.Mid(10)));
-    else if (line.StartsWith(wxT("UNIT: ")))
-      m_wordList[unit].Add(FixTemplate(line.Mid(6)));
-  }
 
-  index.Close();
+  // The symbols from data/autocomplete.txt are compiled into the program by
+  // AutocompleteSymbols.cmake: They are already sorted and their templates
+  // don't need to be fixed.
+  m_wordList[command].Alloc(WXSIZEOF(AutocompleteCommands));
+  for (size_t i = 0; i < WXSIZEOF(AutocompleteCommands); i++)
+    m_wordList[command].Add(wxString::FromUTF8(AutocompleteCommands[i]));
+  m_wordList[tmplte].Alloc(WXSIZEOF(AutocompleteTemplates));
+  for (size_t i = 0; i < WXSIZEOF(AutocompleteTemplates); i++)
+    m_wordList[tmplte].Add(wxString::FromUTF8(AutocompleteTemplates[i]));
+  m_wordList[unit].Alloc(WXSIZEOF(AutocompleteUnits));
+  for (size_t i = 0; i < WXSIZEOF(AutocompleteUnits); i++)
+    m_wordList[unit].Add(wxString::FromUTF8(AutocompleteUnits[i]));
 
   /// Add wxMaxima functions
   m_wordList[command].Add(wxT("wxanimate_framerate"));
@@ -156,26 +281,18 @@ bool AutoComplete::LoadSymbols(wxString file)
   // Prepare a list of all built-in loadable files of maxima.
   {
     GetMacFiles_includingSubdirs maximaLispIterator (m_builtInLoadFiles);
-    wxDir maximadir(dirstruct.MaximaLispLocation()+ "/share/");
-    if(maximadir.IsOpened())
-      maximadir.Traverse(maximaLispIterator);
+    m_directoryIndex.Traverse(dirstruct.MaximaLispLocation()+ "/share/", maximaLispIterator);
     GetMacFiles userLispIterator (m_builtInLoadFiles);
-    wxDir maximauserfilesdir(dirstruct.MaximaUserFilesDir());
-    if(maximauserfilesdir.IsOpened())
-      maximauserfilesdir.Traverse(userLispIterator);
+    m_directoryIndex.Traverse(dirstruct.MaximaUserFilesDir(), userLispIterator);
   }
   
 
   // Prepare a list of all built-in demos of maxima.
   {
     GetDemoFiles_includingSubdirs maximaLispIterator (m_builtInDemoFiles);
-    wxDir maximadir(dirstruct.MaximaLispLocation());
-    if(maximadir.IsOpened())
-      maximadir.Traverse(maximaLispIterator);
+    m_directoryIndex.Traverse(dirstruct.MaximaLispLocation(), maximaLispIterator);
     GetDemoFiles userLispIterator (m_builtInDemoFiles);
-    wxDir maximauserfilesdir(dirstruct.MaximaUserFilesDir());
-    if(maximauserfilesdir.IsOpened())
-      maximauserfilesdir.Traverse(userLispIterator);
+    m_directoryIndex.Traverse(dirstruct.MaximaUserFilesDir(), userLispIterator);
   }
   
 
@@ -184,12 +301,11 @@ bool AutoComplete::LoadSymbols(wxString file)
   m_wordList[unit].Sort();
   m_builtInLoadFiles.Sort();
   m_builtInDemoFiles.Sort();
-
-  return false;
 }
 
 void AutoComplete::UpdateDemoFiles(wxString partial, wxString maximaDir)
 {
+  WaitForSymbols();
   // Remove the opening quote from the partial.
   if(partial[0] == wxT('\"'))
     partial = partial.Right(partial.Length()-1);
@@ -220,14 +336,13 @@ void AutoComplete::UpdateDemoFiles(wxString partial, wxString maximaDir)
   if(partial != wxT("//"))
   {
     GetDemoFiles userLispIterator(m_wordList[demofile], prefix);
-    wxDir demofilesdir(partial);
-    if(demofilesdir.IsOpened())
-      demofilesdir.Traverse(userLispIterator);
+    m_directoryIndex.Traverse(partial, userLispIterator);
   }
 }
 
 void AutoComplete::UpdateGeneralFiles(wxString partial, wxString maximaDir)
 {
+  WaitForSymbols();
   // Remove the opening quote from the partial.
   if(partial[0] == wxT('\"'))
     partial = partial.Right(partial.Length()-1);
@@ -255,14 +370,13 @@ void AutoComplete::UpdateGeneralFiles(wxString partial, wxString maximaDir)
   if(partial != wxT("//"))
   {
     GetGeneralFiles fileIterator(m_wordList[generalfile], prefix);
-    wxDir generalfilesdir(partial);
-    if(generalfilesdir.IsOpened())
-      generalfilesdir.Traverse(fileIterator);
+    m_directoryIndex.Traverse(partial, fileIterator);
   }
 }
 
 void AutoComplete::UpdateLoadFiles(wxString partial, wxString maximaDir)
 {
+  WaitForSymbols();
   // Remove the opening quote from the partial.
   if(partial[0] == wxT('\"'))
     partial = partial.Right(partial.Length()-1);
@@ -293,15 +407,14 @@ void AutoComplete::UpdateLoadFiles(wxString partial, wxString maximaDir)
   if(partial != wxT("//"))
   {
     GetMacFiles userLispIterator(m_wordList[loadfile], prefix);
-    wxDir loadfilesdir(partial);
-    if(loadfilesdir.IsOpened())
-      loadfilesdir.Traverse(userLispIterator);
+    m_directoryIndex.Traverse(partial, userLispIterator);
   }
 }
 
 /// Returns a string array with functions which start with partial.
 wxArrayString AutoComplete::CompleteSymbol(wxString partial, autoCompletionType type)
 {
+  WaitForSymbols();
   wxArrayString completions;
   wxArrayString perfectCompletions;
   
@@ -364,6 +477,7 @@ wxArrayString AutoComplete::CompleteSymbol(wxString partial, autoCompletionType
 
 void AutoComplete::AddSymbol(wxString fun, autoCompletionType type)
 {
+  WaitForSymbols();
   /// Check for function of template
   if (fun.StartsWith(wxT("FUNCTION: ")))
   {
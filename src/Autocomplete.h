@@ -34,7 +34,11 @@
 #include <wx/arrstr.h>
 #include <wx/regex.h>
 #include <wx/filename.h>
+#include <wx/thread.h>
 #include "Dirstructure.h"
+#include "DirectoryIndex.h"
+
+class DirectoryIndexThread;
 
 class AutoComplete
 {
@@ -54,7 +58,30 @@ public:
 
   AutoComplete();
 
-  bool LoadSymbols(wxString file);
+  //! Waits for LoadSymbolsInBackground() to finish
+  ~AutoComplete();
+
+  /*! Load the lists of maxima's built-in symbols and of the files maxima can load
+
+    The built-in symbols are compiled into the program from data/autocomplete.txt.
+   */
+  void LoadSymbols();
+
+  /*! Run LoadSymbols() in a background thread
+
+    Reading the symbol lists and scanning maxima's share directory for loadable
+    files takes a while. All other methods wait for this thread to finish
+    before they access the symbol lists.
+   */
+  void LoadSymbolsInBackground();
+
+  /*! List the files in dir in a background thread
+
+    The next completion of a file name in dir then doesn't need to wait for
+    the directory to be read. If another directory is still being listed dir
+    is queued and listed afterwards.
+   */
+  void IndexDirectoryInBackground(wxString dir);
 
   void AddSymbol(wxString fun, autoCompletionType type = command);
 
@@ -70,13 +97,24 @@ public:
 
   //! Clear the list of words that appear in the workSheet's code cells
   void ClearWorksheetWords();
-  void ClearLoadfileList(){m_wordList[loadfile] = m_builtInLoadFiles;}
-  void ClearDemofileList(){m_wordList[demofile] = m_builtInDemoFiles;}
+  void ClearLoadfileList(){WaitForSymbols(); m_wordList[loadfile] = m_builtInLoadFiles;}
+  void ClearDemofileList(){WaitForSymbols(); m_wordList[demofile] = m_builtInDemoFiles;}
   
   wxArrayString CompleteSymbol(wxString partial, autoCompletionType type = command);
   wxString FixTemplate(wxString templ);
 
 private:
+  //! Waits for the thread LoadSymbolsInBackground() has started to finish
+  void WaitForSymbols();
+
+  //! The thread LoadSymbolsInBackground() runs LoadSymbols() in
+  wxThread *m_symbolLoader;
+
+  //! The contents of all directories we have completed file names in
+  DirectoryIndex m_directoryIndex;
+
+  //! The thread IndexDirectoryInBackground() lists a directory in
+  DirectoryIndexThread *m_directoryIndexer;
 
   wxArrayString m_builtInLoadFiles;
   wxArrayString m_builtInDemoFiles;
@@ -0,0 +1,75 @@
+# Compiles data/autocomplete.txt into AutocompleteSymbols.h that contains the
+# sorted lists of maxima's commands, templates and units as C arrays.
+#
+# This way wxMaxima doesn't need to read and parse this file on every start.
+# AutoComplete::FixTemplate() is applied to the templates here, too.
+#
+# Usage: cmake -DINPUT=autocomplete.txt -DOUTPUT=AutocompleteSymbols.h -P AutocompleteSymbols.cmake
+
+file(READ "${INPUT}" symbols)
+
+# Semicolons separate the entries of cmake lists. Unbalanced square brackets
+# stop cmake from splitting a list at the following semicolons. Hide both
+# before we split the file into lines.
+string(REPLACE ";" "@SEMICOLON@" symbols "${symbols}")
+string(REPLACE "[" "@OPEN@" symbols "${symbols}")
+string(REPLACE "]" "@CLOSE@" symbols "${symbols}")
+string(REPLACE "\r" "" symbols "${symbols}")
+string(REPLACE "\n" ";" symbols "${symbols}")
+
+set(commands)
+set(templates)
+set(units)
+foreach(line ${symbols})
+  if(line MATCHES "^(FUNCTION: |OPTION  : )(.*)$")
+    list(APPEND commands "${CMAKE_MATCH_2}")
+  elseif(line MATCHES "^TEMPLATE: (.*)$")
+    # The same as AutoComplete::FixTemplate()
+    set(template "${CMAKE_MATCH_1}")
+    string(REPLACE " " "" template "${template}")
+    string(REPLACE ",..." "" template "${template}")
+    string(REGEX REPLACE "@OPEN@<([^>]*)>@CLOSE@" "<@OPEN@\\1@CLOSE@>" template "${template}")
+    list(APPEND templates "${template}")
+  elseif(line MATCHES "^UNIT: (.*)$")
+    # FixTemplate() doesn't change unit names that don't contain spaces
+    set(unit "${CMAKE_MATCH_1}")
+    string(REPLACE " " "" unit "${unit}")
+    list(APPEND units "${unit}")
+  endif()
+endforeach()
+
+# Converts a list of symbols into the body of a C array
+function(symbols_to_c result)
+  set(array "")
+  list(REMOVE_DUPLICATES ARGN)
+  list(SORT ARGN)
+  foreach(symbol ${ARGN})
+    string(REPLACE "@SEMICOLON@" ";" symbol "${symbol}")
+    string(REPLACE "@OPEN@" "[" symbol "${symbol}")
+    string(REPLACE "@CLOSE@" "]" symbol "${symbol}")
+    string(REPLACE "\\" "\\\\" symbol "${symbol}")
+    string(REPLACE "\"" "\\\"" symbol "${symbol}")
+    set(array "${array}  \"${symbol}\",\n")
+  endforeach()
+  set(${result} "${array}" PARENT_SCOPE)
+endfunction()
+
+symbols_to_c(commandArray ${commands})
+symbols_to_c(templateArray ${templates})
+symbols_to_c(unitArray ${units})
+
+file(WRITE "${OUTPUT}"
+"// Generated from autocomplete.txt by AutocompleteSymbols.cmake. Do not edit.
+
+//! The names of maxima's built-in commands and options
+static const char *const AutocompleteCommands[] = {
+${commandArray}};
+
+//! The templates for maxima's built-in commands
+static const char *const AutocompleteTemplates[] = {
+${templateArray}};
+
+//! The names of the units ezunits knows about
+static const char *const AutocompleteUnits[] = {
+${unitArray}};
+")
@@ -0,0 +1,184 @@
+﻿// -*- mode: c++; c-file-style: "linux"; c-basic-offset: 2; indent-tabs-mode: nil -*-
+//
+//  Copyright (C) 2017 Gunter Königsmann <wxMaxima@physikbuch.de>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+
+/*! \file
+  This file defines the class CellPool
+
+  CellPool provides the memory all MathCells are allocated from.
+ */
+
+#include "CellPool.h"
+#include <new>
+#include <stdlib.h>
+#if defined __WXMSW__
+#include <malloc.h>
+#endif
+
+CellPool::Chunk *CellPool::m_freeChunks[CellPool::m_sizeClasses] = {NULL};
+size_t CellPool::m_bytesReserved = 0;
+size_t CellPool::m_cellsAllocated = 0;
+
+bool CellPool::HasFreeSlots(Chunk *chunk)
+{
+  size_t slotSize = (chunk->m_sizeClass + 1) * m_granularity;
+  return (chunk->m_freeSlots != NULL) ||
+         (chunk->m_unused + slotSize <= (char *) chunk + m_chunkSize);
+}
+
+CellPool::Chunk *CellPool::NewChunk(size_t sizeClass)
+{
+  void *mem = NULL;
+#if defined __WXMSW__
+  mem = _aligned_malloc(m_chunkSize, m_chunkSize);
+#else
+  if (posix_memalign(&mem, m_chunkSize, m_chunkSize) != 0)
+    mem = NULL;
+#endif
+  if (mem == NULL)
+    return NULL;
+
+  Chunk *chunk = (Chunk *) mem;
+  chunk->m_next = chunk->m_previous = NULL;
+  chunk->m_freeSlots = NULL;
+  chunk->m_unused = (char *) mem + FirstSlotOffset();
+  chunk->m_sizeClass = sizeClass;
+  chunk->m_slotsUsed = 0;
+  chunk->m_inFreeList = false;
+  m_bytesReserved += m_chunkSize;
+  return chunk;
+}
+
+void CellPool::DeleteChunk(Chunk *chunk)
+{
+  RemoveFromFreeList(chunk);
+  m_bytesReserved -= m_chunkSize;
+#if defined __WXMSW__
+  _aligned_free(chunk);
+#else
+  free(chunk);
+#endif
+}
+
+void CellPool::AddToFreeList(Chunk *chunk)
+{
+  if (chunk->m_inFreeList)
+    return;
+  Chunk *&first = m_freeChunks[chunk->m_sizeClass];
+  chunk->m_previous = NULL;
+  chunk->m_next = first;
+  if (first != NULL)
+    first->m_previous = chunk;
+  first = chunk;
+  chunk->m_inFreeList = true;
+}
+
+void CellPool::RemoveFromFreeList(Chunk *chunk)
+{
+  if (!chunk->m_inFreeList)
+    return;
+  if (chunk->m_previous != NULL)
+    chunk->m_previous->m_next = chunk->m_next;
+  else
+    m_freeChunks[chunk->m_sizeClass] = chunk->m_next;
+  if (chunk->m_next != NULL)
+    chunk->m_next->m_previous = chunk->m_previous;
+  chunk->m_next = chunk->m_previous = NULL;
+  chunk->m_inFreeList = false;
+}
+
+void *CellPool::Allocate(size_t size)
+{
+  if (size == 0)
+    size = 1;
+
+  if (size > m_maxSlotSize)
+  {
+    void *retval = ::operator new(size);
+    m_bytesReserved += size;
+    m_cellsAllocated++;
+    return retval;
+  }
+
+  size_t sizeClass = SizeClass(size);
+  Chunk *chunk = m_freeChunks[sizeClass];
+  if (chunk == NULL)
+  {
+    chunk = NewChunk(sizeClass);
+    if (chunk == NULL)
+      throw std::bad_alloc();
+    AddToFreeList(chunk);
+  }
+
+  void *retval;
+  if (chunk->m_freeSlots != NULL)
+  {
+    retval = chunk->m_freeSlots;
+    chunk->m_freeSlots = chunk->m_freeSlots->m_next;
+  }
+  else
+  {
+    retval = chunk->m_unused;
+    chunk->m_unused += (sizeClass + 1) * m_granularity;
+  }
+  chunk->m_slotsUsed++;
+  m_cellsAllocated++;
+
+  if (!HasFreeSlots(chunk))
+    RemoveFromFreeList(chunk);
+
+  return retval;
+}
+
+void CellPool::Free(void *ptr, size_t size)
+{
+  if (ptr == NULL)
+    return;
+
+  if (size == 0)
+    size = 1;
+
+  if (size > m_maxSlotSize)
+  {
+    ::operator delete(ptr);
+    m_bytesReserved -= size;
+    m_cellsAllocated--;
+    return;
+  }
+
+  Chunk *chunk = ChunkOf(ptr);
+  FreeSlot *slot = (FreeSlot *) ptr;
+  slot->m_next = chunk->m_freeSlots;
+  chunk->m_freeSlots = slot;
+  chunk->m_slotsUsed--;
+  m_cellsAllocated--;
+
+  if (chunk->m_slotsUsed == 0)
+  {
+    // Keep one empty chunk per size class around so allocating and freeing
+    // a single cell doesn't cause a chunk to be allocated and freed each time.
+    Chunk *first = m_freeChunks[chunk->m_sizeClass];
+    if ((first != NULL) && ((first != chunk) || (chunk->m_next != NULL)))
+    {
+      DeleteChunk(chunk);
+      return;
+    }
+  }
+  AddToFreeList(chunk);
+}
@@ -0,0 +1,128 @@
+﻿// -*- mode: c++; c-file-style: "linux"; c-basic-offset: 2; indent-tabs-mode: nil -*-
+//
+//  Copyright (C) 2017 Gunter Königsmann <wxMaxima@physikbuch.de>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+
+/*! \file
+  This file declares the class CellPool
+
+  CellPool provides the memory all MathCells are allocated from.
+ */
+
+#ifndef CELLPOOL_H
+#define CELLPOOL_H
+
+#include <stddef.h>
+
+/*! A pool allocator for MathCells
+
+  A big output (for example a matrix with 100000 elements) consists of
+  hundreds of thousands of small cells. Allocating each of them from the
+  general-purpose heap is slow and so is handing them back one by one.
+
+  Instead CellPool hands out slots from 64 KiB chunks, each of which only
+  contains cells of one size. Allocating or freeing a cell only means taking
+  a slot from or returning it to the chunk's free list. As soon as the
+  last cell of a chunk is freed (which happens if a big output is deleted)
+  the whole chunk is returned to the operating system in one step.
+
+  MathCell::operator new and MathCell::operator delete use this class.
+  It isn't thread-safe: Cells are only created and deleted by the main thread.
+ */
+class CellPool
+{
+public:
+  //! Allocates size bytes of memory
+  static void *Allocate(size_t size);
+
+  //! Frees memory Allocate() has returned. size has to be the size that was requested.
+  static void Free(void *ptr, size_t size);
+
+  /*! The number of bytes currently allocated for cells
+
+    Includes the unused slots of the chunks and the cells that are too big
+    for a slot and therefore are allocated from the heap.
+   */
+  static size_t BytesReserved()
+  { return m_bytesReserved; }
+
+  //! The number of cells that currently are allocated
+  static size_t CellsAllocated()
+  { return m_cellsAllocated; }
+
+private:
+  //! The size of a chunk. Must be a power of 2 since chunks are aligned to it.
+  static const size_t m_chunkSize = 65536;
+  //! Slot sizes are a multiple of this
+  static const size_t m_granularity = 16;
+  //! Bigger objects are allocated directly from the heap
+  static const size_t m_maxSlotSize = 1024;
+  static const size_t m_sizeClasses = m_maxSlotSize / m_granularity;
+
+  //! A slot that currently isn't in use
+  struct FreeSlot
+  {
+    FreeSlot *m_next;
+  };
+
+  //! The header at the start of each chunk
+  struct Chunk
+  {
+    //! The next chunk of the same size class that has free slots
+    Chunk *m_next;
+    //! The previous chunk of the same size class that has free slots
+    Chunk *m_previous;
+    //! Slots that have been freed and can be re-used
+    FreeSlot *m_freeSlots;
+    //! The first slot that never has been used
+    char *m_unused;
+    //! The size class this chunk belongs to
+    size_t m_sizeClass;
+    //! The number of slots that currently are in use
+    size_t m_slotsUsed;
+    //! Is this chunk in the list of chunks that have free slots?
+    bool m_inFreeList;
+  };
+
+  //! The size class a request for size bytes is served from
+  static size_t SizeClass(size_t size)
+  { return (size + m_granularity - 1) / m_granularity - 1; }
+
+  //! The chunk a slot belongs to
+  static Chunk *ChunkOf(void *ptr)
+  { return (Chunk *) ((size_t) ptr & ~(m_chunkSize - 1)); }
+
+  //! The offset of the first slot in a chunk
+  static size_t FirstSlotOffset()
+  { return ((sizeof(Chunk) + m_granularity - 1) / m_granularity) * m_granularity; }
+
+  //! Does a chunk have slots left that can be handed out?
+  static bool HasFreeSlots(Chunk *chunk);
+
+  static Chunk *NewChunk(size_t sizeClass);
+  static void DeleteChunk(Chunk *chunk);
+  static void AddToFreeList(Chunk *chunk);
+  static void RemoveFromFreeList(Chunk *chunk);
+
+  //! For each size class the list of chunks that have free slots
+  static Chunk *m_freeChunks[m_sizeClasses];
+  static size_t m_bytesReserved;
+  static size_t m_cellsAllocated;
+};
+
+#endif // CELLPOOL_H
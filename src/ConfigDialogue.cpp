@@ -256,6 +256,14 @@ void ConfigDialogue::SetProperties()
           _("Once the local network link between maxima and wxMaxima has been established maxima has no reason to send any messages using the system's stdout stream so all this stream transport should be a greeting message; The lisp running maxima will send eventual error messages using the system's stderr stream instead. If this box is checked we will nonetheless watch maxima's stdout stream for messages."));
   m_restartOnReEvaluation->SetToolTip(
           _("Maxima provides no \"forget all\" command that flushes all settings a maxima session could make. wxMaxima therefore normally defaults to starting a fresh maxima process every time the worksheet is to be re-evaluated. As this needs a little bit of time this switch allows to disable this behavior."));
+  m_pipelineCommands->SetToolTip(
+          _("Normally wxMaxima waits for maxima to finish a command before sending the next one. If this box is checked a few commands are sent in advance which speeds up evaluating many short commands. Commands that maxima has already received will still be evaluated after an error. Commands are only sent in advance after commands that cannot make maxima ask a question, which means after commands that only use built-in functions that are known not to ask one."));
+  m_framedProtocol->SetToolTip(
+          _("Normally wxMaxima finds the end of the messages maxima sends by searching for closing tags. If this box is checked maxima is asked to tell the length of its output instead which is faster for big results and cannot be confused by text in strings that looks like a tag. Takes effect the next time maxima is started."));
+  m_packedMatrices->SetToolTip(
+          _("Big matrices that only contain plain numbers can be sent by maxima as a list of numbers instead of as a XML tag per entry. This reduces the amount of data to transfer and interpret. Takes effect the next time maxima is started."));
+  m_warmSpareMaxima->SetToolTip(
+          _("If this box is checked a second maxima process is started in the background and prepared for use so restarting maxima doesn't mean waiting for maxima to start up. This needs the memory for a second maxima."));
   m_maximaProgram->SetToolTip(_("Enter the path to the Maxima executable."));
   m_additionalParameters->SetToolTip(_("Additional parameters for Maxima"
                                                " (e.g. -l clisp)."));
@@ -314,8 +322,19 @@ void ConfigDialogue::SetProperties()
   m_defaultPort->SetToolTip(_("The default port used for communication between Maxima and wxMaxima."));
   m_undoLimit->SetToolTip(
           _("Save only this number of actions in the undo buffer. 0 means: save an infinite number of actions."));
+  m_undoMemoryLimit->SetToolTip(
+          _("The maximum amount of memory deleted cells and old cell contents in the undo buffer "
+            "may occupy. If this limit is exceeded the oldest actions are forgotten. 0 means: no limit."));
+  m_wxmxCompressionLevel->SetToolTip(
+          _("How strongly the text part of .wxmx files is compressed. 0 means: store it uncompressed "
+            "which allows version control systems like git to track changes line by line."));
   m_recentItems->SetToolTip(_("The number of recently opened files that is to be remembered."));
   m_incrementalSearch->SetToolTip(_("Start searching while the phrase to search for is still being typed."));
+  m_compactFoldedOutput->SetToolTip(
+          _("Keep only a compressed copy of big outputs that are hidden in a folded section. "
+            "This saves memory, but unfolding the section takes longer."));
+  m_autoSaveInBackground->SetToolTip(
+          _("Compress and write autosaves in a background thread so editing isn't interrupted while big files are saved."));
   m_notifyIfIdle->SetToolTip(_("Issue a notification if maxima finishes calculating while the wxMaxima window isn't in focus."));
 
   m_hideBrackets->SetToolTip(
@@ -334,6 +353,7 @@ void ConfigDialogue::SetProperties()
   // configuration data for this item.
   bool savePanes = true;
   bool fixedFontTC = true, usejsmath = true, keepPercent = true, abortOnError = true, pollStdOut = false;
+  bool framedProtocol = false, packedMatrices = true, warmSpareMaxima = false;
   bool enterEvaluates = false, saveUntitled = true,
           AnimateLaTeX = true, TeXExponentsAfterSubscript = false,
           usePartialForDiff = false,
@@ -344,10 +364,13 @@ void ConfigDialogue::SetProperties()
 
   int labelWidth = 4;
   int undoLimit = 0;
+  int undoMemoryLimit = 256;
+  int wxmxCompressionLevel = 0;
   int recentItems = 10;
   int autosubscript = 1;
   int bitmapScale = 3;
   bool incrementalSearch = true;
+  bool autoSaveInBackground = true;
   int defaultFramerate = 2;
   wxString texPreamble = wxEmptyString;
   wxString documentclass = wxT("article");
@@ -397,13 +420,19 @@ void ConfigDialogue::SetProperties()
   config->Read(wxT("cursorJump"), &cursorJump);
   config->Read(wxT("labelWidth"), &labelWidth);
   config->Read(wxT("undoLimit"), &undoLimit);
+  config->Read(wxT("undoMemoryLimit"), &undoMemoryLimit);
+  config->Read(wxT("wxmxCompressionLevel"), &wxmxCompressionLevel);
   config->Read(wxT("recentItems"), &recentItems);
   config->Read(wxT("bitmapScale"), &bitmapScale);
   config->Read(wxT("incrementalSearch"), &incrementalSearch);
+  config->Read(wxT("autoSaveInBackground"), &autoSaveInBackground);
   config->Read(wxT("usejsmath"), &usejsmath);
   config->Read(wxT("keepPercent"), &keepPercent);
   config->Read(wxT("abortOnError"), &abortOnError);
   config->Read(wxT("pollStdOut"), &pollStdOut);
+  config->Read(wxT("framedProtocol"), &framedProtocol);
+  config->Read(wxT("packedMatrices"), &packedMatrices);
+  config->Read(wxT("warmSpareMaxima"), &warmSpareMaxima);
   unsigned int i = 0;
   for (i = 0; i < LANGUAGE_NUMBER; i++)
     if (langs[i] == lang)
@@ -462,11 +491,15 @@ void ConfigDialogue::SetProperties()
   m_autoWrap->SetSelection(val);
   m_labelWidth->SetValue(labelWidth);
   m_undoLimit->SetValue(undoLimit);
+  m_undoMemoryLimit->SetValue(undoMemoryLimit);
+  m_wxmxCompressionLevel->SetValue(wxmxCompressionLevel);
   m_recentItems->SetValue(recentItems);
   m_bitmapScale->SetValue(bitmapScale);
   m_printScale->SetValue(configuration->PrintScale());
   m_fixReorderedIndices->SetValue(configuration->FixReorderedIndices());
+  m_compactFoldedOutput->SetValue(configuration->CompactFoldedOutput());
   m_incrementalSearch->SetValue(incrementalSearch);
+  m_autoSaveInBackground->SetValue(autoSaveInBackground);
   m_notifyIfIdle->SetValue(configuration->NotifyIfIdle());
   m_fixedFontInTC->SetValue(fixedFontTC);
   m_useJSMath->SetValue(usejsmath);
@@ -474,6 +507,10 @@ void ConfigDialogue::SetProperties()
   m_abortOnError->SetValue(abortOnError);
   m_pollStdOut->SetValue(pollStdOut);
   m_restartOnReEvaluation->SetValue(configuration->RestartOnReEvaluation());
+  m_pipelineCommands->SetValue(configuration->PipelineCommands());
+  m_framedProtocol->SetValue(framedProtocol);
+  m_packedMatrices->SetValue(packedMatrices);
+  m_warmSpareMaxima->SetValue(warmSpareMaxima);
   m_defaultFramerate->SetValue(defaultFramerate);
   m_defaultPlotWidth->SetValue(defaultPlotWidth);
   m_defaultPlotHeight->SetValue(defaultPlotHeight);
@@ -842,6 +879,16 @@ wxPanel *ConfigDialogue::CreateOptionsPanel()
   grid_sizer->Add(ul, 0, wxALL | wxALIGN_CENTER_VERTICAL, 5);
   grid_sizer->Add(m_undoLimit, 0, wxALL, 5);
 
+  wxStaticText *um = new wxStaticText(panel, -1, _("Undo memory limit in MB (0 for none):"));
+  m_undoMemoryLimit = new wxSpinCtrl(panel, -1, wxEmptyString, wxDefaultPosition, wxSize(100, -1), wxSP_ARROW_KEYS, 0, 100000);
+  grid_sizer->Add(um, 0, wxALL | wxALIGN_CENTER_VERTICAL, 5);
+  grid_sizer->Add(m_undoMemoryLimit, 0, wxALL, 5);
+
+  wxStaticText *wc = new wxStaticText(panel, -1, _(".wxmx text compression (0 for none):"));
+  m_wxmxCompressionLevel = new wxSpinCtrl(panel, -1, wxEmptyString, wxDefaultPosition, wxSize(100, -1), wxSP_ARROW_KEYS, 0, 9);
+  grid_sizer->Add(wc, 0, wxALL | wxALIGN_CENTER_VERTICAL, 5);
+  grid_sizer->Add(m_wxmxCompressionLevel, 0, wxALL, 5);
+
   wxStaticText *rf = new wxStaticText(panel, -1, _("Recent files list length:"));
   m_recentItems = new wxSpinCtrl(panel, -1, wxEmptyString, wxDefaultPosition, wxSize(100, -1), wxSP_ARROW_KEYS, 5, 30);
   grid_sizer->Add(rf, 0, wxALL | wxALIGN_CENTER_VERTICAL, 5);
@@ -876,9 +923,14 @@ wxPanel *ConfigDialogue::CreateOptionsPanel()
 
   m_fixReorderedIndices = new wxCheckBox(panel, -1, _("Fix reordered reference indices (of %i, %o) before saving"));
   vsizer->Add(m_fixReorderedIndices, 0, wxALL, 5);
+  m_compactFoldedOutput = new wxCheckBox(panel, -1, _("Compress the output of folded cells"));
+  vsizer->Add(m_compactFoldedOutput, 0, wxALL, 5);
   m_incrementalSearch = new wxCheckBox(panel, -1, _("Incremental Search"));
   vsizer->Add(m_incrementalSearch, 0, wxALL, 5);
 
+  m_autoSaveInBackground = new wxCheckBox(panel, -1, _("Autosave in the background"));
+  vsizer->Add(m_autoSaveInBackground, 0, wxALL, 5);
+
   m_notifyIfIdle = new wxCheckBox(panel, -1, _("Warn if an inactive window is idle"));
   vsizer->Add(m_notifyIfIdle, 0, wxALL, 5);
 
@@ -960,10 +1012,22 @@ wxPanel *ConfigDialogue::CreateMaximaPanel()
 
   m_pollStdOut = new wxCheckBox(panel, -1, _("Debug: watch maxima's stdout stream"));
   vsizer->Add(m_pollStdOut, 0, wxALL, 5);
-  panel->SetSizerAndFit(vsizer);
 
   m_restartOnReEvaluation = new wxCheckBox(panel, -1, _("Start a new maxima for each re-evaluation"));
   vsizer->Add(m_restartOnReEvaluation, 0, wxALL, 5);
+
+  m_pipelineCommands = new wxCheckBox(panel, -1, _("Send commands to maxima in advance"));
+  vsizer->Add(m_pipelineCommands, 0, wxALL, 5);
+
+  m_framedProtocol = new wxCheckBox(panel, -1, _("Let maxima send the length of its output"));
+  vsizer->Add(m_framedProtocol, 0, wxALL, 5);
+
+  m_packedMatrices = new wxCheckBox(panel, -1, _("Let maxima send big numeric matrices in a compact format"));
+  vsizer->Add(m_packedMatrices, 0, wxALL, 5);
+
+  m_warmSpareMaxima = new wxCheckBox(panel, -1, _("Keep a spare maxima ready for restarts"));
+  vsizer->Add(m_warmSpareMaxima, 0, wxALL, 5);
+
   panel->SetSizerAndFit(vsizer);
 
   return panel;
@@ -1150,7 +1214,11 @@ void ConfigDialogue::WriteSettings()
   Configuration *configuration = m_configuration;
   config->Write(wxT("abortOnError"), m_abortOnError->GetValue());
   config->Write(wxT("pollStdOut"), m_pollStdOut->GetValue());
+  config->Write(wxT("framedProtocol"), m_framedProtocol->GetValue());
+  config->Write(wxT("packedMatrices"), m_packedMatrices->GetValue());
+  config->Write(wxT("warmSpareMaxima"), m_warmSpareMaxima->GetValue());
   configuration->RestartOnReEvaluation(m_restartOnReEvaluation->GetValue());
+  configuration->PipelineCommands(m_pipelineCommands->GetValue());
   if (
           (configuration->MaximaFound()) ||
           (configuration->MaximaLocation() != m_maximaProgram->GetValue())
@@ -1174,11 +1242,15 @@ void ConfigDialogue::WriteSettings()
   configuration->SetAutoWrap(m_autoWrap->GetSelection());
   config->Write(wxT("labelWidth"), m_labelWidth->GetValue());
   config->Write(wxT("undoLimit"), m_undoLimit->GetValue());
+  config->Write(wxT("undoMemoryLimit"), m_undoMemoryLimit->GetValue());
+  config->Write(wxT("wxmxCompressionLevel"), m_wxmxCompressionLevel->GetValue());
   config->Write(wxT("recentItems"), m_recentItems->GetValue());
   config->Write(wxT("bitmapScale"), m_bitmapScale->GetValue());
   configuration->PrintScale(m_printScale->GetValue());
   configuration->FixReorderedIndices(m_fixReorderedIndices->GetValue());
+  configuration->CompactFoldedOutput(m_compactFoldedOutput->GetValue());
   config->Write(wxT("incrementalSearch"), m_incrementalSearch->GetValue());
+  config->Write(wxT("autoSaveInBackground"), m_autoSaveInBackground->GetValue());
   configuration->NotifyIfIdle(m_notifyIfIdle->GetValue());
   configuration->SetLabelChoice(m_showUserDefinedLabels->GetSelection());
   config->Write(wxT("defaultPort"), m_defaultPort->GetValue());
@@ -229,6 +229,14 @@ protected:
   wxCheckBox *m_abortOnError;
   wxCheckBox *m_pollStdOut;
   wxCheckBox *m_restartOnReEvaluation;
+  //! Send commands to maxima in advance?
+  wxCheckBox *m_pipelineCommands;
+  //! Use the length-prefixed framed protocol for maxima's output?
+  wxCheckBox *m_framedProtocol;
+  //! Let maxima send big numeric matrices without a tag per entry?
+  wxCheckBox *m_packedMatrices;
+  //! Keep a spare maxima running for fast restarts?
+  wxCheckBox *m_warmSpareMaxima;
   wxCheckBox *m_wrapLatexMath;
   wxCheckBox *m_savePanes;
   wxCheckBox *m_usepngCairo;
@@ -260,11 +268,15 @@ protected:
   wxChoice *m_autoWrap;
   wxSpinCtrl *m_labelWidth;
   wxSpinCtrl *m_undoLimit;
+  wxSpinCtrl *m_undoMemoryLimit;
+  wxSpinCtrl *m_wxmxCompressionLevel;
   wxSpinCtrl *m_recentItems;
   wxSpinCtrl *m_bitmapScale;
   wxSpinCtrlDouble *m_printScale;
   wxCheckBox *m_fixReorderedIndices;
+  wxCheckBox *m_compactFoldedOutput;
   wxCheckBox *m_incrementalSearch;
+  wxCheckBox *m_autoSaveInBackground;
   wxCheckBox *m_notifyIfIdle;
   wxChoice *m_showUserDefinedLabels;
   wxButton *m_getFont;
@@ -48,6 +48,7 @@ Configuration::Configuration(wxDC &dc) : m_dc(&dc)
   m_printer = false;
   m_notifyIfIdle = true;
   m_fixReorderedIndices = true;
+  m_compactFoldedOutput = true;
   m_showBrackets = true;
   m_printBrackets = false;
   m_hideBrackets = true;
@@ -112,6 +113,7 @@ void Configuration::ReadConfig()
   config->Read(wxT("antiAliasLines"), & m_antiAliasLines);
   
   config->Read(wxT("fixReorderedIndices"), &m_fixReorderedIndices);
+  config->Read(wxT("compactFoldedOutput"), &m_compactFoldedOutput);
 
   config->Read(wxT("showLength"), &m_showLength);
   config->Read(wxT("printScale"), &m_printScale);
@@ -151,6 +153,12 @@ void Configuration::ReadConfig()
   m_restartOnReEvaluation = true;
   config->Read(wxT("restartOnReEvaluation"), &m_restartOnReEvaluation);
 
+  m_pipelineCommands = false;
+  config->Read(wxT("pipelineCommands"), &m_pipelineCommands);
+
+  m_pipelineDepth = 8;
+  config->Read(wxT("pipelineDepth"), &m_pipelineDepth);
+
   m_matchParens = true;
   config->Read(wxT("matchParens"), &m_matchParens);
 
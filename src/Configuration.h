@@ -469,6 +469,27 @@ public:
     wxConfig::Get()->Write(wxT("restartOnReEvaluation"), m_restartOnReEvaluation = arg);
   }
 
+  //! Send commands to maxima before the prompt for the previous one has arrived?
+  bool PipelineCommands()
+  { return m_pipelineCommands; }
+
+  void PipelineCommands(bool pipeline)
+  {
+    wxConfig::Get()->Write(wxT("pipelineCommands"), m_pipelineCommands = pipeline);
+  }
+
+  /*! The maximum number of commands maxima has been sent but hasn't answered yet
+
+    1 means: Wait for the prompt of each command before sending the next one.
+   */
+  int PipelineDepth()
+  {
+    if (m_pipelineCommands && (m_pipelineDepth > 1))
+      return m_pipelineDepth;
+    else
+      return 1;
+  }
+
   //! Reads the size of the current worksheet's visible window. See SetCanvasSize
   wxSize GetCanvasSize()
   { return m_canvasSize; }
@@ -533,6 +554,15 @@ public:
    */
   bool MaximaFound(wxString location = wxEmptyString);
 
+  //! Replace the output of folded cells by its compressed XML in order to save memory?
+  bool CompactFoldedOutput()
+  { return m_compactFoldedOutput; }
+
+  void CompactFoldedOutput(bool compact)
+  {
+    wxConfig::Get()->Write(wxT("compactFoldedOutput"), m_compactFoldedOutput = compact);
+  }
+
   //! Renumber out-of-order cell labels on saving.
   bool FixReorderedIndices()
   { return m_fixReorderedIndices; }
@@ -685,6 +715,10 @@ private:
   bool m_TeXFonts;
   bool m_keepPercent;
   bool m_restartOnReEvaluation;
+  //! Send commands to maxima in advance?
+  bool m_pipelineCommands;
+  //! How many commands may be sent to maxima in advance?
+  int m_pipelineDepth;
   wxString m_fontCMRI, m_fontCMSY, m_fontCMEX, m_fontCMMI, m_fontCMTI;
   int m_clientWidth;
   int m_clientHeight;
@@ -694,6 +728,7 @@ private:
   int m_lineWidth_em;
   int m_showLabelChoice;
   bool m_fixReorderedIndices;
+  bool m_compactFoldedOutput;
   wxString m_mathJaxURL;
   bool m_showCodeCells;
   bool m_copyBitmap;
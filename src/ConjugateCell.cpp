@@ -147,19 +147,35 @@ void ConjugateCell::Draw(wxPoint point, int fontsize)
 }
 
 wxString ConjugateCell::ToString()
+{
+  wxString s;
+  WriteString(s);
+  return s;
+}
+
+void ConjugateCell::WriteString(wxString &out)
 {
   if (m_isBroken)
-    return wxEmptyString;
-  else
-    return wxT("conjugate(") + m_innerCell->ListToString() + wxT(")");
+    return;
+  out += wxT("conjugate(");
+  m_innerCell->ListWriteString(out);
+  out += wxT(")");
 }
 
 wxString ConjugateCell::ToTeX()
+{
+  wxString s;
+  WriteTeX(s);
+  return s;
+}
+
+void ConjugateCell::WriteTeX(wxString &out)
 {
   if (m_isBroken)
-    return wxEmptyString;
-  else
-    return wxT("\\overline{") + m_innerCell->ListToTeX() + wxT("}");
+    return;
+  out += wxT("\\overline{");
+  m_innerCell->ListWriteTeX(out);
+  out += wxT("}");
 }
 
 wxString ConjugateCell::ToMathML()
@@ -176,12 +192,21 @@ wxString ConjugateCell::ToOMML()
 }
 
 wxString ConjugateCell::ToXML()
+{
+  wxString s;
+  WriteXML(s);
+  return s;
+}
+
+void ConjugateCell::WriteXML(wxString &out)
 {
   wxString flags;
   if (m_forceBreakLine)
     flags += wxT(" breakline=\"true\"");
 
-  return wxT("<cj") + flags + wxT(">") + m_innerCell->ListToXML() + wxT("</cj>");
+  out += wxT("<cj") + flags + wxT(">");
+  m_innerCell->ListWriteXML(out);
+  out += wxT("</cj>");
 }
 
 bool ConjugateCell::BreakUp()
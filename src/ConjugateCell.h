@@ -76,13 +76,19 @@ protected:
 
   wxString ToString();
 
+  void WriteString(wxString &out);
+
   wxString ToTeX();
 
+  void WriteTeX(wxString &out);
+
   wxString ToMathML();
 
   wxString ToOMML();
 
   wxString ToXML();
+
+  void WriteXML(wxString &out);
 };
 
 #endif // CONJUGATECELL_H
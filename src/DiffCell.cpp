@@ -125,16 +125,22 @@ void DiffCell::Draw(wxPoint point, int fontsize)
 }
 
 wxString DiffCell::ToString()
+{
+  wxString s;
+  WriteString(s);
+  return s;
+}
+
+void DiffCell::WriteString(wxString &out)
 {
   if (m_isBroken)
-    return wxEmptyString;
+    return;
   MathCell *tmp = m_baseCell->m_next;
-  wxString s = wxT("'diff(");
+  out += wxT("'diff(");
   if (tmp != NULL)
-    s += tmp->ListToString();
-  s += m_diffCell->ListToString();
-  s += wxT(")");
-  return s;
+    tmp->ListWriteString(out);
+  m_diffCell->ListWriteString(out);
+  out += wxT(")");
 }
 
 wxString DiffCell::ToTeX()
@@ -180,10 +186,20 @@ wxString DiffCell::ToOMML()
 }
 
 wxString DiffCell::ToXML()
+{
+  wxString s;
+  WriteXML(s);
+  return s;
+}
+
+void DiffCell::WriteXML(wxString &out)
 {
   wxString flags;
   if (m_forceBreakLine)
     flags += wxT(" breakline=\"true\"");
 
-  return wxT("<d") + flags + wxT(">") + m_diffCell->ListToXML() + m_baseCell->ListToXML() + _T("</d>");
+  out += wxT("<d") + flags + wxT(">");
+  m_diffCell->ListWriteXML(out);
+  m_baseCell->ListWriteXML(out);
+  out += _T("</d>");
 }
@@ -0,0 +1,167 @@
+﻿// -*- mode: c++; c-file-style: "linux"; c-basic-offset: 2; indent-tabs-mode: nil -*-
+//
+//  Copyright (C) 2017 Gunter Königsmann <wxMaxima@physikbuch.de>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+
+/*! \file
+  This file defines the class DirectoryIndex
+
+  DirectoryIndex caches the contents of directories.
+ */
+
+#include "DirectoryIndex.h"
+#include <wx/filename.h>
+#include <wx/filefn.h>
+#include <wx/datetime.h>
+
+DirectoryIndex::DirectoryIndex()
+{
+  m_entries = 0;
+}
+
+wxString DirectoryIndex::Normalize(wxString dir)
+{
+  dir.Replace(wxFileName::GetPathSeparator(), wxT("/"));
+  while ((dir.Length() > 1) && dir.EndsWith(wxT("/")) && !dir.EndsWith(wxT(":/")))
+    dir.RemoveLast();
+  return dir;
+}
+
+bool DirectoryIndex::GetListing(const wxString &dir, Listing &listing)
+{
+  // Directories can vanish or be unreadable: That's no reason to pop up an
+  // error message.
+  wxLogNull suppressErrorDialogs;
+
+  if (!wxDirExists(dir))
+    return false;
+  time_t modified = wxFileModificationTime(dir);
+  if (modified == (time_t) -1)
+    return false;
+
+  {
+    wxCriticalSectionLocker lock(m_lock);
+    std::map<wxString, Listing>::const_iterator it = m_listings.find(dir);
+    // The modification time only has a resolution of a second: If the
+    // directory was modified in the second we listed it we cannot know if
+    // that happened before or after listing it.
+    if ((it != m_listings.end()) && (it->second.modified == modified) &&
+        (modified < it->second.listedAt))
+    {
+      listing = it->second;
+      return true;
+    }
+  }
+
+  listing.modified = modified;
+  listing.listedAt = wxDateTime::GetTimeNow();
+  listing.files.Clear();
+  listing.dirs.Clear();
+
+  wxDir directory(dir);
+  if (!directory.IsOpened())
+    return false;
+  wxString name;
+  bool more = directory.GetFirst(&name, wxEmptyString, wxDIR_FILES | wxDIR_HIDDEN);
+  while (more)
+  {
+    listing.files.Add(name);
+    more = directory.GetNext(&name);
+  }
+  more = directory.GetFirst(&name, wxEmptyString, wxDIR_DIRS | wxDIR_HIDDEN);
+  while (more)
+  {
+    listing.dirs.Add(name);
+    more = directory.GetNext(&name);
+  }
+
+  Store(dir, listing);
+  return true;
+}
+
+void DirectoryIndex::Store(const wxString &dir, const Listing &listing)
+{
+  wxCriticalSectionLocker lock(m_lock);
+  std::map<wxString, Listing>::iterator it = m_listings.find(dir);
+  if (it != m_listings.end())
+  {
+    m_entries -= it->second.files.GetCount() + it->second.dirs.GetCount();
+    m_listings.erase(it);
+  }
+
+  // Traversing maxima's share directory lists hundreds of directories: Evict
+  // the oldest listings until the new one fits. A single listing that alone
+  // exceeds the limit is kept anyway, since it is the one we need right now.
+  size_t size = listing.files.GetCount() + listing.dirs.GetCount();
+  while ((!m_listings.empty()) && (m_entries + size > m_maxEntries))
+  {
+    std::map<wxString, Listing>::iterator oldest = m_listings.begin();
+    for (it = m_listings.begin(); it != m_listings.end(); ++it)
+      if (it->second.listedAt < oldest->second.listedAt)
+        oldest = it;
+    m_entries -= oldest->second.files.GetCount() + oldest->second.dirs.GetCount();
+    m_listings.erase(oldest);
+  }
+
+  m_listings[dir] = listing;
+  m_entries += size;
+}
+
+void DirectoryIndex::Update(const wxString &dir)
+{
+  Listing listing;
+  GetListing(Normalize(dir), listing);
+}
+
+bool DirectoryIndex::Traverse(const wxString &dir, wxDirTraverser &traverser)
+{
+  wxString path = Normalize(dir);
+  if (!wxDirExists(path))
+    return false;
+  DoTraverse(path, traverser);
+  return true;
+}
+
+wxDirTraverseResult DirectoryIndex::DoTraverse(const wxString &dir, wxDirTraverser &traverser)
+{
+  Listing listing;
+  if (!GetListing(dir, listing))
+    return wxDIR_CONTINUE;
+
+  wxString prefix = dir;
+  if (!prefix.EndsWith(wxT("/")))
+    prefix += wxT("/");
+
+  // Like wxDir::Traverse() we first handle the subdirectories, then the files.
+  for (size_t i = 0; i < listing.dirs.GetCount(); i++)
+  {
+    wxString subdir = prefix + listing.dirs[i];
+    wxDirTraverseResult result = traverser.OnDir(subdir);
+    if (result == wxDIR_STOP)
+      return wxDIR_STOP;
+    if ((result == wxDIR_CONTINUE) && (DoTraverse(subdir, traverser) == wxDIR_STOP))
+      return wxDIR_STOP;
+  }
+
+  for (size_t i = 0; i < listing.files.GetCount(); i++)
+  {
+    if (traverser.OnFile(prefix + listing.files[i]) == wxDIR_STOP)
+      return wxDIR_STOP;
+  }
+  return wxDIR_CONTINUE;
+}
@@ -0,0 +1,102 @@
+﻿// -*- mode: c++; c-file-style: "linux"; c-basic-offset: 2; indent-tabs-mode: nil -*-
+//
+//  Copyright (C) 2017 Gunter Königsmann <wxMaxima@physikbuch.de>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+
+/*! \file
+  This file declares the class DirectoryIndex
+
+  DirectoryIndex caches the contents of directories.
+ */
+
+#ifndef DIRECTORYINDEX_H
+#define DIRECTORYINDEX_H
+
+#include <wx/wx.h>
+#include <wx/string.h>
+#include <wx/arrstr.h>
+#include <wx/dir.h>
+#include <wx/thread.h>
+#include <map>
+
+/*! A cache of the contents of directories
+
+  Autocompleting file names needs the list of the files in a directory on
+  every key press, and on network drives or in maxima's share directory
+  listing them can take seconds. DirectoryIndex lists a directory only if
+  its modification time has changed since it was listed last time, which
+  needs only one stat() call.
+
+  The cache holds at most m_maxEntries file and directory names: Beyond that
+  the directories that were listed longest ago are forgotten and, if needed
+  again, listed anew.
+
+  All methods can be called from several threads at once.
+ */
+class DirectoryIndex
+{
+public:
+  DirectoryIndex();
+
+  /*! Call traverser's OnDir() and OnFile() for the contents of dir
+
+    Works like wxDir::Traverse(): If OnDir() returns wxDIR_CONTINUE the
+    subdirectory is traversed, too.
+    \return false, if dir couldn't be read.
+   */
+  bool Traverse(const wxString &dir, wxDirTraverser &traverser);
+
+  //! Make sure the cached contents of dir are up to date
+  void Update(const wxString &dir);
+
+private:
+  //! The contents of a directory
+  struct Listing
+  {
+    //! The modification time of the directory when it was listed
+    time_t modified;
+    //! The time the directory was listed at
+    time_t listedAt;
+    wxArrayString files;
+    wxArrayString dirs;
+  };
+
+  /*! Get the contents of dir, from the cache if it hasn't changed since
+
+    \return false, if dir couldn't be read.
+   */
+  bool GetListing(const wxString &dir, Listing &listing);
+
+  //! The part of Traverse() that calls itself for subdirectories
+  wxDirTraverseResult DoTraverse(const wxString &dir, wxDirTraverser &traverser);
+
+  //! Brings directory names into the form we use as keys for m_listings
+  static wxString Normalize(wxString dir);
+
+  //! Adds listing to m_listings and drops old listings if the cache gets too big
+  void Store(const wxString &dir, const Listing &listing);
+
+  //! The maximum number of file and directory names m_listings may hold
+  static const size_t m_maxEntries = 100000;
+  std::map<wxString, Listing> m_listings;
+  //! The number of file and directory names in m_listings
+  size_t m_entries;
+  wxCriticalSection m_lock;
+};
+
+#endif // DIRECTORYINDEX_H
@@ -80,9 +80,15 @@ public:
 
 #endif
 
-  //! The path to wxMaxima's own AutoComplete file
-  wxString AutocompleteFile()
-  { return DataDir() + wxT("/autocomplete.txt"); }
+  //! The file the location and the keyword index of maxima's manual is cached in
+#if defined __WXMSW__
+  wxString HelpIndexCacheFile() {return UserConfDir()+wxT("wxmax.hlp");}
+#else
+
+  wxString HelpIndexCacheFile()
+  { return UserConfDir() + wxT(".wxmaxima.helpindex"); }
+
+#endif
 
   //! The directory art is stored relative to
   wxString ArtDir();
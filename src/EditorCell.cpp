@@ -33,6 +33,7 @@
 #include "wxMaxima.h"
 #include "wxMaximaFrame.h"
 #include <wx/tokenzr.h>
+#include <algorithm>
 
 #define ESC_CHAR wxT('\xA6')
 
@@ -55,6 +56,8 @@ EditorCell::EditorCell(MathCell *parent, Configuration **config,
   m_lastSelectionStart = -1;
   m_displayCaret = false;
   m_text = wxEmptyString;
+  m_textRevision = 1;
+  m_searchIndexRevision = 0;
   m_fontSize = -1;
   m_fontSize_Last = -1;
   m_positionOfCaret = 0;
@@ -62,6 +65,9 @@ EditorCell::EditorCell(MathCell *parent, Configuration **config,
   m_selectionStart = -1;
   m_selectionEnd = -1;
   m_paren1 = m_paren2 = -1;
+  m_parenthesisStateRevision = 0;
+  m_parenthesisStateLisp = false;
+  m_parenthesisStateIndex = 0;
   m_isDirty = false;
   m_hasFocus = false;
   m_underlined = false;
@@ -77,6 +83,19 @@ EditorCell::EditorCell(MathCell *parent, Configuration **config,
   ResetSize();
 }
 
+size_t EditorCell::SizeInMemory()
+{
+  size_t size = sizeof(EditorCell) + ColdDataSize() +
+    (m_text.Length() + m_searchText.Length() + m_searchTextLower.Length()) *
+    sizeof(wxChar) +
+    m_searchTrigrams.size() * sizeof(wxUint32);
+  for (size_t i = 0; i < m_textHistory.GetCount(); i++)
+    size += m_textHistory[i].Length() * sizeof(wxChar);
+  for (std::vector<StyledText>::iterator it = m_styledText.begin(); it != m_styledText.end(); ++it)
+    size += sizeof(StyledText) + it->GetText().Length() * sizeof(wxChar);
+  return size;
+}
+
 wxString EditorCell::EscapeHTMLChars(wxString input)
 {
   input.Replace(wxT("&"), wxT("&amp;"));
@@ -1069,13 +1088,14 @@ void EditorCell::ProcessEvent(wxKeyEvent &event)
   if (!done)
     HandleOrdinaryKey(event);
 
-  if (m_type == MC_TYPE_INPUT)
-    FindMatchingParens();
-
   if (m_isDirty)
   {
+    m_textRevision++;
     m_width = m_maxDrop = -1;
   }
+
+  if (m_type == MC_TYPE_INPUT)
+    FindMatchingParens();
   m_displayCaret = true;
 }
 
@@ -1885,6 +1905,7 @@ bool EditorCell::HandleSpecialKey(wxKeyEvent &event)
               m_text = m_text.SubString(0, start - 1) +
                        m_text.SubString(end, m_text.Length());
               ClearSelection();
+              m_isDirty = true;
             }
             m_positionOfCaret = start;
             StyleText();
@@ -1908,6 +1929,7 @@ bool EditorCell::HandleSpecialKey(wxKeyEvent &event)
                        ins +
                        m_text.SubString(m_positionOfCaret, m_text.Length());
               m_positionOfCaret += ins.Length();
+              m_isDirty = true;
             }
             else
             {
@@ -1918,6 +1940,7 @@ bool EditorCell::HandleSpecialKey(wxKeyEvent &event)
                 m_text =
                         m_text.SubString(0, start - 1) +
                         m_text.SubString(start + 4, m_text.Length());
+                m_isDirty = true;
                 if (m_positionOfCaret > start)
                 {
                   m_positionOfCaret = start;
@@ -2215,145 +2238,316 @@ bool EditorCell::HandleOrdinaryKey(wxKeyEvent &event)
   return true;
 }
 
-/**
- * For a given quotation mark ("), find a matching quote.
- * Since there are no nested quotes, an odd-numbered, non-escaped quote
- * is an opening quote, and an even-numbered non-escaped quote
- * is a closing quote.
- *
- * @return true if matching quotation marks were found; false otherwise
- */
-bool EditorCell::FindMatchingQuotes()
+wxString EditorCell::AnalyzeParenthesis(const wxString &text, bool lisp, int &index,
+                                        std::vector<int> *matches,
+                                        std::vector<long> *statementEnds)
 {
-  int pos = m_positionOfCaret;
-  if (pos < 0)
-  {
-    m_paren1 = m_paren2 = -1;
-    return false;
-  }
+  wxString error;
+  int errorIndex = 0;
+  index = 0;
+
+  if (matches != NULL)
+    matches->assign(text.Length(), -1);
 
-  if(pos >= (long)m_text.Length())
-    pos = m_text.Length()-1;
-  if ((pos >= (long) m_text.Length() - 1)||
-      (wxString(wxT("\"")).Find(m_text.GetChar(pos)) == -1))
+  if (text.Right(1) == wxT("\\"))
   {
-    pos--;
-    if (pos < 0 ||
-        wxString(wxT("\"")).Find(m_text.GetChar(pos)) == -1)
-    {
-      m_paren1 = m_paren2 = -1;
-      return false;
-    }
+    error = _("Cell ends in a backslash");
+    errorIndex = text.Length() - 1;
   }
 
-  int count = 0;
-  for (int i = 0; i < (int) m_text.Length(); ++i)
+  // The closing brackets we expect and the position of the opening ones
+  std::vector<wxChar> delimiters;
+  std::vector<int> delimiterPositions;
+
+  wxChar lastC = wxT(';');
+  wxChar lastnonWhitespace = wxT(',');
+
+  wxString::const_iterator it = text.begin();
+  while (it != text.end())
   {
-    if (m_text.GetChar(i) == '"' &&
-        ((i == 0) ||
-         (i >= 1 && m_text.GetChar(i - 1) != '\\')))
+    wxChar c = *it;
+
+    switch (c)
     {
-      ++count;
-      if (count & 1)
+      // Opening parenthesis
+    case wxT('('):
+      delimiters.push_back(wxT(')'));
+      delimiterPositions.push_back(index);
+      lastC = c;
+      break;
+    case wxT('['):
+      delimiters.push_back(wxT(']'));
+      delimiterPositions.push_back(index);
+      lastC = c;
+      break;
+    case wxT('{'):
+      delimiters.push_back(wxT('}'));
+      delimiterPositions.push_back(index);
+      lastC = c;
+      break;
+
+      // Closing parenthesis
+    case wxT(')'):
+    case wxT(']'):
+    case wxT('}'):
+      if ((delimiters.empty()) || (c != delimiters.back()))
       {
-        m_paren1 = i;  // open quote here
+        if (error == wxEmptyString)
+        {
+          error = _("Mismatched parenthesis");
+          errorIndex = index;
+        }
       }
       else
       {
-        m_paren2 = i;  // close quote here
-        if (m_paren1 == pos || m_paren2 == pos)
+        if (matches != NULL)
+        {
+          (*matches)[index] = delimiterPositions.back();
+          (*matches)[delimiterPositions.back()] = index;
+        }
+        delimiters.pop_back();
+        delimiterPositions.pop_back();
+      }
+      lastC = c;
+      if ((lastnonWhitespace == wxT(',')) && (error == wxEmptyString))
+      {
+        error = _("Comma directly followed by a closing parenthesis");
+        errorIndex = index;
+      }
+      break;
+
+      // Escaped characters
+    case wxT('\\'):
+      if (it + 1 != text.end())
+      {++it;++index;}
+      lastC = c;
+      break;
+
+      // Strings
+    case wxT('\"'):
+    {
+      int stringStart = index;
+      ++it;++index;
+      while ((it != text.end()) && (*it != wxT('\"')))
+      {
+        if ((*it == wxT('\\')) && (it + 1 != text.end()))
+        {++it;++index;}
+        ++it;++index;
+      }
+      if (it == text.end())
+      {
+        if (error == wxEmptyString)
         {
-          // found the pair of quotes under the cursor
-          return true;
+          error = _("Unterminated string.");
+          errorIndex = stringStart;
         }
+        // The outer loop has reached the end of the text.
+        --it;--index;
+      }
+      else if (matches != NULL)
+      {
+        (*matches)[stringStart] = index;
+        (*matches)[index] = stringStart;
       }
+      lastC = c;
+      break;
     }
-  }
 
-  // didn't find matching quotes; do not highlight quotes
-  m_paren1 = m_paren2 = -1;
-  return false;
-}
+    // a to_lisp command
+    case wxT('t'):
+    {
+      // Extract 7 chars of the string.
+      wxString command;
+      wxString::const_iterator it2(it);
+      if(it2 != text.end())
+      {
+        command += wxString(*it2);
+        ++it2;
+      }
+      while((it2 != text.end()) && (wxIsalpha(*it2)))
+      {
+        command += wxString(*it2);
+        ++it2;
+      }
+      if(command.StartsWith(wxT("to_lisp")))
+         lisp = true;
+      lastC = c;
+      break;
+    }
 
-void EditorCell::FindMatchingParens()
-{
-  if (FindMatchingQuotes())
-  {
-    return;
+    // An eventual :lisp command
+    case wxT(':'):
+    {
+      // Extract 5 chars of the string.
+      wxString command;
+      wxString::const_iterator it2(it);
+      if(it2 != text.end())
+      {
+        command += wxString(*it2);
+        ++it2;
+      }
+      while((it2 != text.end()) && (wxIsalpha(*it2)))
+      {
+        command += wxString(*it2);
+        ++it2;
+      }
+
+      // Let's see if this is a :lisp-quiet or a :lisp
+      if ((command == wxT(":lisp")) || (command == wxT(":lisp-quiet")))
+        lisp = true;
+      lastC = c;
+      break;
+    }
+    case wxT(';'):
+    case wxT('$'):
+      if ((!lisp) && (!delimiters.empty()) && (error == wxEmptyString))
+      {
+        error = _("Un-closed parenthesis on encountering ; or $");
+        errorIndex = index;
+      }
+      if ((statementEnds != NULL) && (!lisp) && (delimiters.empty()))
+        statementEnds->push_back(index);
+      lastC = c;
+      break;
+
+      // Comments
+    case wxT('/'):
+      if ((it + 1 != text.end()) && (*(it + 1) == wxT('*')))
+      {
+        // Comment start. Let's search for the comment end.
+        int commentStart = index;
+        ++it;++index;
+        while (it != text.end())
+        {
+          wxChar last = *it;
+          ++it;++index;
+
+          // We reached the end of the string without finding a comment end.
+          if (it == text.end())
+          {
+            if (error == wxEmptyString)
+            {
+              error = _("Unterminated comment.");
+              errorIndex = commentStart;
+            }
+            --it;--index;
+            break;
+          }
+
+          // A comment end.
+          if ((last == wxT('*')) && (*it == wxT('/')))
+            break;
+        }
+      }
+      else
+        lastC = c;
+      break;
+
+    default:
+      if ((c != wxT('\n')) && (c != wxT(' ')) && (c != wxT('\t')) &&
+          (c != wxT('\r')) && (c != wxT('\xa0')))
+        lastC = c;
+    }
+
+    if (
+      (c != wxT(' ')) &&
+      (c != wxT('\t')) &&
+      (c != wxT('\n')) &&
+      (c != wxT('\r')) &&
+      (c != wxT('\xa0'))
+      )
+      lastnonWhitespace = c;
+
+    ++it;++index;
   }
 
-  m_paren2 = m_positionOfCaret;
-  if (m_paren2 < 0)
+  if (error != wxEmptyString)
   {
-    m_paren1 = m_paren2 = -1;
-    return;
+    index = errorIndex;
+    return error;
   }
 
-  if(m_paren2 >= (long)m_text.Length())
-    m_paren2 = m_text.Length() - 1;
-  if ((m_paren2 >= (long) m_text.Length() - 1)||
-      (wxString(wxT("([{}])")).Find(m_text.GetChar(m_paren2)) == -1))
+  if (!delimiters.empty())
+    return _("Un-closed parenthesis");
+
+  if (!lisp)
   {
-    m_paren2--;
-    if (m_paren2 < 0 ||
-        wxString(wxT("([{}])")).Find(m_text.GetChar(m_paren2)) == -1)
+    bool endingNeeded = true;
+
+    // Cells ending in ";" or in "$" don't require us to add an ending.
+    if ((lastC == wxT(';')) || (lastC == wxT('$')))
+      endingNeeded = false;
+
+    // Cells ending in "(to-maxima)" (with optional spaces around the "to-maxima")
+    // don't require us to add an ending, neither.
+    wxString trimmed = text;
+    trimmed.Replace(wxT("\xa0"), wxT(" "));
+    trimmed.Trim(true);
+    trimmed.Trim(false);
+    if (trimmed.EndsWith(wxT(")")))
     {
-      m_paren1 = m_paren2 = -1;
-      return;
+      trimmed = trimmed.SubString(0, trimmed.Length() - 2);
+      trimmed.Trim();
+      if (trimmed.EndsWith(wxT("to-maxima")))
+        endingNeeded = false;
     }
+
+    if (endingNeeded)
+      return _("No dollar ($) or semicolon (;) at the end of command");
   }
+  return wxEmptyString;
+}
 
-  wxChar first = m_text.GetChar(m_paren2);
-  wxChar second;
-  int dir;
+void EditorCell::UpdateParenthesisState(bool lisp)
+{
+  if ((m_parenthesisStateRevision == m_textRevision) && (m_parenthesisStateLisp == lisp))
+    return;
 
-  switch (first)
-  {
-    case '(':
-      second = ')';
-      dir = 1;
-      break;
-    case '[':
-      second = ']';
-      dir = 1;
-      break;
-    case '{':
-      second = '}';
-      dir = 1;
-      break;
-    case ')':
-      second = '(';
-      dir = -1;
-      break;
-    case ']':
-      second = '[';
-      dir = -1;
-      break;
-    case '}':
-      second = '{';
-      dir = -1;
-      break;
-    default:
-      return;
-  }
+  m_parenthesisStateRevision = m_textRevision;
+  m_parenthesisStateLisp = lisp;
+  m_parenthesisState = AnalyzeParenthesis(m_text, lisp, m_parenthesisStateIndex,
+                                          &m_matchingParens);
+}
 
-  m_paren1 = m_paren2 + dir;
-  int depth = 1;
+wxString EditorCell::GetUnmatchedParenthesisState(bool lisp, int &index)
+{
+  UpdateParenthesisState(lisp);
+  index = m_parenthesisStateIndex;
+  return m_parenthesisState;
+}
 
-  while (m_paren1 >= 0 && m_paren1 < (int) m_text.Length())
-  {
-    if (m_text.GetChar(m_paren1) == second)
-      depth--;
-    else if (m_text.GetChar(m_paren1) == first)
-      depth++;
+int EditorCell::GetMatchingParenthesis(long pos)
+{
+  UpdateParenthesisState((m_parenthesisStateRevision == m_textRevision) && m_parenthesisStateLisp);
+  if ((pos < 0) || (pos >= (long) m_matchingParens.size()))
+    return -1;
+  return m_matchingParens[pos];
+}
 
-    if (depth == 0)
-      break;
-    m_paren1 += dir;
+void EditorCell::FindMatchingParens()
+{
+  m_paren1 = m_paren2 = -1;
+
+  long pos = m_positionOfCaret;
+  long length = m_text.Length();
+  if ((pos < 0) || (length == 0))
+    return;
+
+  // Prefer the char right of the cursor and fall back to the one left of it.
+  if (pos >= length)
+    pos = length - 1;
+  if ((pos >= length - 1) || (wxString(wxT("([{}])\"")).Find(m_text.GetChar(pos)) == -1))
+  {
+    pos--;
+    if ((pos < 0) || (wxString(wxT("([{}])\"")).Find(m_text.GetChar(pos)) == -1))
+      return;
   }
 
-  if (m_paren1 < 0 || m_paren1 >= (int) m_text.Length())
-    m_paren1 = m_paren2 = -1;
+  int match = GetMatchingParenthesis(pos);
+  if (match < 0)
+    return;
+  m_paren1 = match;
+  m_paren2 = pos;
 }
 
 #if wxUSE_UNICODE
@@ -2700,6 +2894,7 @@ bool EditorCell::AddEnding()
   if(endingNeeded)
   {
     m_text += wxT(";");
+    m_textRevision++;
     m_paren1 = m_paren2 = m_width = -1;
     StyleText();
     return true;
@@ -3196,6 +3391,7 @@ bool EditorCell::CutToClipboard()
   // We cannot use SetValue() here, since SetValue() tends to move the cursor.
   m_text = m_text.SubString(0, start - 1) +
            m_text.SubString(end, m_text.Length());
+  m_textRevision++;
   StyleText();
 
   ClearSelection();
@@ -3329,6 +3525,7 @@ void EditorCell::Undo()
 
   // We cannot use SetValue() here, since SetValue() tends to move the cursor.
   m_text = m_textHistory.Item(m_historyPosition);
+  m_textRevision++;
   StyleText();
 
   m_positionOfCaret = m_positionHistory[m_historyPosition];
@@ -3359,6 +3556,7 @@ void EditorCell::Redo()
 
   // We cannot use SetValue() here, since SetValue() tends to move the cursor.
   m_text = m_textHistory.Item(m_historyPosition);
+  m_textRevision++;
   StyleText();
 
   m_positionOfCaret = m_positionHistory[m_historyPosition];
@@ -4299,6 +4497,7 @@ void EditorCell::SetValue(const wxString &text)
   if(m_positionOfCaret < 0)
     m_positionOfCaret = 0;
   
+  m_textRevision++;
   FindMatchingParens();
   m_containsChanges = true;
 
@@ -4324,7 +4523,11 @@ int EditorCell::ReplaceAll(wxString oldString, wxString newString, bool IgnoreCa
 {
   if (oldString == wxEmptyString)
     return 0;
-  
+
+  UpdateSearchIndex();
+  if (!MightContain(oldString))
+    return 0;
+
   SaveValue();
   wxString newText;
   int count = 0;
@@ -4359,6 +4562,7 @@ int EditorCell::ReplaceAll(wxString oldString, wxString newString, bool IgnoreCa
   if (count > 0)
   {
     m_text = newText;
+    m_textRevision++;
     m_containsChanges = true;
     ClearSelection();
     StyleText();
@@ -4371,18 +4575,98 @@ int EditorCell::ReplaceAll(wxString oldString, wxString newString, bool IgnoreCa
   return count;
 }
 
+bool EditorCell::UpdateSearchIndex()
+{
+  if (m_searchIndexRevision == m_textRevision)
+    return false;
+
+  m_searchIndexRevision = m_textRevision;
+  m_searchText = m_text;
+  m_searchText.Replace(wxT('\r'), wxT(' '));
+  m_searchTextLower = m_searchText;
+  m_searchTextLower.MakeLower();
+
+  m_searchTrigrams.clear();
+  if (m_searchTextLower.Length() >= 3)
+  {
+    m_searchTrigrams.reserve(m_searchTextLower.Length() - 2);
+    wxString::const_iterator it = m_searchTextLower.begin();
+    wxChar a = *it++;
+    wxChar b = *it++;
+    while (it != m_searchTextLower.end())
+    {
+      wxChar c = *it++;
+      m_searchTrigrams.push_back(TrigramHash(a, b, c));
+      a = b;
+      b = c;
+    }
+    std::sort(m_searchTrigrams.begin(), m_searchTrigrams.end());
+    m_searchTrigrams.erase(std::unique(m_searchTrigrams.begin(), m_searchTrigrams.end()),
+                           m_searchTrigrams.end());
+  }
+  return true;
+}
+
+bool EditorCell::MightContain(wxString str)
+{
+  if (str.Length() > m_searchText.Length())
+    return false;
+
+  // Strings this short aren't worth consulting the index for
+  if (str.Length() < 3)
+    return true;
+
+  // The index is built from the lowercase text: Every trigram a match contains
+  // must be in there, no matter if the search is case-sensitive or not.
+  str.MakeLower();
+  wxString::const_iterator it = str.begin();
+  wxChar a = *it++;
+  wxChar b = *it++;
+  while (it != str.end())
+  {
+    wxChar c = *it++;
+    if (!std::binary_search(m_searchTrigrams.begin(), m_searchTrigrams.end(), TrigramHash(a, b, c)))
+      return false;
+    a = b;
+    b = c;
+  }
+  return true;
+}
+
+long EditorCell::FindAll(wxString str, bool ignoreCase)
+{
+  if (str == wxEmptyString)
+    return 0;
+
+  UpdateSearchIndex();
+  if (!MightContain(str))
+    return 0;
+
+  if (ignoreCase)
+    str.MakeLower();
+  const wxString &text = ignoreCase ? m_searchTextLower : m_searchText;
+
+  long count = 0;
+  size_t pos = text.find(str);
+  while (pos != wxString::npos)
+  {
+    count++;
+    pos = text.find(str, pos + str.Length());
+  }
+  return count;
+}
+
 bool EditorCell::FindNext(wxString str, bool down, bool ignoreCase)
 {
   int start = down ? 0 : m_text.Length();
-  wxString text(m_text);
 
-  text.Replace(wxT('\r'), wxT(' '));
+  UpdateSearchIndex();
+  if (!MightContain(str))
+    return false;
 
   if (ignoreCase)
-  {
     str.MakeLower();
-    text.MakeLower();
-  }
+  const wxString &text = ignoreCase ? m_searchTextLower : m_searchText;
 
   if (m_selectionStart >= 0)
   {
@@ -4446,6 +4730,7 @@ bool EditorCell::ReplaceSelection(wxString oldStr, wxString newStr, bool keepSel
     m_text = text_left+
              newStr +
              text_right;
+    m_textRevision++;
     StyleText();
 
     m_containsChanges = true;
@@ -72,6 +72,39 @@ private:
   //! The font size the linewrap was done for.
   int m_oldDefaultFontSize;
 
+  /*! Is incremented every time m_text might have been changed
+
+    Allows the search index and the bracket structure to find out if they are
+    outdated without comparing the whole text. StyleText() doesn't increment it:
+    It only re-does the soft line breaks and list bullets, which doesn't change
+    what a search or the bracket structure sees.
+  */
+  unsigned long m_textRevision;
+  //! The m_textRevision the search index was built for
+  unsigned long m_searchIndexRevision;
+  //! m_text without soft line breaks
+  wxString m_searchText;
+  //! A lowercase version of m_searchText for case-insensitive searches
+  wxString m_searchTextLower;
+  //! The sorted hashes of all trigrams in m_searchTextLower
+  std::vector<wxUint32> m_searchTrigrams;
+  //! The m_textRevision the bracket structure was determined for
+  unsigned long m_parenthesisStateRevision;
+  //! Was the bracket structure determined for lisp mode?
+  bool m_parenthesisStateLisp;
+  //! The first syntax error AnalyzeParenthesis() has found
+  wxString m_parenthesisState;
+  //! The position of the error in m_parenthesisState
+  int m_parenthesisStateIndex;
+  //! For each char: The position of the matching bracket or quote or -1.
+  std::vector<int> m_matchingParens;
+  //! Brings the bracket structure of this cell up-to-date.
+  void UpdateParenthesisState(bool lisp);
+
+  //! Calculates the hash of a trigram for m_searchTrigrams
+  static wxUint32 TrigramHash(wxChar a, wxChar b, wxChar c)
+  { return ((wxUint32) a * 31 + (wxUint32) b) * 31 + (wxUint32) c; }
+
   int ChangeNumpadToChar(int c);
 
   //! A list of all potential autoComplete targets within this cell
@@ -212,6 +245,8 @@ public:
 
   MathCell *Copy();
 
+  size_t SizeInMemory();
+
   //! Recalculate the widths of the current cell.
   void RecalculateWidths(int fontsize);
 
@@ -367,10 +402,41 @@ public:
     return m_selectionStart != -1;
   }
 
-  bool FindMatchingQuotes();
+  /*! Highlights the bracket or quote that matches the one at the cursor
 
+    Uses the bracket structure UpdateParenthesisState() has determined.
+   */
   void FindMatchingParens();
 
+  /*! Analyzes the bracket, string and comment structure of a piece of maxima code
+
+    \param text The code to analyze
+    \param lisp true = the code is sent while maxima is in lisp mode
+    \param index Is set to the position an error was found at
+    \param matches If not NULL this vector is filled with the position of the
+           matching bracket or quote for each char of text (-1 = none)
+    \param statementEnds If not NULL the positions of all ";" and "$" that end
+           a command are appended to this vector. In lisp mode there are none.
+    \return A description of the first error or wxEmptyString if the code is OK
+   */
+  static wxString AnalyzeParenthesis(const wxString &text, bool lisp, int &index,
+                                     std::vector<int> *matches = NULL,
+                                     std::vector<long> *statementEnds = NULL);
+
+  /*! Has the cell unmatched parenthesis, unterminated strings or similar?
+
+    The result is cached until the cell's text changes, which allows
+    the code that sends commands to maxima to ask this question for every
+    command without re-scanning the cell.
+    \param lisp true = maxima is in lisp mode
+    \param index Is set to the position the error was found at
+    \return A description of the error or wxEmptyString if the cell is OK
+   */
+  wxString GetUnmatchedParenthesisState(bool lisp, int &index);
+
+  //! The position of the bracket or quote matching the one at pos, or -1
+  int GetMatchingParenthesis(long pos);
+
   int GetLineWidth(wxDC *dc, unsigned int line, int end);
 
   //! true, if this cell's width has to be recalculated.
@@ -474,6 +540,33 @@ public:
    */
   bool FindNext(wxString str, bool down, bool ignoreCase);
 
+  /*! Finds all occurrences of a string
+
+    \param str The string to search for
+    \param ignoreCase
+     - true: Case-insensitive search
+     - false: Case-sensitive search
+    \return The number of occurrences
+   */
+  long FindAll(wxString str, bool ignoreCase);
+
+  /*! Brings the search index of this cell up-to-date
+
+    The search index consists of the text with all soft line breaks removed,
+    a lowercase copy of it and a sorted list of the hashes of all trigrams
+    the lowercase text contains.
+    \return true, if the index had to be rebuilt.
+   */
+  bool UpdateSearchIndex();
+
+  /*! Might this cell contain the string str?
+
+    Uses the trigram index to rule out cells that cannot contain str without
+    searching their text. A false result is definitive, a true one only means
+    the text still has to be searched.
+   */
+  bool MightContain(wxString str);
+
   void SetSelection(int start, int end);
 
   void GetSelection(int *start, int *end)
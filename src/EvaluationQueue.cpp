@@ -28,6 +28,182 @@
 
 #include "EvaluationQueue.h"
 
+/*! Functions that are known never to make maxima ask the user a question
+
+  Any function that isn't in this list might ask a question: User-defined
+  functions, for example, might call asksign() or integrate(). Keywords that
+  are followed by a parenthesis are listed here, too. Their arguments are
+  checked like every other part of the command.
+*/
+static const wxChar *questionlessFunctions[] =
+{
+  wxT("abs"), wxT("acos"), wxT("acosh"), wxT("and"), wxT("append"), wxT("asin"),
+  wxT("asinh"), wxT("assume"), wxT("atan"), wxT("atan2"), wxT("atanh"), wxT("atom"),
+  wxT("bfloat"), wxT("block"), wxT("ceiling"), wxT("coeff"), wxT("concat"), wxT("cons"),
+  wxT("cos"), wxT("cosh"), wxT("cot"), wxT("csc"), wxT("declare"), wxT("denom"),
+  wxT("diff"), wxT("disp"), wxT("display"), wxT("do"), wxT("else"), wxT("elseif"),
+  wxT("endcons"), wxT("exp"), wxT("expand"), wxT("factor"), wxT("first"), wxT("float"),
+  wxT("floor"), wxT("for"), wxT("forget"), wxT("fullratsimp"), wxT("hipow"),
+  wxT("ident"), wxT("if"), wxT("integerp"), wxT("kill"), wxT("last"), wxT("ldisp"),
+  wxT("length"), wxT("lhs"), wxT("listp"), wxT("log"), wxT("lopow"), wxT("makelist"),
+  wxT("matrix"), wxT("max"), wxT("min"), wxT("mod"), wxT("not"), wxT("num"),
+  wxT("numberp"), wxT("or"), wxT("part"), wxT("print"), wxT("rat"), wxT("ratexpand"),
+  wxT("ratsimp"), wxT("rest"), wxT("return"), wxT("reverse"), wxT("rhs"), wxT("round"),
+  wxT("sconcat"), wxT("sec"), wxT("second"), wxT("signum"), wxT("sin"), wxT("sinh"),
+  wxT("sqrt"), wxT("string"), wxT("subst"), wxT("tan"), wxT("tanh"), wxT("then"),
+  wxT("third"), wxT("transpose"), wxT("trigexpand"), wxT("trigreduce"), wxT("trigsimp"),
+  wxT("truncate"), wxT("unless"), wxT("while"), wxT("zeromatrix")
+};
+
+//! Can ch be part of a maxima identifier?
+static bool IsIdentifierChar(wxChar ch)
+{
+  return wxIsalnum(ch) || (ch == wxT('_')) || (ch == wxT('%'));
+}
+
+//! The position after the string that starts at pos
+static size_t SkipString(const wxString &command, size_t pos)
+{
+  for (++pos; pos < command.Length(); ++pos)
+  {
+    if (command[pos] == wxT('\\'))
+      ++pos;
+    else if (command[pos] == wxT('"'))
+      return pos + 1;
+  }
+  return command.Length();
+}
+
+//! The position after the bracket that closes the one at pos
+static size_t SkipBrackets(const wxString &command, size_t pos)
+{
+  int level = 0;
+  while (pos < command.Length())
+  {
+    wxChar ch = command[pos];
+    if (ch == wxT('"'))
+    {
+      pos = SkipString(command, pos);
+      continue;
+    }
+    if (ch == wxT('\\'))
+      ++pos;
+    else if ((ch == wxT('(')) || (ch == wxT('[')) || (ch == wxT('{')))
+      level++;
+    else if ((ch == wxT(')')) || (ch == wxT(']')) || (ch == wxT('}')))
+    {
+      if (--level == 0)
+        return pos + 1;
+    }
+    ++pos;
+  }
+  return pos;
+}
+
+//! The position of the first char at or after pos that isn't a whitespace
+static size_t SkipSpaces(const wxString &command, size_t pos)
+{
+  while ((pos < command.Length()) && wxIsspace(command[pos]))
+    ++pos;
+  return pos;
+}
+
+/*! Might command make maxima ask a question?
+
+  If maxima asks a question it reads the commands that have been sent after
+  this one as the answer => we only may send commands in advance if we are
+  sure that this doesn't happen. Therefore this function returns true for
+  every command it can't prove to be harmless:
+   - calls of functions that aren't in questionlessFunctions[],
+   - subscripted variables that aren't assigned to: They might be array functions,
+   - "''" and top-level commas that might evaluate noun forms like 'integrate().
+  Function definitions never ask since they don't evaluate their body.
+*/
+static bool MightAskQuestion(const wxString &command)
+{
+  size_t firstChar = SkipSpaces(command, 0);
+  int level = 0;
+  size_t pos = firstChar;
+  while (pos < command.Length())
+  {
+    wxChar ch = command[pos];
+    if (ch == wxT('"'))
+    {
+      pos = SkipString(command, pos);
+      continue;
+    }
+    if ((ch == wxT('(')) || (ch == wxT('[')) || (ch == wxT('{')))
+      level++;
+    if ((ch == wxT(')')) || (ch == wxT(']')) || (ch == wxT('}')))
+      level--;
+    if ((ch == wxT(',')) && (level == 0))
+      return true;
+    if ((ch == wxT('\'')) && (pos + 1 < command.Length()) && (command[pos + 1] == wxT('\'')))
+      return true;
+    if (wxIsdigit(ch))
+    {
+      // Numbers like 1.5e3 or 2b0
+      while ((pos < command.Length()) && (IsIdentifierChar(command[pos]) || (command[pos] == wxT('.'))))
+        ++pos;
+      continue;
+    }
+    if (!(IsIdentifierChar(ch) || (ch == wxT('\\'))))
+    {
+      ++pos;
+      continue;
+    }
+
+    size_t start = pos;
+    wxString name;
+    while ((pos < command.Length()) && (IsIdentifierChar(command[pos]) || (command[pos] == wxT('\\'))))
+    {
+      if ((command[pos] == wxT('\\')) && (pos + 1 < command.Length()))
+        name += command[pos++];
+      name += command[pos++];
+    }
+
+    size_t bracket = SkipSpaces(command, pos);
+    if ((bracket >= command.Length()) ||
+        ((command[bracket] != wxT('(')) && (command[bracket] != wxT('['))))
+      continue;
+
+    // Is this the head of a function definition or an assignment to an array element?
+    size_t after = SkipSpaces(command, SkipBrackets(command, bracket));
+    wxString op = command.Mid(after, 3);
+    if (op.StartsWith(wxT(":=")) || op.StartsWith(wxT("::=")))
+    {
+      // A definition that spans the whole command doesn't evaluate anything.
+      if (start == firstChar)
+        return false;
+      continue;
+    }
+    if (command[bracket] == wxT('['))
+    {
+      if (op.StartsWith(wxT(":")))
+        continue;
+      return true;
+    }
+
+    bool known = false;
+    for (size_t i = 0; i < sizeof(questionlessFunctions) / sizeof(questionlessFunctions[0]); i++)
+      if (name == questionlessFunctions[i])
+      {
+        known = true;
+        break;
+      }
+    if (!known)
+      return true;
+  }
+  return false;
+}
+
+EvaluationQueue::command::command(wxString string, int index)
+{
+  m_command = string;
+  m_indexStart = index;
+  m_mightAsk = MightAskQuestion(string);
+}
+
 bool EvaluationQueue::Empty()
 {
   return (m_queue.size() <= 1) && (m_commands.empty());
@@ -36,6 +212,7 @@ bool EvaluationQueue::Empty()
 EvaluationQueue::EvaluationQueue()
 {
   m_size = 0;
+  m_commandsSent = 0;
   m_workingGroupChanged = false;
 }
 
@@ -45,13 +222,19 @@ void EvaluationQueue::Clear()
     RemoveFirst();
   m_size = 0;
   m_commands.clear();
+  m_queue.clear();
   m_workingGroupChanged = false;
+
+  // Maxima will still answer the commands it already has received.
+  for(std::list<commandInFlight>::iterator it = m_commandsInFlight.begin(); it != m_commandsInFlight.end(); ++it)
+    it->m_cell = NULL;
+  m_commandsSent = 0;
 }
 
 bool EvaluationQueue::IsInQueue(GroupCell *gr)
 {
-  for(std::list<GroupCell *>::iterator it=m_queue.begin(); it != m_queue.end(); ++it)
-    if (*it == gr)
+  for(std::list<queuedCell>::iterator it=m_queue.begin(); it != m_queue.end(); ++it)
+    if (it->GetCell() == gr)
       return true;
   
   return false;
@@ -59,14 +242,30 @@ bool EvaluationQueue::IsInQueue(GroupCell *gr)
 
 void EvaluationQueue::Remove(GroupCell *gr)
 {
-  bool removeFirst = m_queue.size() > 0 && gr == m_queue.front();
-  m_queue.remove(gr);
+  // Maxima will still answer the commands from this cell it already has received.
+  for(std::list<commandInFlight>::iterator it = m_commandsInFlight.begin(); it != m_commandsInFlight.end(); ++it)
+  {
+    if (it->m_cell == gr)
+    {
+      it->m_cell = NULL;
+      m_commandsSent--;
+    }
+  }
+
+  bool removeFirst = m_queue.size() > 0 && gr == m_queue.front().GetCell();
+  std::list<queuedCell>::iterator it = m_queue.begin();
+  while (it != m_queue.end())
+  {
+    if (it->GetCell() == gr)
+      it = m_queue.erase(it);
+    else
+      ++it;
+  }
   m_size = m_queue.size();
   if(removeFirst)
   {
     m_commands.clear();
-    if(!m_queue.empty())
-      AddTokens(gr);
+    AddTokens();
   }
 }
 
@@ -81,13 +280,14 @@ void EvaluationQueue::AddToQueue(GroupCell *gr)
 
   gr->GetEditable()->AddEnding();
 
-  if(m_queue.empty())
+  m_queue.push_back(queuedCell(gr));
+  TokenizeCell(gr, m_queue.back().m_commands);
+  m_size++;
+  if(m_queue.size() == 1)
   {
-    AddTokens(gr);
+    AddTokens();
     m_workingGroupChanged = true;
   }
-  m_size++;
-  m_queue.push_back(gr);
 }
 
 /**
@@ -124,20 +324,25 @@ void EvaluationQueue::RemoveFirst()
       
       m_queue.pop_front();
       m_size--;
-      AddTokens(GetCell());
+      AddTokens();
     } while (m_commands.empty() && (!m_queue.empty()));
     m_workingGroupChanged = true;
   }
 }
 
-void EvaluationQueue::AddTokens(GroupCell *cell)
+void EvaluationQueue::AddTokens()
 {
-  if(cell == NULL)
+  if(m_queue.empty())
     return;
   
-  wxString commandString = cell->GetEditable()->GetValue();
+  m_knownAnswers = m_queue.front().GetCell()->m_knownAnswers;
 
-  m_knownAnswers = cell->m_knownAnswers;
+  m_commands.splice(m_commands.end(), m_queue.front().m_commands);
+}
+
+void EvaluationQueue::TokenizeCell(GroupCell *cell, std::list<EvaluationQueue::command> &commands)
+{
+  wxString commandString = cell->GetEditable()->GetValue();
 
   wxString token;
 
@@ -258,7 +463,7 @@ void EvaluationQueue::AddTokens(GroupCell *cell)
       token.Trim(false);
       token.Trim(true);
       if (token.Length() > 1)
-        m_commands.push_back(command(token, index));
+        commands.push_back(command(token, index));
       token = wxEmptyString;
     }
     ++it;++index;
@@ -269,7 +474,7 @@ void EvaluationQueue::AddTokens(GroupCell *cell)
   token.Trim(false);
   token.Trim(true);
   if (token.Length() > 1)
-    m_commands.push_back(command(token, index));
+    commands.push_back(command(token, index));
 }
 
 GroupCell *EvaluationQueue::GetCell()
@@ -277,7 +482,101 @@ GroupCell *EvaluationQueue::GetCell()
   if(m_queue.empty())
     return NULL;
   else
-    return m_queue.front();
+    return m_queue.front().GetCell();
+}
+
+wxString EvaluationQueue::GetNextUnsentCommand(GroupCell **cell, bool *mightAsk)
+{
+  if(m_queue.empty())
+    return wxEmptyString;
+
+  int n = m_commandsSent;
+  std::list<queuedCell>::iterator group = m_queue.begin();
+  for(std::list<command>::iterator it = m_commands.begin(); it != m_commands.end(); ++it)
+  {
+    if(n-- == 0)
+    {
+      *cell = group->GetCell();
+      if(mightAsk != NULL)
+        *mightAsk = it->MightAsk();
+      return it->GetString();
+    }
+  }
+
+  // The command lies in one of the cells that follow the current one.
+  for(++group; group != m_queue.end(); ++group)
+  {
+    for(std::list<command>::iterator it = group->m_commands.begin(); it != group->m_commands.end(); ++it)
+    {
+      if(n-- == 0)
+      {
+        *cell = group->GetCell();
+        if(mightAsk != NULL)
+        *mightAsk = it->MightAsk();
+        return it->GetString();
+      }
+    }
+  }
+  return wxEmptyString;
+}
+
+void EvaluationQueue::CommandSent()
+{
+  GroupCell *cell = NULL;
+  bool mightAsk = false;
+  if(GetNextUnsentCommand(&cell, &mightAsk) == wxEmptyString)
+    return;
+
+  m_commandsInFlight.push_back(commandInFlight(cell, mightAsk));
+  m_commandsSent++;
+}
+
+bool EvaluationQueue::QuestionMightBeAsked()
+{
+  for(std::list<commandInFlight>::iterator it = m_commandsInFlight.begin(); it != m_commandsInFlight.end(); ++it)
+    if (it->m_mightAsk)
+      return true;
+  return false;
+}
+
+bool EvaluationQueue::PromptReceived()
+{
+  if(m_commandsInFlight.empty())
+    return true;
+
+  GroupCell *cell = m_commandsInFlight.front().m_cell;
+  m_commandsInFlight.pop_front();
+  if(cell == NULL)
+    return false;
+
+  m_commandsSent--;
+  return true;
+}
+
+void EvaluationQueue::StopAfterCurrentCommand()
+{
+  // Maxima might have read the commands sent in advance as the answer or might
+  // still evaluate them: Sending them again might evaluate them twice.
+  while(m_commandsInFlight.size() > 1)
+    m_commandsInFlight.pop_back();
+  bool currentSent = !m_commandsInFlight.empty() && (m_commandsInFlight.front().m_cell != NULL);
+  m_commandsSent = currentSent ? 1 : 0;
+
+  if(currentSent && !m_commands.empty())
+    m_commands.erase(++m_commands.begin(), m_commands.end());
+  else
+    m_commands.clear();
+  if(!m_queue.empty())
+    m_queue.erase(++m_queue.begin(), m_queue.end());
+  if(!currentSent)
+    m_queue.clear();
+  m_size = m_queue.size();
+}
+
+void EvaluationQueue::ForgetCommandsInFlight()
+{
+  m_commandsInFlight.clear();
+  m_commandsSent = 0;
 }
 
 wxString EvaluationQueue::GetCommand()
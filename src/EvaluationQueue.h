@@ -42,12 +42,47 @@ private:
 
   class command{
   public:
-    command(wxString string, int index){m_command = string; m_indexStart = index;}
+    command(wxString string, int index);
     wxString GetString(){return m_command;}
     int GetIndex(){return m_indexStart;}
+    /*! Might the command make maxima ask a question?
+
+      true for every command we cannot prove not to ask one.
+    */
+    bool MightAsk(){return m_mightAsk;}
   private:
     int m_indexStart;
     wxString m_command;
+    bool m_mightAsk;
+  };
+
+  //! A cell in the evaluation queue and the commands it consists of
+  class queuedCell{
+  public:
+    queuedCell(GroupCell *cell){m_cell = cell;}
+    GroupCell *GetCell(){return m_cell;}
+    /*! The commands of this cell
+
+      They are determined when the cell is queued: This way the cell's text is
+      split into commands only once and the commands don't change if the user
+      edits the cell while it waits to be evaluated.
+    */
+    std::list<EvaluationQueue::command> m_commands;
+  private:
+    GroupCell *m_cell;
+  };
+
+  //! A command that has been sent to maxima but whose prompt hasn't arrived yet.
+  class commandInFlight{
+  public:
+    commandInFlight(GroupCell *cell, bool mightAsk){m_cell = cell; m_mightAsk = mightAsk;}
+    /*! The cell the command belongs to
+
+      NULL if the command has been removed from the queue after it has been sent.
+    */
+    GroupCell *m_cell;
+    //! Might the command make maxima ask a question?
+    bool m_mightAsk;
   };
     
   /*! A list of all the commands in the current cell
@@ -62,10 +97,29 @@ private:
   //! The label the user has assigned to the current command.
   wxString m_userLabel;
   //! The groupCells in the evaluation Queue.
-  std::list<GroupCell *>m_queue;
+  std::list<EvaluationQueue::queuedCell>m_queue;
 
-  //! Adds all commands in commandString as separate tokens to the queue.
-  void AddTokens(GroupCell *cell);
+  //! Makes the commands of the first cell in the queue the current ones.
+  void AddTokens();
+
+  //! Splits the contents of a cell into the commands it consists of.
+  void TokenizeCell(GroupCell *cell, std::list<EvaluationQueue::command> &commands);
+
+  /*! The commands that have been sent to maxima, in the order they were sent in
+
+    Normally this is at most one command. If commands are pipelined (see
+    Configuration::PipelineDepth()) a few more commands might be sent to maxima
+    before the prompt for the current one has arrived. Commands that are removed
+    from the queue after they have been sent stay in this list as maxima will
+    send a prompt for them, nonetheless.
+   */
+  std::list<EvaluationQueue::commandInFlight> m_commandsInFlight;
+
+  /*! The number of commands from the start of the queue that have been sent to maxima
+
+    Equals the number of entries of m_commandsInFlight that still belong to a cell.
+   */
+  int m_commandsSent;
 
   //! A list of answers provided by the user
   std::list<wxString> m_knownAnswers;
@@ -101,7 +155,7 @@ public:
     if (m_queue.empty())
       return false;
     else
-      return (gr == m_queue.front());
+      return (gr == m_queue.front().GetCell());
   }
 
   //! Is GroupCell gr part of the evaluation queue?
@@ -137,11 +191,67 @@ public:
   //! Is the answer queue empty?
   bool AnswersEmpty() {return m_knownAnswers.empty();}
 
-  //! Clear the queue
+  /*! Clear the queue
+
+    Commands that already have been sent to maxima will be evaluated, nonetheless.
+    Their prompts are therefore still waited for, see PromptReceived().
+  */
   void Clear();
 
   //! Return the next command that needs to be evaluated.
   wxString GetCommand();
+
+  /*! Return the first command in the queue that hasn't been sent to maxima yet
+
+    Doesn't change the user label GetUserLabel() returns.
+
+    \param cell Is set to the GroupCell the command belongs to.
+    \param mightAsk If not NULL it is set to true if the command might make maxima
+                    ask a question.
+    \return The command or wxEmptyString, if all commands have been sent.
+   */
+  wxString GetNextUnsentCommand(GroupCell **cell, bool *mightAsk = NULL);
+
+  //! Informs the queue that the command GetNextUnsentCommand() returns has been sent to maxima.
+  void CommandSent();
+
+  //! Has the current command already been sent to maxima?
+  bool CurrentCommandSent()
+  { return m_commandsSent > 0; }
+
+  //! The number of commands that have been sent to maxima but haven't been answered yet.
+  int CommandsInFlight()
+  { return m_commandsInFlight.size(); }
+
+  /*! Might one of the commands maxima hasn't answered yet make it ask a question?
+
+    If maxima asks a question it reads the commands that have been sent after the
+    question-raising one as the answer. No more commands should be sent in advance, then.
+   */
+  bool QuestionMightBeAsked();
+
+  /*! Informs the queue that maxima has sent a prompt
+
+    \return false, if the command maxima has finished has been removed from the
+            queue after it had been sent to maxima. Else the caller has to
+            remove the command using RemoveFirst().
+  */
+  bool PromptReceived();
+
+  /*! Drop everything from the queue that follows the oldest unanswered command
+
+    If maxima asks a question it reads the commands that have been sent in advance
+    as its answer. We cannot know which of them maxima has read => they are
+    neither sent again nor waited for.
+
+    SendCommandsAhead() doesn't send commands past one that might ask a question.
+    This only is needed if this check has been fooled, for example by a user who
+    has redefined a built-in function.
+  */
+  void StopAfterCurrentCommand();
+
+  //! Forget about all commands that have been sent to maxima, e.g. since it has been restarted.
+  void ForgetCommandsInFlight();
   
   //! Return the next known answer.
   wxString GetAnswer()
@@ -185,28 +185,48 @@ void ExptCell::Draw(wxPoint point, int fontsize)
 }
 
 wxString ExptCell::ToString()
+{
+  wxString s;
+  WriteString(s);
+  return s;
+}
+
+void ExptCell::WriteString(wxString &out)
 {
   if (m_isBroken)
-    return wxEmptyString;
-  wxString s = m_baseCell->ListToString() + wxT("^");
+    return;
+  m_baseCell->ListWriteString(out);
+  out += wxT("^");
   if (m_isMatrix)
-    s += wxT("^");
+    out += wxT("^");
   if (m_powCell->IsCompound())
-    s += wxT("(") + m_powCell->ListToString() + wxT(")");
+  {
+    out += wxT("(");
+    m_powCell->ListWriteString(out);
+    out += wxT(")");
+  }
   else
-    s += m_powCell->ListToString();
-  return s;
+    m_powCell->ListWriteString(out);
 }
 
 wxString ExptCell::ToTeX()
 {
-  if (m_isBroken)
-    return wxEmptyString;
-  wxString s = wxT("{{") + m_baseCell->ListToTeX() + wxT("}^{") +
-               m_powCell->ListToTeX() + wxT("}}");
+  wxString s;
+  WriteTeX(s);
   return s;
 }
 
+void ExptCell::WriteTeX(wxString &out)
+{
+  if (m_isBroken)
+    return;
+  out += wxT("{{");
+  m_baseCell->ListWriteTeX(out);
+  out += wxT("}^{");
+  m_powCell->ListWriteTeX(out);
+  out += wxT("}}");
+}
+
 wxString ExptCell::GetDiffPart()
 {
   wxString s(wxT(","));
@@ -235,14 +255,22 @@ wxString ExptCell::ToOMML()
 
 wxString ExptCell::ToXML()
 {
-//  if (m_isBroken)
-//    return wxEmptyString;
+  wxString s;
+  WriteXML(s);
+  return s;
+}
+
+void ExptCell::WriteXML(wxString &out)
+{
   wxString flags;
   if (m_forceBreakLine)
     flags += wxT(" breakline=\"true\"");
 
-  return wxT("<e") + flags + wxT("><r>") + m_baseCell->ListToXML() + _T("</r><r>") +
-         m_powCell->ListToXML() + _T("</r></e>");
+  out += wxT("<e") + flags + wxT("><r>");
+  m_baseCell->ListWriteXML(out);
+  out += _T("</r><r>");
+  m_powCell->ListWriteXML(out);
+  out += _T("</r></e>");
 }
 
 bool ExptCell::BreakUp()
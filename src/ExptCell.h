@@ -69,10 +69,16 @@ public:
 
   wxString ToString();
 
+  void WriteString(wxString &out);
+
   wxString ToTeX();
 
+  void WriteTeX(wxString &out);
+
   wxString ToXML();
 
+  void WriteXML(wxString &out);
+
   wxString ToOMML();
 
   wxString ToMathML();
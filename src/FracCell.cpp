@@ -275,63 +275,91 @@ void FracCell::Draw(wxPoint point, int fontsize)
 wxString FracCell::ToString()
 {
   wxString s;
-  if (!m_isBroken)
+  WriteString(s);
+  return s;
+}
+
+void FracCell::WriteString(wxString &out)
+{
+  if (m_isBroken)
+    return;
+  if (m_fracStyle == FC_NORMAL)
   {
-    if (m_fracStyle == FC_NORMAL)
+    if (m_num->IsCompound())
+    {
+      out += wxT("(");
+      m_num->ListWriteString(out);
+      out += wxT(")/");
+    }
+    else
     {
-      if (m_num->IsCompound())
-        s += wxT("(") + m_num->ListToString() + wxT(")/");
-      else
-        s += m_num->ListToString() + wxT("/");
-      if (m_denom->IsCompound())
-        s += wxT("(") + m_denom->ListToString() + wxT(")");
-      else
-        s += m_denom->ListToString();
+      m_num->ListWriteString(out);
+      out += wxT("/");
     }
-    else if (m_fracStyle == FC_CHOOSE)
+    if (m_denom->IsCompound())
     {
-      s = wxT("binomial(") + m_num->ListToString() + wxT(",") +
-          m_denom->ListToString() + wxT(")");
+      out += wxT("(");
+      m_denom->ListWriteString(out);
+      out += wxT(")");
     }
     else
+      m_denom->ListWriteString(out);
+  }
+  else if (m_fracStyle == FC_CHOOSE)
+  {
+    out += wxT("binomial(");
+    m_num->ListWriteString(out);
+    out += wxT(",");
+    m_denom->ListWriteString(out);
+    out += wxT(")");
+  }
+  else
+  {
+    MathCell *tmp = m_denom;
+    while (tmp != NULL)
     {
-      MathCell *tmp = m_denom;
-      while (tmp != NULL)
-      {
-        tmp = tmp->m_next;   // Skip the d
-        if (tmp == NULL)
-          break;
-        tmp = tmp->m_next;   // Skip the *
-        if (tmp == NULL)
-          break;
-        s += tmp->GetDiffPart();
-        tmp = tmp->m_next;   // Skip the *
-        if (tmp == NULL)
-          break;
-        tmp = tmp->m_next;
-      }
+      tmp = tmp->m_next;   // Skip the d
+      if (tmp == NULL)
+        break;
+      tmp = tmp->m_next;   // Skip the *
+      if (tmp == NULL)
+        break;
+      out += tmp->GetDiffPart();
+      tmp = tmp->m_next;   // Skip the *
+      if (tmp == NULL)
+        break;
+      tmp = tmp->m_next;
     }
   }
-  return s;
 }
 
 wxString FracCell::ToTeX()
 {
   wxString s;
-  if (!m_isBroken)
+  WriteTeX(s);
+  return s;
+}
+
+void FracCell::WriteTeX(wxString &out)
+{
+  if (m_isBroken)
+    return;
+  if (m_fracStyle == FC_CHOOSE)
   {
-    if (m_fracStyle == FC_CHOOSE)
-    {
-      s = wxT("\\begin{pmatrix}") + m_num->ListToTeX() + wxT("\\\\\n") +
-          m_denom->ListToTeX() + wxT("\\end{pmatrix}");
-    }
-    else
-    {
-      s = wxT("\\frac{") + m_num->ListToTeX() + wxT("}{") +
-          m_denom->ListToTeX() + wxT("}");
-    }
+    out += wxT("\\begin{pmatrix}");
+    m_num->ListWriteTeX(out);
+    out += wxT("\\\\\n");
+    m_denom->ListWriteTeX(out);
+    out += wxT("\\end{pmatrix}");
+  }
+  else
+  {
+    out += wxT("\\frac{");
+    m_num->ListWriteTeX(out);
+    out += wxT("}{");
+    m_denom->ListWriteTeX(out);
+    out += wxT("}");
   }
-  return s;
 }
 
 wxString FracCell::ToMathML()
@@ -350,6 +378,13 @@ wxString FracCell::ToOMML()
 }
 
 wxString FracCell::ToXML()
+{
+  wxString s;
+  WriteXML(s);
+  return s;
+}
+
+void FracCell::WriteXML(wxString &out)
 {
   wxString s = (m_fracStyle == FC_NORMAL || m_fracStyle == FC_DIFF) ?
                _T("f") : _T("f line = \"no\"");
@@ -359,9 +394,11 @@ wxString FracCell::ToXML()
   if (m_forceBreakLine)
     diffStyle += wxT(" breakline=\"true\"");
 
-  return _T("<") + s + diffStyle + _T("><r>") +
-         m_num->ListToXML() + _T("</r><r>") +
-         m_denom->ListToXML() + _T("</r></f>");
+  out += _T("<") + s + diffStyle + _T("><r>");
+  m_num->ListWriteXML(out);
+  out += _T("</r><r>");
+  m_denom->ListWriteXML(out);
+  out += _T("</r></f>");
 }
 
 void FracCell::SetExponentFlag()
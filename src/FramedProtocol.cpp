@@ -0,0 +1,224 @@
+﻿// -*- mode: c++; c-file-style: "linux"; c-basic-offset: 2; indent-tabs-mode: nil -*-
+//
+//  Copyright (C) 2017 Gunter Königsmann <wxMaxima@physikbuch.de>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+
+/*! \file
+  This file defines the class FramedProtocol
+
+  FramedProtocol splits the data maxima sends into complete messages.
+ */
+
+#include "FramedProtocol.h"
+#include <string.h>
+
+#define FRAME_START '\x02'
+#define FRAME_END '\x03'
+
+FramedProtocol::FramedProtocol()
+{
+  m_start = 0;
+  m_waitingSince = 0;
+  m_invalidFrameReported = false;
+}
+
+void FramedProtocol::Append(const char *data, size_t length)
+{
+  // Drop the data we already have extracted before the buffer grows.
+  if (m_start > 0)
+  {
+    m_buffer.erase(m_buffer.begin(), m_buffer.begin() + m_start);
+    m_start = 0;
+  }
+
+  // The frame we wait for isn't stalled as long as data keeps arriving.
+  m_waitingSince = 0;
+
+  size_t oldLength = m_buffer.size();
+  m_buffer.insert(m_buffer.end(), data, data + length);
+  for (size_t i = oldLength; i < m_buffer.size(); i++)
+    if (m_buffer[i] == '\0')
+      m_buffer[i] = ' ';
+}
+
+void FramedProtocol::Clear()
+{
+  m_buffer.clear();
+  m_start = 0;
+  m_waitingSince = 0;
+}
+
+bool FramedProtocol::IsStalled()
+{
+  return (m_waitingSince != 0) && (wxGetLocalTimeMillis() - m_waitingSince > m_frameTimeout);
+}
+
+wxString FramedProtocol::ToString(const char *data, size_t length)
+{
+  if (length == 0)
+    return wxEmptyString;
+  wxString retval = wxString::FromUTF8(data, length);
+  // Maxima might mix UTF8 and the current codepage: Don't lose the text in
+  // this case.
+  if (retval.IsEmpty())
+    retval = wxString(data, wxConvISO8859_1, length);
+  return retval;
+}
+
+long FramedProtocol::FrameLength(MessageType &type, size_t &payloadStart, size_t &payloadLength)
+{
+  size_t available = m_buffer.size() - m_start;
+  const char *frame = &m_buffer[m_start];
+
+  payloadStart = 1;
+  if (available < 2)
+    return 0;
+  switch (frame[1])
+  {
+    case 'm':
+      type = math;
+      break;
+    case 's':
+      type = statusbar;
+      break;
+    case 'y':
+      type = symbols;
+      break;
+    default:
+      return -1;
+  }
+
+  // Read the payload length
+  size_t pos = 2;
+  payloadLength = 0;
+  while ((pos < available) && (frame[pos] >= '0') && (frame[pos] <= '9'))
+  {
+    payloadLength = payloadLength * 10 + (frame[pos] - '0');
+    pos++;
+    if (pos > m_maxHeaderLength)
+    {
+      payloadStart = pos;
+      return -1;
+    }
+  }
+  payloadStart = pos;
+  if (pos >= available)
+    return 0;
+  if ((pos == 2) || (frame[pos] != ':'))
+    return -1;
+  payloadStart = pos + 1;
+
+  // Wait until the whole frame has arrived
+  if (available < payloadStart + payloadLength + 1)
+    return 0;
+
+  // If the length maxima told us doesn't match the frame isn't valid.
+  if (frame[payloadStart + payloadLength] != FRAME_END)
+    return -1;
+
+  return payloadStart + payloadLength + 1;
+}
+
+bool FramedProtocol::GetText(wxString &payload, size_t end)
+{
+  // Don't cut an UTF-8 character in half that is continued in the next packet:
+  // Only the first byte of a multibyte UTF-8 char has its two most significant
+  // bits set, the following bytes have the most significant bit set.
+  if (end == m_buffer.size())
+  {
+    size_t charStart = end;
+    while ((charStart > m_start) && (end - charStart < 4) &&
+           ((m_buffer[charStart - 1] & 0xC0) == 0x80))
+      charStart--;
+    if ((charStart > m_start) && ((m_buffer[charStart - 1] & 0xC0) == 0xC0))
+    {
+      unsigned char lead = m_buffer[charStart - 1];
+      size_t charLength = 2;
+      if ((lead & 0xF0) == 0xF0)
+        charLength = 4;
+      else if ((lead & 0xE0) == 0xE0)
+        charLength = 3;
+      if (end - charStart + 1 < charLength)
+        end = charStart - 1;
+    }
+  }
+
+  if (end <= m_start)
+    return false;
+
+  payload = ToString(&m_buffer[m_start], end - m_start);
+  m_start = end;
+  return true;
+}
+
+bool FramedProtocol::GetMessage(MessageType &type, wxString &payload)
+{
+  if (m_start >= m_buffer.size())
+  {
+    Clear();
+    return false;
+  }
+
+  if (m_buffer[m_start] == FRAME_START)
+  {
+    size_t payloadStart = 0;
+    size_t payloadLength = 0;
+    long frameLength = FrameLength(type, payloadStart, payloadLength);
+    if (frameLength == 0)
+    {
+      if (m_waitingSince == 0)
+        m_waitingSince = wxGetLocalTimeMillis();
+      if (!IsStalled())
+        return false;
+      // The frame will never be complete: Resynchronize by treating it like
+      // an invalid one.
+      frameLength = -1;
+    }
+    m_waitingSince = 0;
+    if (frameLength > 0)
+    {
+      payload = ToString(&m_buffer[m_start + payloadStart], payloadLength);
+      m_start += frameLength;
+      return true;
+    }
+
+    // Not a valid frame, for example since the lisp didn't encode the
+    // payload as UTF-8: Drop the header and hand the rest to the tag parser
+    // which will find the tags the payload is wrapped in.
+    if (!m_invalidFrameReported)
+    {
+      wxLogMessage(_("Received a frame with an invalid header or length from maxima"));
+      m_invalidFrameReported = true;
+    }
+    m_start += payloadStart;
+    return GetMessage(type, payload);
+  }
+
+  // Unframed text reaches up to the next frame.
+  type = text;
+  const char *next = (const char *) memchr(&m_buffer[m_start], FRAME_START, m_buffer.size() - m_start);
+  size_t end = m_buffer.size();
+  if (next != NULL)
+    end = next - &m_buffer[0];
+  if (!GetText(payload, end))
+    return false;
+  payload.Replace(wxT("\x03"), wxEmptyString);
+  if (payload.IsEmpty())
+    return GetMessage(type, payload);
+  return true;
+}
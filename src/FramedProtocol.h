@@ -0,0 +1,115 @@
+﻿// -*- mode: c++; c-file-style: "linux"; c-basic-offset: 2; indent-tabs-mode: nil -*-
+//
+//  Copyright (C) 2017 Gunter Königsmann <wxMaxima@physikbuch.de>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+
+/*! \file
+  This file declares the class FramedProtocol
+
+  FramedProtocol splits the data maxima sends into complete messages.
+ */
+
+#ifndef FRAMEDPROTOCOL_H
+#define FRAMEDPROTOCOL_H
+
+#include <wx/wx.h>
+#include <vector>
+
+/*! Splits the byte stream we receive from maxima into messages
+
+  Normally wxMaxima finds out where a message from maxima ends by searching
+  for its closing tag. If the framed protocol has been negotiated with
+  wxmathml.lisp math output, status bar messages and autocompletion symbols
+  are sent as frames instead:
+
+    STX (0x02), a character telling the message type, the length of the payload
+    in bytes as a decimal number, ":", the payload, ETX (0x03)
+
+  A frame can be cut out of the stream as soon as enough bytes have arrived
+  without looking at its contents, which means that tag-like text in user
+  strings no longer can confuse us. Everything between frames (error messages,
+  the output of print() and the prompts) is returned as text and is still
+  interpreted by searching for tags.
+
+  The data is kept as bytes until a message is complete so a multi-byte UTF-8
+  character that is split between two network packets doesn't get lost.
+ */
+class FramedProtocol
+{
+public:
+  //! The types of messages maxima sends
+  enum MessageType
+  {
+    text,      //!< Unframed text that still has to be searched for tags
+    math,      //!< A <mth> tag containing maxima's 2D output
+    statusbar, //!< A message for the status bar
+    symbols    //!< A list of autocompletion symbols separated by "$"
+  };
+
+  FramedProtocol();
+
+  //! Add the bytes of a packet we received from maxima
+  void Append(const char *data, size_t length);
+
+  /*! Extract the next complete message
+
+    \param type The type of the message
+    \param payload The contents of the message, without the frame
+    \return false, if no complete message has arrived yet.
+   */
+  bool GetMessage(MessageType &type, wxString &payload);
+
+  //! Forget about all data that hasn't been extracted yet
+  void Clear();
+
+  /*! Have we waited for the rest of a frame for too long?
+
+    If maxima has sent a wrong length the rest of its output would wait for a
+    frame end that never comes. Once this returns true GetMessage() gives up
+    on the frame and returns its payload as text.
+   */
+  bool IsStalled();
+
+private:
+  //! The maximum length of a frame header we accept
+  static const size_t m_maxHeaderLength = 24;
+  //! How many milliseconds without new data make an incomplete frame stalled
+  static const long m_frameTimeout = 5000;
+  //! Converts bytes we got from maxima to a string
+  static wxString ToString(const char *data, size_t length);
+  /*! Returns the length of the frame at m_start
+
+    \param payloadStart The length of the header. If the frame isn't valid or
+    complete: the length of the part of the header that has been read.
+    \return 0 if the frame isn't complete yet, -1 if the data at m_start
+            isn't a valid frame.
+   */
+  long FrameLength(MessageType &type, size_t &payloadStart, size_t &payloadLength);
+  //! Extracts unframed text up to the next frame
+  bool GetText(wxString &payload, size_t end);
+  //! The bytes we have received
+  std::vector<char> m_buffer;
+  //! The first byte in m_buffer that hasn't been extracted yet
+  size_t m_start;
+  //! When we have started waiting for the rest of the frame at m_start; 0 = we aren't
+  wxLongLong m_waitingSince;
+  //! Have we already told the user about an invalid frame?
+  bool m_invalidFrameReported;
+};
+
+#endif // FRAMEDPROTOCOL_H
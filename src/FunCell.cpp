@@ -121,14 +121,25 @@ void FunCell::Draw(wxPoint point, int fontsize)
 
 wxString FunCell::ToString()
 {
-  if (m_isBroken)
-    return wxEmptyString;
-  if (m_altCopyText != wxEmptyString)
-    return m_altCopyText + MathCell::ListToString();
-  wxString s = m_nameCell->ListToString() + m_argCell->ListToString();
+  wxString s;
+  WriteString(s);
   return s;
 }
 
+void FunCell::WriteString(wxString &out)
+{
+  if (m_isBroken)
+    return;
+  if (GetAltCopyText() != wxEmptyString)
+  {
+    out += GetAltCopyText();
+    MathCell::ListWriteString(out);
+    return;
+  }
+  m_nameCell->ListWriteString(out);
+  m_argCell->ListWriteString(out);
+}
+
 wxString FunCell::ToTeX()
 {
   if (m_isBroken)
@@ -156,13 +167,21 @@ wxString FunCell::ToTeX()
 
 wxString FunCell::ToXML()
 {
-//  if (m_isBroken)
-//    return wxEmptyString;
+  wxString s;
+  WriteXML(s);
+  return s;
+}
+
+void FunCell::WriteXML(wxString &out)
+{
   wxString flags;
   if (m_forceBreakLine)
     flags += wxT(" breakline=\"true\"");
-  return wxT("<fn") + flags + wxT("><r>") + m_nameCell->ListToXML() + wxT("</r>") +
-         m_argCell->ListToXML() + wxT("</fn>");
+  out += wxT("<fn") + flags + wxT("><r>");
+  m_nameCell->ListWriteXML(out);
+  out += wxT("</r>");
+  m_argCell->ListWriteXML(out);
+  out += wxT("</fn>");
 }
 
 wxString FunCell::ToMathML()
@@ -71,12 +71,16 @@ public:
 
   wxString ToString();
 
+  void WriteString(wxString &out);
+
   wxString ToTeX();
 
   wxString ToMathML();
 
   wxString ToXML();
 
+  void WriteXML(wxString &out);
+
   wxString ToOMML();
 
   bool BreakUp();
@@ -37,13 +37,18 @@
 #include "EditorCell.h"
 #include "ImgCell.h"
 #include "Bitmap.h"
+#include "MathParser.h"
 #include "list"
+#include <wx/mstream.h>
+#include <wx/sstream.h>
+#include <wx/zstream.h>
 
 GroupCell::GroupCell(Configuration **config, int groupType, CellPointers *cellPointers, wxString initString) : MathCell(
         this, config)
 {
   m_next = m_previous = m_nextToDraw = m_previousToDraw = NULL;
   m_autoAnswer = false;
+  m_expandFailed = false;
   m_cellPointers = cellPointers;
   m_inEvaluationQueue = false;
   m_lastInEvaluationQueue = false;
@@ -266,6 +271,12 @@ MathCell *GroupCell::Copy()
     tmp->SetInput(m_inputLabel->CopyList());
   if (m_output != NULL)
     tmp->SetOutput(m_output->CopyList());
+  else if (IsCompacted())
+  {
+    tmp->m_compactOutput = m_compactOutput;
+    tmp->m_compactLabel = m_compactLabel;
+    tmp->ExpandOutput();
+  }
 
   return tmp;
 }
@@ -397,6 +408,8 @@ void GroupCell::MarkAsDeleted()
     m_cellPointers->m_lastWorkingGroup = NULL;
   if (this == m_cellPointers->m_groupCellUnderPointer)
     m_cellPointers->m_groupCellUnderPointer = NULL;
+  if (this == m_cellPointers->m_cellMatchesCountedUpTo)
+    m_cellPointers->m_cellMatchesCountedUpTo = NULL;
 
   MathCell::MarkAsDeleted();
 }
@@ -414,13 +427,6 @@ std::list<MathCell *> GroupCell::GetInnerCells()
   return innerCells;
 }
 
-wxString GroupCell::TexEscapeOutputCell(wxString Input)
-{
-  wxString retval(Input);
-  Input.Replace(wxT("#"), wxT("\\#"));
-  return (Input);
-}
-
 void GroupCell::SetInput(MathCell *input)
 {
   if (input == NULL)
@@ -464,6 +470,9 @@ void GroupCell::SetOutput(MathCell *output)
     m_cellPointers->m_answerCell = NULL;
   
   wxDELETE(m_output);
+  m_compactOutput.Clear();
+  m_compactLabel.Clear();
+  m_expandFailed = false;
 
   m_output = output;
   m_output->SetGroup(this);
@@ -479,6 +488,10 @@ void GroupCell::SetOutput(MathCell *output)
 
 void GroupCell::RemoveOutput()
 {
+  m_compactOutput.Clear();
+  m_compactLabel.Clear();
+  m_expandFailed = false;
+
   // If there is nothing to do we can skip the rest of this action.
   if (m_output == NULL)
     return;
@@ -504,6 +517,8 @@ void GroupCell::AppendOutput(MathCell *cell)
 {
   wxASSERT_MSG(cell != NULL, _("Bug: Trying to append NULL to a group cell."));
   if (cell == NULL) return;
+  if (IsCompacted())
+    ExpandOutput();
   cell->SetGroupList(this);
   if (m_output == NULL)
   {
@@ -1215,7 +1230,7 @@ wxString GroupCell::ToString()
           str += wxT("\n");
         }
       }
-      str += tmp->ToString();
+      tmp->WriteString(str);
       firstCell = false;
       tmp = tmp->m_nextToDraw;
     }
@@ -1274,9 +1289,16 @@ wxString GroupCell::ToRTF()
 }
 
 wxString GroupCell::ToTeX(wxString imgDir, wxString filename, int *imgCounter)
+{
+  wxString str;
+  WriteTeX(str, imgDir, filename, imgCounter);
+  return str;
+}
+
+void GroupCell::WriteTeX(wxString &out, wxString imgDir, wxString filename, int *imgCounter)
 {
   wxASSERT_MSG((imgCounter != NULL), _("Bug: No image counter to write to!"));
-  if (imgCounter == NULL) return wxEmptyString;
+  if (imgCounter == NULL) return;
   wxString str;
   // Now we might want to introduce some markdown:
   MarkDownTeX MarkDown(*m_configuration);
@@ -1314,8 +1336,10 @@ wxString GroupCell::ToTeX(wxString imgDir, wxString filename, int *imgCounter)
       break;
 
     case GC_TYPE_CODE:
-      str = ToTeXCodeCell(imgDir, filename, imgCounter);
-      break;
+      // Code cells make up most of a typical worksheet: Append their TeX
+      // representation to the output directly.
+      WriteTeXCodeCell(out, imgDir, filename, imgCounter);
+      return;
 
     default:
       if (GetEditable() != NULL && !m_hide)
@@ -1353,28 +1377,31 @@ wxString GroupCell::ToTeX(wxString imgDir, wxString filename, int *imgCounter)
       break;
   }
 
-  return str;
+  out += str;
 }
 
 wxString GroupCell::ToTeXCodeCell(wxString imgDir, wxString filename, int *imgCounter)
 {
   wxString str;
+  WriteTeXCodeCell(str, imgDir, filename, imgCounter);
+  return str;
+}
 
+void GroupCell::WriteTeXCodeCell(wxString &str, wxString imgDir, wxString filename, int *imgCounter)
+{
   // Input cells
   if ((*m_configuration)->ShowCodeCells())
   {
-    str = wxT("\n\n\\noindent\n%%%%%%%%%%%%%%%\n")
-                  wxT("%%% INPUT:\n")
-                  wxT("\\begin{minipage}[t]{8ex}\\color{red}\\bf\n") +
-          m_inputLabel->ToTeX() +
-          wxT("\n\\end{minipage}");
+    str += wxT("\n\n\\noindent\n%%%%%%%%%%%%%%%\n")
+           wxT("%%% INPUT:\n")
+           wxT("\\begin{minipage}[t]{8ex}\\color{red}\\bf\n");
+    m_inputLabel->WriteTeX(str);
+    str += wxT("\n\\end{minipage}");
     if (m_inputLabel->m_next != NULL)
     {
-
-      wxString input = m_inputLabel->m_next->ToTeX();
-      str += wxT("\n\\begin{minipage}[t]{\\textwidth}\\color{blue}\n") +
-             input +
-             wxT("\n\\end{minipage}");
+      str += wxT("\n\\begin{minipage}[t]{\\textwidth}\\color{blue}\n");
+      m_inputLabel->m_next->WriteTeX(str);
+      str += wxT("\n\\end{minipage}");
     }
   }
 
@@ -1411,7 +1438,8 @@ wxString GroupCell::ToTeXCodeCell(wxString imgDir, wxString filename, int *imgCo
               str += wxT("\\[\\displaystyle\n");
               mathMode = true;
             }
-            str += tmp->ToTeX() + wxT("\n");
+            tmp->WriteTeX(str);
+            str += wxT("\n");
             break;
 
           case TS_STRING:
@@ -1420,7 +1448,9 @@ wxString GroupCell::ToTeXCodeCell(wxString imgDir, wxString filename, int *imgCo
               str += wxT("\\mbox{}\n\\]");
               mathMode = false;
             }
-            str += TexEscapeOutputCell(tmp->ToTeX()) + wxT("\n");
+            // TextCell::TeXEscape() already escapes "#"
+            tmp->WriteTeX(str);
+            str += wxT("\n");
             break;
 
           default:
@@ -1429,7 +1459,7 @@ wxString GroupCell::ToTeXCodeCell(wxString imgDir, wxString filename, int *imgCo
               str += wxT("\\[\\displaystyle\n");
               mathMode = true;
             }
-            str += tmp->ToTeX();
+            tmp->WriteTeX(str);
             break;
         }
       }
@@ -1444,8 +1474,6 @@ wxString GroupCell::ToTeXCodeCell(wxString imgDir, wxString filename, int *imgCo
       str += wxT("\\mbox{}\n\\]\n%%%%%%%%%%%%%%%");
     }
   }
-
-  return str;
 }
 
 wxString GroupCell::ToTeXImage(MathCell *tmp, wxString imgDir, wxString filename, int *imgCounter)
@@ -1500,14 +1528,20 @@ wxString GroupCell::ToTeXImage(MathCell *tmp, wxString imgDir, wxString filename
 
 wxString GroupCell::ToXML()
 {
-  wxString str;
-  str = wxT("\n<cell"); // start opening tag
+  wxString s;
+  WriteXML(s);
+  return s;
+}
+
+void GroupCell::WriteXML(wxString &out)
+{
+  out += wxT("\n<cell"); // start opening tag
   // write "type" according to m_groupType
   switch (m_groupType)
   {
     case GC_TYPE_CODE:
     {
-      str += wxT(" type=\"code\"");
+      out += wxT(" type=\"code\"");
       int i = 0;
       for(std::list<wxString>::iterator it = m_knownAnswers.begin(); it != m_knownAnswers.end();++it)
       {
@@ -1517,90 +1551,98 @@ wxString GroupCell::ToXML()
         // seems to be broken => escape newlines.
         wxString answer = MathCell::XMLescape(*it);
         answer.Replace(wxT("\n"),wxT("&#10;"));
-        str += wxString::Format(wxT(" answer%i=\""),i) + answer + wxT("\"");
+        out += wxString::Format(wxT(" answer%i=\""),i) + answer + wxT("\"");
       }
       if(m_autoAnswer)
-        str += wxT(" auto_answer=\"yes\"");
+        out += wxT(" auto_answer=\"yes\"");
       break;
     }
     case GC_TYPE_IMAGE:
-      str += wxT(" type=\"image\"");
+      out += wxT(" type=\"image\"");
       break;
     case GC_TYPE_TEXT:
-      str += wxT(" type=\"text\"");
+      out += wxT(" type=\"text\"");
       break;
     case GC_TYPE_TITLE:
-      str += wxT(" type=\"title\" sectioning_level=\"1\"");
+      out += wxT(" type=\"title\" sectioning_level=\"1\"");
       break;
     case GC_TYPE_SECTION:
-      str += wxT(" type=\"section\" sectioning_level=\"2\"");
+      out += wxT(" type=\"section\" sectioning_level=\"2\"");
       break;
     case GC_TYPE_SUBSECTION:
-      str += wxT(" type=\"subsection\" sectioning_level=\"3\"");
+      out += wxT(" type=\"subsection\" sectioning_level=\"3\"");
       break;
     case GC_TYPE_SUBSUBSECTION:
       // We save subsubsections as subsections with a higher sectioning level:
       // This makes them backwards-compatible in the way that they are displayed
       // as subsections on old wxMaxima installations.
-      str += wxT(" type=\"subsection\" sectioning_level=\"4\"");
+      out += wxT(" type=\"subsection\" sectioning_level=\"4\"");
       break;
     case GC_TYPE_PAGEBREAK:
     {
-      str += wxT(" type=\"pagebreak\"/>");
-      return str;
+      out += wxT(" type=\"pagebreak\"/>");
+      return;
     }
       break;
     default:
-      str += wxT(" type=\"unknown\"");
+      out += wxT(" type=\"unknown\"");
       break;
   }
 
   // write hidden status
   if (m_hide)
-    str += wxT(" hide=\"true\"");
-  str += wxT(">\n");
+    out += wxT(" hide=\"true\"");
+  out += wxT(">\n");
 
   MathCell *input = GetInput();
-  MathCell *output = GetLabel();
+  // A compacted output is written as it is, without recreating the cells.
+  MathCell *output = IsCompacted() ? NULL : GetLabel();
   // write contents
   switch (m_groupType)
   {
     case GC_TYPE_CODE:
       if (input != NULL)
       {
-        str += wxT("<input>\n");
-        str += input->ListToXML();
-        str += wxT("</input>");
+        out += wxT("<input>\n");
+        input->ListWriteXML(out);
+        out += wxT("</input>");
+      }
+      if (IsCompacted())
+      {
+        out += wxT("\n<output>\n");
+        out += wxT("<mth>");
+        out += CompactOutputXML();
+        out += wxT("\n</mth></output>");
       }
       if (output != NULL)
       {
-        str += wxT("\n<output>\n");
-        str += wxT("<mth>");
-        str += output->ListToXML();
-        str += wxT("\n</mth></output>");
+        out += wxT("\n<output>\n");
+        out += wxT("<mth>");
+        output->ListWriteXML(out);
+        out += wxT("\n</mth></output>");
       }
       break;
     case GC_TYPE_IMAGE:
       if (input != NULL)
-        str += input->ListToXML();
+        input->ListWriteXML(out);
       if (output != NULL)
-        str += output->ListToXML();
+        output->ListWriteXML(out);
       break;
     case GC_TYPE_TEXT:
       if (input)
-        str += input->ListToXML();
+        input->ListWriteXML(out);
       break;
     case GC_TYPE_TITLE:
     case GC_TYPE_SECTION:
     case GC_TYPE_SUBSECTION:
     case GC_TYPE_SUBSUBSECTION:
       if (input)
-        str += input->ListToXML();
+        input->ListWriteXML(out);
       if (m_hiddenTree)
       {
-        str += wxT("<fold>");
-        str += m_hiddenTree->ListToXML();
-        str += wxT("</fold>");
+        out += wxT("<fold>");
+        m_hiddenTree->ListWriteXML(out);
+        out += wxT("</fold>");
       }
       break;
     default:
@@ -1608,15 +1650,13 @@ wxString GroupCell::ToXML()
       MathCell *tmp = output;
       while (tmp != NULL)
       {
-        str += tmp->ListToXML();
+        tmp->ListWriteXML(out);
         tmp = tmp->m_next;
       }
       break;
     }
   }
-  str += wxT("\n</cell>\n");
-
-  return str;
+  out += wxT("\n</cell>\n");
 }
 
 void GroupCell::SelectRectGroup(wxRect &rect, wxPoint &one, wxPoint &two,
@@ -1919,6 +1959,105 @@ void GroupCell::SwitchHide()
   Hide(!m_hide);
 }
 
+void GroupCell::CompactOutput()
+{
+  if ((m_groupType != GC_TYPE_CODE) || (m_output == NULL) || IsCompacted())
+    return;
+
+  // Maxima might still be about to add something to this output.
+  if (m_inEvaluationQueue || (m_cellPointers->GetWorkingGroup() == this))
+    return;
+  if ((m_cellPointers->m_answerCell) && (m_cellPointers->m_answerCell->GetGroup() == this))
+    return;
+
+  if (m_output->SizeInMemoryList() < m_minCompactSize)
+    return;
+
+  // Images are saved to the memory filesystem instead of to the XML.
+  for (MathCell *tmp = m_output; tmp != NULL; tmp = tmp->m_next)
+    if ((tmp->GetType() == MC_TYPE_IMAGE) || (tmp->GetType() == MC_TYPE_SLIDE))
+      return;
+
+  wxString xml;
+  m_output->ListWriteXML(xml);
+  wxScopedCharBuffer utf8 = xml.utf8_str();
+
+  wxMemoryOutputStream compressed;
+  {
+    wxZlibOutputStream zlib(compressed);
+    zlib.Write(utf8.data(), utf8.length());
+    if (!zlib.Close())
+      return;
+  }
+  m_compactOutput.SetDataLen(0);
+  m_compactOutput.AppendData(compressed.GetOutputStreamBuffer()->GetBufferStart(),
+                             compressed.GetOutputStreamBuffer()->GetIntPosition());
+  m_compactLabel = m_output->ToString();
+  m_expandFailed = false;
+
+  wxDELETE(m_output);
+  m_lastInOutput = NULL;
+  m_appendedCells = NULL;
+  ResetSize();
+}
+
+wxString GroupCell::CompactOutputXML()
+{
+  wxMemoryInputStream compressed(m_compactOutput.GetData(), m_compactOutput.GetDataLen());
+  wxZlibInputStream zlib(compressed);
+  wxMemoryOutputStream utf8;
+  zlib.Read(utf8);
+  return wxString::FromUTF8((const char *) utf8.GetOutputStreamBuffer()->GetBufferStart(),
+                            utf8.GetOutputStreamBuffer()->GetIntPosition());
+}
+
+wxString GroupCell::GetLabelText()
+{
+  if (IsCompacted())
+    return m_compactLabel;
+  if (m_output == NULL)
+    return wxEmptyString;
+  return m_output->ToString();
+}
+
+void GroupCell::ExpandOutput()
+{
+  // Don't try again to parse output we already have failed to parse.
+  if (!IsCompacted() || m_expandFailed)
+    return;
+
+  // Parse the output the same way it is read from a .wxmx file.
+  wxString xml = wxT("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<mth>") +
+                 CompactOutputXML() + wxT("</mth>");
+
+  // If the output cannot be rebuilt we keep the compacted copy so it isn't lost
+  // and still is saved with the file.
+  wxXmlDocument doc;
+  wxStringInputStream xmlStream(xml);
+  if ((!doc.Load(xmlStream, wxT("UTF-8"), wxXMLDOC_KEEP_WHITESPACE_NODES)) || (doc.GetRoot() == NULL))
+  {
+    m_expandFailed = true;
+    return;
+  }
+
+  MathParser parser(m_configuration, m_cellPointers);
+  MathCell *output = parser.ParseTag(doc.GetRoot());
+  if (output == NULL)
+  {
+    m_expandFailed = true;
+    return;
+  }
+
+  m_compactOutput.Clear();
+  m_compactLabel.Clear();
+  m_output = output;
+  m_output->SetGroupList(this);
+  m_lastInOutput = m_output;
+  while (m_lastInOutput->m_next != NULL)
+    m_lastInOutput = m_lastInOutput->m_next;
+  ResetSize();
+}
+
 //
 // support for folding/unfolding sections
 //
@@ -1930,11 +2069,14 @@ bool GroupCell::HideTree(GroupCell *tree)
   m_hiddenTree->SetHiddenTreeParent(this);
 
   // Clear cached images from cells that are hidden
+  bool compact = (*m_configuration)->CompactFoldedOutput();
   GroupCell *tmp = m_hiddenTree;
   while (tmp)
   {
-    if (tmp->GetLabel())
-      tmp->GetLabel()->ClearCacheList();
+    if (tmp->m_output)
+      tmp->m_output->ClearCacheList();
+    if (compact)
+      tmp->CompactOutput();
     tmp = dynamic_cast<GroupCell *>(tmp->m_next);
   }
 
@@ -1944,6 +2086,8 @@ bool GroupCell::HideTree(GroupCell *tree)
 GroupCell *GroupCell::UnhideTree()
 {
   GroupCell *tree = m_hiddenTree;
+  for (GroupCell *tmp = tree; tmp != NULL; tmp = dynamic_cast<GroupCell *>(tmp->m_next))
+    tmp->ExpandOutput();
   m_hiddenTree->SetHiddenTreeParent(m_hiddenTreeParent);
   m_hiddenTree = NULL;
   return tree;
@@ -1992,10 +2136,13 @@ GroupCell *GroupCell::Fold()
   GroupCell *end = dynamic_cast<GroupCell *>(m_next);
   GroupCell *start = end; // first to fold
 
+  bool compact = (*m_configuration)->CompactFoldedOutput();
   while (end != NULL)
   {
-    if (end->GetLabel())
-      end->GetLabel()->ClearCacheList();
+    if (end->m_output)
+      end->m_output->ClearCacheList();
+    if (compact)
+      end->CompactOutput();
 
     GroupCell *tmp = dynamic_cast<GroupCell *>(end->m_next);
     if (tmp == NULL)
@@ -2035,6 +2182,10 @@ GroupCell *GroupCell::Unfold()
   m_next = m_nextToDraw = m_hiddenTree;
   m_hiddenTree->m_previous = m_hiddenTree->m_previousToDraw = this;
 
+  // The cells will be displayed again => They need their output.
+  for (GroupCell *cell = m_hiddenTree; cell != NULL; cell = dynamic_cast<GroupCell *>(cell->m_next))
+    cell->ExpandOutput();
+
   MathCell *tmp = m_hiddenTree;
   while (tmp->m_next)
     tmp = tmp->m_next;
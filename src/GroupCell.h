@@ -115,6 +115,13 @@ public:
 
   MathCell *Copy();
 
+  //! Includes the cells that are hidden in this cell if it is folded
+  size_t SizeInMemory()
+  {
+    return sizeof(GroupCell) + ColdDataSize() + m_compactOutput.GetDataLen() +
+      ((m_hiddenTree != NULL) ? m_hiddenTree->SizeInMemoryList() : 0);
+  }
+
   // general methods
   int GetGroupType()
   { return m_groupType; }
@@ -150,6 +157,13 @@ public:
 
   wxString ToTeX(wxString imgDir, wxString filename, int *imgCounter);
 
+  /*! Appends the TeX representation of this cell to out
+
+    Unlike ToTeX() this doesn't create a temporary string per cell which makes
+    exporting a big worksheet to TeX considerably faster.
+   */
+  void WriteTeX(wxString &out, wxString imgDir, wxString filename, int *imgCounter);
+
   /*! Convert the current cell to its wxm representation.
 
     \param wxm:
@@ -162,6 +176,9 @@ public:
 
   wxString ToTeXCodeCell(wxString imgDir, wxString filename, int *imgCounter);
 
+  //! Appends the TeX representation of a code cell to str
+  void WriteTeXCodeCell(wxString &str, wxString imgDir, wxString filename, int *imgCounter);
+
   wxString ToTeXImage(MathCell *tmp, wxString imgDir, wxString filename, int *imgCounter);
 
   wxString ToTeX();
@@ -171,6 +188,8 @@ public:
 
   wxString ToXML();
 
+  void WriteXML(wxString &out);
+
   //! Return the hide status
   bool IsHidden()
   { return m_hide; }
@@ -188,8 +207,6 @@ public:
 
   void AppendInput(MathCell *cell);
 
-  wxString TexEscapeOutputCell(wxString Input);
-
   MathCell *GetPrompt()
   { return m_inputLabel; }
 
@@ -201,11 +218,37 @@ public:
       return NULL;
   }
 
+  //! The output label. Recreates the output if CompactOutput() has compacted it.
   MathCell *GetLabel()
-  { return m_output; }
+  { if (m_compactOutput.GetDataLen() > 0) ExpandOutput(); return m_output; }
 
+  /*! The text of the output label
+
+    Unlike GetLabel() this doesn't recreate the output if CompactOutput() has
+    compacted it.
+   */
+  wxString GetLabelText();
+
+  //! The output without its label. Recreates it if CompactOutput() has compacted it.
   MathCell *GetOutput()
-  { if (m_output == NULL) return NULL; else return m_output->m_next; }
+  { MathCell *label = GetLabel(); if (label == NULL) return NULL; else return label->m_next; }
+
+  /*! Replace the output by a compressed copy of its XML representation
+
+    Folded cells aren't displayed, but their output still occupies the memory
+    for the cells, their layout information and their cached bitmaps. This
+    function frees all of this and keeps only the compressed XML the output
+    is saved as in .wxmx files. Does nothing if the output is small, contains
+    images or still might be appended to.
+   */
+  void CompactOutput();
+
+  //! Recreate the output that CompactOutput() has replaced by its XML representation
+  void ExpandOutput();
+
+  //! Has CompactOutput() replaced the output by its XML representation?
+  bool IsCompacted()
+  { return m_compactOutput.GetDataLen() > 0; }
 
   //
   wxRect GetOutputRect()
@@ -461,6 +504,16 @@ protected:
 private:
   //! Does this GroupCell save the answer to a question?
   bool m_autoAnswer;
+  //! The zlib-compressed UTF-8 XML of the output while it is compacted. See CompactOutput().
+  wxMemoryBuffer m_compactOutput;
+  //! The text of the output label while the output is compacted. See GetLabelText().
+  wxString m_compactLabel;
+  //! Has ExpandOutput() failed to recreate the output from m_compactOutput?
+  bool m_expandFailed;
+  //! Outputs that occupy less memory than this aren't worth being compacted
+  static const size_t m_minCompactSize = 8192;
+  //! Decompress m_compactOutput
+  wxString CompactOutputXML();
   wxRect m_outputRect;
   bool m_inEvaluationQueue;
   bool m_lastInEvaluationQueue;
@@ -0,0 +1,439 @@
+﻿// -*- mode: c++; c-file-style: "linux"; c-basic-offset: 2; indent-tabs-mode: nil -*-
+//
+//  Copyright (C) 2017 Gunter Königsmann <wxMaxima@physikbuch.de>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+
+/*! \file
+  This file defines the class HelpIndex
+
+  HelpIndex knows where maxima's manual is and which page documents which
+  command.
+ */
+
+#include "HelpIndex.h"
+#include "wxMaximaFrame.h"
+#include <wx/filename.h>
+#include <wx/textfile.h>
+#include <wx/ffile.h>
+#include <wx/convauto.h>
+#include <stdio.h>
+
+//! The first line of the cache file
+#define HELPINDEX_CACHE_HEADER wxT("wxMaxima help index 1")
+
+/*! The thread HelpIndex::Update() does its work in
+
+  The thread works on its own copy of everything it needs so HelpIndex never
+  has to wait for it: An Update() with a different maxima only cancels the
+  thread that is still busy with the old one.
+ */
+class HelpIndexThread : public wxThread
+{
+public:
+  HelpIndexThread(wxEvtHandler *handler, const wxString &cacheFile, const wxString &command,
+                  const wxString &version, const wxString &helpFile) :
+    wxThread(wxTHREAD_JOINABLE)
+  {
+    m_handler = handler;
+    m_cacheFile = cacheFile;
+    m_command = command;
+    m_version = version;
+    m_helpFile = helpFile;
+    m_cancelled = false;
+    m_finished = false;
+  }
+
+  //! Ask Build() to stop as soon as possible and not to send its event
+  void Cancel()
+  {
+    wxCriticalSectionLocker lock(m_lock);
+    m_cancelled = true;
+  }
+
+  //! Has Build() returned?
+  bool IsFinished()
+  {
+    wxCriticalSectionLocker lock(m_lock);
+    return m_finished;
+  }
+
+  /*! Find the manual and read its index
+
+    Runs in the thread, or in the GUI thread if the thread couldn't be started.
+   */
+  void Build();
+
+  //! The manual Build() has found. Only valid once we are IsFinished().
+  const wxString &GetHelpFile()
+  { return m_helpFile; }
+
+  //! The index Build() has read. Only valid once we are IsFinished().
+  std::map<wxString, wxString> &GetAnchors()
+  { return m_anchors; }
+
+protected:
+  ExitCode Entry()
+  {
+    Build();
+    return 0;
+  }
+
+private:
+  bool IsCancelled()
+  {
+    wxCriticalSectionLocker lock(m_lock);
+    return m_cancelled;
+  }
+
+  //! Read the cache. \return false, if the cache is missing or outdated.
+  bool ReadCache();
+
+  void WriteCache();
+
+  //! Ask maxima where its manual is. \return the path to header.hhp
+  wxString FindHelpFile();
+
+  //! Read the keyword index of a manual in the html help format
+  void ReadIndex();
+
+  //! The line in the cache that tells which maxima the cache was made for
+  wxString CacheKey();
+
+  wxEvtHandler *m_handler;
+  wxString m_cacheFile;
+  wxString m_command;
+  wxString m_version;
+  wxString m_helpFile;
+  //! The page and anchor for each keyword in the manual's index
+  std::map<wxString, wxString> m_anchors;
+  //! Guards m_cancelled and m_finished
+  wxCriticalSection m_lock;
+  bool m_cancelled;
+  bool m_finished;
+};
+
+//! The value of the attribute of a html tag, or wxEmptyString
+static wxString AttributeValue(const wxString &tag, const wxString &attribute)
+{
+  size_t start = tag.Lower().find(attribute + wxT("=\""));
+  if (start == wxString::npos)
+    return wxEmptyString;
+  start += attribute.Length() + 2;
+  size_t end = tag.find(wxT('"'), start);
+  if (end == wxString::npos)
+    return wxEmptyString;
+  return tag.SubString(start, end - 1);
+}
+
+//! Replaces the entities texi2html uses in index entries by the characters they stand for
+static wxString UnescapeHTML(wxString text)
+{
+  if (text.Find(wxT('&')) == wxNOT_FOUND)
+    return text;
+  text.Replace(wxT("&lt;"), wxT("<"));
+  text.Replace(wxT("&gt;"), wxT(">"));
+  text.Replace(wxT("&quot;"), wxT("\""));
+  text.Replace(wxT("&amp;"), wxT("&"));
+  return text;
+}
+
+HelpIndex::HelpIndex()
+{
+  m_thread = NULL;
+  m_done = false;
+}
+
+HelpIndex::~HelpIndex()
+{
+  if (m_thread != NULL)
+  {
+    m_thread->Cancel();
+    m_cancelledThreads.push_back(m_thread);
+    m_thread = NULL;
+  }
+  for (size_t i = 0; i < m_cancelledThreads.size(); i++)
+  {
+    m_cancelledThreads[i]->Wait();
+    delete m_cancelledThreads[i];
+  }
+  m_cancelledThreads.clear();
+}
+
+void HelpIndex::Update(wxEvtHandler *handler, const wxString &cacheFile, const wxString &command,
+                       const wxString &version, const wxString &helpFile)
+{
+  bool ready = IsReady();
+  if (((m_thread != NULL) || ready) && (command == m_command) && (version == m_version) &&
+      (helpFile.IsEmpty() || (helpFile == m_helpFile)))
+    return;
+
+  if (m_thread != NULL)
+  {
+    m_thread->Cancel();
+    m_cancelledThreads.push_back(m_thread);
+    m_thread = NULL;
+  }
+
+  m_command = command;
+  m_version = version;
+  m_helpFile = helpFile;
+  m_anchors.clear();
+  m_done = false;
+
+  m_thread = new HelpIndexThread(handler, cacheFile, command, version, helpFile);
+  if (m_thread->Run() != wxTHREAD_NO_ERROR)
+  {
+    m_thread->Build();
+    TakeResult();
+  }
+}
+
+void HelpIndex::TakeResult()
+{
+  m_helpFile = m_thread->GetHelpFile();
+  m_anchors.swap(m_thread->GetAnchors());
+  wxDELETE(m_thread);
+  m_done = true;
+}
+
+void HelpIndex::DeleteCancelledThreads()
+{
+  std::vector<HelpIndexThread *>::iterator it = m_cancelledThreads.begin();
+  while (it != m_cancelledThreads.end())
+  {
+    if ((*it)->IsFinished())
+    {
+      (*it)->Wait();
+      delete *it;
+      it = m_cancelledThreads.erase(it);
+    }
+    else
+      ++it;
+  }
+}
+
+bool HelpIndex::IsReady()
+{
+  if (!m_cancelledThreads.empty())
+    DeleteCancelledThreads();
+
+  if ((m_thread != NULL) && m_thread->IsFinished())
+  {
+    // Build() has returned: Waiting for the thread only waits for it to exit.
+    m_thread->Wait();
+    TakeResult();
+  }
+  return (m_thread == NULL) && m_done;
+}
+
+wxString HelpIndex::GetHelpFile()
+{
+  if (!IsReady())
+    return wxEmptyString;
+  return m_helpFile;
+}
+
+wxString HelpIndex::GetAnchor(const wxString &keyword)
+{
+  if (!IsReady())
+    return wxEmptyString;
+  std::map<wxString, wxString>::const_iterator it = m_anchors.find(keyword);
+  if (it == m_anchors.end())
+    return wxEmptyString;
+  return it->second;
+}
+
+void HelpIndexThread::Build()
+{
+  if (!ReadCache())
+  {
+    m_anchors.clear();
+    if (m_helpFile.IsEmpty())
+      m_helpFile = FindHelpFile();
+
+    // The index of a .chm file can only be read by the windows help viewer.
+    if (!m_helpFile.IsEmpty() && !m_helpFile.Lower().EndsWith(wxT(".chm")) && !IsCancelled())
+      ReadIndex();
+
+    // A cancelled thread must not overwrite the cache the next one reads.
+    if (!m_helpFile.IsEmpty() && !IsCancelled())
+      WriteCache();
+  }
+
+  bool cancelled;
+  {
+    wxCriticalSectionLocker lock(m_lock);
+    m_finished = true;
+    cancelled = m_cancelled;
+  }
+  if (!cancelled && (m_handler != NULL))
+    wxQueueEvent(m_handler, new wxThreadEvent(wxEVT_THREAD, wxMaximaFrame::help_index_ready_id));
+}
+
+wxString HelpIndexThread::CacheKey()
+{
+  return m_command + wxT("\t") + m_version;
+}
+
+bool HelpIndexThread::ReadCache()
+{
+  // Without knowing the version we cannot know if the cache is outdated.
+  if (m_version.IsEmpty() || !wxFileExists(m_cacheFile))
+    return false;
+
+  wxTextFile cache(m_cacheFile);
+  if (!cache.Open(wxConvUTF8) || (cache.GetLineCount() < 3))
+    return false;
+
+  wxString helpFile = cache.GetLine(2);
+  if ((cache.GetLine(0) != HELPINDEX_CACHE_HEADER) ||
+      (cache.GetLine(1) != CacheKey()) ||
+      (!m_helpFile.IsEmpty() && (helpFile != m_helpFile)) ||
+      !wxFileExists(helpFile))
+    return false;
+
+  m_helpFile = helpFile;
+  for (size_t i = 3; i < cache.GetLineCount(); i++)
+  {
+    wxString line = cache.GetLine(i);
+    int tab = line.Find(wxT('\t'));
+    if (tab != wxNOT_FOUND)
+      m_anchors[line.Left(tab)] = line.Mid(tab + 1);
+  }
+  return true;
+}
+
+void HelpIndexThread::WriteCache()
+{
+  if (m_version.IsEmpty())
+    return;
+
+  wxString contents = HELPINDEX_CACHE_HEADER;
+  contents += wxT("\n") + CacheKey() + wxT("\n") + m_helpFile + wxT("\n");
+  for (std::map<wxString, wxString>::const_iterator it = m_anchors.begin(); it != m_anchors.end(); ++it)
+    contents += it->first + wxT("\t") + it->second + wxT("\n");
+
+  wxFFile cache(m_cacheFile, wxT("w"));
+  if (cache.IsOpened())
+    cache.Write(contents, wxConvUTF8);
+}
+
+wxString HelpIndexThread::FindHelpFile()
+{
+#if defined __WXMSW__
+  // On MSW the manual is found by searching the file system and is passed to
+  // Update() instead.
+  return wxEmptyString;
+#else
+  // wxExecute() may only be called from the main thread.
+  FILE *output = popen((m_command + wxT(" -d")).mb_str(), "r");
+  if (output == NULL)
+    return wxEmptyString;
+
+  wxString docdir;
+  wxString langsubdir;
+  char buffer[4096];
+  while (fgets(buffer, sizeof(buffer), output) != NULL)
+  {
+    wxString line = wxString(buffer, wxConvLocal);
+    line.Trim();
+    if (line.StartsWith(wxT("maxima-htmldir")))
+      docdir = line.Mid(15);
+    else if (line.StartsWith(wxT("maxima-lang-subdir")))
+    {
+      langsubdir = line.Mid(19);
+      if (langsubdir == wxT("NIL"))
+        langsubdir = wxEmptyString;
+    }
+  }
+  pclose(output);
+
+  if (docdir.Length() == 0)
+    return wxEmptyString;
+
+  wxString headerFile = docdir + wxT("/");
+  if (langsubdir.Length())
+    headerFile += langsubdir + wxT("/");
+  headerFile += wxT("header.hhp");
+
+  if (!wxFileExists(headerFile))
+    headerFile = docdir + wxT("/header.hhp");
+
+  if (!wxFileExists(headerFile))
+    return wxEmptyString;
+
+  return headerFile;
+#endif
+}
+
+void HelpIndexThread::ReadIndex()
+{
+  wxString indexFile = wxT("index.hhk");
+  wxTextFile header(m_helpFile);
+  if (header.Open())
+  {
+    for (size_t i = 0; i < header.GetLineCount(); i++)
+    {
+      wxString line = header.GetLine(i);
+      if (line.Lower().StartsWith(wxT("index file=")))
+        indexFile = line.Mid(11).Trim().Trim(false);
+    }
+  }
+
+  indexFile = wxFileName(m_helpFile).GetPathWithSep() + indexFile;
+  if (!wxFileExists(indexFile))
+    return;
+
+  wxFFile file(indexFile);
+  wxString contents;
+  if (!file.IsOpened() || !file.ReadAll(&contents, wxConvAuto()))
+    return;
+
+  // Each index entry is an <object> that contains the tags
+  //   <param name="Name" value="plot2d">
+  //   <param name="Local" value="maxima_46.html#IDX1234">
+  // in either order. If a keyword appears more than once the first entry
+  // wins, as it does in wxHtmlHelpController's index.
+  wxString lowercase = contents.Lower();
+  size_t pos = lowercase.find(wxT("<object"));
+  while ((pos != wxString::npos) && !IsCancelled())
+  {
+    size_t end = lowercase.find(wxT("<object"), pos + 1);
+    wxString keyword;
+    wxString anchor;
+    size_t param = pos;
+    while (((param = lowercase.find(wxT("<param "), param)) != wxString::npos) && (param < end))
+    {
+      size_t tagEnd = lowercase.find(wxT('>'), param);
+      if (tagEnd == wxString::npos)
+        break;
+      wxString tag = contents.SubString(param, tagEnd);
+      param = tagEnd;
+
+      wxString paramName = AttributeValue(tag, wxT("name")).Lower();
+      if (paramName == wxT("name"))
+        keyword = UnescapeHTML(AttributeValue(tag, wxT("value")));
+      else if (paramName == wxT("local"))
+        anchor = UnescapeHTML(AttributeValue(tag, wxT("value")));
+    }
+
+    if (!keyword.IsEmpty() && !anchor.IsEmpty() && (m_anchors.find(keyword) == m_anchors.end()))
+      m_anchors[keyword] = anchor;
+    pos = end;
+  }
+}
@@ -0,0 +1,114 @@
+﻿// -*- mode: c++; c-file-style: "linux"; c-basic-offset: 2; indent-tabs-mode: nil -*-
+//
+//  Copyright (C) 2017 Gunter Königsmann <wxMaxima@physikbuch.de>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+
+/*! \file
+  This file declares the class HelpIndex
+
+  HelpIndex knows where maxima's manual is and which page documents which
+  command.
+ */
+
+#ifndef HELPINDEX_H
+#define HELPINDEX_H
+
+#include <wx/wx.h>
+#include <wx/string.h>
+#include <wx/thread.h>
+#include <map>
+#include <vector>
+
+class HelpIndexThread;
+
+/*! Where maxima's manual is and the anchors of its index entries
+
+  Finding the manual requires asking maxima for its installation directories
+  which means starting a maxima process. Doing this each time the user
+  presses F1 made looking something up slow. Instead HelpIndex finds the
+  manual and reads its keyword index once in a background thread and caches
+  the result in a file in the user's config directory. The cache is only
+  used if it was made for the same maxima command and maxima version.
+
+  None of the methods waits for the background thread, except for the
+  destructor.
+ */
+class HelpIndex
+{
+public:
+  HelpIndex();
+
+  //! Cancels the background threads and waits for them to finish
+  ~HelpIndex();
+
+  /*! Start finding the manual and reading its index in the background
+
+    If an earlier Update() is still running it is cancelled.
+    \param handler Receives a wxThreadEvent with the ID
+    wxMaximaFrame::help_index_ready_id as soon as we are IsReady().
+    \param cacheFile The file the result is cached in
+    \param command The command that starts maxima
+    \param version The version of the maxima this command starts
+    \param helpFile The manual, if we already know where it is.
+    If this string is empty we run "maxima -d" to find it out.
+   */
+  void Update(wxEvtHandler *handler, const wxString &cacheFile, const wxString &command,
+              const wxString &version, const wxString &helpFile);
+
+  //! Has Update() been called?
+  bool IsStarted()
+  { return m_thread != NULL || m_done; }
+
+  /*! Has Update() finished?
+
+    Doesn't wait for the background thread: Running "maxima -d" and reading
+    the index might take seconds the GUI would be frozen for otherwise.
+   */
+  bool IsReady();
+
+  //! The manual's header.hhp or .chm file; wxEmptyString, if we aren't IsReady() yet.
+  wxString GetHelpFile();
+
+  /*! The page and anchor the manual documents keyword at
+
+    \return wxEmptyString, if the index doesn't know about keyword or
+    if we aren't IsReady() yet.
+   */
+  wxString GetAnchor(const wxString &keyword);
+
+private:
+  //! Take over the result of m_thread which must have finished and delete it
+  void TakeResult();
+
+  //! Delete the threads Update() has cancelled that have finished by now
+  void DeleteCancelledThreads();
+
+  wxString m_command;
+  wxString m_version;
+  wxString m_helpFile;
+  //! The page and anchor for each keyword in the manual's index
+  std::map<wxString, wxString> m_anchors;
+  //! The thread that works for the last Update()
+  HelpIndexThread *m_thread;
+  //! The threads Update() has cancelled that might still be running
+  std::vector<HelpIndexThread *> m_cancelledThreads;
+  //! Has Update() finished?
+  bool m_done;
+};
+
+#endif // HELPINDEX_H
@@ -46,6 +46,7 @@ History::History(wxWindow *parent, int id) : wxPanel(parent, id)
   box->Fit(this);
   box->SetSizeHints(this);
   m_current = 0;
+  m_displayOutdated = false;
 }
 
 History::~History()
@@ -70,7 +71,12 @@ void History::AddToHistory(wxString cmd)
 
   m_current = commands.GetCount();
 
-  UpdateDisplay();
+  // Refilling the list after each command is wasted work while the pane is
+  // hidden - which it is by default.
+  if (IsShown())
+    UpdateDisplay();
+  else
+    m_displayOutdated = true;
 }
 
 void History::UpdateDisplay()
@@ -98,6 +104,7 @@ void History::UpdateDisplay()
   }
 
   m_history->Set(display);
+  m_displayOutdated = false;
 }
 
 void History::OnRegExEvent(wxCommandEvent &WXUNUSED(ev))
@@ -105,12 +112,22 @@ void History::OnRegExEvent(wxCommandEvent &WXUNUSED(ev))
   UpdateDisplay();
 }
 
+void History::OnShow(wxShowEvent &ev)
+{
+  if (ev.IsShown() && m_displayOutdated)
+    UpdateDisplay();
+  ev.Skip();
+}
+
 wxString History::GetCommand(bool next)
 {
   if (commands.GetCount() == 0)
     return wxEmptyString;
 
-  else if (next)
+  if (m_displayOutdated)
+    UpdateDisplay();
+
+  if (next)
   {
     --m_current;
     if (m_current < 0)
@@ -130,4 +147,5 @@ wxString History::GetCommand(bool next)
 
 BEGIN_EVENT_TABLE(History, wxPanel)
                 EVT_TEXT(history_regex_id, History::OnRegExEvent)
+                EVT_SHOW(History::OnShow)
 END_EVENT_TABLE()
@@ -54,6 +54,9 @@ public:
 
   void OnRegExEvent(wxCommandEvent &ev);
 
+  //! Updates the display if commands were added while the pane was hidden
+  void OnShow(wxShowEvent &ev);
+
   void UpdateDisplay();
 
   wxString GetCommand(bool next);
@@ -64,6 +67,8 @@ private:
   wxArrayString commands;
   //! The currently selected item. -1=none.
   long m_current;
+  //! Have commands been added since the list was last updated?
+  bool m_displayOutdated;
 DECLARE_EVENT_TABLE()
 };
 
@@ -100,11 +100,11 @@ Image::Image(Configuration **config, const wxBitmap &bitmap)
 }
 
 // constructor which loads an image
-Image::Image(Configuration **config, wxString image, bool remove, wxFileSystem *filesystem)
+Image::Image(Configuration **config, wxString image, bool remove, WXMXArchive *archive)
 {
   m_configuration = config;
   m_scaledBitmap.Create(1, 1);
-  LoadImage(image, remove, filesystem);
+  LoadImage(image, remove, archive);
   m_maxWidth = -1;
   m_maxHeight = -1;
 }
@@ -237,26 +237,18 @@ void Image::LoadImage(const wxBitmap &bitmap)
   m_height = 1;
 }
 
-void Image::LoadImage(wxString image, bool remove, wxFileSystem *filesystem)
+void Image::LoadImage(wxString image, bool remove, WXMXArchive *archive)
 {
   m_compressedImage.Clear();
   m_scaledBitmap.Create(1, 1);
 
-  if (filesystem)
+  if (archive)
   {
-    wxFSFile *fsfile = filesystem->OpenFile(image);
-    if (fsfile)
-    { // open successful
-
-      wxInputStream *istream = fsfile->GetStream();
-
-      m_compressedImage = ReadCompressedImage(istream);
-    }
-
-    // Closing and deleting fsfile is important: If this line is missing
-    // opening .wxmx files containing hundreds of images might lead to a
-    // "too many open files" error.
-    wxDELETE(fsfile);
+    // The archive keeps the file's contents in memory, already.
+    char *data;
+    size_t length;
+    if (archive->GetEntry(image, data, length))
+      m_compressedImage.AppendData(data, length);
   }
   else
   {
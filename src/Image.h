@@ -31,8 +31,7 @@
 #include "MathCell.h"
 #include <wx/image.h>
 
-#include <wx/filesys.h>
-#include <wx/fs_arc.h>
+#include "WXMXArchive.h"
 #include <wx/buffer.h>
 
 /*! Manages an auto-scaling image
@@ -78,10 +77,10 @@ public:
 
     \param config The pointer to the current configuration storage for the worksheet
     \param image The name of the file
-    \param filesystem The filesystem to load it from
+    \param archive The .wxmx archive to load it from. NULL = the operating system's filesystem
     \param remove true = Delete the file after loading it
    */
-  Image(Configuration **config, wxString image, bool remove = true, wxFileSystem *filesystem = NULL);
+  Image(Configuration **config, wxString image, bool remove = true, WXMXArchive *archive = NULL);
 
   /*! Temporarily forget the scaled image in order to save memory
 
@@ -98,7 +97,7 @@ public:
   { return m_extension; };
 
   //! Loads an image from a file
-  void LoadImage(wxString image, bool remove = true, wxFileSystem *filesystem = NULL);
+  void LoadImage(wxString image, bool remove = true, WXMXArchive *archive = NULL);
 
   double GetMaxWidth(){return m_maxWidth;}
   double GetMaxHeight(){return m_maxHeight;}
@@ -132,6 +131,13 @@ public:
   //! The height of the scaled image
   long m_height;
 
+  //! Roughly how many bytes this image occupies
+  size_t SizeInMemory()
+  {
+    return sizeof(Image) + m_compressedImage.GetDataLen() +
+      m_scaledBitmap.GetWidth() * m_scaledBitmap.GetHeight() * 4;
+  }
+
   //! Returns the original image in its compressed form
   wxMemoryBuffer GetCompressedImage()
   { return m_compressedImage; }
@@ -72,14 +72,14 @@ ImgCell::ImgCell(MathCell *parent, Configuration **config, CellPointers *cellpoi
 int ImgCell::s_counter = 0;
 
 // constructor which load image
-ImgCell::ImgCell(MathCell *parent, Configuration **config, CellPointers *cellpointers, wxString image, bool remove, wxFileSystem *filesystem)
+ImgCell::ImgCell(MathCell *parent, Configuration **config, CellPointers *cellpointers, wxString image, bool remove, WXMXArchive *archive)
         : MathCell(parent, config)
 {
   m_cellPointers = cellpointers;
   m_type = MC_TYPE_IMAGE;
   m_drawRectangle = true;
   if (image != wxEmptyString)
-    m_image = new Image(m_configuration, image, remove, filesystem);
+    m_image = new Image(m_configuration, image, remove, archive);
   else
     m_image = new Image(m_configuration);
   m_drawBoundingBox = false;
@@ -140,7 +140,7 @@ wxString ImgCell::GetToolTip(const wxPoint &point)
                "be the result of gnuplot not being able to write the image or not being "
                "able to understand what maxima wanted to plot."));
     else
-      return m_toolTip;
+      return GetLocalToolTip();
   }
   else
     return wxEmptyString;
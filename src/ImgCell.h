@@ -26,9 +26,6 @@
 #include <wx/image.h>
 #include "Image.h"
 
-#include <wx/filesys.h>
-#include <wx/fs_arc.h>
-
 class ImgCell : public MathCell
 {
 public:
@@ -37,7 +34,7 @@ public:
   ImgCell(MathCell *parent, Configuration **config, CellPointers *cellPointers, wxMemoryBuffer image, wxString type);
 
   ImgCell(MathCell *parent, Configuration **config, CellPointers *cellPointers, wxString image, bool remove = true,
-          wxFileSystem *filesystem = NULL);
+          WXMXArchive *archive = NULL);
 
   ImgCell(MathCell *parent, Configuration **config, CellPointers *cellPointers, const wxBitmap &bitmap);
 
@@ -50,6 +47,9 @@ public:
 
   MathCell *Copy();
 
+  size_t SizeInMemory()
+  { return sizeof(ImgCell) + ColdDataSize() + ((m_image != NULL) ? m_image->SizeInMemory() : 0); }
+
   friend class SlideShow;
 
   /*! Writes the image to a file
@@ -408,22 +408,30 @@ wxString IntCell::ToString()
 
 wxString IntCell::ToTeX()
 {
-  wxString s = wxT("\\int");
+  wxString s;
+  WriteTeX(s);
+  return s;
+}
 
-  wxString to = m_over->ListToTeX();
-  wxString from = m_under->ListToTeX();
+void IntCell::WriteTeX(wxString &out)
+{
+  out += wxT("\\int");
 
   if (m_intStyle == INT_DEF)
-    s += wxT("_{") + from + wxT("}^{") + to + wxT("}");
+  {
+    out += wxT("_{");
+    m_under->ListWriteTeX(out);
+    out += wxT("}^{");
+    m_over->ListWriteTeX(out);
+    out += wxT("}");
+  }
   else
-    s += wxT(" ");
-
-  s += wxT("{\\left. ");
-  s += m_base->ListToTeX();
-  s += m_var->ListToTeX();
-  s += wxT("\\right.}");
+    out += wxT(" ");
 
-  return s;
+  out += wxT("{\\left. ");
+  m_base->ListWriteTeX(out);
+  m_var->ListWriteTeX(out);
+  out += wxT("\\right.}");
 }
 
 wxString IntCell::ToMathML()
@@ -481,32 +489,31 @@ wxString IntCell::ToOMML()
 
 wxString IntCell::ToXML()
 {
-  wxString from;
-  if (m_under != NULL)
-    from = m_under->ListToXML();
-  from = wxT("<r>") + from + wxT("</r>");
-
-  wxString to;
-  if (m_over != NULL)
-    to = m_over->ListToXML();
-  to = wxT("<r>") + to + wxT("</r>");
-
-  wxString base;
-  if (m_base != NULL)
-    base = m_base->ListToXML();
-  base = wxT("<r>") + base + wxT("</r>");
-
-  wxString var;
-  if (m_var != NULL)
-    var = m_var->ListToXML();
-  var = wxT("<r>") + var + wxT("</r>");
+  wxString s;
+  WriteXML(s);
+  return s;
+}
 
+void IntCell::WriteXML(wxString &out)
+{
   wxString flags;
   if (m_forceBreakLine)
     flags += wxT(" breakline=\"true\"");
 
   if (m_intStyle != INT_DEF)
     flags += wxT(" def=\"false\">");
-  
-  return wxT("<in") + flags + wxT(">") + from + to + base + var + wxT("</in>");
+
+  out += wxT("<in") + flags + wxT("><r>");
+  if (m_under != NULL)
+    m_under->ListWriteXML(out);
+  out += wxT("</r><r>");
+  if (m_over != NULL)
+    m_over->ListWriteXML(out);
+  out += wxT("</r><r>");
+  if (m_base != NULL)
+    m_base->ListWriteXML(out);
+  out += wxT("</r><r>");
+  if (m_var != NULL)
+    m_var->ListWriteXML(out);
+  out += wxT("</r></in>");
 }
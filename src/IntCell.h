@@ -80,12 +80,16 @@ public:
 
   wxString ToTeX();
 
+  void WriteTeX(wxString &out);
+
   wxString ToMathML();
 
   wxString ToOMML();
 
   wxString ToXML();
 
+  void WriteXML(wxString &out);
+
   void SetGroup(MathCell *parent);
 
 protected:
@@ -212,14 +212,25 @@ wxString LimitCell::ToMathML()
 }
 
 wxString LimitCell::ToXML()
+{
+  wxString s;
+  WriteXML(s);
+  return s;
+}
+
+void LimitCell::WriteXML(wxString &out)
 {
   wxString flags;
   if (m_forceBreakLine)
     flags += wxT(" breakline=\"true\"");
 
-  return _T("<lm") + flags + wxT("><r>") + m_name->ListToXML() + _T("</r><r>") +
-         m_under->ListToXML() + _T("</r><r>") +
-         m_base->ListToXML() + _T("</r></lm>");
+  out += _T("<lm") + flags + wxT("><r>");
+  m_name->ListWriteXML(out);
+  out += _T("</r><r>");
+  m_under->ListWriteXML(out);
+  out += _T("</r><r>");
+  m_base->ListWriteXML(out);
+  out += _T("</r></lm>");
 }
 
 wxString LimitCell::ToOMML()
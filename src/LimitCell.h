@@ -59,6 +59,8 @@ public:
 
   wxString ToXML();
 
+  void WriteXML(wxString &out);
+
   wxString ToOMML();
 
   wxString ToMathML();
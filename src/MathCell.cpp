@@ -44,12 +44,14 @@ wxString MathCell::GetToolTip(const wxPoint &point)
         return toolTip;
     }
   }
-  return m_toolTip;
+  return GetLocalToolTip();
 }
 
+const wxString MathCell::m_emptyString;
+
 MathCell::MathCell(MathCell *group, Configuration **config)
 {
-  m_toolTip = wxEmptyString;
+  m_coldData = NULL;
   m_group = group;
   m_parent = group;
   m_configuration = config;
@@ -77,7 +79,7 @@ MathCell::MathCell(MathCell *group, Configuration **config)
   m_imageBorderWidth = 0;
   m_currentPoint.x = -1;
   m_currentPoint.y = -1;
-  m_toolTip = (*m_configuration)->GetDefaultMathCellToolTip();
+  SetToolTip((*m_configuration)->GetDefaultMathCellToolTip());
 }
 
 MathCell::~MathCell()
@@ -95,6 +97,22 @@ MathCell::~MathCell()
     wxDELETE(tmp);
     last->m_next = NULL;
   }
+  if (m_coldData != NULL)
+  {
+    wxASSERT_MSG(m_coldDataBytes >= ColdDataSize(), _("Bug: Lost track of the size of the ColdData"));
+    m_coldDataBytes -= ColdDataSize();
+    m_coldDataCells--;
+    wxDELETE(m_coldData);
+  }
+}
+
+size_t MathCell::ColdDataSize()
+{
+  if (m_coldData == NULL)
+    return 0;
+  return sizeof(ColdData) +
+    (m_coldData->m_toolTip.Length() + m_coldData->m_altCopyText.Length() +
+     m_coldData->m_initialToolTip.Length()) * sizeof(wxChar);
 }
 
 void MathCell::SetType(int type)
@@ -502,9 +520,37 @@ wxString MathCell::ToString()
   return wxEmptyString;
 }
 
+size_t MathCell::MemoryPerCell()
+{
+  if (CellPool::CellsAllocated() == 0)
+    return 0;
+  return (CellPool::BytesReserved() + m_coldDataBytes) / CellPool::CellsAllocated();
+}
+
+size_t MathCell::SizeInMemoryList()
+{
+  size_t size = 0;
+  for (MathCell *tmp = this; tmp != NULL; tmp = tmp->m_next)
+  {
+    size += tmp->SizeInMemory();
+    std::list<MathCell *> innerCells = tmp->GetInnerCells();
+    for (std::list<MathCell *>::iterator it = innerCells.begin(); it != innerCells.end(); ++it)
+      if (*it != NULL)
+        size += (*it)->SizeInMemoryList();
+  }
+  return size;
+}
+
 wxString MathCell::ListToString()
 {
   wxString retval;
+  ListWriteString(retval);
+  return retval;
+}
+
+void MathCell::ListWriteString(wxString &out)
+{
+  size_t start = out.Length();
   MathCell *tmp = this;
   bool firstline = true;
 
@@ -512,8 +558,8 @@ wxString MathCell::ListToString()
   {
     if ((!firstline) && (tmp->m_forceBreakLine))
     {
-      if(!retval.EndsWith(wxT('\n')))
-        retval += wxT("\n");
+      if((out.Length() == start) || (!out.EndsWith(wxT('\n'))))
+        out += wxT("\n");
       // if(
       //    (tmp->GetStyle() != TS_LABEL) &&
       //    (tmp->GetStyle() != TS_USERLABEL) &&
@@ -529,13 +575,11 @@ wxString MathCell::ListToString()
     //      (tmp->GetStyle() != TS_OTHER_PROMPT))
     //     retval += wxT("\t");        
     // }
-    retval += tmp->ToString();
+    tmp->WriteString(out);
     
     firstline = false;
     tmp = tmp->m_nextToDraw;
   }
-
-  return retval;
 }
 
 wxString MathCell::ToTeX()
@@ -546,14 +590,21 @@ wxString MathCell::ToTeX()
 wxString MathCell::ListToTeX()
 {
   wxString retval;
+  ListWriteTeX(retval);
+  return retval;
+}
+
+void MathCell::ListWriteTeX(wxString &out)
+{
+  size_t start = out.Length();
   MathCell *tmp = this;
 
   while (tmp != NULL)
   {
-    if ((tmp->m_textStyle == TS_LABEL && retval != wxEmptyString) ||
-        (tmp->m_breakLine && retval != wxEmptyString))
-      retval += wxT("\\]\\[");
-    retval += tmp->ToTeX();
+    if ((tmp->m_textStyle == TS_LABEL && out.Length() > start) ||
+        (tmp->m_breakLine && out.Length() > start))
+      out += wxT("\\]\\[");
+    tmp->WriteTeX(out);
     tmp = tmp->m_next;
   }
 
@@ -564,7 +615,6 @@ wxString MathCell::ListToTeX()
   //
   //  wxRegEx removeUnneededBraces1(wxT("{([a-zA-Z0-9])}([{}_a-zA-Z0-9 \\\\^_])"));
   //  removeUnneededBraces1.Replace(&retval,wxT(" \\1\\2"),true);
-  return retval;
 }
 
 wxString MathCell::ToXML()
@@ -854,36 +904,40 @@ wxString MathCell::ListToRTF(bool startofline)
 }
 
 wxString MathCell::ListToXML()
+{
+  wxString retval;
+  ListWriteXML(retval);
+  return retval;
+}
+
+void MathCell::ListWriteXML(wxString &out)
 {
   bool highlight = false;
 
-  wxString retval;
   MathCell *tmp = this;
 
   while (tmp != NULL)
   {
     if ((tmp->GetHighlight()) && (!highlight))
     {
-      retval += wxT("<hl>\n");
+      out += wxT("<hl>\n");
       highlight = true;
     }
 
     if ((!tmp->GetHighlight()) && (highlight))
     {
-      retval += wxT("</hl>\n");
+      out += wxT("</hl>\n");
       highlight = false;
     }
 
-    retval += tmp->ToXML();
+    tmp->WriteXML(out);
     tmp = tmp->m_next;
   }
 
   if (highlight)
   {
-    retval += wxT("</hl>\n");
+    out += wxT("</hl>\n");
   }
-
-  return retval;
 }
 
 /***
@@ -1073,8 +1127,8 @@ void MathCell::UnsetPen()
  */
 void MathCell::CopyData(MathCell *s, MathCell *t)
 {
-  t->m_altCopyText = s->m_altCopyText;
-  t->m_toolTip = s->m_toolTip;
+  t->SetAltCopyText(s->GetAltCopyText());
+  t->SetToolTip(s->GetLocalToolTip());
   t->m_forceBreakLine = s->m_forceBreakLine;
   t->m_type = s->m_type;
   t->m_textStyle = s->m_textStyle;
@@ -1327,6 +1381,7 @@ MathCell::CellPointers::CellPointers(wxScrolledCanvas *mathCtrl)
   m_cellKeyboardSelectionStartedIn = NULL;
   m_cellUnderPointer = NULL;
   m_cellSearchStartedIn = NULL;
+  m_cellMatchesCountedUpTo = NULL;
   m_answerCell = NULL;
   m_indexSearchStartedAt = -1;
   m_activeCell = NULL;
@@ -1378,5 +1433,7 @@ void MathCell::MarkAsDeleted()
 // The variables all MathCells share.
 wxRect  MathCell::m_updateRegion;
 bool    MathCell::m_clipToDrawRegion = true;
+size_t  MathCell::m_coldDataBytes = 0;
+size_t  MathCell::m_coldDataCells = 0;
 wxRect  MathCell::m_visibleRegion;
 wxPoint MathCell::m_worksheetPosition;
@@ -40,6 +40,7 @@
 #endif // wxUSE_ACCESSIBILITY
 #include "Configuration.h"
 #include "TextStyle.h"
+#include "CellPool.h"
 
 /*! The supported types of math cells
  */
@@ -107,6 +108,13 @@ class MathCell
   public:
   MathCell(MathCell *group, Configuration **config);
 
+  //! Cells are allocated from the CellPool which is much faster for many small objects.
+  static void *operator new(size_t size)
+  { return CellPool::Allocate(size); }
+
+  static void operator delete(void *ptr, size_t size)
+  { CellPool::Free(ptr, size); }
+
   static void SetVisibleRegion(wxRect visibleRegion){m_visibleRegion = visibleRegion;}
   static void SetWorksheetPosition(wxPoint worksheetPosition){m_worksheetPosition = worksheetPosition;}
 
@@ -136,10 +144,6 @@ class MathCell
   virtual wxAccStatus GetRole (int childId, wxAccRole *role);
 #endif
 
-
-
-  wxString m_toolTip;
-
   /*! Returns the ToolTip this cell provides.
 
     wxEmptyString means: No ToolTip
@@ -557,6 +561,36 @@ class MathCell
   //! Convert this cell to an representation fit for saving in a .wxmx file
   virtual wxString ToMathML();
 
+  /*! Append this cell's representation as a string to out
+
+    The To* functions return a string the cell containing this one then has
+    to copy into its own result - which for deeply nested cells means that
+    the same text is copied once per nesting level. The Write* functions
+    instead append to a buffer that is handed down to the inner cells.
+
+    Cells that don't contain other cells don't need to override the Write*
+    functions: By default they append the result of the matching To* function.
+   */
+  virtual void WriteString(wxString &out)
+  { out += ToString(); }
+
+  //! Append this cell's LaTeX representation to out. See WriteString().
+  virtual void WriteTeX(wxString &out)
+  { out += ToTeX(); }
+
+  //! Append this cell's .wxmx representation to out. See WriteString().
+  virtual void WriteXML(wxString &out)
+  { out += ToXML(); }
+
+  //! Append the list's representation as a string to out
+  void ListWriteString(wxString &out);
+
+  //! Append the list's LaTeX representation to out
+  void ListWriteTeX(wxString &out);
+
+  //! Append the list's .wxmx representation to out
+  void ListWriteXML(wxString &out);
+
   //! Escape a string for RTF
   static wxString RTFescape(wxString, bool MarkDown = false);
 
@@ -638,13 +672,13 @@ class MathCell
      - for MathCells when they are drawn.
   */
   wxPoint m_currentPoint;
-  bool m_bigSkip;
+  bool m_bigSkip : 1;
   /*! true means:  This cell is broken into two or more lines.
     
     Long abs(), conjugate(), fraction and similar cells can be broken into more
     than one line and will change their visual representation in this case.
    */
-  bool m_isBroken;
+  bool m_isBroken : 1;
   /*! True means: This cell is not to be drawn.
 
     Currently the following items fall into this category:
@@ -652,7 +686,7 @@ class MathCell
      - plus signs within numbers
      - most multiplication dots.
    */
-  bool m_isHidden;
+  bool m_isHidden : 1;
 
   /*! Determine if this cell contains text that isn't code
 
@@ -748,8 +782,22 @@ class MathCell
 
   bool IsMath();
 
-  void SetAltCopyText(wxString text)
-  { m_altCopyText = text; }
+  //! Set the text that is to be put on the clipboard if this cell is copied as text.
+  void SetAltCopyText(const wxString &text)
+  {
+    if ((m_coldData == NULL) && text.IsEmpty())
+      return;
+    size_t oldSize = ColdDataSize();
+    GetColdData()->m_altCopyText = text;
+    ColdDataResized(oldSize);
+  }
+
+  /*! Text that should end up on the clipboard if this cell is copied as text.
+
+     \attention  The alt copy text is not check in all cell types!
+  */
+  const wxString &GetAltCopyText()
+  { return (m_coldData != NULL) ? m_coldData->m_altCopyText : m_emptyString; }
 
   /*! Attach a copy of the list of cells that follows this one to a cell
     
@@ -766,6 +814,33 @@ class MathCell
   */
   virtual MathCell *Copy() = 0;
 
+  /*! Roughly how many bytes this cell occupies
+
+    Doesn't include the cells GetInnerCells() returns or the rest of the list.
+    Used for limiting the amount of memory the undo buffer keeps alive.
+   */
+  virtual size_t SizeInMemory()
+  { return sizeof(MathCell) + ColdDataSize(); }
+
+  //! Roughly how many bytes this cell, its inner cells and the rest of its list occupy
+  size_t SizeInMemoryList();
+
+  /*! The average number of bytes a cell currently occupies
+
+    Includes the memory the CellPool has reserved for cells and the ColdData
+    of all cells including the strings it contains.
+    Returns 0 if no cell is allocated.
+   */
+  static size_t MemoryPerCell();
+
+  //! The number of bytes the ColdData of all cells occupies
+  static size_t ColdDataBytes()
+  { return m_coldDataBytes; }
+
+  //! The number of cells that have a ColdData
+  static size_t CellsWithColdData()
+  { return m_coldDataCells; }
+
   /*! Do we want to begin this cell with a center dot if it is part of a product?
 
     Maxima will represent a product like (a*b*c) by a list like the following:
@@ -774,10 +849,21 @@ class MathCell
     many => we need parenthesis cells to set this flag for the first cell in 
     their "inner cell" list.
    */
-  bool m_SuppressMultiplicationDot;
+  bool m_SuppressMultiplicationDot : 1;
 
   //! Set the tooltip of this math cell. wxEmptyString means: no tooltip.
-  void SetToolTip(const wxString &tooltip){m_toolTip = tooltip;}
+  void SetToolTip(const wxString &tooltip)
+  {
+    if ((m_coldData == NULL) && tooltip.IsEmpty())
+      return;
+    size_t oldSize = ColdDataSize();
+    GetColdData()->m_toolTip = tooltip;
+    ColdDataResized(oldSize);
+  }
+
+  //! The tooltip of this cell itself, not the one of the cell under the mouse pointer
+  const wxString &GetLocalToolTip()
+  { return (m_coldData != NULL) ? m_coldData->m_toolTip : m_emptyString; }
 
 protected:
   //! The worksheet all cells are drawn on
@@ -819,19 +905,64 @@ protected:
   int m_textStyle;
 
   //! Does this cell begin with a forced page break?
-  bool m_breakPage;
+  bool m_breakPage : 1;
   //! Are we allowed to add a line break before this cell?
-  bool m_breakLine;
+  bool m_breakLine : 1;
   //! true means we force this cell to begin with a line break.  
-  bool m_forceBreakLine;
-  bool m_highlight;
-  /* Text that should end up on the clipboard if this cell is copied as text.
-
-     \attention  m_altCopyText is not check in all cell types!
-  */
-  wxString m_altCopyText;
+  bool m_forceBreakLine : 1;
+  bool m_highlight : 1;
   Configuration **m_configuration;
 
+  /*! Data only few cells need
+
+    Large outputs consist of millions of cells, most of which have neither a
+    tooltip nor an alternative text for the clipboard. Keeping these strings
+    in every cell would make up a big part of the memory a cell needs =>
+    they are kept in an extra object that is only allocated if needed.
+   */
+  struct ColdData
+  {
+    //! The tooltip of this cell. See SetToolTip().
+    wxString m_toolTip;
+    //! The text that is put on the clipboard instead of the cell's contents
+    wxString m_altCopyText;
+    //! The tooltip a TextCell falls back to if its value is changed
+    wxString m_initialToolTip;
+  };
+
+  //! The ColdData of this cell, or NULL if none has been needed so far.
+  ColdData *m_coldData;
+
+  //! Returns this cell's ColdData, allocating it if necessary
+  ColdData *GetColdData()
+  {
+    if (m_coldData == NULL)
+    {
+      m_coldData = new ColdData;
+      m_coldDataCells++;
+    }
+    return m_coldData;
+  }
+
+  //! The number of bytes the ColdData of this cell occupies
+  size_t ColdDataSize();
+
+  //! Updates m_coldDataBytes after the ColdData of this cell that had oldSize bytes has changed
+  void ColdDataResized(size_t oldSize)
+  {
+    wxASSERT_MSG(m_coldDataBytes >= oldSize, _("Bug: Lost track of the size of the ColdData"));
+    m_coldDataBytes -= oldSize;
+    m_coldDataBytes += ColdDataSize();
+  }
+
+  //! The number of bytes the ColdData of all cells occupies
+  static size_t m_coldDataBytes;
+  //! The number of cells that have a ColdData
+  static size_t m_coldDataCells;
+
+  //! An empty string the accessors for the ColdData can return a reference to
+  static const wxString m_emptyString;
+
 virtual std::list<MathCell *> GetInnerCells() = 0;
   
 private:
@@ -906,6 +1037,8 @@ public:
     MathCell *m_cellSearchStartedIn;
     //! Which cursor position incremental search has started at?
     int m_indexSearchStartedAt;
+    //! The GroupCell MathCtrl::CountMatches() continues searching in
+    MathCell *m_cellMatchesCountedUpTo;
     //! Which cell the blinking cursor is in?
     MathCell *m_activeCell;
     //! The GroupCell that is under the mouse pointer 
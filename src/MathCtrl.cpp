@@ -38,6 +38,7 @@
 #include "Bitmap.h"
 #include "Setup.h"
 #include "EditorCell.h"
+#include "StageTimer.h"
 #include "GroupCell.h"
 #include "SlideShowCell.h"
 #include "ImgCell.h"
@@ -54,9 +55,11 @@
 #include <wx/mstream.h>
 #include <wx/dcgraph.h>
 #include <wx/fileconf.h>
+#include <wx/time.h>
 
 #include <wx/zipstrm.h>
 #include <wx/wfstream.h>
+#include <wx/stream.h>
 #include <wx/txtstrm.h>
 #include <wx/filesys.h>
 #include <wx/fs_mem.h>
@@ -65,6 +68,12 @@
 //! The default delay between animation steps in milliseconds
 #define ANIMATION_TIMER_TIMEOUT 300
 
+//! After this many milliseconds without changes a new text change gets its own undo action
+#define UNDO_MERGE_PAUSE 3000
+
+//! Text changes aren't merged into an undo action that has changed more characters than this
+#define UNDO_MERGE_MAXCHARS 200
+
 //! This class represents the worksheet shown in the middle of the wxMaxima window.
 MathCtrl::MathCtrl(wxWindow *parent, int id, wxPoint position, wxSize size) :
         wxScrolledCanvas(
@@ -84,6 +93,10 @@ MathCtrl::MathCtrl(wxWindow *parent, int id, wxPoint position, wxSize size) :
   m_rectToRefresh = wxRect(-1,-1,-1,-1);
   m_notificationMessage = NULL;
   m_dc = new wxClientDC(this);
+  m_layoutSuspended = false;
+  m_matchCountIgnoreCase = false;
+  m_matchCount = 0;
+  m_matchCountFinished = true;
   m_configuration = new Configuration(*m_dc);
   m_configuration->SetWorkSheet(this);
   m_configuration->ReadConfig();
@@ -122,6 +135,8 @@ MathCtrl::MathCtrl(wxWindow *parent, int id, wxPoint position, wxSize size) :
   m_timer.SetOwner(this, TIMER_ID);
   m_caretTimer.SetOwner(this, CARET_TIMER_ID);
   m_saved = false;
+  m_backgroundSaveThread = NULL;
+  m_backgroundSaveMarksAsSaved = false;
   AdjustSize();
   m_autocompleteTemplates = false;
 
@@ -294,6 +309,8 @@ void MathCtrl::RequestRedraw(GroupCell *start)
 
 MathCtrl::~MathCtrl()
 {
+  WaitForBackgroundSave();
+
   if (HasCapture())
     ReleaseMouse();
 
@@ -315,6 +332,7 @@ MathCtrl::~MathCtrl()
  */
 void MathCtrl::OnPaint(wxPaintEvent &WXUNUSED(event))
 {
+  StageTimer::Scope timer(StageTimer::draw);
   #if wxUSE_ACCESSIBILITY
   if(m_accessibilityInfo != NULL)
     m_accessibilityInfo->NotifyEvent(0, this, wxOBJID_CLIENT, wxOBJID_CLIENT);
@@ -692,10 +710,14 @@ void MathCtrl::InsertLine(MathCell *newCell, bool forceNewLine)
 
     tmp->AppendOutput(newCell);
 
-    UpdateConfigurationClientSize();
+    if (!m_layoutSuspended)
+    {
+      StageTimer::Scope timer(StageTimer::layout);
+      UpdateConfigurationClientSize();
     
-    tmp->RecalculateAppended();
-    Recalculate(tmp, false);
+      tmp->RecalculateAppended();
+      Recalculate(tmp, false);
+    }
 
     if (FollowEvaluation())
     {
@@ -749,7 +771,7 @@ void MathCtrl::SetZoomFactor(double newzoom, bool recalc)
 
 void MathCtrl::Recalculate(GroupCell *start, bool force)
 {
-  if(m_dc == NULL)
+  if((m_dc == NULL) || m_layoutSuspended)
     return;
 
   GroupCell *tmp;
@@ -2368,18 +2390,21 @@ void MathCtrl::TreeUndo_ClearBuffers()
   TreeUndo_ActiveCell = NULL;
 }
 
-void MathCtrl::TreeUndo_DiscardAction(std::list<TreeUndoAction *> *actionList)
+size_t MathCtrl::TreeUndo_DiscardAction(std::list<TreeUndoAction *> *actionList)
 {
+  size_t size = 0;
   if(!actionList->empty())
   {
     do
     {
       TreeUndoAction *Action = actionList->back();
+      size += Action->GetSize();
       wxDELETE(Action);
       actionList->pop_back();
     }
     while(!actionList->empty() && (actionList->back()->m_partOfAtomicAction));
   }
+  return size;
 }
 
 void MathCtrl::TreeUndo_CellLeft()
@@ -2402,11 +2427,41 @@ void MathCtrl::TreeUndo_CellLeft()
     (m_treeUndo_ActiveCellOldText.Length() > 1)
     )
   {
+    wxLongLong now = wxGetLocalTimeMillis();
+    long changedChars = labs((long) activeCell->GetEditable()->GetValue().Length() -
+                             (long) m_treeUndo_ActiveCellOldText.Length());
+    if (changedChars < 1)
+      changedChars = 1;
+
+    // If the last thing that happened was a change of this cell's text, too,
+    // the action that is already in the buffer restores an even older text
+    // => we can just drop the intermediate state. Unless the user has paused
+    // or the action already covers a big change: Else a long editing session
+    // would become a single undo step.
+    if (
+      (!treeUndoActions.empty()) &&
+      (treeUndoActions.front()->m_start == activeCell) &&
+      (treeUndoActions.front()->m_oldText != wxEmptyString) &&
+      (treeUndoActions.front()->m_newCellsEnd == NULL) &&
+      (treeUndoActions.front()->m_oldCells == NULL) &&
+      (!treeUndoActions.front()->m_partOfAtomicAction) &&
+      (now - treeUndoActions.front()->m_changeTime < UNDO_MERGE_PAUSE) &&
+      (treeUndoActions.front()->m_changedChars + changedChars <= UNDO_MERGE_MAXCHARS)
+      )
+    {
+      treeUndoActions.front()->m_changeTime = now;
+      treeUndoActions.front()->m_changedChars += changedChars;
+      TreeUndo_ClearRedoActionList();
+      return;
+    }
+
     TreeUndoAction *undoAction = new TreeUndoAction;
     wxASSERT_MSG(activeCell != NULL, _("Bug: Text changed, but no active cell."));
     undoAction->m_start = activeCell;
     wxASSERT_MSG(undoAction->m_start != NULL, _("Bug: Trying to record a cell contents change for undo without a cell."));
     undoAction->m_oldText = m_treeUndo_ActiveCellOldText;
+    undoAction->m_changeTime = now;
+    undoAction->m_changedChars = changedChars;
     treeUndoActions.push_front(undoAction);
     TreeUndo_LimitUndoBuffer();
     TreeUndo_ClearRedoActionList();
@@ -4433,15 +4488,20 @@ struct SimpleMathConfigurationIterator
 };
 
 //returns the index in (%i...) or (%o...)
-int getMathCellIndex(MathCell *cell)
+int getMathCellIndex(wxString strindex)
 {
-  if (!cell) return -1;
-  wxString strindex = cell->ToString().Trim(); //(%i...)
+  strindex.Trim(); //(%i...)
   long temp;
   if (!strindex.Mid(3, strindex.Len() - 4).ToLong(&temp)) return -1;
   return temp;
 }
 
+int getMathCellIndex(MathCell *cell)
+{
+  if (!cell) return -1;
+  return getMathCellIndex(cell->ToString());
+}
+
 void MathCtrl::CalculateReorderedCellIndices(MathCell *tree, int &cellIndex, std::vector<int> &cellMap)
 {
   GroupCell *tmp = dynamic_cast<GroupCell *>(tree);
@@ -4469,7 +4529,7 @@ void MathCtrl::CalculateReorderedCellIndices(MathCell *tree, int &cellIndex, std
         }
 
         long promptIndex = getMathCellIndex(prompt);
-        long outputIndex = getMathCellIndex(tmp->GetLabel()) - initialHiddenExpressions;
+        long outputIndex = getMathCellIndex(tmp->GetLabelText()) - initialHiddenExpressions;
         long index = promptIndex;
         if (promptIndex < 0) index = outputIndex; //no input index => use output index
         else
@@ -5608,7 +5668,10 @@ bool MathCtrl::ExportToTeX(wxString file)
   if (!outfile.IsOk())
     return false;
 
-  wxTextOutputStream output(outfile);
+  // Collect the many small writes in a big buffer instead of handing each
+  // of them to the OS.
+  wxBufferedOutputStream bufferedOutfile(outfile, 1024 * 1024);
+  wxTextOutputStream output(bufferedOutfile);
 
   wxString documentclass = wxT("article");
   wxConfig::Get()->Read(wxT("documentclass"), &documentclass);
@@ -5686,10 +5749,15 @@ bool MathCtrl::ExportToTeX(wxString file)
   //
   // Write contents
   //
+  // The cells append their TeX code to a string that is reused for every cell
+  // so its memory is allocated only once.
+  wxString s;
   while (tmp != NULL)
   {
-    wxString s = tmp->ToTeX(imgDir, filename, &imgCounter);
-    output << s << wxT("\n");
+    s.Truncate(0);
+    tmp->WriteTeX(s, imgDir, filename, &imgCounter);
+    s += wxT("\n");
+    output.WriteString(s);
     tmp = dynamic_cast<GroupCell *>(tmp->m_next);
   }
 
@@ -5698,8 +5766,8 @@ bool MathCtrl::ExportToTeX(wxString file)
   //
   output << wxT("\\end{document}\n");
 
-
-  bool done = !outfile.GetFile()->Error();
+  bufferedOutfile.Close();
+  bool done = bufferedOutfile.IsOk() && !outfile.GetFile()->Error();
   outfile.Close();
 
   return done;
@@ -5883,89 +5951,37 @@ wxString ConvertToUnicode(wxString str)
 /*
   Save the data as wxmx file
 
-  First saves the data to a backup file ending in .wxmx~ so if anything goes
-  horribly wrong in this stepp all that is lost is the data that was input
-  since the last save. Then the original .wxmx file is replaced in a
-  (hopefully) atomic operation.
+  Serializes the worksheet and writes the result using WriteWXMX().
 */
 bool MathCtrl::ExportToWXMX(wxString file, bool markAsSaved)
 {
   // Show a busy cursor as long as we export a file.
   wxBusyCursor crs;
 
-  // delete temp file if it already exists
-  wxString backupfile = file + wxT("~");
-  if (wxFileExists(backupfile))
-  {
-    if (!wxRemoveFile(backupfile))
-      return false;
-  }
+  // A background save might still be writing to the same backup file.
+  WaitForBackgroundSave();
 
-  wxFFileOutputStream out(backupfile);
-  if (!out.IsOk())
+  WXMXSnapshot snapshot;
+  GetWXMXSnapshot(snapshot);
+  if (!WriteWXMX(file, snapshot))
     return false;
-  wxZipOutputStream zip(out);
-  wxTextOutputStream output(zip);
-
-  /* The first zip entry is a file named "mimetype": This makes sure that the mimetype
-     is always stored at the same position in the file. This is common practice. One
-     example from an ePub file:
-
-     00000000  50 4b 03 04 14 00 00 08  00 00 cd bd 0a 43 6f 61  |PK...........Coa|
-     00000010  ab 2c 14 00 00 00 14 00  00 00 08 00 00 00 6d 69  |.,............mi|
-     00000020  6d 65 74 79 70 65 61 70  70 6c 69 63 61 74 69 6f  |metypeapplicatio|
-     00000030  6e 2f 65 70 75 62 2b 7a  69 70 50 4b 03 04 14 00  |n/epub+zipPK....|
-
-  */
 
-  // Make sure that the mime type is stored as plain text.
-  //
-  // We will keep that setting for the rest of the file for the following reasons:
-  //  - Compression of the .zip file won't improve compression of the embedded .png images
-  //  - The text part of the file is too small to justify compression
-  //  - not compressing the text part of the file allows version control systems to
-  //    determine which lines have changed and to track differences between file versions
-  //    efficiently (in a compressed text virtually every byte might change when one
-  //    byte at the start of the uncompressed original is)
-  //  - and if anything crashes in a bad way chances are high that the uncompressed
-  //    contents of the .wxmx file can be rescued using a text editor.
-  //  Who would - under these circumstances - care about a kilobyte?
-  zip.SetLevel(0);
-  zip.PutNextEntry(wxT("mimetype"));
-  output << wxT("text/x-wxmathml");
-  zip.PutNextEntry(wxT("format.txt"));
-  output << wxT(
-          "\n\nThis file contains a wxMaxima session in the .wxmx format.\n"
-                  ".wxmx files are .xml-based files contained in a .zip container like .odt\n"
-                  "or .docx files. After changing their name to end in .zip the .xml and\n"
-                  "eventual bitmap files inside them can be extracted using any .zip file\n"
-                  "viewer.\n"
-                  "The reason why part of a .wxmx file still might still seem to make sense in a\n"
-                  "ordinary text viewer is that the text portion of .wxmx by default\n"
-                  "isn't compressed: The text is typically small and compressing it would\n"
-                  "mean that changing a single character would (with a high probability) change\n"
-                  "big parts of the  whole contents of the compressed .zip archive.\n"
-                  "Even if version control tools like git and svn that remember all changes\n"
-                  "that were ever made to a file can handle binary files compression would\n"
-                  "make the changed part of the file bigger and therefore seriously reduce\n"
-                  "the efficiency of version control\n\n"
-                  "wxMaxima can be downloaded from https://github.com/andrejv/wxmaxima.\n"
-                  "It also is part of the windows installer for maxima\n"
-                  "(http://maxima.sourceforge.net).\n\n"
-                  "If a .wxmx file is broken but the content.xml portion of the file can still be\n"
-                  "viewed using an text editor just save the xml's text as \"content.xml\"\n"
-                  "and try to open it using a recent version of wxMaxima.\n"
-                  "If it is valid XML (the XML header is intact, all opened tags are closed again,\n"
-                  "the text is saved with the text encoding \"UTF8 without BOM\" and the few\n"
-                  "special characters XML requires this for are properly escaped)\n"
-                  "chances are high that wxMaxima will be able to recover all code and text\n"
-                  "from the XML file.\n\n"
-  );
+  if (markAsSaved)
+    m_saved = true;
+  return true;
+}
 
-  // next zip entry is "content.xml", xml of m_tree
+void MathCtrl::GetWXMXSnapshot(WXMXSnapshot &snapshot)
+{
+  snapshot.m_compressionLevel = 0;
+  wxConfig::Get()->Read(wxT("wxmxCompressionLevel"), &snapshot.m_compressionLevel);
+  if (snapshot.m_compressionLevel < 0)
+    snapshot.m_compressionLevel = 0;
+  if (snapshot.m_compressionLevel > 9)
+    snapshot.m_compressionLevel = 9;
 
-  zip.PutNextEntry(wxT("content.xml"));
-  output << wxT("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+  wxString &output = snapshot.m_content;
+  output = wxT("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
   output << wxT("\n<!--   Created by wxMaxima ") << wxT(GITVERSION) << wxT("   -->");
   output << wxT("\n<!--https://andrejv.github.io/wxmaxima/-->\n");
 
@@ -6020,36 +6036,18 @@ bool MathCtrl::ExportToWXMX(wxString file, bool markAsSaved)
   if (ActiveCellNumber >= 0)
     output << wxString::Format(wxT(" activecell=\"%li\""), ActiveCellNumber);
 
-  output << ">\n";
+  output << wxT(">\n");
 
   // Reset image counter
   ImgCell::WXMXResetCounter();
 
-  wxString xmlText;
+  // The cells write themselves directly into the document's text.
   if (m_tree)
-    xmlText = ConvertToUnicode(m_tree->ListToXML());
-  size_t xmlLen = xmlText.Length();
-
-  // Delete all but one control character from the string: there should be
-  // no way for them to enter this string, anyway. But sometimes they still
-  // do...
-  for (size_t index = 0; index < xmlLen; index++)
-  {
-    wxChar c = xmlText[index];
-
-    if ((c < wxT('\t')) ||
-        ((c > wxT('\n')) && (c < wxT(' '))) ||
-        (c == wxChar((char) 0x7F))
-            )
-    {
-      xmlText[index] = wxT(' ');
-    }
-  }
-
-  if (m_tree != NULL)output << xmlText;
+    m_tree->ListWriteXML(output);
   output << wxT("\n</wxMaximaDocument>");
 
-  // save images from memory to zip file
+  // Writing the cells has put the images into the memory filesystem. Take them
+  // out of it so writing the file doesn't need to access it.
   wxFileSystem *fsystem = new wxFileSystem();
   fsystem->AddHandler(new wxMemoryFSHandler);
   fsystem->ChangePathTo(wxT("memory:"), true);
@@ -6067,11 +6065,16 @@ bool MathCtrl::ExportToWXMX(wxString file, bool markAsSaved)
     name = name.Right(name.Length() - 7);
     if (fsfile)
     {
-      zip.PutNextEntry(name);
       wxInputStream *imagefile = fsfile->GetStream();
+      wxMemoryOutputStream data;
 
       while (!(imagefile->Eof()))
-        imagefile->Read(zip);
+        imagefile->Read(data);
+
+      snapshot.m_imageNames.push_back(name);
+      snapshot.m_imageData.push_back(std::vector<char>(data.GetSize()));
+      if (data.GetSize() > 0)
+        data.CopyTo(&snapshot.m_imageData.back()[0], data.GetSize());
 
       wxDELETE(imagefile);
       wxMemoryFSHandler::RemoveFile(name);
@@ -6079,6 +6082,124 @@ bool MathCtrl::ExportToWXMX(wxString file, bool markAsSaved)
   }
 
   wxDELETE(fsystem);
+}
+
+/*
+  Save the data as wxmx file
+
+  First saves the data to a backup file ending in .wxmx~ so if anything goes
+  horribly wrong in this stepp all that is lost is the data that was input
+  since the last save. Then the original .wxmx file is replaced in a
+  (hopefully) atomic operation.
+*/
+bool MathCtrl::WriteWXMX(const wxString &file, WXMXSnapshot &snapshot)
+{
+  // delete temp file if it already exists
+  wxString backupfile = file + wxT("~");
+  if (wxFileExists(backupfile))
+  {
+    if (!wxRemoveFile(backupfile))
+      return false;
+  }
+
+  wxFFileOutputStream out(backupfile);
+  if (!out.IsOk())
+    return false;
+  wxZipOutputStream zip(out);
+  wxTextOutputStream output(zip);
+
+  /* The first zip entry is a file named "mimetype": This makes sure that the mimetype
+     is always stored at the same position in the file. This is common practice. One
+     example from an ePub file:
+
+     00000000  50 4b 03 04 14 00 00 08  00 00 cd bd 0a 43 6f 61  |PK...........Coa|
+     00000010  ab 2c 14 00 00 00 14 00  00 00 08 00 00 00 6d 69  |.,............mi|
+     00000020  6d 65 74 79 70 65 61 70  70 6c 69 63 61 74 69 6f  |metypeapplicatio|
+     00000030  6e 2f 65 70 75 62 2b 7a  69 70 50 4b 03 04 14 00  |n/epub+zipPK....|
+
+  */
+
+  // Make sure that the mime type is stored as plain text.
+  //
+  // By default we will keep that setting for the rest of the file for the following reasons:
+  //  - Compression of the .zip file won't improve compression of the embedded .png images
+  //  - The text part of the file is typically too small to justify compression
+  //  - not compressing the text part of the file allows version control systems to
+  //    determine which lines have changed and to track differences between file versions
+  //    efficiently (in a compressed text virtually every byte might change when one
+  //    byte at the start of the uncompressed original is)
+  //  - and if anything crashes in a bad way chances are high that the uncompressed
+  //    contents of the .wxmx file can be rescued using a text editor.
+  // Users with huge worksheets that aren't under version control can ask for
+  // content.xml to be compressed, though.
+  zip.SetLevel(0);
+  zip.PutNextEntry(wxT("mimetype"));
+  output << wxT("text/x-wxmathml");
+  zip.PutNextEntry(wxT("format.txt"));
+  output << wxT(
+          "\n\nThis file contains a wxMaxima session in the .wxmx format.\n"
+                  ".wxmx files are .xml-based files contained in a .zip container like .odt\n"
+                  "or .docx files. After changing their name to end in .zip the .xml and\n"
+                  "eventual bitmap files inside them can be extracted using any .zip file\n"
+                  "viewer.\n"
+                  "The reason why part of a .wxmx file still might still seem to make sense in a\n"
+                  "ordinary text viewer is that the text portion of .wxmx by default\n"
+                  "isn't compressed: The text is typically small and compressing it would\n"
+                  "mean that changing a single character would (with a high probability) change\n"
+                  "big parts of the  whole contents of the compressed .zip archive.\n"
+                  "Even if version control tools like git and svn that remember all changes\n"
+                  "that were ever made to a file can handle binary files compression would\n"
+                  "make the changed part of the file bigger and therefore seriously reduce\n"
+                  "the efficiency of version control\n\n"
+                  "wxMaxima can be downloaded from https://github.com/andrejv/wxmaxima.\n"
+                  "It also is part of the windows installer for maxima\n"
+                  "(http://maxima.sourceforge.net).\n\n"
+                  "If a .wxmx file is broken but the content.xml portion of the file can still be\n"
+                  "viewed using an text editor just save the xml's text as \"content.xml\"\n"
+                  "and try to open it using a recent version of wxMaxima.\n"
+                  "If it is valid XML (the XML header is intact, all opened tags are closed again,\n"
+                  "the text is saved with the text encoding \"UTF8 without BOM\" and the few\n"
+                  "special characters XML requires this for are properly escaped)\n"
+                  "chances are high that wxMaxima will be able to recover all code and text\n"
+                  "from the XML file.\n\n"
+  );
+
+  // next zip entry is "content.xml", xml of m_tree
+
+  zip.SetLevel(snapshot.m_compressionLevel);
+  zip.PutNextEntry(wxT("content.xml"));
+
+  wxString &xmlText = snapshot.m_content;
+  size_t xmlLen = xmlText.Length();
+
+  // Delete all but one control character from the string: there should be
+  // no way for them to enter this string, anyway. But sometimes they still
+  // do...
+  for (size_t index = 0; index < xmlLen; index++)
+  {
+    wxChar c = xmlText[index];
+
+    if ((c < wxT('\t')) ||
+        ((c > wxT('\n')) && (c < wxT(' '))) ||
+        (c == wxChar((char) 0x7F))
+            )
+    {
+      xmlText[index] = wxT(' ');
+    }
+  }
+
+  output << ConvertToUnicode(xmlText);
+
+  // The images already are compressed => store them as they are
+  zip.SetLevel(0);
+
+  // save the images
+  for (unsigned int i = 0; i < snapshot.m_imageNames.size(); i++)
+  {
+    zip.PutNextEntry(snapshot.m_imageNames[i]);
+    if (!snapshot.m_imageData[i].empty())
+      zip.Write(&snapshot.m_imageData[i][0], snapshot.m_imageData[i].size());
+  }
 
   if (!zip.Close())
     return false;
@@ -6099,11 +6220,85 @@ bool MathCtrl::ExportToWXMX(wxString file, bool markAsSaved)
         return false;
     }
   }
+  return true;
+}
+
+//! The thread MathCtrl::ExportToWXMXInBackground() writes the file in
+class WXMXSaveThread : public wxThread
+{
+public:
+  //! The thread takes ownership of snapshot
+  WXMXSaveThread(wxEvtHandler *handler, const wxString &file, MathCtrl::WXMXSnapshot *snapshot) :
+    wxThread(wxTHREAD_JOINABLE)
+  {
+    m_handler = handler;
+    m_file = file;
+    m_snapshot = snapshot;
+  }
+
+  ~WXMXSaveThread()
+  {
+    wxDELETE(m_snapshot);
+  }
+
+protected:
+  ExitCode Entry()
+  {
+    bool success;
+    {
+      // Failures are reported to the GUI thread by the event below.
+      wxLogNull suppressErrorDialogs;
+      success = MathCtrl::WriteWXMX(m_file, *m_snapshot);
+    }
+
+    wxThreadEvent *event = new wxThreadEvent(wxEVT_THREAD, wxMaximaFrame::background_save_finished_id);
+    event->SetInt(success);
+    event->SetString(m_file);
+    wxQueueEvent(m_handler, event);
+    return (ExitCode) (wxIntPtr) (success ? 0 : 1);
+  }
+
+private:
+  wxEvtHandler *m_handler;
+  wxString m_file;
+  MathCtrl::WXMXSnapshot *m_snapshot;
+};
+
+bool MathCtrl::ExportToWXMXInBackground(wxString file, bool markAsSaved)
+{
+  if (m_backgroundSaveThread != NULL)
+    return false;
+
+  WXMXSnapshot *snapshot = new WXMXSnapshot;
+  GetWXMXSnapshot(*snapshot);
+
+  m_backgroundSaveThread = new WXMXSaveThread(GetParent()->GetEventHandler(), file, snapshot);
+  if (m_backgroundSaveThread->Run() != wxTHREAD_NO_ERROR)
+  {
+    // No thread => Save the file in the foreground, instead.
+    wxDELETE(m_backgroundSaveThread);
+    return ExportToWXMX(file, markAsSaved);
+  }
+
+  // Changes made from now on will mark the worksheet as modified again.
+  m_backgroundSaveMarksAsSaved = markAsSaved;
   if (markAsSaved)
     m_saved = true;
   return true;
 }
 
+void MathCtrl::WaitForBackgroundSave()
+{
+  if (m_backgroundSaveThread == NULL)
+    return;
+
+  bool success = (m_backgroundSaveThread->Wait() == 0);
+  wxDELETE(m_backgroundSaveThread);
+
+  if ((!success) && m_backgroundSaveMarksAsSaved)
+    m_saved = false;
+}
+
 /**!
  * CanEdit: we can edit the input if the we have the whole input in selection!
  */
@@ -6498,11 +6693,23 @@ void MathCtrl::TreeUndo_LimitUndoBuffer()
   if (undoLimit < 0)
     undoLimit = 0;
   
-  if (undoLimit == 0)
+  if (undoLimit > 0)
+  {
+    while ((long) treeUndoActions.size() > undoLimit)
+      TreeUndo_DiscardAction(&treeUndoActions);
+  }
+
+  long undoMemoryLimit = 256;
+  config->Read(wxT("undoMemoryLimit"), &undoMemoryLimit);
+  if (undoMemoryLimit <= 0)
     return;
 
-  while ((long) treeUndoActions.size() > undoLimit)
-    TreeUndo_DiscardAction(&treeUndoActions);
+  size_t memoryLimit = (size_t) undoMemoryLimit * 1024 * 1024;
+  size_t size = 0;
+  for (std::list<TreeUndoAction *>::iterator it = treeUndoActions.begin(); it != treeUndoActions.end(); ++it)
+    size += (*it)->GetSize();
+  while ((treeUndoActions.size() > 1) && (size > memoryLimit))
+    size -= TreeUndo_DiscardAction(&treeUndoActions);
 }
 
 bool MathCtrl::CanTreeUndo()
@@ -7705,6 +7912,54 @@ int MathCtrl::ReplaceAll(wxString oldString, wxString newString, bool ignoreCase
   return count;
 }
 
+void MathCtrl::StartCountingMatches(wxString str, bool ignoreCase)
+{
+  m_matchCountString = str;
+  m_matchCountIgnoreCase = ignoreCase;
+  m_matchCount = 0;
+  m_matchCountFinished = (str == wxEmptyString);
+  m_cellPointers.m_cellMatchesCountedUpTo = m_tree;
+}
+
+bool MathCtrl::CountMatches(int maxCells)
+{
+  if (m_matchCountFinished)
+    return false;
+
+  // If the cell we would have continued with has been deleted we have to start over.
+  GroupCell *tmp = dynamic_cast<GroupCell *>(m_cellPointers.m_cellMatchesCountedUpTo);
+  if (tmp == NULL)
+  {
+    m_matchCount = 0;
+    tmp = m_tree;
+  }
+
+  for (; (tmp != NULL) && (maxCells > 0); tmp = dynamic_cast<GroupCell *>(tmp->m_next), maxCells--)
+  {
+    EditorCell *editor = dynamic_cast<EditorCell *>(tmp->GetEditable());
+    if (editor != NULL)
+      m_matchCount += editor->FindAll(m_matchCountString, m_matchCountIgnoreCase);
+  }
+
+  m_cellPointers.m_cellMatchesCountedUpTo = tmp;
+  m_matchCountFinished = (tmp == NULL);
+  return m_matchCountFinished;
+}
+
+bool MathCtrl::UpdateSearchIndex(int maxCells)
+{
+  for (GroupCell *tmp = m_tree; tmp != NULL; tmp = dynamic_cast<GroupCell *>(tmp->m_next))
+  {
+    EditorCell *editor = dynamic_cast<EditorCell *>(tmp->GetEditable());
+    if ((editor != NULL) && (editor->UpdateSearchIndex()))
+    {
+      if (--maxCells <= 0)
+        return true;
+    }
+  }
+  return false;
+}
+
 bool MathCtrl::Autocomplete(AutoComplete::autoCompletionType type)
 {
   EditorCell *editor = GetActiveCell();
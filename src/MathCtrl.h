@@ -33,7 +33,9 @@
 #include <wx/aui/aui.h>
 #include <wx/textfile.h>
 #include <wx/fdrepdlg.h>
+#include <wx/thread.h>
 #include <list>
+#include <vector>
 
 #include "Notification.h"
 #include "MathCell.h"
@@ -93,6 +95,16 @@ private:
     Drawing is done from a wxPaintDC in OnPaint() instead.
   */
   wxDC *m_dc;
+  //! Don't calculate the sizes and positions of cells? See SuspendLayout()
+  bool m_layoutSuspended;
+  //! The string StartCountingMatches() counts the occurrences of
+  wxString m_matchCountString;
+  //! Does StartCountingMatches() count case-insensitive matches?
+  bool m_matchCountIgnoreCase;
+  //! The number of matches in the cells before m_cellPointers.m_cellMatchesCountedUpTo
+  long m_matchCount;
+  //! Have all cells been searched for m_matchCountString?
+  bool m_matchCountFinished;
   //! Where do we need to start the repainting of the worksheet?
   GroupCell *m_redrawStart;
   //! Do we need to redraw the worksheet?
@@ -213,6 +225,9 @@ private:
       wxDELETE(m_oldCells);
       m_oldCells = NULL;
       m_partOfAtomicAction = false;
+      m_size = 0;
+      m_changeTime = 0;
+      m_changedChars = 0;
     }
 
     TreeUndoAction()
@@ -222,6 +237,25 @@ private:
       m_newCellsEnd = NULL;
       m_oldCells = NULL;
       m_partOfAtomicAction = false;
+      m_size = 0;
+      m_changeTime = 0;
+      m_changedChars = 0;
+    }
+
+    /*! Roughly how many bytes this action keeps alive
+
+      Deleted cells are kept in the undo buffer by reference and aren't changed
+      while they are there => the result is calculated only once.
+     */
+    size_t GetSize()
+    {
+      if (m_size == 0)
+      {
+        m_size = sizeof(TreeUndoAction) + m_oldText.Length() * sizeof(wxChar);
+        if (m_oldCells != NULL)
+          m_size += m_oldCells->SizeInMemoryList();
+      }
+      return m_size;
     }
 
     //! True = This undo action is only part of an atomic undo action.
@@ -256,6 +290,16 @@ private:
       If this field's value is NULL no cells have to be added to undo this action.
     */
     GroupCell *m_oldCells;
+
+    //! When the last text change that has been merged into this action has happened
+    wxLongLong m_changeTime;
+
+    //! Roughly how many characters the text changes merged into this action have changed
+    long m_changedChars;
+
+  private:
+    //! The cached result of GetSize(); 0 = not calculated yet.
+    size_t m_size;
   };
 
   //! The list of tree actions that can be undone
@@ -273,8 +317,11 @@ private:
   //! Clear the list of actions for which undo can undo
   void TreeUndo_ClearUndoActionList();
 
-  //! Remove one action ftom the action list
-  void TreeUndo_DiscardAction(std::list<TreeUndoAction *> *actionList);
+  /*! Remove one action ftom the action list
+
+    \return The sum of the GetSize() of the actions that were discarded
+   */
+  size_t TreeUndo_DiscardAction(std::list<TreeUndoAction *> *actionList);
 
   //! Add another action to this undo action
   void TreeUndo_AppendAction(std::list<TreeUndoAction *> *actionList)
@@ -292,7 +339,12 @@ private:
    */
   GroupCell *TreeUndo_ActiveCell;
 
-  //! Drop actions from the back of the undo list until itis within the undo limit.
+  /*! Drop actions from the back of the undo list until it is within the undo limit.
+
+    Both the maximum number of actions ("undoLimit") and the maximum amount of
+    memory the actions may keep alive ("undoMemoryLimit", in MB) are enforced.
+    The newest action is never dropped.
+   */
   void TreeUndo_LimitUndoBuffer();
 
   /*! Undo an item from a list of undo actions.
@@ -563,6 +615,10 @@ private:
   wxBitmap m_memory;
   //! True if no changes have to be saved.
   bool m_saved;
+  //! The thread a background save is running in, if any.
+  wxThread *m_backgroundSaveThread;
+  //! Does the background save that is running clear the "modified" status?
+  bool m_backgroundSaveMarksAsSaved;
   AutoComplete m_autocomplete;
   wxArrayString m_completions;
   bool m_autocompleteTemplates;
@@ -895,6 +951,18 @@ public:
   void Recalculate(bool force = false)
   { Recalculate(m_tree, force); }
 
+  /*! Stop calculating the sizes and positions of cells
+
+    Used if the worksheet is never displayed, for example in headless batch mode:
+    Saving a document doesn't require it to be laid out.
+   */
+  void SuspendLayout(bool suspend)
+  { m_layoutSuspended = suspend; }
+
+  //! Are we currently refraining from calculating the sizes and positions of cells?
+  bool LayoutSuspended()
+  { return m_layoutSuspended; }
+
   //! Force a full recalculation of the worksheet
   void RecalculateForce()
   {
@@ -1068,6 +1136,47 @@ public:
   */
   bool ExportToWXMX(wxString file, bool markAsSaved = true);
 
+  //! The contents of a .wxmx file that still has to be written to disk
+  struct WXMXSnapshot
+  {
+    //! The text of content.xml
+    wxString m_content;
+    //! The zip compression level for content.xml: 0 = stored, 9 = smallest
+    int m_compressionLevel;
+    //! The names of the image files
+    std::vector<wxString> m_imageNames;
+    //! The contents of the image files
+    std::vector<std::vector<char> > m_imageData;
+  };
+
+  //! Serialize the worksheet into snapshot
+  void GetWXMXSnapshot(WXMXSnapshot &snapshot);
+
+  /*! Write a snapshot to a .wxmx file
+
+    Doesn't access the worksheet which means it can be called from a background
+    thread. Writes to a backup file first that is then renamed to file.
+   */
+  static bool WriteWXMX(const wxString &file, WXMXSnapshot &snapshot);
+
+  /*! Export to a .wxmx file, compressing and writing the data in a background thread
+
+    Only serializing the worksheet is done in the GUI thread. When the file
+    has been written, the parent window receives a wxThreadEvent with the ID
+    wxMaximaFrame::background_save_finished_id whose int tells whether saving
+    succeeded and whose string contains the file name.
+
+    \return false, if a background save is already running.
+  */
+  bool ExportToWXMXInBackground(wxString file, bool markAsSaved = true);
+
+  /*! Wait for a save started by ExportToWXMXInBackground() to finish
+
+    If the save has failed and was meant to clear the worksheet's "modified"
+    status the worksheet is marked as modified again.
+   */
+  void WaitForBackgroundSave();
+
   //! The start of a RTF document
   wxString RTFStart();
 
@@ -1319,24 +1428,63 @@ public:
    */
   bool FindNext(wxString str, bool down, bool ignoreCase, bool warn = true);
 
-  /*! Replace the current ocourrence of a string
+  /*! Replace the current occurrence of a string
 
     Used by the find dialog.
    */
   void Replace(wxString oldString, wxString newString, bool ignoreCase);
 
-  /*! Replace all ocourrences of a string
+  /*! Replace all occurrences of a string
 
     Used by the find dialog.
    */
   int ReplaceAll(wxString oldString, wxString newString, bool ignoreCase);
 
+  /*! Start counting all occurrences of a string in the input cells
+
+    Used by the find dialog. The cells are searched in small steps by
+    CountMatches() so typing into the find dialog never has to wait for the
+    whole worksheet to be searched.
+   */
+  void StartCountingMatches(wxString str, bool ignoreCase);
+
+  /*! Search up to maxCells more cells for the string StartCountingMatches() was called for
+
+    \return true, if the last cell has been searched with this call: MatchCount()
+            now is the number of occurrences in the whole worksheet.
+   */
+  bool CountMatches(int maxCells);
+
+  //! Are there cells left CountMatches() still has to search?
+  bool CountingMatches()
+  { return !m_matchCountFinished; }
+
+  //! The number of occurrences CountMatches() has found.
+  long MatchCount()
+  { return m_matchCount; }
+
+  /*! Brings the search index of up to maxCells cells up-to-date
+
+    Called from the idle task while the find dialog is open so the index
+    is built in the background.
+    \return true, if there are cells left whose index is outdated.
+   */
+  bool UpdateSearchIndex(int maxCells);
+
   wxString GetInputAboveCaret();
 
   wxString GetOutputAboveCaret();
 
-  bool LoadSymbols(wxString file)
-  { return m_autocomplete.LoadSymbols(file); }
+  void LoadSymbols()
+  { m_autocomplete.LoadSymbols(); }
+
+  //! Load the autocompletion symbols in a background thread
+  void LoadSymbolsInBackground()
+  { m_autocomplete.LoadSymbolsInBackground(); }
+
+  //! Read the names of the files in dir for autocompletion in a background thread
+  void IndexDirectoryInBackground(wxString dir)
+  { m_autocomplete.IndexDirectoryInBackground(dir); }
 
   bool Autocomplete(AutoComplete::autoCompletionType type = AutoComplete::command);
 
@@ -76,7 +76,7 @@ wxXmlNode *MathParser::GetNextTag(wxXmlNode *node)
   return SkipWhitespaceNode(node);
 }
 
-MathParser::MathParser(Configuration **cfg, MathCell::CellPointers *cellPointers, wxString zipfile)
+MathParser::MathParser(Configuration **cfg, MathCell::CellPointers *cellPointers, WXMXArchive *archive)
 {
   wxASSERT(m_graphRegex.Compile(wxT("[[:cntrl:]]")));
   m_configuration = cfg;
@@ -84,19 +84,11 @@ MathParser::MathParser(Configuration **cfg, MathCell::CellPointers *cellPointers
   m_ParserStyle = MC_TYPE_DEFAULT;
   m_FracStyle = FracCell::FC_NORMAL;
   m_highlight = false;
-  if (zipfile.Length() > 0)
-  {
-    m_fileSystem = new wxFileSystem();
-    m_fileSystem->ChangePathTo(zipfile + wxT("#zip:/"), true);
-  }
-  else
-    m_fileSystem = NULL;
+  m_archive = archive;
 }
 
 MathParser::~MathParser()
 {
-  if (m_fileSystem)
-    wxDELETE(m_fileSystem);
 }
 
 // ParseCellTag
@@ -665,24 +657,139 @@ MathCell *MathParser::ParseTableTag(wxXmlNode *node)
   if (node->GetAttribute(wxT("rownames"), wxT("false")) == wxT("true"))
     matrix->RowNames(true);
 
+  long packedColumns = 0;
+  if (node->GetAttribute(wxT("packed"), wxT("0")).ToLong(&packedColumns) && (packedColumns > 0))
+    ParsePackedNumbers(node, matrix, packedColumns);
+  else
+  {
+    // Big matrices that only contain numbers don't need a list of cells per entry.
+    bool numeric = IsNumericTable(node);
+    wxXmlNode *rows = SkipWhitespaceNode(node->GetChildren());
+    while (rows)
+    {
+      matrix->NewRow();
+      wxXmlNode *cells = SkipWhitespaceNode(rows->GetChildren());
+      while (cells)
+      {
+        matrix->NewColumn();
+        if (numeric)
+          matrix->AddNewNumber(GetPlainNumber(cells->GetChildren()));
+        else
+          matrix->AddNewCell(HandleNullPointer(ParseTag(cells, false)));
+        cells = GetNextTag(cells);
+      }
+      rows = rows->GetNext();
+    }
+  }
+  matrix->SetType(m_ParserStyle);
+  matrix->SetStyle(TS_VARIABLE);
+  matrix->SetDimension();
+  ParseCommonAttrs(node, matrix);
+  return matrix;
+}
+
+wxString MathParser::GetPlainNumber(wxXmlNode *node)
+{
+  wxString sign;
+  node = SkipWhitespaceNode(node);
+
+  // Negative numbers are sent as a "-" followed by the number
+  if ((node != NULL) && (node->GetType() == wxXML_ELEMENT_NODE) &&
+      (node->GetName() == wxT("v")) && (node->GetAttributes() == NULL) &&
+      (node->GetNodeContent() == wxT("-")))
+  {
+    sign = wxT("-");
+    node = GetNextTag(node);
+  }
+
+  if ((node == NULL) || (node->GetType() != wxXML_ELEMENT_NODE) ||
+      (node->GetName() != wxT("n")) || (node->GetAttributes() != NULL) ||
+      (GetNextTag(node) != NULL))
+    return wxEmptyString;
+
+  wxString number = node->GetNodeContent();
+  number.Trim(true);
+  number.Trim(false);
+  if (number.IsEmpty() || ((int) number.Length() > (*m_configuration)->GetDisplayedDigits()))
+    return wxEmptyString;
+  return sign + number;
+}
+
+void MathParser::ParsePackedNumbers(wxXmlNode *node, MatrCell *matrix, long columns)
+{
+  // Split the text into the numbers without creating a tokenizer.
+  wxString text = node->GetNodeContent();
+  std::vector<wxString> numbers;
+  bool fitsNumericMode = true;
+  wxString::const_iterator it = text.begin();
+  while (it != text.end())
+  {
+    while ((it != text.end()) && wxIsspace(*it))
+      ++it;
+    wxString::const_iterator start = it;
+    while ((it != text.end()) && !wxIsspace(*it))
+      ++it;
+    if (it != start)
+    {
+      numbers.push_back(wxString(start, it));
+      if ((int) numbers.back().Length() > (*m_configuration)->GetDisplayedDigits())
+        fitsNumericMode = false;
+    }
+  }
+  if ((int) numbers.size() < MatrCell::m_minNumericEntries)
+    fitsNumericMode = false;
+
+  size_t rows = numbers.size() / columns;
+  for (size_t row = 0; row < rows; row++)
+  {
+    matrix->NewRow();
+    for (long column = 0; column < columns; column++)
+    {
+      const wxString &number = numbers[row * columns + column];
+      matrix->NewColumn();
+      if (fitsNumericMode)
+        matrix->AddNewNumber(number);
+      else
+      {
+        // Numbers that are too long for being displayed in full are shortened
+        // by TextCell.
+        TextCell *cell = new TextCell(NULL, m_configuration, m_cellPointers);
+        cell->SetType(m_ParserStyle);
+        cell->SetStyle(TS_NUMBER);
+        cell->SetHighlight(m_highlight);
+        wxString value = number;
+#if wxUSE_UNICODE
+        value.Replace(wxT("-"), wxT("\x2212")); // unicode minus sign
+#endif
+        cell->SetValue(value);
+        matrix->AddNewCell(cell);
+      }
+    }
+  }
+}
+
+bool MathParser::IsNumericTable(wxXmlNode *node)
+{
+  if (node->GetAttribute(wxT("special"), wxT("false")) == wxT("true"))
+    return false;
+  if (node->GetAttribute(wxT("inference"), wxT("false")) == wxT("true"))
+    return false;
+
+  int entries = 0;
   wxXmlNode *rows = SkipWhitespaceNode(node->GetChildren());
   while (rows)
   {
-    matrix->NewRow();
     wxXmlNode *cells = SkipWhitespaceNode(rows->GetChildren());
     while (cells)
     {
-      matrix->NewColumn();
-      matrix->AddNewCell(HandleNullPointer(ParseTag(cells, false)));
+      if (GetPlainNumber(cells->GetChildren()) == wxEmptyString)
+        return false;
+      entries++;
       cells = GetNextTag(cells);
     }
     rows = rows->GetNext();
   }
-  matrix->SetType(m_ParserStyle);
-  matrix->SetStyle(TS_VARIABLE);
-  matrix->SetDimension();
-  ParseCommonAttrs(node, matrix);
-  return matrix;
+  return entries >= MatrCell::m_minNumericEntries;
 }
 
 MathCell *MathParser::ParseTag(wxXmlNode *node, bool all)
@@ -860,8 +967,8 @@ MathCell *MathParser::ParseTag(wxXmlNode *node, bool all)
         filename = filename1;
 #endif
 
-        if (m_fileSystem) // loading from zip
-          imageCell = new ImgCell(NULL, m_configuration, m_cellPointers, filename, false, m_fileSystem);
+        if (m_archive) // loading from zip
+          imageCell = new ImgCell(NULL, m_configuration, m_cellPointers, filename, false, m_archive);
         else
         {
           if (node->GetAttribute(wxT("del"), wxT("yes")) != wxT("no"))
@@ -903,7 +1010,7 @@ MathCell *MathParser::ParseTag(wxXmlNode *node, bool all)
       else if (tagName == wxT("slide"))
       {
         bool del = node->GetAttribute(wxT("del"), wxT("false")) == wxT("true");
-        SlideShow *slideShow = new SlideShow(NULL, m_configuration, m_cellPointers, m_fileSystem);
+        SlideShow *slideShow = new SlideShow(NULL, m_configuration, m_cellPointers, m_archive);
         wxString str(node->GetChildren()->GetContent());
         wxArrayString images;
         wxString framerate;
@@ -29,11 +29,10 @@ The header file for the xml cell parser
 
 #include <wx/xml/xml.h>
 
-#include <wx/filesys.h>
-#include <wx/fs_arc.h>
-
 #include "MathCell.h"
 #include "TextCell.h"
+#include "MatrCell.h"
+#include "WXMXArchive.h"
 
 /*! This class handles parsing the xml representation of a cell tree.
 
@@ -43,7 +42,12 @@ inside a wxmx file
 class MathParser
 {
 public:
-  MathParser(Configuration **cfg, MathCell::CellPointers *cellPointers, wxString zipfile = wxEmptyString);
+  /*! The constructor
+
+    \param archive The .wxmx archive images are loaded from. NULL = load them from
+                   the operating system's filesystem.
+   */
+  MathParser(Configuration **cfg, MathCell::CellPointers *cellPointers, WXMXArchive *archive = NULL);
 
   ~MathParser();
 
@@ -108,6 +112,26 @@ private:
 
   MathCell *ParseTableTag(wxXmlNode *node);
 
+  /*! The number a matrix entry consists of
+
+    \param node The first child of the <mtd> tag.
+    \return The number, including its sign, if the entry is a plain number
+    that isn't shortened on display. Otherwise wxEmptyString.
+   */
+  wxString GetPlainNumber(wxXmlNode *node);
+
+  //! Is node a matrix that only contains plain numbers and is big enough for MatrCell's numeric mode?
+  bool IsNumericTable(wxXmlNode *node);
+
+  /*! Reads the entries of a matrix maxima has sent in packed form
+
+    Big matrices of plain numbers are sent as a <tb packed="columns"> tag
+    that contains the numbers separated by spaces instead of a tag per row
+    and entry. This saves most of the bytes and doesn't create a XML node
+    per entry.
+   */
+  void ParsePackedNumbers(wxXmlNode *node, MatrCell *matrix, long columns);
+
   MathCell *ParseAtTag(wxXmlNode *node);
 
   MathCell *ParseDiffTag(wxXmlNode *node);
@@ -134,7 +158,7 @@ private:
   MathCell::CellPointers *m_cellPointers;
   Configuration **m_configuration;
   bool m_highlight;
-  wxFileSystem *m_fileSystem; // used for loading pictures in <img> and <slide>
+  WXMXArchive *m_archive; // used for loading pictures in <img> and <slide>
 };
 
 #endif // MATHPARSER_H
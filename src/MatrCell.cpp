@@ -36,6 +36,9 @@ MatrCell::MatrCell(MathCell *parent, Configuration **config, CellPointers *cellP
   m_specialMatrix = false;
   m_inferenceMatrix = false;
   m_rowNames = m_colNames = false;
+  m_numberFontSize = -1;
+  m_numberZoomFactor = -1;
+  m_numberHeight = 0;
 }
 
 void MatrCell::SetGroup(MathCell *parent)
@@ -58,12 +61,51 @@ MathCell *MatrCell::Copy()
   tmp->m_colNames = m_colNames;
   tmp->m_matWidth = m_matWidth;
   tmp->m_matHeight = m_matHeight;
-  for (int i = 0; i < m_matWidth * m_matHeight; i++)
-    (tmp->m_cells).push_back(m_cells[i]->CopyList());
+  if (IsNumeric())
+    tmp->m_numbers = m_numbers;
+  else
+    for (int i = 0; i < m_matWidth * m_matHeight; i++)
+      (tmp->m_cells).push_back(m_cells[i]->CopyList());
 
   return tmp;
 }
 
+size_t MatrCell::SizeInMemory()
+{
+  size_t size = sizeof(MatrCell) + ColdDataSize() +
+    (m_widths.size() + m_drops.size() + m_centers.size()) * sizeof(int) +
+    m_cells.size() * sizeof(MathCell *) +
+    m_numbers.size() * sizeof(wxString);
+  for (unsigned int i = 0; i < m_numbers.size(); i++)
+    size += m_numbers[i].Length() * sizeof(wxChar);
+  return size;
+}
+
+wxString MatrCell::GetToolTip(const wxPoint &point)
+{
+  if (!IsNumeric())
+    return MathCell::GetToolTip(point);
+
+  if (!ContainsPoint(point))
+    return wxEmptyString;
+  if (GetLocalToolTip() != wxEmptyString)
+    return GetLocalToolTip();
+
+  // Tell which entry the mouse pointer is over: In a big matrix this isn't obvious.
+  int row = (point.y - (m_currentPoint.y - m_center + Scale_Px(5))) / (m_numberHeight + Scale_Px(10));
+  if ((row < 0) || (row >= m_matHeight))
+    return wxEmptyString;
+  int x = m_currentPoint.x + Scale_Px(5);
+  for (int col = 0; col < m_matWidth; col++)
+  {
+    x += m_widths[col] + Scale_Px(10);
+    if (point.x < x)
+      return wxString::Format(_("Row %i, column %i: %s"), row + 1, col + 1,
+                              m_numbers[row * m_matWidth + col]);
+  }
+  return wxEmptyString;
+}
+
 MatrCell::~MatrCell()
 {
   for (unsigned int i = 0; i < m_cells.size(); i++)
@@ -85,19 +127,86 @@ std::list<MathCell *> MatrCell::GetInnerCells()
 
 
 
-void MatrCell::RecalculateWidths(int fontsize)
+void MatrCell::SetNumberFont(int fontsize)
+{
+  Configuration *configuration = (*m_configuration);
+  wxFont font = configuration->GetFont(TS_NUMBER, fontsize);
+  if (!font.IsOk())
+    font = *wxNORMAL_FONT;
+  font.SetPointSize(Scale_Px(MAX(4, fontsize)));
+  configuration->GetDC()->SetFont(font);
+}
+
+int MatrCell::NumberWidth(const wxString &number)
 {
-  for (int i = 0; i < m_matWidth * m_matHeight; i++)
+  int width = 0;
+  for (wxString::const_iterator it = number.begin(); it != number.end(); ++it)
   {
-    m_cells[i]->RecalculateWidthsList(MAX(MC_MIN_SIZE, fontsize - 2));
+    long ch = (*it).GetValue();
+    if ((ch < 0) || (ch >= 128))
+    {
+      // Not a character we cache the width of => Measure the whole number
+      int height;
+      (*m_configuration)->GetDC()->GetTextExtent(number, &width, &height);
+      break;
+    }
+    if (m_charWidths[ch] < 0)
+    {
+      int height;
+      (*m_configuration)->GetDC()->GetTextExtent(wxString(*it), &m_charWidths[ch], &height);
+    }
+    width += m_charWidths[ch];
   }
+  return width + 2 * Scale_Px(MC_TEXT_PADDING);
+}
+
+void MatrCell::RecalculateNumberWidths(int fontsize)
+{
+  Configuration *configuration = (*m_configuration);
+
+  // The entries don't change => the columns only need to be measured again
+  // if the font has changed.
+  if ((m_numberFontSize == fontsize) &&
+      (m_numberZoomFactor == configuration->GetZoomFactor()) &&
+      (!configuration->ForceUpdate()) &&
+      ((int) m_widths.size() == m_matWidth))
+    return;
+
+  m_numberFontSize = fontsize;
+  m_numberZoomFactor = configuration->GetZoomFactor();
+  SetNumberFont(fontsize);
+  for (int i = 0; i < 128; i++)
+    m_charWidths[i] = -1;
+
+  int width;
+  configuration->GetDC()->GetTextExtent(wxT("0123456789"), &width, &m_numberHeight);
+  m_numberHeight += 2 * Scale_Px(MC_TEXT_PADDING);
+
   m_widths.clear();
-  for (int i = 0; i < m_matWidth; i++)
+  m_widths.resize(m_matWidth, 0);
+  for (int j = 0; j < m_matHeight; j++)
+    for (int i = 0; i < m_matWidth; i++)
+      m_widths[i] = MAX(m_widths[i], NumberWidth(m_numbers[m_matWidth * j + i]));
+}
+
+void MatrCell::RecalculateWidths(int fontsize)
+{
+  if (IsNumeric())
+    RecalculateNumberWidths(MAX(MC_MIN_SIZE, fontsize - 2));
+  else
   {
-    m_widths.push_back(0);
-    for (int j = 0; j < m_matHeight; j++)
+    for (int i = 0; i < m_matWidth * m_matHeight; i++)
     {
-      m_widths[i] = MAX(m_widths[i], m_cells[m_matWidth * j + i]->GetFullWidth());
+      m_cells[i]->RecalculateWidthsList(MAX(MC_MIN_SIZE, fontsize - 2));
+    }
+    m_widths.clear();
+    for (int i = 0; i < m_matWidth; i++)
+    {
+      m_widths.push_back(0);
+      for (int j = 0; j < m_matHeight; j++)
+      {
+        m_widths[i] = MAX(m_widths[i], m_cells[m_matWidth * j + i]->GetFullWidth());
+      }
     }
   }
   m_width = 0;
@@ -112,20 +221,29 @@ void MatrCell::RecalculateWidths(int fontsize)
 
 void MatrCell::RecalculateHeight(int fontsize)
 {
-  for (int i = 0; i < m_matWidth * m_matHeight; i++)
-  {
-    m_cells[i]->RecalculateHeightList(MAX(MC_MIN_SIZE, fontsize - 2));
-  }
   m_centers.clear();
   m_drops.clear();
-  for (int i = 0; i < m_matHeight; i++)
+  if (IsNumeric())
   {
-    m_centers.push_back(0);
-    m_drops.push_back(0);
-    for (int j = 0; j < m_matWidth; j++)
+    // All entries of a numeric matrix are of the same height.
+    m_centers.resize(m_matHeight, m_numberHeight / 2);
+    m_drops.resize(m_matHeight, m_numberHeight - m_numberHeight / 2);
+  }
+  else
+  {
+    for (int i = 0; i < m_matWidth * m_matHeight; i++)
     {
-      m_centers[i] = MAX(m_centers[i], m_cells[m_matWidth * i + j]->GetMaxCenter());
-      m_drops[i] = MAX(m_drops[i], m_cells[m_matWidth * i + j]->GetMaxDrop());
+      m_cells[i]->RecalculateHeightList(MAX(MC_MIN_SIZE, fontsize - 2));
+    }
+    for (int i = 0; i < m_matHeight; i++)
+    {
+      m_centers.push_back(0);
+      m_drops.push_back(0);
+      for (int j = 0; j < m_matWidth; j++)
+      {
+        m_centers[i] = MAX(m_centers[i], m_cells[m_matWidth * i + j]->GetMaxCenter());
+        m_drops[i] = MAX(m_drops[i], m_cells[m_matWidth * i + j]->GetMaxDrop());
+      }
     }
   }
   m_height = 0;
@@ -145,21 +263,26 @@ void MatrCell::Draw(wxPoint point, int fontsize)
     MathCell::Draw(point, fontsize);
     Configuration *configuration = (*m_configuration);
     wxDC *dc = configuration->GetDC();
-    wxPoint mp;
-    mp.x = point.x + Scale_Px(5);
-    mp.y = point.y - m_center;
-    for (int i = 0; i < m_matWidth; i++)
+    if (IsNumeric())
+      DrawNumbers(point, MAX(MC_MIN_SIZE, fontsize - 2));
+    else
     {
-      mp.y = point.y - m_center + Scale_Px(5);
-      for (int j = 0; j < m_matHeight; j++)
+      wxPoint mp;
+      mp.x = point.x + Scale_Px(5);
+      mp.y = point.y - m_center;
+      for (int i = 0; i < m_matWidth; i++)
       {
-        mp.y += m_centers[j];
-        wxPoint mp1(mp);
-        mp1.x = mp.x + (m_widths[i] - m_cells[j * m_matWidth + i]->GetFullWidth()) / 2;
-        m_cells[j * m_matWidth + i]->DrawList(mp1, MAX(MC_MIN_SIZE, fontsize - 2));
-        mp.y += (m_drops[j] + Scale_Px(10));
+        mp.y = point.y - m_center + Scale_Px(5);
+        for (int j = 0; j < m_matHeight; j++)
+        {
+          mp.y += m_centers[j];
+          wxPoint mp1(mp);
+          mp1.x = mp.x + (m_widths[i] - m_cells[j * m_matWidth + i]->GetFullWidth()) / 2;
+          m_cells[j * m_matWidth + i]->DrawList(mp1, MAX(MC_MIN_SIZE, fontsize - 2));
+          mp.y += (m_drops[j] + Scale_Px(10));
+        }
+        mp.x += (m_widths[i] + Scale_Px(10));
       }
-      mp.x += (m_widths[i] + Scale_Px(10));
     }
     SetPen(1.5);
     if (m_specialMatrix)
@@ -218,57 +341,126 @@ void MatrCell::Draw(wxPoint point, int fontsize)
   }
 }
 
+void MatrCell::DrawNumbers(wxPoint point, int fontsize)
+{
+  Configuration *configuration = (*m_configuration);
+  wxDC *dc = configuration->GetDC();
+  RecalculateNumberWidths(fontsize);
+  SetNumberFont(fontsize);
+  if (m_highlight)
+    dc->SetTextForeground(configuration->GetColor(TS_HIGHLIGHT));
+  else
+    dc->SetTextForeground(configuration->GetColor(TS_NUMBER));
+
+  // Only the columns and rows that intersect the update region are drawn.
+  vector<int> columns;
+  vector<int> columnsX;
+  int x = point.x + Scale_Px(5);
+  for (int i = 0; i < m_matWidth; i++)
+  {
+    if (InUpdateRegion(wxRect(x, point.y - m_center, m_widths[i], m_height)))
+    {
+      columns.push_back(i);
+      columnsX.push_back(x);
+    }
+    x += m_widths[i] + Scale_Px(10);
+  }
+  if (columns.empty())
+    return;
+
+  int y = point.y - m_center + Scale_Px(5);
+  for (int j = 0; j < m_matHeight; j++)
+  {
+    if (InUpdateRegion(wxRect(point.x, y, m_width, m_numberHeight)))
+    {
+      for (unsigned int k = 0; k < columns.size(); k++)
+      {
+        const wxString &number = m_numbers[j * m_matWidth + columns[k]];
+        dc->DrawText(number,
+                     columnsX[k] + (m_widths[columns[k]] - NumberWidth(number)) / 2 +
+                     Scale_Px(MC_TEXT_PADDING),
+                     y + Scale_Px(MC_TEXT_PADDING));
+      }
+    }
+    y += m_numberHeight + Scale_Px(10);
+  }
+}
+
+wxString MatrCell::NumberToXML(const wxString &number)
+{
+  if (number.StartsWith(wxT("-")))
+    return wxT("<v>-</v><n>") + number.Mid(1) + wxT("</n>");
+  else
+    return wxT("<n>") + number + wxT("</n>");
+}
+
 wxString MatrCell::ToString()
 {
-  wxString s = wxT("matrix(\n");
+  wxString s;
+  WriteString(s);
+  return s;
+}
+
+void MatrCell::WriteString(wxString &out)
+{
+  out += wxT("matrix(\n");
   for (int i = 0; i < m_matHeight; i++)
   {
-    s += wxT("\t\t[");
+    out += wxT("\t\t[");
     for (int j = 0; j < m_matWidth; j++)
     {
-      s += m_cells[i * m_matWidth + j]->ListToString();
+      if (IsNumeric())
+        out += m_numbers[i * m_matWidth + j];
+      else
+        m_cells[i * m_matWidth + j]->ListWriteString(out);
       if (j < m_matWidth - 1)
-        s += wxT(",\t");
+        out += wxT(",\t");
     }
-    s += wxT("]");
+    out += wxT("]");
     if (i < m_matHeight - 1)
-      s += wxT(",");
-    s += wxT("\n");
+      out += wxT(",");
+    out += wxT("\n");
   }
-  s += wxT("\t)");
-  return s;
+  out += wxT("\t)");
 }
 
 wxString MatrCell::ToTeX()
 {
-  //ToDo: We ignore colNames and rowNames here. Are they currently in use?
   wxString s;
+  WriteTeX(s);
+  return s;
+}
 
+void MatrCell::WriteTeX(wxString &out)
+{
+  //ToDo: We ignore colNames and rowNames here. Are they currently in use?
   if (!m_specialMatrix)
-    s = wxT("\\begin{pmatrix}");
+    out += wxT("\\begin{pmatrix}");
   else
   {
-    s = wxT("\\begin{array}{");
+    out += wxT("\\begin{array}{");
     for (int j = 0; j < m_matWidth; j++)
-      s += wxT("c");
-    s += wxT("}");
+      out += wxT("c");
+    out += wxT("}");
   }
   for (int i = 0; i < m_matHeight; i++)
   {
     for (int j = 0; j < m_matWidth; j++)
     {
-      s += m_cells[i * m_matWidth + j]->ListToTeX();
+      if (IsNumeric())
+        out += m_numbers[i * m_matWidth + j];
+      else
+        m_cells[i * m_matWidth + j]->ListWriteTeX(out);
       if (j < m_matWidth - 1)
-        s += wxT(" & ");
+        out += wxT(" & ");
     }
     if (i < m_matHeight - 1)
-      s += wxT("\\\\\n");
+      out += wxT("\\\\\n");
   }
   if (!m_specialMatrix)
-    s += wxT("\\end{pmatrix}");
+    out += wxT("\\end{pmatrix}");
   else
-    s += wxT("\\end{array}");
-  return s;
+    out += wxT("\\end{array}");
 }
 
 wxString MatrCell::ToMathML()
@@ -282,7 +474,12 @@ wxString MatrCell::ToMathML()
   {
     retval += wxT("<mtr>");
     for (int j = 0; j < m_matWidth; j++)
-      retval += wxT("<mtd>") + m_cells[i * m_matWidth + j]->ListToMathML() + wxT("</mtd>");
+    {
+      if (IsNumeric())
+        retval += wxT("<mtd><mn>") + m_numbers[i * m_matWidth + j] + wxT("</mn></mtd>");
+      else
+        retval += wxT("<mtd>") + m_cells[i * m_matWidth + j]->ListToMathML() + wxT("</mtd>");
+    }
     retval += wxT("</mtr>");
   }
   retval += wxT("</mtable>\n");
@@ -305,7 +502,12 @@ wxString MatrCell::ToOMML()
   {
     retval += wxT("<m:mr>");
     for (int j = 0; j < m_matWidth; j++)
-      retval += wxT("<m:e>") + m_cells[i * m_matWidth + j]->ListToOMML() + wxT("</m:e>");
+    {
+      if (IsNumeric())
+        retval += wxT("<m:e><m:t>") + m_numbers[i * m_matWidth + j] + wxT("</m:t></m:e>");
+      else
+        retval += wxT("<m:e>") + m_cells[i * m_matWidth + j]->ListToOMML() + wxT("</m:e>");
+    }
     retval += wxT("</m:mr>");
   }
 
@@ -314,31 +516,42 @@ wxString MatrCell::ToOMML()
 }
 
 wxString MatrCell::ToXML()
+{
+  wxString s;
+  WriteXML(s);
+  return s;
+}
+
+void MatrCell::WriteXML(wxString &out)
 {
   wxString flags;
   if (m_forceBreakLine)
     flags += wxT(" breakline=\"true\"");
 
-  wxString s = wxEmptyString;
   if (m_specialMatrix)
-    s = wxString::Format(
+    out += wxString::Format(
       wxT("<tb") + flags + wxT(" special=\"true\" inference=\"%s\" rownames=\"%s\" colnames=\"%s\">"),
             m_inferenceMatrix ? wxT("true") : wxT("false"),
             m_rowNames ? wxT("true") : wxT("false"),
             m_colNames ? wxT("true") : wxT("false"));
   else
-    s = wxT("<tb") +flags +wxT(">");
+    out += wxT("<tb") +flags +wxT(">");
 
   for (int i = 0; i < m_matHeight; i++)
   {
-    s += wxT("<mtr>");
+    out += wxT("<mtr>");
     for (int j = 0; j < m_matWidth; j++)
-      s += wxT("<mtd>") + m_cells[i * m_matWidth + j]->ListToXML() + wxT("</mtd>");
-    s += wxT("</mtr>");
+    {
+      out += wxT("<mtd>");
+      if (IsNumeric())
+        out += NumberToXML(m_numbers[i * m_matWidth + j]);
+      else
+        m_cells[i * m_matWidth + j]->ListWriteXML(out);
+      out += wxT("</mtd>");
+    }
+    out += wxT("</mtr>");
   }
-  s += wxT("</tb>");
-
-  return s;
+  out += wxT("</tb>");
 }
 
 void MatrCell::SetDimension()
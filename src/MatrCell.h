@@ -39,6 +39,10 @@ public:
 
   MathCell *Copy();
 
+  size_t SizeInMemory();
+
+  wxString GetToolTip(const wxPoint &point);
+
   void RecalculateHeight(int fontsize);
 
   void RecalculateWidths(int fontsize);
@@ -50,6 +54,27 @@ public:
     m_cells.push_back(cell);
   }
 
+  /*! Add an entry to a matrix that only consists of plain numbers
+
+    A matrix either is built using AddNewCell() or using AddNewNumber(),
+    never using both.
+   */
+  void AddNewNumber(const wxString &number)
+  {
+    m_numbers.push_back(number);
+  }
+
+  //! Does this matrix store its entries as plain numbers instead of cells?
+  bool IsNumeric()
+  { return !m_numbers.empty(); }
+
+  /*! The minimum number of entries a matrix needs for being stored as plain numbers
+
+    Numeric matrices are fast to lay out and to draw, but their entries
+    cannot be selected individually => small matrices still get a cell per entry.
+   */
+  static const int m_minNumericEntries = 400;
+
   void NewRow()
   {
     m_matHeight++;
@@ -64,14 +89,20 @@ public:
 
   wxString ToString();
 
+  void WriteString(wxString &out);
+
   wxString ToTeX();
 
+  void WriteTeX(wxString &out);
+
   wxString ToMathML();
 
   wxString ToOMML();
 
   wxString ToXML();
 
+  void WriteXML(wxString &out);
+
   void SetSpecialFlag(bool special)
   { m_specialMatrix = special; }
 
@@ -87,6 +118,25 @@ public:
   { m_colNames = cn; }
 
 protected:
+  //! Sets the font numbers in a numeric matrix are drawn with
+  void SetNumberFont(int fontsize);
+
+  //! Measure the columns of a numeric matrix, if the font has changed since the last time
+  void RecalculateNumberWidths(int fontsize);
+
+  /*! The width of a number of a numeric matrix.
+
+    Uses the character widths that were measured for the current font
+    instead of asking the DC for every number.
+   */
+  int NumberWidth(const wxString &number);
+
+  //! Draw the rows and columns of a numeric matrix that are inside the update region
+  void DrawNumbers(wxPoint point, int fontsize);
+
+  //! The XML representation of an entry of a numeric matrix
+  static wxString NumberToXML(const wxString &number);
+
   int m_matWidth;
   int m_matHeight;
   bool m_specialMatrix, m_inferenceMatrix, m_rowNames, m_colNames;
@@ -94,6 +144,16 @@ protected:
   vector<int> m_widths;
   vector<int> m_drops;
   vector<int> m_centers;
+  //! The entries of a numeric matrix, row by row. Empty if m_cells is used.
+  vector<wxString> m_numbers;
+  //! The widths of the ASCII characters in the font the numbers were last measured for
+  int m_charWidths[128];
+  //! The font size the columns of a numeric matrix were last measured for
+  int m_numberFontSize;
+  //! The zoom factor the columns of a numeric matrix were last measured for
+  double m_numberZoomFactor;
+  //! The height of an entry of a numeric matrix
+  int m_numberHeight;
 };
 
 #endif // MATRCELL_H
@@ -377,44 +377,64 @@ void ParenCell::Draw(wxPoint point, int fontsize)
 wxString ParenCell::ToString()
 {
   wxString s;
-  if (!m_isBroken)
-  {
-    if (m_print)
-      s = wxT("(") + m_innerCell->ListToString() + wxT(")");
-    else
-      s = m_innerCell->ListToString();
-  }
+  WriteString(s);
   return s;
 }
 
+void ParenCell::WriteString(wxString &out)
+{
+  if (m_isBroken)
+    return;
+  if (m_print)
+    out += wxT("(");
+  m_innerCell->ListWriteString(out);
+  if (m_print)
+    out += wxT(")");
+}
+
 wxString ParenCell::ToTeX()
 {
   wxString s;
-  if (!m_isBroken)
-  {
-    wxString innerCell = m_innerCell->ListToTeX();
+  WriteTeX(s);
+  return s;
+}
 
-    // Let's see if the cell contains anything potentially higher than a normal
-    // character.
-    bool needsLeftRight = false;
-    for (size_t i = 0; i < innerCell.Length(); i++)
-      if (!wxIsalnum(innerCell[i]))
-      {
-        needsLeftRight = true;
-        break;
-      }
+void ParenCell::WriteTeX(wxString &out)
+{
+  if (m_isBroken)
+    return;
+  if (!m_print)
+  {
+    m_innerCell->ListWriteTeX(out);
+    return;
+  }
 
-    if (m_print)
+  // We assume we need \left( and \right) and fall back to plain parenthesis
+  // afterwards. In that case the contents consist of alphanumeric characters
+  // only and therefore don't contain another parenthesis => every character
+  // is moved at most once, even if parenthesis are nested deeply.
+  wxString leftParen = wxT("\\left( ");
+  size_t start = out.Length();
+  out += leftParen;
+  m_innerCell->ListWriteTeX(out);
+
+  // Let's see if the cell contains anything potentially higher than a normal
+  // character.
+  bool needsLeftRight = false;
+  for (size_t i = start + leftParen.Length(); i < out.Length(); i++)
+    if (!wxIsalnum(out[i]))
     {
-      if (needsLeftRight)
-        s = wxT("\\left( ") + m_innerCell->ListToTeX() + wxT("\\right) ");
-      else
-        s = wxT("(") + m_innerCell->ListToTeX() + wxT(")");
+      needsLeftRight = true;
+      break;
     }
-    else
-      s = m_innerCell->ListToTeX();
+
+  if (needsLeftRight)
+    out += wxT("\\right) ");
+  else
+  {
+    out.replace(start, leftParen.Length(), wxT("("));
+    out += wxT(")");
   }
-  return s;
 }
 
 wxString ParenCell::ToOMML()
@@ -439,13 +459,21 @@ wxString ParenCell::ToMathML()
 
 wxString ParenCell::ToXML()
 {
-//  if( m_isBroken )
-//    return wxEmptyString;
-  wxString s = m_innerCell->ListToXML();
+  wxString s;
+  WriteXML(s);
+  return s;
+}
+
+void ParenCell::WriteXML(wxString &out)
+{
   wxString flags;
   if (m_forceBreakLine)
     flags += wxT(" breakline=\"true\"");
-  return ((m_print) ? _T("<r><") + flags + wxT("p>") + s + _T("</p></r>") : s);
+  if (m_print)
+    out += _T("<r><") + flags + wxT("p>");
+  m_innerCell->ListWriteXML(out);
+  if (m_print)
+    out += _T("</p></r>");
 }
 
 bool ParenCell::BreakUp()
@@ -0,0 +1,416 @@
+﻿// -*- mode: c++; c-file-style: "linux"; c-basic-offset: 2; indent-tabs-mode: nil -*-
+//
+//  Copyright (C) 2017 Gunter Königsmann <wxMaxima@physikbuch.de>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+
+/*! \file
+  This file defines the class ProcessMonitor
+
+  ProcessMonitor tells how much CPU time, memory and disk I/O maxima uses.
+ */
+
+#include "ProcessMonitor.h"
+
+#if defined __WXMSW__
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#endif
+
+ProcessMonitor::ProcessMonitor()
+{
+  m_pid = -1;
+#if defined __WXMSW__
+  m_processHandle = NULL;
+#else
+  m_procStat = open("/proc/stat", O_RDONLY);
+  m_updatesSinceScan = 0;
+  m_pageSize = sysconf(_SC_PAGESIZE);
+  if (m_pageSize <= 0)
+    m_pageSize = 4096;
+#endif
+  Clear();
+}
+
+ProcessMonitor::~ProcessMonitor()
+{
+  SetPid(-1);
+#if !defined __WXMSW__
+  if (m_procStat >= 0)
+    close(m_procStat);
+#endif
+}
+
+void ProcessMonitor::Clear()
+{
+  m_cpuTime = -1;
+  m_cpuPercentage = -1;
+  m_residentBytes = -1;
+  m_bytesRead = -1;
+  m_bytesWritten = -1;
+  m_processes = 0;
+  m_treeTimeOld = -1;
+  m_totalTimeOld = -1;
+  m_percentageCpuTime = -1;
+  m_percentageTotalTime = -1;
+}
+
+void ProcessMonitor::SetPid(long pid)
+{
+  if (pid == m_pid)
+    return;
+
+#if defined __WXMSW__
+  if (m_processHandle != NULL)
+    CloseHandle((HANDLE) m_processHandle);
+  m_processHandle = NULL;
+  if (pid > 0)
+    m_processHandle = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, false, pid);
+#else
+  for (std::map<long, ProcFiles>::iterator it = m_procFiles.begin(); it != m_procFiles.end(); ++it)
+    CloseProcFiles(it->second);
+  m_procFiles.clear();
+  m_scannedChildren.clear();
+  m_updatesSinceScan = 0;
+#endif
+
+  m_pid = pid;
+  Clear();
+  if (m_pid > 0)
+    m_cpuTime = 0;
+}
+
+double ProcessMonitor::CpuTimeUnitsPerSecond()
+{
+#if defined __WXMSW__
+  // GetProcessTimes() counts in units of 100ns
+  return 1e7;
+#else
+  long ticks = sysconf(_SC_CLK_TCK);
+  if (ticks <= 0)
+    ticks = 100;
+  return ticks;
+#endif
+}
+
+void ProcessMonitor::UpdateCpuTime(long long treeTime, long long totalTime)
+{
+  // A child process that has ended without its parent waiting for it takes
+  // its CPU time with it => Only count the CPU time that was added.
+  if ((m_treeTimeOld >= 0) && (treeTime > m_treeTimeOld))
+    m_cpuTime += treeTime - m_treeTimeOld;
+
+  m_treeTimeOld = treeTime;
+  m_totalTimeOld = totalTime;
+}
+
+void ProcessMonitor::UpdateCpuPercentage()
+{
+  if ((m_cpuTime < 0) || (m_totalTimeOld < 0))
+  {
+    m_cpuPercentage = -1;
+    return;
+  }
+
+  if ((m_percentageTotalTime >= 0) && (m_totalTimeOld > m_percentageTotalTime))
+    m_cpuPercentage = (double) (m_cpuTime - m_percentageCpuTime) /
+      (m_totalTimeOld - m_percentageTotalTime) * 100;
+  else if (m_totalTimeOld != m_percentageTotalTime)
+    m_cpuPercentage = -1;
+
+  m_percentageCpuTime = m_cpuTime;
+  m_percentageTotalTime = m_totalTimeOld;
+}
+
+#if defined __WXMSW__
+
+bool ProcessMonitor::Update()
+{
+  if (m_processHandle == NULL)
+    return false;
+
+  HANDLE process = (HANDLE) m_processHandle;
+  FILETIME creationTime, exitTime, kernelTime, userTime;
+  if (!GetProcessTimes(process, &creationTime, &exitTime, &kernelTime, &userTime))
+    return false;
+
+  ULARGE_INTEGER kernel, user;
+  kernel.LowPart = kernelTime.dwLowDateTime;
+  kernel.HighPart = kernelTime.dwHighDateTime;
+  user.LowPart = userTime.dwLowDateTime;
+  user.HighPart = userTime.dwHighDateTime;
+
+  // The time all CPUs together had available is the elapsed time multiplied
+  // by the number of CPUs.
+  FILETIME systemTime;
+  GetSystemTimeAsFileTime(&systemTime);
+  ULARGE_INTEGER now;
+  now.LowPart = systemTime.dwLowDateTime;
+  now.HighPart = systemTime.dwHighDateTime;
+  SYSTEM_INFO systemInfo;
+  GetSystemInfo(&systemInfo);
+
+  UpdateCpuTime(kernel.QuadPart + user.QuadPart,
+                   now.QuadPart * systemInfo.dwNumberOfProcessors);
+
+  IO_COUNTERS io;
+  if (GetProcessIoCounters(process, &io))
+  {
+    m_bytesRead = io.ReadTransferCount;
+    m_bytesWritten = io.WriteTransferCount;
+  }
+  m_processes = 1;
+  return true;
+}
+
+#else
+
+ProcessMonitor::ProcFiles ProcessMonitor::OpenProcFiles(long pid)
+{
+  ProcFiles files;
+  char name[64];
+  snprintf(name, sizeof(name), "/proc/%ld/stat", pid);
+  files.m_stat = open(name, O_RDONLY);
+  snprintf(name, sizeof(name), "/proc/%ld/io", pid);
+  files.m_io = open(name, O_RDONLY);
+  snprintf(name, sizeof(name), "/proc/%ld/task/%ld/children", pid, pid);
+  files.m_children = open(name, O_RDONLY);
+  files.m_alive = false;
+  return files;
+}
+
+void ProcessMonitor::CloseProcFiles(ProcFiles &files)
+{
+  if (files.m_stat >= 0)
+    close(files.m_stat);
+  if (files.m_io >= 0)
+    close(files.m_io);
+  if (files.m_children >= 0)
+    close(files.m_children);
+  files.m_stat = files.m_io = files.m_children = -1;
+}
+
+long ProcessMonitor::ReadProcFile(int fd)
+{
+  if (fd < 0)
+    return -1;
+  ssize_t length = pread(fd, m_buffer, sizeof(m_buffer) - 1, 0);
+  if (length < 0)
+    return -1;
+  m_buffer[length] = '\0';
+  return length;
+}
+
+void ProcessMonitor::ScanForChildren(long pid, std::vector<long> &children)
+{
+  DIR *proc = opendir("/proc");
+  if (proc == NULL)
+    return;
+
+  struct dirent *entry;
+  while ((entry = readdir(proc)) != NULL)
+  {
+    char *end;
+    long child = strtol(entry->d_name, &end, 10);
+    if ((*end != '\0') || (child <= 0))
+      continue;
+
+    char name[64];
+    snprintf(name, sizeof(name), "/proc/%ld/stat", child);
+    int fd = open(name, O_RDONLY);
+    if (fd < 0)
+      continue;
+    long length = ReadProcFile(fd);
+    close(fd);
+    if (length <= 0)
+      continue;
+
+    // The parent process ID is the second field after the process name.
+    char *pos = strrchr(m_buffer, ')');
+    if (pos == NULL)
+      continue;
+    pos = strchr(pos + 2, ' ');
+    if ((pos != NULL) && (strtol(pos + 1, NULL, 10) == pid))
+      children.push_back(child);
+  }
+  closedir(proc);
+}
+
+bool ProcessMonitor::Update()
+{
+  if (m_pid <= 0)
+    return false;
+
+  // The CPU time of all CPUs together is the sum of the first 8 numbers in the
+  // "cpu" line of /proc/stat that always is the first line of this file. The
+  // numbers that follow are already included in the first ones.
+  long long totalTime = 0;
+  if (ReadProcFile(m_procStat) <= 0)
+    return false;
+  if (strncmp(m_buffer, "cpu ", 4) != 0)
+    return false;
+  char *pos = m_buffer + 4;
+  for (int field = 0; field < 8; field++)
+  {
+    char *end;
+    long long value = strtoll(pos, &end, 10);
+    if (end == pos)
+      break;
+    totalTime += value;
+    pos = end;
+  }
+
+  // Walk the process tree starting at maxima.
+  for (std::map<long, ProcFiles>::iterator it = m_procFiles.begin(); it != m_procFiles.end(); ++it)
+    it->second.m_alive = false;
+
+  // Kernels that don't provide the list of children of a process force us to
+  // look at every process in the system. Don't do so too often.
+  bool scan = (++m_updatesSinceScan >= 10);
+  if (scan)
+  {
+    m_updatesSinceScan = 0;
+    m_scannedChildren.clear();
+  }
+
+  long long treeTime = 0;
+  long long residentBytes = 0;
+  long long bytesRead = -1;
+  long long bytesWritten = -1;
+  int processes = 0;
+
+  std::vector<long> pending;
+  pending.push_back(m_pid);
+  while (!pending.empty())
+  {
+    long pid = pending.back();
+    pending.pop_back();
+
+    std::map<long, ProcFiles>::iterator it = m_procFiles.find(pid);
+    if (it == m_procFiles.end())
+      it = m_procFiles.insert(std::make_pair(pid, OpenProcFiles(pid))).first;
+    ProcFiles &files = it->second;
+
+    // Don't look at the same process twice
+    if (files.m_alive)
+      continue;
+
+    // The process name is enclosed in parenthesis and might contain spaces or
+    // parenthesis => The fields we are interested in are counted from the last ")".
+    if (ReadProcFile(files.m_stat) <= 0)
+      continue;
+    pos = strrchr(m_buffer, ')');
+    if (pos == NULL)
+      continue;
+    files.m_alive = true;
+    processes++;
+
+    // Field 3 (the process state) follows the ")". utime, stime, cutime and cstime
+    // are the fields 14 to 17, rss is field 24.
+    pos += 2;
+    for (int field = 3; (field < 14) && (pos != NULL); field++)
+    {
+      pos = strchr(pos, ' ');
+      if (pos != NULL)
+        pos++;
+    }
+    if (pos == NULL)
+      continue;
+    for (int field = 14; field < 18; field++)
+      treeTime += strtoll(pos, &pos, 10);
+    for (int field = 18; (field < 24) && (pos != NULL); field++)
+    {
+      pos = strchr(pos + 1, ' ');
+    }
+    if (pos != NULL)
+      residentBytes += strtoll(pos, NULL, 10) * m_pageSize;
+
+    // The number of bytes that actually have been read from or written to disk.
+    if (ReadProcFile(files.m_io) > 0)
+    {
+      char *readBytes = strstr(m_buffer, "\nread_bytes: ");
+      char *writeBytes = strstr(m_buffer, "\nwrite_bytes: ");
+      if (readBytes != NULL)
+      {
+        if (bytesRead < 0)
+          bytesRead = 0;
+        bytesRead += strtoll(readBytes + 13, NULL, 10);
+      }
+      if (writeBytes != NULL)
+      {
+        if (bytesWritten < 0)
+          bytesWritten = 0;
+        bytesWritten += strtoll(writeBytes + 14, NULL, 10);
+      }
+    }
+
+    // Add the children of this process to the list of processes to look at.
+    if (files.m_children >= 0)
+    {
+      if (ReadProcFile(files.m_children) > 0)
+      {
+        pos = m_buffer;
+        char *end;
+        long child;
+        while ((child = strtol(pos, &end, 10)) > 0)
+        {
+          pending.push_back(child);
+          pos = end;
+        }
+      }
+    }
+    else
+    {
+      if (scan)
+        ScanForChildren(pid, m_scannedChildren);
+      for (std::vector<long>::iterator child = m_scannedChildren.begin(); child != m_scannedChildren.end(); ++child)
+        if (*child != pid)
+          pending.push_back(*child);
+    }
+  }
+
+  // Close the files of processes that have ended.
+  std::map<long, ProcFiles>::iterator it = m_procFiles.begin();
+  while (it != m_procFiles.end())
+  {
+    if ((!it->second.m_alive) && (it->first != m_pid))
+    {
+      CloseProcFiles(it->second);
+      m_procFiles.erase(it++);
+    }
+    else
+      ++it;
+  }
+
+  if (processes == 0)
+    return false;
+
+  UpdateCpuTime(treeTime, totalTime);
+  m_residentBytes = residentBytes;
+  m_bytesRead = bytesRead;
+  m_bytesWritten = bytesWritten;
+  m_processes = processes;
+  return true;
+}
+
+#endif
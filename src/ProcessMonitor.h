@@ -0,0 +1,173 @@
+﻿// -*- mode: c++; c-file-style: "linux"; c-basic-offset: 2; indent-tabs-mode: nil -*-
+//
+//  Copyright (C) 2017 Gunter Königsmann <wxMaxima@physikbuch.de>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+
+/*! \file
+  This file declares the class ProcessMonitor
+
+  ProcessMonitor tells how much CPU time, memory and disk I/O maxima uses.
+ */
+
+#ifndef PROCESSMONITOR_H
+#define PROCESSMONITOR_H
+
+#include <wx/wx.h>
+#include <map>
+#include <vector>
+
+/*! Measures the resources maxima and its child processes use
+
+  Maxima is a lisp process that might start child processes of its own, for
+  example gnuplot or a compiler. This class sums up the CPU time, the resident
+  memory and the disk I/O of the whole process tree.
+
+  On Linux the files in /proc that are needed for this are opened only once and
+  are read again on every Update(). The data is parsed in place without
+  creating any strings. On MS Windows only the maxima process itself is
+  measured using a process handle that is kept open. On other systems no
+  information is available and all values are -1.
+ */
+class ProcessMonitor
+{
+public:
+  ProcessMonitor();
+
+  ~ProcessMonitor();
+
+  //! Monitor the process tree starting at pid. -1 means: Stop monitoring.
+  void SetPid(long pid);
+
+  /*! Read the current resource usage
+
+    Doesn't change CpuPercentage(): Reading the CPU time for timing a single
+    command therefore doesn't shorten the interval the percentage the status
+    bar shows is averaged over.
+
+    \return false if no information about the process could be read.
+   */
+  bool Update();
+
+  //! Calculate CpuPercentage() for the time between the last call to this function and the last Update()
+  void UpdateCpuPercentage();
+
+  /*! The CPU time the process tree has used since SetPid()
+
+    In units of CpuTimeUnitsPerSecond(); -1 means: unknown.
+   */
+  long long CpuTime() const
+  { return m_cpuTime; }
+
+  /*! The percentage of all available CPUs the process tree has used between the last two calls to UpdateCpuPercentage()
+
+    -1 means: unknown.
+   */
+  double CpuPercentage() const
+  { return m_cpuPercentage; }
+
+  //! The resident memory of all processes in bytes; -1 means: unknown
+  long long ResidentBytes() const
+  { return m_residentBytes; }
+
+  //! The number of bytes the processes have read from disk; -1 means: unknown
+  long long BytesRead() const
+  { return m_bytesRead; }
+
+  //! The number of bytes the processes have written to disk; -1 means: unknown
+  long long BytesWritten() const
+  { return m_bytesWritten; }
+
+  //! The number of processes in the tree
+  int Processes() const
+  { return m_processes; }
+
+  //! The number of units per second CpuTime() counts in
+  static double CpuTimeUnitsPerSecond();
+
+private:
+  //! Forget all information about the process tree
+  void Clear();
+
+  //! Add the CPU time the process tree has used since the last Update() to m_cpuTime
+  void UpdateCpuTime(long long treeTime, long long totalTime);
+
+  //! The process at the root of the tree
+  long m_pid;
+  long long m_cpuTime;
+  double m_cpuPercentage;
+  long long m_residentBytes;
+  long long m_bytesRead;
+  long long m_bytesWritten;
+  int m_processes;
+  //! The CPU time of the process tree the last time we looked
+  long long m_treeTimeOld;
+  //! The CPU time of all CPUs together the last time we looked
+  long long m_totalTimeOld;
+  //! m_cpuTime at the last call to UpdateCpuPercentage()
+  long long m_percentageCpuTime;
+  //! m_totalTimeOld at the last call to UpdateCpuPercentage()
+  long long m_percentageTotalTime;
+
+#if defined __WXMSW__
+  //! The handle of the maxima process
+  void *m_processHandle;
+#else
+  //! The open files in /proc/<pid>/ that belong to one process
+  struct ProcFiles
+  {
+    //! /proc/<pid>/stat
+    int m_stat;
+    //! /proc/<pid>/io
+    int m_io;
+    //! /proc/<pid>/task/<pid>/children
+    int m_children;
+    //! Did this process still exist the last time we looked?
+    bool m_alive;
+  };
+
+  //! Open the files in /proc we need for a process
+  static ProcFiles OpenProcFiles(long pid);
+
+  //! Close all files in files
+  static void CloseProcFiles(ProcFiles &files);
+
+  /*! Read a file in /proc from its start into m_buffer
+
+    \return The number of bytes read; The data is terminated by a zero byte.
+  */
+  long ReadProcFile(int fd);
+
+  //! Find the children of a process by looking at the parent ID of all processes
+  void ScanForChildren(long pid, std::vector<long> &children);
+
+  //! The files we have opened for each process in the tree
+  std::map<long, ProcFiles> m_procFiles;
+  //! /proc/stat
+  int m_procStat;
+  //! The number of Update() calls since we last scanned /proc for child processes
+  int m_updatesSinceScan;
+  //! The children of the processes the last time we scanned /proc
+  std::vector<long> m_scannedChildren;
+  //! The size of a memory page
+  long m_pageSize;
+  //! A buffer the files from /proc are read into
+  char m_buffer[4096];
+#endif
+};
+
+#endif // PROCESSMONITOR_H
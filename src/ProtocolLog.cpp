@@ -0,0 +1,106 @@
+﻿// -*- mode: c++; c-file-style: "linux"; c-basic-offset: 2; indent-tabs-mode: nil -*-
+//
+//  Copyright (C) 2017 Gunter Königsmann <wxMaxima@physikbuch.de>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+
+/*! \file
+  This file defines the class ProtocolLog
+
+  ProtocolLog keeps the most recent part of the communication with maxima.
+ */
+
+#include "ProtocolLog.h"
+#include <wx/file.h>
+
+const size_t ProtocolLog::m_maxLogBytes;
+const size_t ProtocolLog::m_maxLogChunkBytes;
+
+ProtocolLog::ProtocolLog()
+{
+  m_logBytes = 0;
+}
+
+void ProtocolLog::Add(Direction direction, const char *data, size_t length)
+{
+  if (length == 0)
+    return;
+
+  // Add the data to the log, joining it with the last chunk if that one has
+  // been sent in the same direction and isn't too big yet.
+  if (m_log.empty() || (m_log.back().direction != direction) ||
+      (m_log.back().data.length() >= m_maxLogChunkBytes))
+  {
+    LogChunk chunk;
+    chunk.direction = direction;
+    m_log.push_back(chunk);
+  }
+  m_log.back().data.append(data, length);
+  m_logBytes += length;
+
+  // Drop the oldest chunks if the log has become too big.
+  bool dropped = false;
+  while ((m_logBytes > m_maxLogBytes) && (m_log.size() > 1))
+  {
+    m_logBytes -= m_log.front().data.length();
+    m_log.pop_front();
+    dropped = true;
+  }
+
+  // A chunk may end in the middle of a UTF-8 character => Make the log
+  // start at the beginning of the next character.
+  if (dropped)
+  {
+    std::string &front = m_log.front().data;
+    size_t start = 0;
+    while ((start < front.length()) && ((front[start] & 0xC0) == 0x80))
+      start++;
+    front.erase(0, start);
+    m_logBytes -= start;
+  }
+}
+
+bool ProtocolLog::Save(wxString file, bool fromMaximaOnly)
+{
+  wxFile output(file, wxFile::write);
+  if (!output.IsOpened())
+    return false;
+
+  bool ok = true;
+  bool first = true;
+  Direction lastDirection = toMaxima;
+  for (std::deque<LogChunk>::const_iterator chunk = m_log.begin(); chunk != m_log.end(); ++chunk)
+  {
+    if (!fromMaximaOnly)
+    {
+      // Big transfers are split into several chunks. They only get one heading.
+      if (first || (chunk->direction != lastDirection))
+      {
+        if (chunk->direction == toMaxima)
+          ok = ok && output.Write(wxT("\n--- SENT TO MAXIMA ---\n"));
+        else
+          ok = ok && output.Write(wxT("\n--- MAXIMA RESPONSE ---\n"));
+      }
+    }
+    else if (chunk->direction != fromMaxima)
+      continue;
+    first = false;
+    lastDirection = chunk->direction;
+    ok = ok && (output.Write(chunk->data.data(), chunk->data.length()) == chunk->data.length());
+  }
+  return output.Close() && ok;
+}
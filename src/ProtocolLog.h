@@ -0,0 +1,90 @@
+﻿// -*- mode: c++; c-file-style: "linux"; c-basic-offset: 2; indent-tabs-mode: nil -*-
+//
+//  Copyright (C) 2017 Gunter Königsmann <wxMaxima@physikbuch.de>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+
+/*! \file
+  This file declares the class ProtocolLog
+
+  ProtocolLog keeps the most recent part of the communication with maxima.
+ */
+
+#ifndef PROTOCOLLOG_H
+#define PROTOCOLLOG_H
+
+#include <wx/wx.h>
+#include <deque>
+#include <string>
+
+/*! The most recent part of the communication with maxima
+
+  Everything that is exchanged with maxima is logged byte for byte, no matter
+  if the XmlInspector that can save the log has been created yet. The log is
+  limited to m_maxLogBytes bytes: The oldest data is dropped first.
+ */
+class ProtocolLog
+{
+public:
+  //! Who has sent a piece of the communication
+  enum Direction
+  {
+    toMaxima,
+    fromMaxima
+  };
+
+  ProtocolLog();
+
+  //! Add data that was sent in direction, exactly as it was sent
+  void Add(Direction direction, const char *data, size_t length);
+
+  /*! Save the log to a file
+
+    \param file The name of the file to write to.
+    \param fromMaximaOnly true means: Write only the bytes maxima has sent,
+           exactly as they were received. false means: Write the data that
+           was sent in both directions, each chunk preceded by a line that
+           tells who has sent it.
+    \return false, if the file couldn't be written.
+   */
+  bool Save(wxString file, bool fromMaximaOnly = false);
+
+private:
+  //! The maximum number of bytes m_log holds
+  static const size_t m_maxLogBytes = 4 * 1024 * 1024;
+  /*! Data is appended to the last chunk of m_log only if it is smaller than this
+
+    The oldest data is dropped a chunk at a time which means we don't need
+    to move the rest of a big chunk each time data is added.
+   */
+  static const size_t m_maxLogChunkBytes = 64 * 1024;
+
+  //! A piece of the communication with maxima that was sent in one direction
+  struct LogChunk
+  {
+    Direction direction;
+    //! The data exactly as it was sent
+    std::string data;
+  };
+
+  //! The log of the communication with maxima, the newest data last
+  std::deque<LogChunk> m_log;
+  //! The number of bytes in m_log
+  size_t m_logBytes;
+};
+
+#endif // PROTOCOLLOG_H
@@ -0,0 +1,199 @@
+﻿// -*- mode: c++; c-file-style: "linux"; c-basic-offset: 2; indent-tabs-mode: nil -*-
+//
+//  Copyright (C) 2017 Gunter Königsmann <wxMaxima@physikbuch.de>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+/*! \file
+  This file defines the classes ProtocolRecorder and ProtocolReplay
+
+  They record the communication between wxMaxima and maxima and play it back
+  later without a maxima.
+ */
+
+#include "ProtocolRecording.h"
+#include <stdio.h>
+#include <string.h>
+
+//! The first line of a recording
+#define PROTOCOL_RECORDING_HEADER "wxMaxima protocol recording 1\n"
+
+ProtocolRecorder::ProtocolRecorder()
+{
+  m_start = 0;
+}
+
+ProtocolRecorder::~ProtocolRecorder()
+{
+  if (m_file.IsOpened())
+    m_file.Close();
+}
+
+bool ProtocolRecorder::Start(wxString file)
+{
+  if (m_file.IsOpened())
+    m_file.Close();
+  if (!m_file.Open(file, wxT("wb")))
+    return false;
+  m_start = wxGetLocalTimeMillis();
+  return m_file.Write(PROTOCOL_RECORDING_HEADER, strlen(PROTOCOL_RECORDING_HEADER)) ==
+    strlen(PROTOCOL_RECORDING_HEADER);
+}
+
+void ProtocolRecorder::Record(char type, const char *data, size_t length)
+{
+  if (!m_file.IsOpened())
+    return;
+
+  wxString header = wxString::Format(wxT("%c %ld %lu\n"), type,
+                                     (long) (wxGetLocalTimeMillis() - m_start).GetValue(),
+                                     (unsigned long) length);
+  m_file.Write(header);
+  m_file.Write(data, length);
+  m_file.Write("\n", 1);
+  // If wxMaxima crashes we still want to see what has lead to the crash.
+  m_file.Flush();
+}
+
+ProtocolReplay::ProtocolReplay(wxString file, int port, bool realTime, long timeout) :
+  wxThread(wxTHREAD_JOINABLE)
+{
+  m_port = port;
+  m_realTime = realTime;
+  m_timeout = timeout;
+  m_timeouts = 0;
+  // Sockets can only be used in a thread if they have been initialized in the
+  // main thread.
+  wxSocketBase::Initialize();
+  m_ok = Read(file);
+}
+
+bool ProtocolReplay::Read(wxString file)
+{
+  wxFFile input(file, wxT("rb"));
+  if (!input.IsOpened())
+    return false;
+
+  std::string contents;
+  char buffer[65536];
+  size_t length;
+  while ((length = input.Read(buffer, sizeof(buffer))) > 0)
+    contents.append(buffer, length);
+
+  size_t pos = strlen(PROTOCOL_RECORDING_HEADER);
+  if (contents.compare(0, pos, PROTOCOL_RECORDING_HEADER) != 0)
+    return false;
+
+  while (pos < contents.length())
+  {
+    size_t end = contents.find('\n', pos);
+    if (end == std::string::npos)
+      return false;
+
+    Chunk chunk;
+    unsigned long chunkLength;
+    if (sscanf(contents.substr(pos, end - pos).c_str(), "%c %ld %lu",
+               &chunk.type, &chunk.time, &chunkLength) != 3)
+      return false;
+    pos = end + 1;
+    if (pos + chunkLength > contents.length())
+      return false;
+    chunk.data = contents.substr(pos, chunkLength);
+    // Skip the newline that follows the data.
+    pos += chunkLength + 1;
+    m_chunks.push_back(chunk);
+  }
+  return true;
+}
+
+bool ProtocolReplay::Write(wxSocketBase &socket, const std::string &data)
+{
+  size_t sent = 0;
+  while ((sent < data.length()) && (!TestDestroy()))
+  {
+    socket.Write(data.data() + sent, data.length() - sent);
+    if (socket.Error() && (socket.LastError() != wxSOCKET_WOULDBLOCK))
+      return false;
+    sent += socket.LastCount();
+  }
+  return true;
+}
+
+wxThread::ExitCode ProtocolReplay::Entry()
+{
+  // Sockets in threads other than the main thread need to block.
+  wxSocketClient socket(wxSOCKET_BLOCK);
+  wxIPV4address addr;
+  addr.LocalHost();
+  addr.Service(m_port);
+  if (!socket.Connect(addr, true))
+    return (ExitCode) 1;
+
+  // The number of bytes wxMaxima has sent we haven't waited for yet
+  size_t received = 0;
+  // The time the recording would have started at if it had been made now
+  wxLongLong start = wxGetLocalTimeMillis();
+  size_t i = 0;
+  while ((i < m_chunks.size()) && (!TestDestroy()) && socket.IsConnected())
+  {
+    if (m_chunks[i].type == 'S')
+    {
+      // The output that follows was maxima's answer to what it has been sent
+      // here => wait until wxMaxima has sent about the same amount of data.
+      // The data itself might differ: It can contain file names, for example.
+      size_t expected = 0;
+      while ((i < m_chunks.size()) && (m_chunks[i].type == 'S'))
+        expected += m_chunks[i++].data.length();
+      // Evaluating a cell can legitimately take wxMaxima long, e.g. if it
+      // contains a big plot => the timeout is configurable.
+      wxLongLong timeout = wxGetLocalTimeMillis() + m_timeout;
+      while ((received < expected) && (wxGetLocalTimeMillis() < timeout) &&
+             (!TestDestroy()) && socket.IsConnected())
+      {
+        if (!socket.WaitForRead(0, 100))
+          continue;
+        char buffer[4096];
+        socket.Read(buffer, sizeof(buffer));
+        if (socket.LastCount() == 0)
+          break;
+        received += socket.LastCount();
+      }
+      if ((received < expected) && (wxGetLocalTimeMillis() >= timeout))
+        m_timeouts++;
+      if (received > expected)
+        received -= expected;
+      else
+        received = 0;
+      // The time spent waiting for wxMaxima doesn't count as maxima's time.
+      if (i > 0)
+        start = wxGetLocalTimeMillis() - m_chunks[i - 1].time;
+      continue;
+    }
+
+    if (m_realTime)
+    {
+      wxLongLong due = start + m_chunks[i].time;
+      wxLongLong now;
+      while (((now = wxGetLocalTimeMillis()) < due) && (!TestDestroy()))
+        Sleep(wxMin(100, (due - now).ToLong()));
+    }
+    if (!Write(socket, m_chunks[i].data))
+      break;
+    i++;
+  }
+  socket.Close();
+  return 0;
+}
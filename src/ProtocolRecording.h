@@ -0,0 +1,147 @@
+﻿// -*- mode: c++; c-file-style: "linux"; c-basic-offset: 2; indent-tabs-mode: nil -*-
+//
+//  Copyright (C) 2017 Gunter Königsmann <wxMaxima@physikbuch.de>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+/*! \file
+  This file declares the classes ProtocolRecorder and ProtocolReplay
+
+  They record the communication between wxMaxima and maxima and play it back
+  later without a maxima, which allows to benchmark how fast wxMaxima handles
+  maxima's output.
+ */
+
+#ifndef PROTOCOLRECORDING_H
+#define PROTOCOLRECORDING_H
+
+#include <wx/wx.h>
+#include <wx/string.h>
+#include <wx/ffile.h>
+#include <wx/thread.h>
+#include <wx/socket.h>
+#include <vector>
+#include <string>
+
+/*! Records the communication with maxima to a file
+
+  The file starts with the line "wxMaxima protocol recording 1". Each chunk of
+  data follows as a line "R <milliseconds> <length>" for data that has been 
+  received from maxima or "S <milliseconds> <length>" for data that has been 
+  sent to it. The time is counted from the start of the recording. The line is 
+  followed by the data itself and a newline.
+ */
+class ProtocolRecorder
+{
+public:
+  ProtocolRecorder();
+  ~ProtocolRecorder();
+
+  /*! Start recording to a file
+
+    \return false, if the file couldn't be opened.
+   */
+  bool Start(wxString file);
+  //! Are we recording?
+  bool IsRecording()
+  { return m_file.IsOpened(); }
+  //! Record data maxima has sent us
+  void Received(const char *data, size_t length)
+  { Record('R', data, length); }
+  //! Record data we have sent to maxima
+  void Sent(const char *data, size_t length)
+  { Record('S', data, length); }
+
+private:
+  void Record(char type, const char *data, size_t length);
+  wxFFile m_file;
+  //! The time the recording has started at
+  wxLongLong m_start;
+};
+
+/*! Plays back a recording made by ProtocolRecorder
+
+  The replay runs in a thread that connects to wxMaxima's server like maxima 
+  would do and sends it everything that maxima has sent in the recording. 
+  Before continuing after a point where wxMaxima has sent something to maxima 
+  the replay waits until wxMaxima has sent a similar amount of data again. 
+  This way the output of a command arrives only after the command has been 
+  sent. Replaying a recording therefore needs wxMaxima to evaluate the same 
+  document again.
+
+  At the end of the recording the connection is closed.
+ */
+class ProtocolReplay : public wxThread
+{
+public:
+  /*! Constructor
+
+    \param file The recording.
+    \param port The port wxMaxima's server listens on.
+    \param realTime false means: send all data as fast as possible. true 
+           means: Keep the time between two chunks of data the recording 
+           contains.
+    \param timeout How many milliseconds to wait for wxMaxima to send maxima
+           what the recording expects before continuing anyway.
+   */
+  ProtocolReplay(wxString file, int port, bool realTime, long timeout = 30000);
+
+  //! false, if the file couldn't be read or isn't a recording made by ProtocolRecorder.
+  bool IsOk()
+  { return m_ok; }
+
+  /*! Did we give up waiting for wxMaxima to send the data the recording expects?
+
+    Only valid after the thread has ended.
+   */
+  bool TimedOut()
+  { return m_timeouts > 0; }
+
+  //! How often did we give up waiting for wxMaxima? Only valid after the thread has ended.
+  size_t Timeouts()
+  { return m_timeouts; }
+
+  //! The number of milliseconds we wait for wxMaxima before giving up
+  long Timeout()
+  { return m_timeout; }
+
+protected:
+  virtual ExitCode Entry();
+
+private:
+  //! A chunk of data from the recording
+  struct Chunk
+  {
+    //! 'R' = received from maxima, 'S' = sent to maxima
+    char type;
+    //! The time [in milliseconds since the start of the recording] the data was recorded at
+    long time;
+    std::string data;
+  };
+  //! Read the recording from a file
+  bool Read(wxString file);
+  //! Write a chunk of data to maxima
+  bool Write(wxSocketBase &socket, const std::string &data);
+
+  std::vector<Chunk> m_chunks;
+  bool m_ok;
+  size_t m_timeouts;
+  long m_timeout;
+  int m_port;
+  bool m_realTime;
+};
+
+#endif // PROTOCOLRECORDING_H
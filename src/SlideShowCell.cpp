@@ -45,7 +45,7 @@
 #include <wx/wfstream.h>
 #include <wx/anidecod.h>
 
-SlideShow::SlideShow(MathCell *parent, Configuration **config, CellPointers *cellPointers, wxFileSystem *filesystem, int framerate) : MathCell(
+SlideShow::SlideShow(MathCell *parent, Configuration **config, CellPointers *cellPointers, WXMXArchive *archive, int framerate) : MathCell(
         parent, config)
 {
   m_cellPointers = cellPointers;
@@ -53,7 +53,7 @@ SlideShow::SlideShow(MathCell *parent, Configuration **config, CellPointers *cel
   m_animationRunning = true;
   m_size = m_displayed = 0;
   m_type = MC_TYPE_SLIDE;
-  m_fileSystem = filesystem; // NULL when not loading from wxmx
+  m_archive = archive; // NULL when not loading from wxmx
   m_framerate = framerate;
   m_imageBorderWidth = 1;
   m_drawBoundingBox = false;
@@ -138,10 +138,10 @@ void SlideShow::LoadImages(wxArrayString images, bool deleteRead)
 
   for (int i = 0; i < m_size; i++)
   {
-    Image *image = new Image(m_configuration, images[i], deleteRead, m_fileSystem);
+    Image *image = new Image(m_configuration, images[i], deleteRead, m_archive);
     m_images.push_back(image);
   }
-  m_fileSystem = NULL;
+  m_archive = NULL;
   m_displayed = 0;
 }
 
@@ -187,6 +187,15 @@ std::list<MathCell *> SlideShow::GetInnerCells()
   return innerCells;
 }
 
+size_t SlideShow::SizeInMemory()
+{
+  size_t size = sizeof(SlideShow) + ColdDataSize();
+  for (vector<Image *>::iterator it = m_images.begin(); it != m_images.end(); ++it)
+    if (*it != NULL)
+      size += (*it)->SizeInMemory();
+  return size;
+}
+
 void SlideShow::SetDisplayedIndex(int ind)
 {
   if (ind >= 0 && ind < m_size)
@@ -387,7 +396,7 @@ wxString SlideShow::GetToolTip(const wxPoint &point)
                "be the result of gnuplot not being able to write the image or not being "
                "able to understand what maxima wanted to plot."));
     else
-      return m_toolTip;
+      return GetLocalToolTip();
   }
   else
     return wxEmptyString;
@@ -33,9 +33,6 @@
 #include <wx/image.h>
 #include <wx/timer.h>
 
-#include <wx/filesys.h>
-#include <wx/fs_arc.h>
-
 #include <vector>
 
 using namespace std;
@@ -50,13 +47,13 @@ public:
     has to be set to -1.
     \param config A pointer to the pointer to the configuration storage of the 
                   worksheet this cell belongs to.
-    \param filesystem The filesystem the contents of this slideshow can be found in.
+    \param archive   The .wxmx archive the contents of this slideshow can be found in.
                       NULL = the operating system's filesystem
     \param parent     The parent GroupCell this cell belongs to.
     \param cellPointers All pointers that might point to this cell and that need to
                         be set to NULL if this cell is deleted.
    */
-  SlideShow(MathCell *parent, Configuration **config, CellPointers *cellPointers, wxFileSystem *filesystem = NULL, int framerate = -1);
+  SlideShow(MathCell *parent, Configuration **config, CellPointers *cellPointers, WXMXArchive *archive = NULL, int framerate = -1);
 
   ~SlideShow();
 
@@ -78,6 +75,8 @@ public:
 
   MathCell *Copy();
 
+  size_t SizeInMemory();
+
   int GetDisplayedIndex()
   { return m_displayed; }
 
@@ -136,7 +135,7 @@ protected:
   bool m_animationRunning;
   int m_size;
   int m_displayed;
-  wxFileSystem *m_fileSystem;
+  WXMXArchive *m_archive;
   vector<Image *> m_images;
 
   void RecalculateHeight(int fontsize);
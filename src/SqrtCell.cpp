@@ -298,19 +298,35 @@ void SqrtCell::Draw(wxPoint point, int fontsize)
 }
 
 wxString SqrtCell::ToString()
+{
+  wxString s;
+  WriteString(s);
+  return s;
+}
+
+void SqrtCell::WriteString(wxString &out)
 {
   if (m_isBroken)
-    return wxEmptyString;
-  else
-    return wxT("sqrt(") + m_innerCell->ListToString() + wxT(")");
+    return;
+  out += wxT("sqrt(");
+  m_innerCell->ListWriteString(out);
+  out += wxT(")");
 }
 
 wxString SqrtCell::ToTeX()
+{
+  wxString s;
+  WriteTeX(s);
+  return s;
+}
+
+void SqrtCell::WriteTeX(wxString &out)
 {
   if (m_isBroken)
-    return wxEmptyString;
-  else
-    return wxT("\\sqrt{") + m_innerCell->ListToTeX() + wxT("}");
+    return;
+  out += wxT("\\sqrt{");
+  m_innerCell->ListWriteTeX(out);
+  out += wxT("}");
 }
 
 wxString SqrtCell::ToMathML()
@@ -326,13 +342,20 @@ wxString SqrtCell::ToOMML()
 
 wxString SqrtCell::ToXML()
 {
-//  if (m_isBroken)
-//    return wxEmptyString;
+  wxString s;
+  WriteXML(s);
+  return s;
+}
+
+void SqrtCell::WriteXML(wxString &out)
+{
   wxString flags;
   if (m_forceBreakLine)
     flags += wxT(" breakline=\"true\"");
 
-  return wxT("<q") + flags + wxT(">") + m_innerCell->ListToXML() + wxT("</q>");
+  out += wxT("<q") + flags + wxT(">");
+  m_innerCell->ListWriteXML(out);
+  out += wxT("</q>");
 }
 
 bool SqrtCell::BreakUp()
@@ -69,14 +69,20 @@ public:
 
   wxString ToString();
 
+  void WriteString(wxString &out);
+
   wxString ToTeX();
 
+  void WriteTeX(wxString &out);
+
   wxString ToMathML();
 
   wxString ToOMML();
 
   wxString ToXML();
 
+  void WriteXML(wxString &out);
+
   void SetGroup(MathCell *parent);
 
 protected:
@@ -0,0 +1,123 @@
+﻿// -*- mode: c++; c-file-style: "linux"; c-basic-offset: 2; indent-tabs-mode: nil -*-
+//
+//  Copyright (C) 2017 Gunter Königsmann <wxMaxima@physikbuch.de>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+/*! \file
+  This file defines the class StageTimer
+
+  StageTimer measures how long wxMaxima needs for each stage of handling 
+  maxima's output.
+ */
+
+#include "StageTimer.h"
+#include <wx/time.h>
+#include <iostream>
+
+bool StageTimer::m_enabled = false;
+StageTimer::Statistics StageTimer::m_statistics[StageTimer::numberOfStages];
+wxLongLong StageTimer::m_bytes = 0;
+wxLongLong StageTimer::m_firstReceived = -1;
+wxLongLong StageTimer::m_lastActivity = -1;
+StageTimer::Scope *StageTimer::m_currentScope = NULL;
+
+void StageTimer::Enable()
+{
+  m_enabled = true;
+  for (int i = 0; i < numberOfStages; i++)
+  {
+    m_statistics[i].calls = 0;
+    m_statistics[i].total = 0;
+    m_statistics[i].max = 0;
+  }
+  m_bytes = 0;
+  m_firstReceived = -1;
+  m_lastActivity = -1;
+}
+
+StageTimer::Scope::Scope(Stage stage)
+{
+  m_stage = stage;
+  m_measuring = m_enabled;
+  m_nestedTime = 0;
+  m_parent = m_currentScope;
+  m_currentScope = this;
+  if (m_measuring)
+    m_start = wxGetUTCTimeUSec();
+}
+
+StageTimer::Scope::~Scope()
+{
+  m_currentScope = m_parent;
+  if (!m_measuring)
+    return;
+
+  wxLongLong now = wxGetUTCTimeUSec();
+  wxLongLong duration = now - m_start;
+  if (m_parent != NULL)
+    m_parent->m_nestedTime += duration;
+
+  // Count the time of nested stages only for these stages.
+  duration -= m_nestedTime;
+  Statistics &statistics = m_statistics[m_stage];
+  statistics.calls++;
+  statistics.total += duration;
+  if (duration > statistics.max)
+    statistics.max = duration;
+  m_lastActivity = now;
+}
+
+void StageTimer::Received(size_t bytes)
+{
+  if (!m_enabled)
+    return;
+
+  if (m_firstReceived < 0)
+    m_firstReceived = wxGetUTCTimeUSec();
+  m_bytes += bytes;
+}
+
+void StageTimer::Report()
+{
+  if (!m_enabled)
+    return;
+
+  static const char *const names[numberOfStages] =
+    {"receive", "interpret", "parse", "insert", "layout", "draw"};
+
+  double seconds = 0;
+  if ((m_firstReceived >= 0) && (m_lastActivity > m_firstReceived))
+    seconds = (m_lastActivity - m_firstReceived).ToDouble() / 1e6;
+  double bytes = m_bytes.ToDouble();
+  std::cerr << wxString::Format(wxT("replay: %.0f bytes in %.3f s"), bytes, seconds).mb_str();
+  if (seconds > 0)
+    std::cerr << wxString::Format(wxT(" = %.3f MB/s"), bytes / seconds / 1048576.0).mb_str();
+  std::cerr << "\n";
+  std::cerr << "replay: times exclude the nested stages\n";
+  std::cerr << "replay: stage         calls    total ms   mean ms    max ms\n";
+  for (int i = 0; i < numberOfStages; i++)
+  {
+    const Statistics &statistics = m_statistics[i];
+    double total = statistics.total.ToDouble() / 1000.0;
+    double mean = 0;
+    if (statistics.calls > 0)
+      mean = total / statistics.calls;
+    std::cerr << wxString::Format(wxT("replay: %-10s %8ld %11.1f %9.3f %9.3f\n"),
+                                  names[i], statistics.calls, total, mean,
+                                  statistics.max.ToDouble() / 1000.0).mb_str();
+  }
+}
@@ -0,0 +1,111 @@
+﻿// -*- mode: c++; c-file-style: "linux"; c-basic-offset: 2; indent-tabs-mode: nil -*-
+//
+//  Copyright (C) 2017 Gunter Königsmann <wxMaxima@physikbuch.de>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+/*! \file
+  This file declares the class StageTimer
+
+  StageTimer measures how long wxMaxima needs for each stage of handling 
+  maxima's output.
+ */
+
+#ifndef STAGETIMER_H
+#define STAGETIMER_H
+
+#include <wx/wx.h>
+#include <wx/string.h>
+
+/*! Measures the time each stage of handling maxima's output takes
+
+  Used by the protocol replay (see ProtocolReplay) for benchmarking the path
+  from the socket to the worksheet. Unless Enable() has been called the
+  measurements do nothing. All methods may only be called from the main thread.
+
+  Stages may be nested, for example layout happens while cells are inserted.
+  The time a nested stage takes is counted for this stage only and not for
+  the stage it is part of => The times of all stages can be added up.
+ */
+class StageTimer
+{
+public:
+  //! The stages of handling maxima's output
+  enum Stage
+  {
+    receive,   //!< Reading from the socket
+    interpret, //!< Splitting up the data and handling everything that isn't math
+    parse,     //!< Converting XML to cells
+    insert,    //!< Adding the cells to the worksheet
+    layout,    //!< Calculating the size and position of the new cells
+    draw,      //!< Drawing the worksheet
+    numberOfStages
+  };
+
+  //! Start measuring, forgetting about all earlier measurements
+  static void Enable();
+
+  static bool IsEnabled()
+  { return m_enabled; }
+
+  //! Remember that bytes bytes have been received from maxima
+  static void Received(size_t bytes);
+
+  //! Print the throughput and the time each stage took to stderr
+  static void Report();
+
+  //! Measures the time between its creation and its destruction
+  class Scope
+  {
+  public:
+    explicit Scope(Stage stage);
+    ~Scope();
+
+  private:
+    Stage m_stage;
+    wxLongLong m_start;
+    //! Was the StageTimer enabled when this Scope was created?
+    bool m_measuring;
+    //! The time [in microseconds] the Scopes nested in this one took
+    wxLongLong m_nestedTime;
+    //! The Scope this one is nested in; NULL if there is none.
+    Scope *m_parent;
+  };
+
+private:
+  //! How often a stage was run and how long it took
+  struct Statistics
+  {
+    long calls;
+    //! The time [in microseconds] all calls took together
+    wxLongLong total;
+    //! The time [in microseconds] the longest call took
+    wxLongLong max;
+  };
+
+  static bool m_enabled;
+  static Statistics m_statistics[numberOfStages];
+  //! The number of bytes that have been received from maxima
+  static wxLongLong m_bytes;
+  //! The time [in microseconds] the first data has been received at
+  static wxLongLong m_firstReceived;
+  //! The time [in microseconds] the last stage has ended at
+  static wxLongLong m_lastActivity;
+  //! The innermost Scope that currently exists
+  static Scope *m_currentScope;
+};
+
+#endif // STAGETIMER_H
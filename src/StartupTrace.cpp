@@ -0,0 +1,48 @@
+﻿// -*- mode: c++; c-file-style: "linux"; c-basic-offset: 2; indent-tabs-mode: nil -*-
+//
+//  Copyright (C) 2017 Gunter Königsmann <wxMaxima@physikbuch.de>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+
+/*! \file
+  This file defines the class StartupTrace
+
+  StartupTrace reports how long each phase of wxMaxima's startup took.
+ */
+
+#include "StartupTrace.h"
+#include <iostream>
+
+bool StartupTrace::m_enabled = false;
+// Static variables are initialized before main() is called.
+wxLongLong StartupTrace::m_start = wxGetLocalTimeMillis();
+wxLongLong StartupTrace::m_lastPhase = StartupTrace::m_start;
+wxCriticalSection StartupTrace::m_lock;
+
+void StartupTrace::Phase(const wxString &name)
+{
+  if (!m_enabled)
+    return;
+
+  wxCriticalSectionLocker lock(m_lock);
+  wxLongLong now = wxGetLocalTimeMillis();
+  std::cerr << wxString::Format(wxT("startup: %6ld ms (+%5ld ms) "),
+                                (long) (now - m_start).GetValue(),
+                                (long) (now - m_lastPhase).GetValue()).mb_str()
+            << name.mb_str() << "\n";
+  m_lastPhase = now;
+}
@@ -0,0 +1,62 @@
+﻿// -*- mode: c++; c-file-style: "linux"; c-basic-offset: 2; indent-tabs-mode: nil -*-
+//
+//  Copyright (C) 2017 Gunter Königsmann <wxMaxima@physikbuch.de>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+
+/*! \file
+  This file declares the class StartupTrace
+
+  StartupTrace reports how long each phase of wxMaxima's startup took.
+ */
+
+#ifndef STARTUPTRACE_H
+#define STARTUPTRACE_H
+
+#include <wx/wx.h>
+#include <wx/string.h>
+#include <wx/thread.h>
+
+/*! Reports how long each phase of wxMaxima's startup took
+
+  If the command line switch --trace-startup is given each call to Phase()
+  prints the time since the program was started and since the last phase
+  finished to stderr. Without it Phase() does nothing.
+ */
+class StartupTrace
+{
+public:
+  //! Start printing the phases of the startup
+  static void Enable()
+  { m_enabled = true; }
+
+  /*! Tell that a phase of the startup has finished
+
+    Can be called from background threads, too.
+   */
+  static void Phase(const wxString &name);
+
+private:
+  static bool m_enabled;
+  //! The time the program was started at
+  static wxLongLong m_start;
+  //! The time the last phase finished at
+  static wxLongLong m_lastPhase;
+  static wxCriticalSection m_lock;
+};
+
+#endif // STARTUPTRACE_H
@@ -32,6 +32,10 @@ StatusBar::StatusBar(wxWindow *parent, int id) : wxStatusBar(parent, id)
   int widths[] = {-1, 300, GetSize().GetHeight()};
   m_maximaPercentage = -1;
   m_oldmaximaPercentage = -1;
+  m_maximaResidentBytes = -1;
+  m_maximaBytesRead = -1;
+  m_maximaBytesWritten = -1;
+  m_maximaProcesses = 0;
   SetFieldsCount(3, widths);
   m_stdToolTip = _(
           "Maxima, the program that does the actual mathematics is started as a separate process. This has the advantage that an eventual crash of maxima cannot harm wxMaxima, which displays the worksheet.\nThis icon indicates if data is transferred between maxima and wxMaxima.");
@@ -115,10 +119,27 @@ void StatusBar::NetworkStatus(networkState status)
       m_networkState = status;
       wxString toolTip = m_stdToolTip;
       if(m_maximaPercentage >= 0)
+      {
         toolTip +=wxString::Format(
           _("\n\nMaxima is currently using %3.3f%% of all available CPUs."),
           m_maximaPercentage
           );
+        if(m_maximaProcesses > 1)
+          toolTip += wxString::Format(
+            _("\nThis includes %i processes maxima has started."),
+            m_maximaProcesses - 1
+            );
+        if(m_maximaResidentBytes >= 0)
+          toolTip += wxString::Format(
+            _("\nMemory used: %.1f MB"),
+            m_maximaResidentBytes / 1048576.0
+            );
+        if((m_maximaBytesRead >= 0) && (m_maximaBytesWritten >= 0))
+          toolTip += wxString::Format(
+            _("\nRead from disk: %.1f MB, written to disk: %.1f MB"),
+            m_maximaBytesRead / 1048576.0, m_maximaBytesWritten / 1048576.0
+            );
+      }
       m_networkStatus->SetToolTip(toolTip);
     }
     break;
@@ -67,6 +67,19 @@ public:
       m_maximaPercentage = percentage;
       NetworkStatus(m_oldNetworkState);
     }
+
+  /*! Inform the status bar about the memory and disk I/O of maxima and its child processes
+
+    Values of -1 mean: unknown. The information is shown in the tooltip
+    of the network icon together with the CPU percentage.
+   */
+  void SetMaximaResources(long long residentBytes, long long bytesRead, long long bytesWritten, int processes)
+    {
+      m_maximaResidentBytes = residentBytes;
+      m_maximaBytesRead = bytesRead;
+      m_maximaBytesWritten = bytesWritten;
+      m_maximaProcesses = processes;
+    }
 protected:
   void OnSize(wxSizeEvent &event);
 
@@ -83,6 +96,14 @@ private:
     See m_maximaPercentage and SetMaximaCPUPercentage()
    */
   float m_oldmaximaPercentage;
+  //! The resident memory of maxima and its child processes; -1 = unknown
+  long long m_maximaResidentBytes;
+  //! The number of bytes maxima and its child processes have read from disk; -1 = unknown
+  long long m_maximaBytesRead;
+  //! The number of bytes maxima and its child processes have written to disk; -1 = unknown
+  long long m_maximaBytesWritten;
+  //! The number of processes maxima consists of
+  int m_maximaProcesses;
   networkState m_oldNetworkState;
   wxString m_stdToolTip;
   wxString m_networkErrToolTip;
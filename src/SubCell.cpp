@@ -130,18 +130,30 @@ void SubCell::Draw(wxPoint point, int fontsize)
 
 wxString SubCell::ToString()
 {
-  if (m_altCopyText != wxEmptyString)
+  wxString s;
+  WriteString(s);
+  return s;
+}
+
+void SubCell::WriteString(wxString &out)
+{
+  if (GetAltCopyText() != wxEmptyString)
   {
-    return m_altCopyText;
+    out += GetAltCopyText();
+    return;
   }
 
-  wxString s;
   if (m_baseCell->IsCompound())
-    s += wxT("(") + m_baseCell->ListToString() + wxT(")");
+  {
+    out += wxT("(");
+    m_baseCell->ListWriteString(out);
+    out += wxT(")");
+  }
   else
-    s += m_baseCell->ListToString();
-  s += wxT("[") + m_indexCell->ListToString() + wxT("]");
-  return s;
+    m_baseCell->ListWriteString(out);
+  out += wxT("[");
+  m_indexCell->ListWriteString(out);
+  out += wxT("]");
 }
 
 wxString SubCell::ToTeX()
@@ -175,14 +187,24 @@ wxString SubCell::ToOMML()
 }
 
 wxString SubCell::ToXML()
+{
+  wxString s;
+  WriteXML(s);
+  return s;
+}
+
+void SubCell::WriteXML(wxString &out)
 {
   wxString flags;
   if (m_forceBreakLine)
     flags += wxT(" breakline=\"true\"");
 
-  if (m_altCopyText != wxEmptyString)
-    flags += wxT(" altCopy=\"") + XMLescape(m_altCopyText) + wxT("\"");
+  if (GetAltCopyText() != wxEmptyString)
+    flags += wxT(" altCopy=\"") + XMLescape(GetAltCopyText()) + wxT("\"");
   
-  return wxT("<i") + flags + wxT("><r>") + m_baseCell->ListToXML() + wxT("</r><r>") +
-           m_indexCell->ListToXML() + wxT("</r></i>");
+  out += wxT("<i") + flags + wxT("><r>");
+  m_baseCell->ListWriteXML(out);
+  out += wxT("</r><r>");
+  m_indexCell->ListWriteXML(out);
+  out += wxT("</r></i>");
 }
@@ -47,6 +47,8 @@ public:
 
   wxString ToString();
 
+  void WriteString(wxString &out);
+
   wxString ToTeX();
 
   wxString ToMathML();
@@ -55,6 +57,8 @@ public:
 
   wxString ToXML();
 
+  void WriteXML(wxString &out);
+
   void SetGroup(MathCell *parent);
 
 protected:
@@ -161,21 +161,39 @@ void SubSupCell::Draw(wxPoint point, int fontsize)
 wxString SubSupCell::ToString()
 {
   wxString s;
+  WriteString(s);
+  return s;
+}
+
+void SubSupCell::WriteString(wxString &out)
+{
   if (m_baseCell->IsCompound())
-    s += wxT("(") + m_baseCell->ListToString() + wxT(")");
+  {
+    out += wxT("(");
+    m_baseCell->ListWriteString(out);
+    out += wxT(")");
+  }
   else
-    s += m_baseCell->ListToString();
-  s += wxT("[") + m_indexCell->ListToString() + wxT("]");
-  s += wxT("^");
+    m_baseCell->ListWriteString(out);
+  out += wxT("[");
+  m_indexCell->ListWriteString(out);
+  out += wxT("]");
+  out += wxT("^");
   if (m_exptCell->IsCompound())
-    s += wxT("(");
-  s += m_exptCell->ListToString();
+    out += wxT("(");
+  m_exptCell->ListWriteString(out);
   if (m_exptCell->IsCompound())
-    s += wxT(")");
-  return s;
+    out += wxT(")");
 }
 
 wxString SubSupCell::ToTeX()
+{
+  wxString s;
+  WriteTeX(s);
+  return s;
+}
+
+void SubSupCell::WriteTeX(wxString &out)
 {
   wxConfigBase *config = wxConfig::Get();
 
@@ -183,18 +201,19 @@ wxString SubSupCell::ToTeX()
 
   config->Read(wxT("TeXExponentsAfterSubscript"), &TeXExponentsAfterSubscript);
 
-  wxString s;
-
   if (TeXExponentsAfterSubscript)
-    s = wxT("{{{") + m_baseCell->ListToTeX() + wxT("}_{") +
-        m_indexCell->ListToTeX() + wxT("}}^{") +
-        m_exptCell->ListToTeX() + wxT("}}");
+    out += wxT("{{{");
   else
-    s = wxT("{{") + m_baseCell->ListToTeX() + wxT("}_{") +
-        m_indexCell->ListToTeX() + wxT("}^{") +
-        m_exptCell->ListToTeX() + wxT("}}");
-
-  return s;
+    out += wxT("{{");
+  m_baseCell->ListWriteTeX(out);
+  out += wxT("}_{");
+  m_indexCell->ListWriteTeX(out);
+  if (TeXExponentsAfterSubscript)
+    out += wxT("}}^{");
+  else
+    out += wxT("}^{");
+  m_exptCell->ListWriteTeX(out);
+  out += wxT("}}");
 }
 
 wxString SubSupCell::ToMathML()
@@ -216,13 +235,23 @@ wxString SubSupCell::ToOMML()
 }
 
 wxString SubSupCell::ToXML()
+{
+  wxString s;
+  WriteXML(s);
+  return s;
+}
+
+void SubSupCell::WriteXML(wxString &out)
 {
   wxString flags;
   if (m_forceBreakLine)
     flags += wxT(" breakline=\"true\"");
 
-  return _T("<ie") + flags +wxT("><r>") + m_baseCell->ListToXML()
-         + _T("</r><r>") + m_indexCell->ListToXML()
-         + _T("</r><r>") + m_exptCell->ListToXML()
-         + _T("</r></ie>");
+  out += _T("<ie") + flags + wxT("><r>");
+  m_baseCell->ListWriteXML(out);
+  out += _T("</r><r>");
+  m_indexCell->ListWriteXML(out);
+  out += _T("</r><r>");
+  m_exptCell->ListWriteXML(out);
+  out += _T("</r></ie>");
 }
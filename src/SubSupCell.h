@@ -49,10 +49,16 @@ public:
 
   wxString ToString();
 
+  void WriteString(wxString &out);
+
   wxString ToTeX();
 
+  void WriteTeX(wxString &out);
+
   wxString ToXML();
 
+  void WriteXML(wxString &out);
+
   wxString ToOMML();
 
   wxString ToMathML();
@@ -314,22 +314,27 @@ wxString SumCell::ToString()
 wxString SumCell::ToTeX()
 {
   wxString s;
+  WriteTeX(s);
+  return s;
+}
+
+void SumCell::WriteTeX(wxString &out)
+{
   if (m_sumStyle == SM_SUM)
-    s = wxT("\\sum");
+    out += wxT("\\sum");
   else
-    s = wxT("\\prod");
+    out += wxT("\\prod");
 
-
-  s += wxT("_{") + m_under->ListToTeX() + wxT("}");
+  out += wxT("_{");
+  m_under->ListWriteTeX(out);
+  out += wxT("}");
   wxString to = m_over->ListToTeX();
   if (to.Length())
-    s += wxT("^{") + to + wxT("}");
-
+    out += wxT("^{") + to + wxT("}");
 
-  s += wxT("{\\left. ");
-  s += m_base->ListToTeX();
-  s += wxT("\\right.}");
-  return s;
+  out += wxT("{\\left. ");
+  m_base->ListWriteTeX(out);
+  out += wxT("\\right.}");
 }
 
 wxString SumCell::ToOMML()
@@ -362,6 +367,13 @@ wxString SumCell::ToOMML()
 
 
 wxString SumCell::ToXML()
+{
+  wxString s;
+  WriteXML(s);
+  return s;
+}
+
+void SumCell::WriteXML(wxString &out)
 {
   wxString type(wxT("sum"));
 
@@ -370,14 +382,17 @@ wxString SumCell::ToXML()
   else if (m_over->ListToString() == wxEmptyString)
     type = wxT("lsum");
 
-
   wxString flags;
   if (m_forceBreakLine)
     flags += wxT(" breakline=\"true\"");
     
-  return wxT("<sm type=\"") + flags + type + wxT("\"><r>") + m_under->ListToXML() + _T("</r><r>") +
-         m_over->ListToXML() + _T("</r><r>") +
-         m_base->ListToXML() + _T("</r></sm>");
+  out += wxT("<sm type=\"") + flags + type + wxT("\"><r>");
+  m_under->ListWriteXML(out);
+  out += _T("</r><r>");
+  m_over->ListWriteXML(out);
+  out += _T("</r><r>");
+  m_base->ListWriteXML(out);
+  out += _T("</r></sm>");
 }
 
 wxString SumCell::ToMathML()
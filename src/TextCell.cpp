@@ -29,6 +29,7 @@
 #include "TextCell.h"
 #include "Setup.h"
 #include "wx/config.h"
+#include <map>
 
 TextCell::TextCell(MathCell *parent, Configuration **config, CellPointers *cellPointers, wxString text) : MathCell(parent, config)
 {
@@ -46,7 +47,13 @@ TextCell::TextCell(MathCell *parent, Configuration **config, CellPointers *cellP
   SetValue(text);
   m_highlight = false;
   m_dontEscapeOpeningParenthesis = false;
-  m_initialToolTip = (*m_configuration)->GetDefaultMathCellToolTip();
+  wxString initialToolTip = (*m_configuration)->GetDefaultMathCellToolTip();
+  if (initialToolTip != wxEmptyString)
+  {
+    size_t oldSize = ColdDataSize();
+    GetColdData()->m_initialToolTip = initialToolTip;
+    ColdDataResized(oldSize);
+  }
 }
 
 TextCell::~TextCell()
@@ -62,7 +69,7 @@ std::list<MathCell *> TextCell::GetInnerCells()
 
 void TextCell::SetValue(const wxString &text)
 {
-  m_toolTip = m_initialToolTip;
+  SetToolTip((m_coldData != NULL) ? m_coldData->m_initialToolTip : m_emptyString);
   m_displayedDigits_old = (*m_configuration)->GetDisplayedDigits();
   m_text = text;
   ResetSize();
@@ -75,46 +82,46 @@ void TextCell::SetValue(const wxString &text)
   if (m_textStyle == TS_FUNCTION)
   {
     if (m_text == wxT("ilt"))
-      m_toolTip = _("The inverse laplace transform.");
+      SetToolTip(_("The inverse laplace transform."));
   }      
 
   if (m_textStyle == TS_VARIABLE)
   {
     if (m_text == wxT("pnz"))
-      m_toolTip = _("Either positive, negative or zero.\n"
+      SetToolTip(_("Either positive, negative or zero.\n"
                     "Normally the result of sign() if the sign cannot be determined."
-        );
+        ));
 
     if (m_text == wxT("pz"))
-      m_toolTip = _("Either positive or zero.\n"
+      SetToolTip(_("Either positive or zero.\n"
                     "A possible result of sign()."
-        );
+        ));
   
     if (m_text == wxT("nz"))
-      m_toolTip = _("Either negative or zero.\n"
+      SetToolTip(_("Either negative or zero.\n"
                     "A possible result of sign()."
-        );
+        ));
 
     if (m_text == wxT("und"))
-      m_toolTip = _("The result was undefined.");
+      SetToolTip(_("The result was undefined."));
 
         if (m_text == wxT("ind"))
-      m_toolTip = _("The result was indefinite.");
+      SetToolTip(_("The result was indefinite."));
 
     if (m_text == wxT("zeroa"))
-      m_toolTip = _("Infinitesimal above zero.");
+      SetToolTip(_("Infinitesimal above zero."));
 
     if (m_text == wxT("zerob"))
-      m_toolTip = _("Infinitesimal below zero.");
+      SetToolTip(_("Infinitesimal below zero."));
 
     if (m_text == wxT("inf"))
-      m_toolTip = wxT("+∞.");
+      SetToolTip(wxT("+∞."));
 
     if (m_text == wxT("infinity"))
-      m_toolTip = _("Complex infinity.");
+      SetToolTip(_("Complex infinity."));
         
     if (m_text == wxT("inf"))
-      m_toolTip = wxT("-∞.");
+      SetToolTip(wxT("-∞."));
 
     if(m_text.StartsWith("%r"))
     {
@@ -132,8 +139,8 @@ void TextCell::SetValue(const wxString &text)
         }
 
       if(isrnum)
-        m_toolTip = _("A variable that can be assigned a number to.\n"
-          "Often used by solve() and algsys(), if there is an infinite number of results.");
+        SetToolTip(_("A variable that can be assigned a number to.\n"
+          "Often used by solve() and algsys(), if there is an infinite number of results."));
     }
 
   
@@ -153,7 +160,7 @@ void TextCell::SetValue(const wxString &text)
         }
       
       if(isinum)
-        m_toolTip = _("An integration constant.");
+        SetToolTip(_("An integration constant."));
     }
   }
   
@@ -168,21 +175,21 @@ void TextCell::SetValue(const wxString &text)
       m_displayedText = m_displayedText.Left(left) +
                         wxString::Format(_("[%i digits]"), (int) m_displayedText.Length() - 2 * left) +
                         m_displayedText.Right(left);
-      m_toolTip = _("The maximum number of displayed digits can be changed in the configuration dialogue");
+      SetToolTip(_("The maximum number of displayed digits can be changed in the configuration dialogue"));
     }
   }
   else
   {
     if(text.StartsWith(wxT("incorrect syntax")) && (text.Contains(wxT("is not an infix operator"))))
-      m_toolTip = _("A command or number wasn't preceded by a \":\", a \"$\", a \";\" or a \",\".\n"
-        "Most probable cause: A missing comma between two list items.");
+      SetToolTip(_("A command or number wasn't preceded by a \":\", a \"$\", a \";\" or a \",\".\n"
+        "Most probable cause: A missing comma between two list items."));
     if(text.StartsWith(wxT("part: fell off the end.")))
-       m_toolTip = _("part() or the [] operator was used in order to extract the nth element "
-                     "of something that was less than n elements long.");
+       SetToolTip(_("part() or the [] operator was used in order to extract the nth element "
+                     "of something that was less than n elements long."));
     if(text.StartsWith(wxT("assignment: cannot assign to")))
-       m_toolTip = _("The value of few special variables is assigned by Maxima and cannot be changed by the user. Also a few constructs aren't variable names and therefore cannot be written to.");
+       SetToolTip(_("The value of few special variables is assigned by Maxima and cannot be changed by the user. Also a few constructs aren't variable names and therefore cannot be written to."));
     if(text.StartsWith(wxT("rat: replaced ")))
-      m_toolTip = _("Normally computers use floating-point numbers that can be handled "
+      SetToolTip(_("Normally computers use floating-point numbers that can be handled "
                     "incredibly fast while being accurate to dozends of digits. "
                     "They will, though, introduce a small error into some common numbers. "
                     "For example 0.1 is represented as 3602879701896397/36028797018963968.\n"
@@ -195,40 +202,40 @@ void TextCell::SetValue(const wxString &text)
                     "This error message doesn't occur if exact numbers (1/10 instead of 0.1) "
                     "are used.\n"
                     "The info that numbers have automatically been converted can be suppressed "
-                    "by setting ratprint to false.");
+                    "by setting ratprint to false."));
     if(text.StartsWith(wxT("expt: undefined: 0 to a negative exponent.")))
-      m_toolTip = _("Division by 0.");
+      SetToolTip(_("Division by 0."));
     if(text.StartsWith(wxT("Only symbols can be bound")))
-      m_toolTip = _("This error message is most probably caused by a try to assign "
+      SetToolTip(_("This error message is most probably caused by a try to assign "
                     "a value to a number instead of a variable name.\n"
                     "One probable cause is using a variable that already has a numeric "
-                    "value as a loop counter.");
+                    "value as a loop counter."));
     if(text.StartsWith(wxT("append: operators of arguments must all be the same.")))
-      m_toolTip = _("Most probably it was attempted to append something to a list "
+      SetToolTip(_("Most probably it was attempted to append something to a list "
                     "that isn't a list.\n"
                     "Enclosing the new element for the list in brackets ([]) "
-                    "converts it to a list and makes it appendable.");
+                    "converts it to a list and makes it appendable."));
     if(text.StartsWith(wxT("part: invalid index of list or matrix.")))
-      m_toolTip = _("The [] or the part() command tried to access a list or matrix "
-                    "element that doesn't exist.");
+      SetToolTip(_("The [] or the part() command tried to access a list or matrix "
+                    "element that doesn't exist."));
     if(text.StartsWith(wxT("apply: subscript must be an integer; found:")))
-      m_toolTip = _("the [] operator tried to extract an element of a list, a matrix, "
+      SetToolTip(_("the [] operator tried to extract an element of a list, a matrix, "
                     "an equation or an array. But instead of an integer number "
                     "something was used whose numerical value is unknown or not an "
                     "integer.\n"
                     "Floating-point numbers are bound to contain small rounding errors "
-                    "and aren't allowed as an array index.");
+                    "and aren't allowed as an array index."));
     if(text.StartsWith(wxT(": improper argument: ")))
     {
       if((m_previous) && (m_previous->ToString() == wxT("at")))
-        m_toolTip = _("The second argument of at() isn't an equation or a list of "
-                      "equations. Most probably it was lacking an \"=\".");
+        SetToolTip(_("The second argument of at() isn't an equation or a list of "
+                      "equations. Most probably it was lacking an \"=\"."));
       else if((m_previous) && (m_previous->ToString() == wxT("subst")))
-        m_toolTip = _("The first argument of subst() isn't an equation or a list of "
-                      "equations. Most probably it was lacking an \"=\".");
+        SetToolTip(_("The first argument of subst() isn't an equation or a list of "
+                      "equations. Most probably it was lacking an \"=\"."));
       else
-        m_toolTip = _("The argument of a function was of the wrong type. Most probably "
-                      "an equation was expected but was lacking an \"=\".");
+        SetToolTip(_("The argument of a function was of the wrong type. Most probably "
+                      "an equation was expected but was lacking an \"=\"."));
     }
   }
   m_alt = m_altJs = false;
@@ -563,8 +570,8 @@ bool TextCell::IsOperator()
 wxString TextCell::ToString()
 {
   wxString text;
-  if (m_altCopyText != wxEmptyString)
-    text = m_altCopyText;
+  if (GetAltCopyText() != wxEmptyString)
+    text = GetAltCopyText();
   else
   {
     text = m_text;
@@ -633,6 +640,231 @@ wxString TextCell::ToString()
   return text;
 }
 
+//! How TextCell::TeXEscape() treats a character
+enum TeXEscapeKind
+{
+  TEX_PLAIN,    //!< Replace the character by a TeX string that works in any mode
+  TEX_MATH,     //!< Wrap the replacement in mathModeStart and mathModeEnd
+  TEX_TEXTMODE  //!< Only replace the character if we aren't inside \ensuremath{}
+};
+
+//! One entry of the table of characters TeX treats specially
+struct TeXEscapeEntry
+{
+  wxChar character;
+  const wxChar *tex;
+  TeXEscapeKind kind;
+};
+
+//! The characters TextCell::ToTeX() escapes. The first entry for a character wins.
+static const TeXEscapeEntry texEscapes[] = {
+  {wxT('\\'), wxT("\\backslash"), TEX_MATH},
+  {wxT('<'), wxT("<"), TEX_MATH},
+  {wxT('>'), wxT(">"), TEX_MATH},
+  {wxT('{'), wxT("\\{"), TEX_PLAIN},
+  {wxT('}'), wxT("\\}"), TEX_PLAIN},
+  {wxT('\xE4'), wxT("\\text{ä}"), TEX_TEXTMODE},
+  {wxT('\xF6'), wxT("\\text{ö}"), TEX_TEXTMODE},
+  {wxT('\xFC'), wxT("\\text{ü}"), TEX_TEXTMODE},
+  {wxT('\xC4'), wxT("\\text{Ä}"), TEX_TEXTMODE},
+  {wxT('\xD6'), wxT("\\text{Ö}"), TEX_TEXTMODE},
+  {wxT('\xDC'), wxT("\\text{Ü}"), TEX_TEXTMODE},
+#if wxUSE_UNICODE
+  {wxT('\x2212'), wxT("-"), TEX_PLAIN},
+  {wxT('\x00B1'), wxT("\\pm"), TEX_MATH},
+  {wxT('\x03B1'), wxT("\\alpha"), TEX_MATH},
+  {wxT('\x00B2'), wxT("^2"), TEX_MATH},
+  {wxT('\x00B3'), wxT("^3"), TEX_MATH},
+  {wxT('\x221A'), wxT("\\sqrt{}"), TEX_MATH},
+  {wxT('\x2148'), wxT("\\mathbbm{i}"), TEX_MATH},
+  {wxT('\x2147'), wxT("\\mathbbm{e}"), TEX_MATH},
+  {wxT('\x210F'), wxT("\\hbar"), TEX_MATH},
+  {wxT('\x2203'), wxT("\\exists"), TEX_MATH},
+  {wxT('\x2204'), wxT("\\nexists"), TEX_MATH},
+  {wxT('\x2208'), wxT("\\in"), TEX_MATH},
+  {wxT('\x21D2'), wxT("\\Longrightarrow"), TEX_MATH},
+  {wxT('\x221E'), wxT("\\infty"), TEX_MATH},
+  {wxT('\x22C0'), wxT("\\wedge"), TEX_MATH},
+  {wxT('\x22C1'), wxT("\\vee"), TEX_MATH},
+  {wxT('\x22BB'), wxT("\\oplus"), TEX_MATH},
+  {wxT('\x22BC'), wxT("\\overline{\\wedge}"), TEX_MATH},
+  {wxT('\x00AC'), wxT("\\setminus"), TEX_MATH},
+  {wxT('\x22C3'), wxT("\\cup"), TEX_MATH},
+  {wxT('\x22C2'), wxT("\\cap"), TEX_MATH},
+  {wxT('\x2286'), wxT("\\subseteq"), TEX_MATH},
+  {wxT('\x2282'), wxT("\\subset"), TEX_MATH},
+  {wxT('\x2288'), wxT("\\not\\subseteq"), TEX_MATH},
+  {wxT('\x0127'), wxT("\\hbar"), TEX_MATH},
+  {wxT('\x0126'), wxT("\\Hbar"), TEX_MATH},
+  {wxT('\x2205'), wxT("\\emptyset"), TEX_MATH},
+  {wxT('\x00BD'), wxT("\\frac{1}{2}"), TEX_MATH},
+  {wxT('\x03B2'), wxT("\\beta"), TEX_MATH},
+  {wxT('\x03B3'), wxT("\\gamma"), TEX_MATH},
+  {wxT('\x03B4'), wxT("\\delta"), TEX_MATH},
+  {wxT('\x03B5'), wxT("\\epsilon"), TEX_MATH},
+  {wxT('\x03B6'), wxT("\\zeta"), TEX_MATH},
+  {wxT('\x03B7'), wxT("\\eta"), TEX_MATH},
+  {wxT('\x03B8'), wxT("\\theta"), TEX_MATH},
+  {wxT('\x03B9'), wxT("\\iota"), TEX_MATH},
+  {wxT('\x03BA'), wxT("\\kappa"), TEX_MATH},
+  {wxT('\x03BB'), wxT("\\lambda"), TEX_MATH},
+  {wxT('\x03BC'), wxT("\\mu"), TEX_MATH},
+  {wxT('\x03BD'), wxT("\\nu"), TEX_MATH},
+  {wxT('\x03BE'), wxT("\\xi"), TEX_MATH},
+  {wxT('\x03BF'), wxT("\\omicron"), TEX_MATH},
+  {wxT('\x03C0'), wxT("\\pi"), TEX_MATH},
+  {wxT('\x03C1'), wxT("\\rho"), TEX_MATH},
+  {wxT('\x03C3'), wxT("\\sigma"), TEX_MATH},
+  {wxT('\x03C4'), wxT("\\tau"), TEX_MATH},
+  {wxT('\x03C5'), wxT("\\upsilon"), TEX_MATH},
+  {wxT('\x03C6'), wxT("\\phi"), TEX_MATH},
+  {wxT('\x03C7'), wxT("\\chi"), TEX_MATH},
+  {wxT('\x03C8'), wxT("\\psi"), TEX_MATH},
+  {wxT('\x03C9'), wxT("\\omega"), TEX_MATH},
+  {wxT('\x0391'), wxT("\\Alpha"), TEX_MATH},
+  {wxT('\x0392'), wxT("\\Beta"), TEX_MATH},
+  {wxT('\x0393'), wxT("\\Gamma"), TEX_MATH},
+  {wxT('\x0394'), wxT("\\Delta"), TEX_MATH},
+  {wxT('\x0395'), wxT("\\Epsilon"), TEX_MATH},
+  {wxT('\x0396'), wxT("\\Zeta"), TEX_MATH},
+  {wxT('\x0397'), wxT("\\Eta"), TEX_MATH},
+  {wxT('\x0398'), wxT("\\Theta"), TEX_MATH},
+  {wxT('\x0399'), wxT("\\Iota"), TEX_MATH},
+  {wxT('\x039A'), wxT("\\Kappa"), TEX_MATH},
+  {wxT('\x039B'), wxT("\\Lambda"), TEX_MATH},
+  {wxT('\x039C'), wxT("\\Mu"), TEX_MATH},
+  {wxT('\x039D'), wxT("\\Nu"), TEX_MATH},
+  {wxT('\x039E'), wxT("\\Xi"), TEX_MATH},
+  {wxT('\x039F'), wxT("\\Omicron"), TEX_MATH},
+  {wxT('\x03A0'), wxT("\\Pi"), TEX_MATH},
+  {wxT('\x03A1'), wxT("\\Rho"), TEX_MATH},
+  {wxT('\x03A3'), wxT("\\Sigma"), TEX_MATH},
+  {wxT('\x03A4'), wxT("\\Tau"), TEX_MATH},
+  {wxT('\x03A5'), wxT("\\Upsilon"), TEX_MATH},
+  {wxT('\x03A6'), wxT("\\Phi"), TEX_MATH},
+  {wxT('\x03A7'), wxT("\\Chi"), TEX_MATH},
+  {wxT('\x03A8'), wxT("\\Psi"), TEX_MATH},
+  {wxT('\x03A9'), wxT("\\Omega"), TEX_MATH},
+  {wxT('\x2202'), wxT("\\partial"), TEX_MATH},
+  {wxT('\x222B'), wxT("\\int"), TEX_MATH},
+  {wxT('\x2245'), wxT("\\approx"), TEX_MATH},
+  {wxT('\x221D'), wxT("\\propto"), TEX_MATH},
+  {wxT('\x2260'), wxT("\\neq"), TEX_MATH},
+  {wxT('\x2264'), wxT("\\leq"), TEX_MATH},
+  {wxT('\x2265'), wxT("\\geq"), TEX_MATH},
+  {wxT('\x226A'), wxT("\\ll"), TEX_MATH},
+  {wxT('\x226B'), wxT("\\gg"), TEX_MATH},
+  {wxT('\x220E'), wxT("\\blacksquare"), TEX_MATH},
+  {wxT('\x2263'), wxT("\\equiv"), TEX_MATH},
+  {wxT('\x2211'), wxT("\\sum"), TEX_MATH},
+  {wxT('\x220F'), wxT("\\prod"), TEX_MATH},
+  {wxT('\x2225'), wxT("\\parallel"), TEX_MATH},
+  {wxT('\x27C2'), wxT("\\bot"), TEX_MATH},
+  {wxT('~'), wxT("\\sim "), TEX_MATH},
+  {wxT('_'), wxT("\\_ "), TEX_PLAIN},
+  {wxT('$'), wxT("\\$ "), TEX_PLAIN},
+  {wxT('%'), wxT("\\% "), TEX_PLAIN},
+  {wxT('&'), wxT("\\& "), TEX_PLAIN},
+  {wxT('@'), wxT("@"), TEX_MATH},
+  {wxT('#'), wxT("\\neq"), TEX_MATH},
+  {wxT('\xDCB6'), wxT("~"), TEX_PLAIN},
+  {wxT('\x219D'), wxT("\\leadsto"), TEX_MATH},
+  {wxT('\x2192'), wxT("\\rightarrow"), TEX_MATH},
+  {wxT('\x2794'), wxT("\\longrightarrow"), TEX_MATH},
+#endif
+};
+
+//! Returns the escape table entry for a character or NULL if it can be copied verbatim
+static const TeXEscapeEntry *GetTeXEscape(wxChar ch)
+{
+  // ASCII characters are looked up in an array, everything else in a map
+  static const TeXEscapeEntry *asciiEscapes[128];
+  static std::map<wxChar, const TeXEscapeEntry *> otherEscapes;
+  static bool initialized = false;
+  if (!initialized)
+  {
+    for (size_t i = 0; i < 128; i++)
+      asciiEscapes[i] = NULL;
+    for (size_t i = 0; i < sizeof(texEscapes) / sizeof(texEscapes[0]); i++)
+    {
+      size_t c = (size_t) texEscapes[i].character;
+      if (c < 128)
+      {
+        if (asciiEscapes[c] == NULL)
+          asciiEscapes[c] = &texEscapes[i];
+      }
+      else if (otherEscapes.find(texEscapes[i].character) == otherEscapes.end())
+        otherEscapes[texEscapes[i].character] = &texEscapes[i];
+    }
+    initialized = true;
+  }
+
+  if (((size_t) ch) < 128)
+    return asciiEscapes[(size_t) ch];
+  std::map<wxChar, const TeXEscapeEntry *>::const_iterator it = otherEscapes.find(ch);
+  if (it == otherEscapes.end())
+    return NULL;
+  return it->second;
+}
+
+void TextCell::TeXEscape(wxString &out, const wxString &text,
+                         const wxString &mathModeStart, const wxString &mathModeEnd,
+                         bool textMode)
+{
+  out.reserve(out.Length() + text.Length() + text.Length() / 4);
+  for (wxString::const_iterator it = text.begin(); it != text.end(); ++it)
+  {
+    wxChar ch = *it;
+    const TeXEscapeEntry *escape = GetTeXEscape(ch);
+    if ((escape == NULL) || ((escape->kind == TEX_TEXTMODE) && !textMode))
+      out += ch;
+    else if (escape->kind == TEX_MATH)
+    {
+      out += mathModeStart;
+      out += escape->tex;
+      out += mathModeEnd;
+    }
+    else
+      out += escape->tex;
+  }
+}
+
+//! Does text need one of the treatments only TextCell::ToTeX() provides?
+static bool NeedsTeXPostprocessing(const wxString &text)
+{
+  for (wxString::const_iterator it = text.begin(); it != text.end(); ++it)
+  {
+    wxChar ch = *it;
+    if ((ch == wxT('*')) || (ch == wxT('\xB7')) || (ch == wxT('%')))
+      return true;
+    const TeXEscapeEntry *escape = GetTeXEscape(ch);
+    if ((escape != NULL) && (escape->kind == TEX_TEXTMODE))
+      return true;
+  }
+  return false;
+}
+
+void TextCell::WriteTeX(wxString &out)
+{
+  if ((m_isHidden) ||
+      ((GetStyle() != TS_NUMBER) && (GetStyle() != TS_VARIABLE)) ||
+      (((*m_configuration)->UseUserLabels()) && (m_userDefinedLabel != wxEmptyString)) ||
+      NeedsTeXPostprocessing(m_displayedText))
+  {
+    out += ToTeX();
+    return;
+  }
+
+  // Only an escaped "_" can make the 2nd character of the escaped text a "_".
+  bool mathit = (GetStyle() == TS_VARIABLE) && (m_displayedText.Length() > 1) &&
+                (m_displayedText[0] != wxT('_'));
+  if (mathit)
+    out += wxT("\\mathit{");
+  TeXEscape(out, m_displayedText, wxEmptyString, wxT(" "), true);
+  if (mathit)
+    out += wxT("}");
+}
+
 wxString TextCell::ToTeX()
 {
   wxString text = m_displayedText;
@@ -656,36 +888,17 @@ wxString TextCell::ToTeX()
   // The string needed in order to close the command that ensures we are in math mode.
   wxString mathModeEnd = wxT(" ");
 
-  if (
+  bool mathModeNeeded =
           (GetStyle() == TS_ERROR) ||
           (GetStyle() == TS_WARNING) ||
           (GetStyle() == TS_LABEL) ||
           (GetStyle() == TS_USERLABEL) ||
           (GetStyle() == TS_MAIN_PROMPT) ||
-          (GetStyle() == TS_OTHER_PROMPT)
-          )
+          (GetStyle() == TS_OTHER_PROMPT);
+  if (mathModeNeeded)
   {
     mathModeStart = wxT("\\ensuremath{");
     mathModeEnd = wxT("}");
-    text.Replace(wxT("\\"), mathModeStart + wxT("\\backslash") + mathModeEnd);
-    text.Replace(wxT("{"), wxT("\\{"));
-    text.Replace(wxT("}"), wxT("\\}"));
-  }
-  else
-  {
-    text.Replace(wxT("\\"), mathModeStart + wxT("\\backslash") + mathModeEnd);
-    text.Replace(wxT("{"), wxT("\\{"));
-    text.Replace(wxT("}"), wxT("\\}"));
-
-    // Babel replaces Umlaute by constructs like \"a - and \" isn't allowed in
-    // math mode. Fortunately amsTeX provides the \text command that allows to
-    // switch to plain text mode again - but with the math font size.
-    text.Replace(wxT("ä"), wxT("\\text{ä}"));
-    text.Replace(wxT("ö"), wxT("\\text{ö}"));
-    text.Replace(wxT("ü"), wxT("\\text{ü}"));
-    text.Replace(wxT("Ä"), wxT("\\text{Ä}"));
-    text.Replace(wxT("Ö"), wxT("\\text{Ö}"));
-    text.Replace(wxT("Ü"), wxT("\\text{Ü}"));
   }
 
   // If we don't want to show automatic labels the following "if" empties the label.
@@ -694,115 +907,16 @@ wxString TextCell::ToTeX()
     )
     text = wxT("");
 
-  text.Replace(wxT("<"), mathModeStart + wxT("<") + mathModeEnd);
-  text.Replace(wxT(">"), mathModeStart + wxT(">") + mathModeEnd);
-#if wxUSE_UNICODE
-  text.Replace(wxT("\x2212"), wxT("-")); // unicode minus sign
-  text.Replace(L"\x00B1", mathModeStart + wxT("\\pm") + mathModeEnd);
-  text.Replace(L"\x03B1", mathModeStart + wxT("\\alpha") + mathModeEnd);
-  text.Replace(L"\x00B2", mathModeStart + wxT("^2") + mathModeEnd);
-  text.Replace(L"\x00B3", mathModeStart + wxT("^3") + mathModeEnd);
-  text.Replace(L"\x221A", mathModeStart + wxT("\\sqrt{}") + mathModeEnd);
-  text.Replace(L"\x2148", mathModeStart + wxT("\\mathbbm{i}") + mathModeEnd);
-  text.Replace(L"\x2147", mathModeStart + wxT("\\mathbbm{e}") + mathModeEnd);
-  text.Replace(L"\x210f", mathModeStart + wxT("\\hbar") + mathModeEnd);
-  text.Replace(L"\x2203", mathModeStart + wxT("\\exists") + mathModeEnd);
-  text.Replace(L"\x2204", mathModeStart + wxT("\\nexists") + mathModeEnd);
-  text.Replace(L"\x2208", mathModeStart + wxT("\\in") + mathModeEnd);
-  text.Replace(L"\x21D2", mathModeStart + wxT("\\Longrightarrow") + mathModeEnd);
-  text.Replace(L"\x221e", mathModeStart + wxT("\\infty") + mathModeEnd);
-  text.Replace(L"\x22C0", mathModeStart + wxT("\\wedge") + mathModeEnd);
-  text.Replace(L"\x22C1", mathModeStart + wxT("\\vee") + mathModeEnd);
-  text.Replace(L"\x22bb", mathModeStart + wxT("\\oplus") + mathModeEnd);
-  text.Replace(L"\x22BC", mathModeStart + wxT("\\overline{\\wedge}") + mathModeEnd);
-  text.Replace(L"\x22BB", mathModeStart + wxT("\\overline{\\vee}") + mathModeEnd);
-  text.Replace(L"\x00AC", mathModeStart + wxT("\\setminus") + mathModeEnd);
-  text.Replace(L"\x22C3", mathModeStart + wxT("\\cup") + mathModeEnd);
-  text.Replace(L"\x22C2", mathModeStart + wxT("\\cap") + mathModeEnd);
-  text.Replace(L"\x2286", mathModeStart + wxT("\\subseteq") + mathModeEnd);
-  text.Replace(L"\x2282", mathModeStart + wxT("\\subset") + mathModeEnd);
-  text.Replace(L"\x2288", mathModeStart + wxT("\\not\\subseteq") + mathModeEnd);
-  text.Replace(L"\x0127", mathModeStart + wxT("\\hbar") + mathModeEnd);
-  text.Replace(L"\x0126", mathModeStart + wxT("\\Hbar") + mathModeEnd);
-  text.Replace(L"\x2205", mathModeStart + wxT("\\emptyset") + mathModeEnd);
-  text.Replace(L"\x00BD", mathModeStart + wxT("\\frac{1}{2}") + mathModeEnd);
-  text.Replace(L"\x03B2", mathModeStart + wxT("\\beta") + mathModeEnd);
-  text.Replace(L"\x03B3", mathModeStart + wxT("\\gamma") + mathModeEnd);
-  text.Replace(L"\x03B4", mathModeStart + wxT("\\delta") + mathModeEnd);
-  text.Replace(L"\x03B5", mathModeStart + wxT("\\epsilon") + mathModeEnd);
-  text.Replace(L"\x03B6", mathModeStart + wxT("\\zeta") + mathModeEnd);
-  text.Replace(L"\x03B7", mathModeStart + wxT("\\eta") + mathModeEnd);
-  text.Replace(L"\x03B8", mathModeStart + wxT("\\theta") + mathModeEnd);
-  text.Replace(L"\x03B9", mathModeStart + wxT("\\iota") + mathModeEnd);
-  text.Replace(L"\x03BA", mathModeStart + wxT("\\kappa") + mathModeEnd);
-  text.Replace(L"\x03BB", mathModeStart + wxT("\\lambda") + mathModeEnd);
-  text.Replace(L"\x03BC", mathModeStart + wxT("\\mu") + mathModeEnd);
-  text.Replace(L"\x03BD", mathModeStart + wxT("\\nu") + mathModeEnd);
-  text.Replace(L"\x03BE", mathModeStart + wxT("\\xi") + mathModeEnd);
-  text.Replace(L"\x03BF", mathModeStart + wxT("\\omicron") + mathModeEnd);
-  text.Replace(L"\x03C0", mathModeStart + wxT("\\pi") + mathModeEnd);
-  text.Replace(L"\x03C1", mathModeStart + wxT("\\rho") + mathModeEnd);
-  text.Replace(L"\x03C3", mathModeStart + wxT("\\sigma") + mathModeEnd);
-  text.Replace(L"\x03C4", mathModeStart + wxT("\\tau") + mathModeEnd);
-  text.Replace(L"\x03C5", mathModeStart + wxT("\\upsilon") + mathModeEnd);
-  text.Replace(L"\x03C6", mathModeStart + wxT("\\phi") + mathModeEnd);
-  text.Replace(L"\x03C7", mathModeStart + wxT("\\chi") + mathModeEnd);
-  text.Replace(L"\x03C8", mathModeStart + wxT("\\psi") + mathModeEnd);
-  text.Replace(L"\x03C9", mathModeStart + wxT("\\omega") + mathModeEnd);
-  text.Replace(L"\x0391", mathModeStart + wxT("\\Alpha") + mathModeEnd);
-  text.Replace(L"\x0392", mathModeStart + wxT("\\Beta") + mathModeEnd);
-  text.Replace(L"\x0393", mathModeStart + wxT("\\Gamma") + mathModeEnd);
-  text.Replace(L"\x0394", mathModeStart + wxT("\\Delta") + mathModeEnd);
-  text.Replace(L"\x0395", mathModeStart + wxT("\\Epsilon") + mathModeEnd);
-  text.Replace(L"\x0396", mathModeStart + wxT("\\Zeta") + mathModeEnd);
-  text.Replace(L"\x0397", mathModeStart + wxT("\\Eta") + mathModeEnd);
-  text.Replace(L"\x0398", mathModeStart + wxT("\\Theta") + mathModeEnd);
-  text.Replace(L"\x0399", mathModeStart + wxT("\\Iota") + mathModeEnd);
-  text.Replace(L"\x039A", mathModeStart + wxT("\\Kappa") + mathModeEnd);
-  text.Replace(L"\x039B", mathModeStart + wxT("\\Lambda") + mathModeEnd);
-  text.Replace(L"\x039C", mathModeStart + wxT("\\Mu") + mathModeEnd);
-  text.Replace(L"\x039D", mathModeStart + wxT("\\Nu") + mathModeEnd);
-  text.Replace(L"\x039E", mathModeStart + wxT("\\Xi") + mathModeEnd);
-  text.Replace(L"\x039F", mathModeStart + wxT("\\Omicron") + mathModeEnd);
-  text.Replace(L"\x03A0", mathModeStart + wxT("\\Pi") + mathModeEnd);
-  text.Replace(L"\x03A1", mathModeStart + wxT("\\Rho") + mathModeEnd);
-  text.Replace(L"\x03A3", mathModeStart + wxT("\\Sigma") + mathModeEnd);
-  text.Replace(L"\x03A4", mathModeStart + wxT("\\Tau") + mathModeEnd);
-  text.Replace(L"\x03A5", mathModeStart + wxT("\\Upsilon") + mathModeEnd);
-  text.Replace(L"\x03A6", mathModeStart + wxT("\\Phi") + mathModeEnd);
-  text.Replace(L"\x03A7", mathModeStart + wxT("\\Chi") + mathModeEnd);
-  text.Replace(L"\x03A8", mathModeStart + wxT("\\Psi") + mathModeEnd);
-  text.Replace(L"\x03A9", mathModeStart + wxT("\\Omega") + mathModeEnd);
-  text.Replace(L"\x2202", mathModeStart + wxT("\\partial") + mathModeEnd);
-  text.Replace(L"\x222b", mathModeStart + wxT("\\int") + mathModeEnd);
-  text.Replace(L"\x2245", mathModeStart + wxT("\\approx") + mathModeEnd);
-  text.Replace(L"\x221d", mathModeStart + wxT("\\propto") + mathModeEnd);
-  text.Replace(L"\x2260", mathModeStart + wxT("\\neq") + mathModeEnd);
-  text.Replace(L"\x2264", mathModeStart + wxT("\\leq") + mathModeEnd);
-  text.Replace(L"\x2265", mathModeStart + wxT("\\geq") + mathModeEnd);
-  text.Replace(L"\x226A", mathModeStart + wxT("\\ll") + mathModeEnd);
-  text.Replace(L"\x226B", mathModeStart + wxT("\\gg") + mathModeEnd);
-  text.Replace(L"\x220e", mathModeStart + wxT("\\blacksquare") + mathModeEnd);
-  text.Replace(L"\x2263", mathModeStart + wxT("\\equiv") + mathModeEnd);
-  text.Replace(L"\x2211", mathModeStart + wxT("\\sum") + mathModeEnd);
-  text.Replace(L"\x220F", mathModeStart + wxT("\\prod") + mathModeEnd);
-  text.Replace(L"\x2225", mathModeStart + wxT("\\parallel") + mathModeEnd);
-  text.Replace(L"\x27C2", mathModeStart + wxT("\\bot") + mathModeEnd);
-  text.Replace(wxT("~"), mathModeStart + wxT("\\sim ") + mathModeEnd);
-  text.Replace(wxT("_"), wxT("\\_ "));
-  text.Replace(wxT("$"), wxT("\\$ "));
-  text.Replace(wxT("%"), wxT("\\% "));
-  text.Replace(wxT("&"), wxT("\\& "));
-  text.Replace(wxT("@"), mathModeStart + wxT("@") + mathModeEnd);
-  text.Replace(wxT("#"), mathModeStart + wxT("\\neq") + mathModeEnd);
-  text.Replace(wxT("\xDCB6"), wxT("~")); // A non-breakable space
-  text.Replace(wxT("<"), mathModeStart + wxT("<") + mathModeEnd);
-  text.Replace(wxT(">"), mathModeStart + wxT(">") + mathModeEnd);
-  text.Replace(wxT("\x219D"), mathModeStart + wxT("\\leadsto") + mathModeEnd);
-  text.Replace(wxT("\x2192"), mathModeStart + wxT("\\rightarrow") + mathModeEnd);
-  text.Replace(wxT("\x2794"), mathModeStart + wxT("\\longrightarrow") + mathModeEnd);
-#endif
-
+  // Escape all characters TeX treats specially in a single pass over the text.
+  // Babel replaces Umlaute by constructs like \"a - and \" isn't allowed in
+  // math mode. Fortunately amsTeX provides the \text command that allows to
+  // switch to plain text mode again - but with the math font size.
+  if (!text.IsEmpty())
+  {
+    wxString escaped;
+    TeXEscape(escaped, text, mathModeStart, mathModeEnd, !mathModeNeeded);
+    text = escaped;
+  }
 
   // m_IsHidden is set for multiplication signs and parenthesis that
   // don't need to be shown
@@ -1282,8 +1396,8 @@ wxString TextCell::ToXML()
   if(m_userDefinedLabel != wxEmptyString)
     flags += wxT(" userdefinedlabel=\"") + XMLescape(m_userDefinedLabel) + wxT("\"");
 
-  if(m_toolTip != wxEmptyString)
-    flags += wxT(" tooltip=\"") + XMLescape(m_toolTip) + wxT("\"");
+  if(GetLocalToolTip() != wxEmptyString)
+    flags += wxT(" tooltip=\"") + XMLescape(GetLocalToolTip()) + wxT("\"");
 
   return wxT("<") + tag + flags + wxT(">") + xmlstring + wxT("</") + tag + wxT(">");
 }
@@ -44,6 +44,13 @@ public:
   
   MathCell *Copy();
 
+  size_t SizeInMemory()
+  {
+    return sizeof(TextCell) + ColdDataSize() +
+      (m_text.Length() + m_displayedText.Length() + m_altText.Length() + m_altJsText.Length() +
+       m_userDefinedLabel.Length()) * sizeof(wxChar);
+  }
+
   //! Set the text contained in this cell
   void SetValue(const wxString &text);
 
@@ -67,6 +74,27 @@ public:
 
   wxString ToTeX();
 
+  /*! Append this cell's LaTeX representation to out
+
+    Numbers and variable names make up most of a big output. If they don't
+    need any of the special treatments ToTeX() provides they are escaped
+    directly into out without creating a temporary string.
+   */
+  void WriteTeX(wxString &out);
+
+  /*! Appends text to out, escaping every character TeX treats specially
+
+    Works in a single pass over the text using a lookup table instead of
+    searching the whole string once for every character that needs escaping.
+    \param out The string the escaped text is appended to
+    \param text The text to escape
+    \param mathModeStart, mathModeEnd The strings that wrap symbols that need math mode
+    \param textMode true = also escape the umlauts that aren't allowed in math mode
+   */
+  static void TeXEscape(wxString &out, const wxString &text,
+                        const wxString &mathModeStart, const wxString &mathModeEnd,
+                        bool textMode);
+
   wxString ToMathML();
 
   wxString ToOMML();
@@ -136,7 +164,6 @@ protected:
 private:
   //! Produces a text sample that determines the label width
   wxString LabelWidthText();
-  wxString m_initialToolTip;
 };
 
 #endif // TEXTCELL_H
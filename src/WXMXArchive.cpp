@@ -0,0 +1,272 @@
+﻿// -*- mode: c++; c-file-style: "linux"; c-basic-offset: 2; indent-tabs-mode: nil -*-
+//
+//  Copyright (C) 2017 Gunter Königsmann <wxMaxima@physikbuch.de>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+
+/*! \file
+  This file defines the class WXMXArchive
+
+  WXMXArchive gives direct access to the files contained in a .wxmx archive.
+ */
+
+#include "WXMXArchive.h"
+
+#include <wx/file.h>
+#include <wx/mstream.h>
+#include <wx/zstream.h>
+
+#if defined __WXMSW__
+#include <windows.h>
+#include <io.h>
+#else
+#include <sys/mman.h>
+#endif
+
+WXMXArchive::WXMXArchive()
+{
+  m_data = NULL;
+  m_length = 0;
+  m_isMapped = false;
+#if defined __WXMSW__
+  m_mapping = NULL;
+#endif
+}
+
+WXMXArchive::~WXMXArchive()
+{
+  Close();
+}
+
+void WXMXArchive::Close()
+{
+  m_entries.clear();
+  if (m_data)
+  {
+    if (m_isMapped)
+    {
+#if defined __WXMSW__
+      UnmapViewOfFile(m_data);
+      CloseHandle((HANDLE) m_mapping);
+      m_mapping = NULL;
+#else
+      munmap(m_data, m_length);
+#endif
+    }
+    else
+      delete[] m_data;
+  }
+  m_data = NULL;
+  m_length = 0;
+  m_isMapped = false;
+}
+
+bool WXMXArchive::Open(const wxString &file)
+{
+  Close();
+
+  wxFile archive(file);
+  if (!archive.IsOpened())
+    return false;
+
+  wxFileOffset length = archive.Length();
+  if (length <= 0)
+    return false;
+  m_length = length;
+
+  // Try to map the file into memory. The mapping is a private one so changes
+  // to the data (like repairing illegal characters) never reach the disk.
+#if defined __WXMSW__
+  HANDLE mapping = CreateFileMapping((HANDLE) _get_osfhandle(archive.fd()), NULL, PAGE_WRITECOPY, 0, 0, NULL);
+  if (mapping != NULL)
+  {
+    m_data = (char *) MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+    if (m_data != NULL)
+    {
+      m_mapping = mapping;
+      m_isMapped = true;
+    }
+    else
+      CloseHandle(mapping);
+  }
+#else
+  void *data = mmap(NULL, m_length, PROT_READ | PROT_WRITE, MAP_PRIVATE, archive.fd(), 0);
+  if (data != MAP_FAILED)
+  {
+    m_data = (char *) data;
+    m_isMapped = true;
+  }
+#endif
+
+  // If mapping the file didn't work we can still read it.
+  if (m_data == NULL)
+  {
+    m_data = new char[m_length];
+    if (archive.Read(m_data, m_length) != (ssize_t) m_length)
+    {
+      Close();
+      return false;
+    }
+  }
+
+  // The mapping stays valid after the file has been closed.
+  archive.Close();
+
+  if (!ReadCentralDirectory())
+  {
+    Close();
+    return false;
+  }
+  return true;
+}
+
+unsigned int WXMXArchive::Read16(size_t pos) const
+{
+  const unsigned char *data = (const unsigned char *) m_data + pos;
+  return data[0] | (data[1] << 8);
+}
+
+size_t WXMXArchive::Read32(size_t pos) const
+{
+  const unsigned char *data = (const unsigned char *) m_data + pos;
+  return (size_t) data[0] | ((size_t) data[1] << 8) | ((size_t) data[2] << 16) | ((size_t) data[3] << 24);
+}
+
+wxString WXMXArchive::NormalizeName(wxString name)
+{
+  while (name.StartsWith(wxT("/")))
+    name = name.Mid(1);
+  return name;
+}
+
+bool WXMXArchive::ReadCentralDirectory()
+{
+  // The "end of central directory" record is at the end of the file, followed
+  // only by a comment of up to 65535 bytes.
+  const size_t endRecordLength = 22;
+  if (m_length < endRecordLength)
+    return false;
+
+  size_t endRecord = m_length - endRecordLength;
+  size_t searchLimit = 0;
+  if (m_length > endRecordLength + 65535)
+    searchLimit = m_length - endRecordLength - 65535;
+  while (Read32(endRecord) != 0x06054b50)
+  {
+    if (endRecord <= searchLimit)
+      return false;
+    endRecord--;
+  }
+
+  unsigned int entries = Read16(endRecord + 10);
+  size_t directorySize = Read32(endRecord + 12);
+  size_t pos = Read32(endRecord + 16);
+  if ((pos > m_length) || (directorySize > m_length - pos))
+    return false;
+  size_t directoryEnd = pos + directorySize;
+
+  for (unsigned int i = 0; i < entries; i++)
+  {
+    const size_t headerLength = 46;
+    if ((directoryEnd - pos < headerLength) || (Read32(pos) != 0x02014b50))
+      return false;
+
+    unsigned int flags = Read16(pos + 8);
+    size_t nameLength = Read16(pos + 28);
+    size_t extraLength = Read16(pos + 30);
+    size_t commentLength = Read16(pos + 32);
+    if (directoryEnd - pos - headerLength < nameLength + extraLength + commentLength)
+      return false;
+
+    Entry entry;
+    entry.m_method = Read16(pos + 10);
+    entry.m_compressedSize = Read32(pos + 20);
+    entry.m_size = Read32(pos + 24);
+    entry.m_localHeader = Read32(pos + 42);
+    entry.m_isInflated = false;
+
+    // Bit 11 of the flags tells if the file name is UTF-8 encoded.
+    wxString name;
+    if (flags & 0x0800)
+      name = wxString::FromUTF8(m_data + pos + headerLength, nameLength);
+    else
+      name = wxString(m_data + pos + headerLength, wxConvISO8859_1, nameLength);
+
+    m_entries[NormalizeName(name)] = entry;
+    pos += headerLength + nameLength + extraLength + commentLength;
+  }
+  return true;
+}
+
+bool WXMXArchive::HasEntry(wxString name) const
+{
+  return m_entries.find(NormalizeName(name)) != m_entries.end();
+}
+
+bool WXMXArchive::GetEntry(wxString name, char *&data, size_t &length)
+{
+  std::map<wxString, Entry>::iterator it = m_entries.find(NormalizeName(name));
+  if (it == m_entries.end())
+    return false;
+  Entry &entry = it->second;
+
+  // The file's data follows its local header whose extra field might differ
+  // from the one in the central directory.
+  const size_t localHeaderLength = 30;
+  size_t pos = entry.m_localHeader;
+  if ((pos > m_length) || (m_length - pos < localHeaderLength) || (Read32(pos) != 0x04034b50))
+    return false;
+  pos += localHeaderLength + Read16(pos + 26) + Read16(pos + 28);
+  if ((pos > m_length) || (m_length - pos < entry.m_compressedSize))
+    return false;
+
+  switch (entry.m_method)
+  {
+    case 0:
+      // Stored: The data can be used as it is.
+      if (entry.m_size != entry.m_compressedSize)
+        return false;
+      data = m_data + pos;
+      length = entry.m_size;
+      return true;
+
+    case 8:
+      // Deflated: Inflate the data the first time it is requested.
+      if (!entry.m_isInflated)
+      {
+        entry.m_inflated.resize(entry.m_size + 1);
+        if (entry.m_size > 0)
+        {
+          wxMemoryInputStream compressed(m_data + pos, entry.m_compressedSize);
+          wxZlibInputStream inflater(compressed, wxZLIB_NO_HEADER);
+          inflater.Read(&entry.m_inflated[0], entry.m_size);
+          if (inflater.LastRead() != entry.m_size)
+          {
+            entry.m_inflated.clear();
+            return false;
+          }
+        }
+        entry.m_isInflated = true;
+      }
+      data = &entry.m_inflated[0];
+      length = entry.m_size;
+      return true;
+
+    default:
+      return false;
+  }
+}
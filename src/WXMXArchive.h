@@ -0,0 +1,129 @@
+﻿// -*- mode: c++; c-file-style: "linux"; c-basic-offset: 2; indent-tabs-mode: nil -*-
+//
+//  Copyright (C) 2017 Gunter Königsmann <wxMaxima@physikbuch.de>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+
+/*! \file
+  This file declares the class WXMXArchive
+
+  WXMXArchive gives direct access to the files contained in a .wxmx archive.
+ */
+
+#ifndef WXMXARCHIVE_H
+#define WXMXARCHIVE_H
+
+#include <wx/wx.h>
+#include <wx/string.h>
+#include <map>
+#include <vector>
+
+/*! Read access to the contents of a .wxmx file
+
+  Opening a .wxmx file using wxFileSystem means that every file that is read
+  from it (content.xml and every single image) causes the archive to be
+  searched for the file and to be read through a chain of streams.
+
+  Instead this class maps the whole archive into memory once and reads its
+  central directory into an index. After that the data of every entry that
+  is stored uncompressed (which is what wxMaxima writes by default) can be
+  accessed directly in the mapped memory without copying it. Compressed
+  entries are inflated once on their first access.
+
+  The mapping is a private copy-on-write one which means that the data
+  GetEntry() returns can be modified without affecting the file on disk.
+  If mapping the file isn't possible it is read into memory instead.
+ */
+class WXMXArchive
+{
+public:
+  WXMXArchive();
+
+  ~WXMXArchive();
+
+  /*! Open a .wxmx file and read its table of contents
+
+    \return false if the file cannot be read or isn't a valid .zip archive
+   */
+  bool Open(const wxString &file);
+
+  //! Close the archive. All data GetEntry() has returned becomes invalid.
+  void Close();
+
+  //! Is an archive open?
+  bool IsOk() const
+  { return m_data != NULL; }
+
+  /*! Get the contents of a file in the archive
+
+    \param name   The file's name inside the archive
+    \param data   Is set to the file's contents. This data stays valid until
+                  the archive is closed and may be modified.
+    \param length Is set to the file's length in bytes
+    \return false if the archive doesn't contain the file or it cannot be read
+   */
+  bool GetEntry(wxString name, char *&data, size_t &length);
+
+  //! Does the archive contain a file of this name?
+  bool HasEntry(wxString name) const;
+
+private:
+  //! What we need to know about a file in the archive
+  struct Entry
+  {
+    //! The compression method: 0 = stored, 8 = deflated
+    unsigned int m_method;
+    //! The size of the data in the archive
+    size_t m_compressedSize;
+    //! The size of the file
+    size_t m_size;
+    //! The position of the file's local header in the archive
+    size_t m_localHeader;
+    //! The inflated contents of a compressed file
+    std::vector<char> m_inflated;
+    //! Has the compressed file already been inflated?
+    bool m_isInflated;
+  };
+
+  //! Read the archive's central directory into m_entries
+  bool ReadCentralDirectory();
+
+  //! Read a little-endian 16-bit value from the archive
+  unsigned int Read16(size_t pos) const;
+
+  //! Read a little-endian 32-bit value from the archive
+  size_t Read32(size_t pos) const;
+
+  //! Remove a leading "/" from a file name
+  static wxString NormalizeName(wxString name);
+
+  //! The files in the archive by their name
+  std::map<wxString, Entry> m_entries;
+
+  //! The contents of the archive
+  char *m_data;
+  //! The length of the archive
+  size_t m_length;
+  //! true = m_data is a memory mapping, false = m_data was allocated using new[]
+  bool m_isMapped;
+#if defined __WXMSW__
+  //! The file mapping object m_data is a view of
+  void *m_mapping;
+#endif
+};
+
+#endif // WXMXARCHIVE_H
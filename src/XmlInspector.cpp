@@ -29,12 +29,19 @@
 
 #include <wx/sizer.h>
 #include <wx/regex.h>
+#include <wx/clipbrd.h>
 
-XmlInspector::XmlInspector(wxWindow *parent, int id) : wxRichTextCtrl(parent, id, wxEmptyString, wxDefaultPosition,
-                                                                  wxDefaultSize, wxTE_READONLY | wxTE_RICH | wxHSCROLL |
-                                                                                 wxTE_MULTILINE)
+const size_t XmlInspector::m_maxPendingLength;
+const size_t XmlInspector::m_maxLines;
+const size_t XmlInspector::m_maxLineLength;
+
+XmlInspector::XmlInspector(wxWindow *parent, int id, ProtocolLog *log) :
+  wxVListBox(parent, id, wxDefaultPosition, wxDefaultSize, wxLB_MULTIPLE)
 {
-  BeginSuppressUndo();
+  SetFont(wxFont(10, wxFONTFAMILY_MODERN, wxFONTSTYLE_NORMAL, wxFONTWEIGHT_NORMAL));
+  m_lineHeight = GetCharHeight() + 2;
+  m_log = log;
+  m_lineOpen = false;
   Clear();
 }
 
@@ -45,8 +52,9 @@ XmlInspector::~XmlInspector()
 void XmlInspector::Clear()
 {
   m_clear = true;
-  m_fromMaxima = wxEmptyString;
-  m_toMaxima = wxEmptyString;
+  m_pending.clear();
+  m_pendingLength = 0;
+  m_pendingDropped = 0;
   m_updateNeeded = true;
 }
 
@@ -55,86 +63,180 @@ void XmlInspector::Update()
   if(!m_updateNeeded)
     return;
   m_updateNeeded = false;
-  
+
+  size_t linesBefore = m_lines.size();
+  bool atEnd = (GetItemCount() == 0) || (GetVisibleRowsEnd() >= GetItemCount());
+
   if(m_clear)
   {
-    wxRichTextCtrl::Clear();
+    m_lines.clear();
+    m_lineOpen = false;
     m_lastChar = wxChar(0);
     m_indentLevel = 0;
     m_state = clear;
     m_clear = false;
   }
-  
-  // Display all data we have sent to Maxima
-  if(m_toMaxima != wxEmptyString)
+
+  if(m_pendingDropped > 0)
   {
-    if(m_state != toMaxima)
+    AddHeading(wxString::Format(_("[%lu characters omitted]"), (unsigned long) m_pendingDropped));
+    m_state = clear;
+    m_pendingDropped = 0;
+  }
+
+  for(std::deque<PendingChunk>::iterator chunk = m_pending.begin(); chunk != m_pending.end(); ++chunk)
+  {
+    // Display all data we have sent to Maxima
+    if(chunk->direction == toMaxima)
     {
-      if(GetValue() != wxEmptyString)
+      if(m_state != toMaxima)
       {
-        Newline();Newline();
+        if(!m_lines.empty())
+          AddHeading(wxEmptyString);
+        AddHeading(_("SENT TO MAXIMA:"));
+        AddHeading(wxEmptyString);
+        m_state = toMaxima;
       }
-      BeginTextColour(wxColour(0,0,0));
-      WriteText(_("SENT TO MAXIMA:"));
-      Newline();Newline();
-      EndTextColour();
-      m_state = toMaxima;
+      else
+        AddText(toMaxima, wxT("\n"));
+
+      AddText(toMaxima, chunk->text);
     }
+    // Display all data from Maxima
     else
-      WriteText("\n");
+    {
+      if(m_state != fromMaxima)
+      {
+        if(!m_lines.empty())
+          AddHeading(wxEmptyString);
+        AddHeading(_("MAXIMA RESPONSE:"));
+        AddHeading(wxEmptyString);
+        m_state = fromMaxima;
+      }
+      chunk->text.Replace(wxT("$FUNCTION:"), wxT("\n$FUNCTION:"));
+
+      // Indent the XML
+      wxString textWithIndention;
+      for ( wxString::iterator it = chunk->text.begin(); it!=chunk->text.end(); ++it)
+      {    
+        // Assume that all tags add indentation
+        if (*it == wxT('>'))
+          m_indentLevel++;
+      
+        // A closing tag needs to remove the indentation of the opening tag 
+        // plus the indentation of the closing tag
+        if ((m_lastChar == wxT('<')) && (*it == wxT('/')))
+          m_indentLevel -= 2;
     
-    BeginTextColour(wxColour(128,0,0));
-    WriteText(m_toMaxima);
-    EndTextColour();
-    m_toMaxima = wxEmptyString;
+        // Self-closing Tags remove their own indentation
+        if ((m_lastChar == wxT('/')) && (*it == wxT('>')))
+          m_indentLevel -= 1;
+    
+        // Add a linebreak and indent if we are at the space between 2 tags
+        if ((m_lastChar == wxT('>')) && (*it == wxT('<')))
+          textWithIndention += wxT ("\n") + IndentString(m_indentLevel);
+
+        textWithIndention += *it;
+        m_lastChar = *it;
+      }
+      AddText(fromMaxima, textWithIndention);
+    }
+  }
+  m_pending.clear();
+  m_pendingLength = 0;
+
+  // Drop the oldest lines if there are too many.
+  size_t dropped = 0;
+  while(m_lines.size() > m_maxLines)
+  {
+    m_lines.pop_front();
+    dropped++;
   }
 
-  // Display all data from Maxima
-  if(m_fromMaxima != wxEmptyString)
+  // The line numbers have changed => the selection no more is valid.
+  if((dropped > 0) || (m_lines.size() < linesBefore))
+    DeselectAll();
+
+  size_t firstVisible = GetVisibleRowsBegin();
+  SetItemCount(m_lines.size());
+  if(!m_lines.empty())
   {
-    if(m_state != fromMaxima)
+    // Follow the new data if the user hasn't scrolled away from it.
+    if(atEnd)
+      ScrollToRow(m_lines.size() - 1);
+    else if(firstVisible > dropped)
+      ScrollToRow(firstVisible - dropped);
+    else
+      ScrollToRow(0);
+  }
+  RefreshAll();
+}
+
+void XmlInspector::AddHeading(const wxString &text)
+{
+  Line line;
+  line.direction = clear;
+  line.text = text;
+  m_lines.push_back(line);
+  m_lineOpen = false;
+}
+
+void XmlInspector::AddText(monitorState direction, const wxString &text)
+{
+  for ( wxString::const_iterator it = text.begin(); it!=text.end(); ++it)
+  {
+    if (*it == wxT('\n'))
     {
-      if(GetValue() != wxEmptyString)
-      {
-        Newline();Newline();
-      }
-      BeginTextColour(wxColour(0,0,0));
-      WriteText(_("MAXIMA RESPONSE:"));
-      Newline();Newline();    
-      EndTextColour();
-      m_state = fromMaxima;
+      // An empty line still needs to be displayed.
+      if (!m_lineOpen)
+        AddText(direction, wxT(" "));
+      m_lineOpen = false;
+      continue;
     }
-    m_fromMaxima.Replace(wxT("$FUNCTION:"), wxT("\n$FUNCTION:"));
-
-    // Indent the XML
-    wxString textWithIndention;
-    for ( wxString::iterator it = m_fromMaxima.begin(); it!=m_fromMaxima.end(); ++it)
-    {    
-      // Assume that all tags add indentation
-      if (*it == wxT('>'))
-        m_indentLevel++;
-      
-      // A closing tag needs to remove the indentation of the opening tag 
-      // plus the indentation of the closing tag
-      if ((m_lastChar == wxT('<')) && (*it == wxT('/')))
-        m_indentLevel -= 2;
-    
-      // Self-closing Tags remove their own indentation
-      if ((m_lastChar == wxT('/')) && (*it == wxT('>')))
-        m_indentLevel -= 1;
     
-      // Add a linebreak and indent if we are at the space between 2 tags
-      if ((m_lastChar == wxT('>')) && (*it == wxT('<')))
-        textWithIndention += wxT ("\n") + IndentString(m_indentLevel);
+    // Start a new line if the last one has ended, is of the other direction or
+    // is too long to be displayed.
+    if ((!m_lineOpen) || (m_lines.back().direction != direction) ||
+        (m_lines.back().text.Length() >= m_maxLineLength))
+    {
+      Line line;
+      line.direction = direction;
+      m_lines.push_back(line);
+      m_lineOpen = true;
+    }
+    m_lines.back().text += *it;
+  }
+}
 
-      textWithIndention += *it;
-      m_lastChar = *it;
+void XmlInspector::OnDrawItem(wxDC &dc, const wxRect &rect, size_t n) const
+{
+  if (n >= m_lines.size())
+    return;
+  
+  const Line &line = m_lines[n];
+  if (IsSelected(n))
+    dc.SetTextForeground(wxSystemSettings::GetColour(wxSYS_COLOUR_HIGHLIGHTTEXT));
+  else
+  {
+    switch (line.direction)
+    {
+    case toMaxima:
+      dc.SetTextForeground(wxColour(128,0,0));
+      break;
+    case fromMaxima:
+      dc.SetTextForeground(wxColour(0,128,0));
+      break;
+    default:
+      dc.SetTextForeground(wxColour(0,0,0));
     }
-    BeginTextColour(wxColour(0,128,0));
-    WriteText(textWithIndention);
-    EndTextColour();
-    m_fromMaxima = wxEmptyString;
   }
+  dc.SetFont(GetFont());
+  dc.DrawText(line.text, rect.GetX() + 2, rect.GetY() + 1);
+}
+
+wxCoord XmlInspector::OnMeasureItem(size_t WXUNUSED(n)) const
+{
+  return m_lineHeight;
 }
 
 wxString XmlInspector::IndentString(int level)
@@ -145,14 +247,104 @@ wxString XmlInspector::IndentString(int level)
   return result;
 }
 
-void XmlInspector::Add_ToMaxima(wxString text)
+void XmlInspector::Add(monitorState direction, const wxString &text)
 {
-  m_toMaxima += text;
+  if (text.IsEmpty())
+    return;
+
+  // If there is more text than fits into the display we don't even need to
+  // keep it.
+  if (m_pending.empty() || (m_pending.back().direction != direction))
+  {
+    PendingChunk chunk;
+    chunk.direction = direction;
+    m_pending.push_back(chunk);
+  }
+  m_pending.back().text += text;
+  m_pendingLength += text.Length();
+  while (m_pendingLength > m_maxPendingLength)
+  {
+    size_t excess = m_pendingLength - m_maxPendingLength;
+    if (m_pending.front().text.Length() <= excess)
+    {
+      m_pendingLength -= m_pending.front().text.Length();
+      m_pendingDropped += m_pending.front().text.Length();
+      m_pending.pop_front();
+    }
+    else
+    {
+      m_pending.front().text.Remove(0, excess);
+      m_pendingLength -= excess;
+      m_pendingDropped += excess;
+    }
+  }
   m_updateNeeded = true;
 }
 
+void XmlInspector::Add_ToMaxima(wxString text)
+{
+  Add(toMaxima, text);
+}
+
 void XmlInspector::Add_FromMaxima(wxString text)
 {
-  m_fromMaxima += text;
-  m_updateNeeded = true;
+  Add(fromMaxima, text);
+}
+
+void XmlInspector::OnContextMenu(wxContextMenuEvent &WXUNUSED(event))
+{
+  wxMenu *popupMenu = new wxMenu();
+  popupMenu->Append(popid_copy, _("Copy"), wxEmptyString, wxITEM_NORMAL);
+  popupMenu->Enable(popid_copy, GetSelectedCount() > 0);
+  popupMenu->AppendSeparator();
+  popupMenu->Append(popid_save_log, _("Save the log..."), wxEmptyString, wxITEM_NORMAL);
+  popupMenu->Append(popid_save_output, _("Save maxima's raw output..."), wxEmptyString, wxITEM_NORMAL);
+  PopupMenu(popupMenu);
+  wxDELETE(popupMenu);
+}
+
+void XmlInspector::OnMenu(wxCommandEvent &event)
+{
+  switch (event.GetId())
+  {
+  case popid_copy:
+  {
+    wxString text;
+    unsigned long cookie;
+    for (int n = GetFirstSelected(cookie); n != wxNOT_FOUND; n = GetNextSelected(cookie))
+    {
+      // Wrapped lines are joined again.
+      if ((!text.IsEmpty()) && (m_lines[n - 1].text.Length() < m_maxLineLength))
+        text += wxT("\n");
+      text += m_lines[n].text;
+    }
+    if (wxTheClipboard->Open())
+    {
+      wxTheClipboard->SetData(new wxTextDataObject(text));
+      wxTheClipboard->Close();
+    }
+    break;
+  }
+  case popid_save_log:
+  case popid_save_output:
+  {
+    bool fromMaximaOnly = (event.GetId() == popid_save_output);
+    wxString file = wxFileSelector(_("Save the communication with maxima"),
+                                   wxEmptyString,
+                                   fromMaximaOnly ? wxT("maxima_output.xml") : wxT("protocol.txt"),
+                                   fromMaximaOnly ? wxT("xml") : wxT("txt"),
+                                   fromMaximaOnly ? _("XML file (*.xml)|*.xml") : _("Text file (*.txt)|*.txt"),
+                                   wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
+    if ((file != wxEmptyString) && (!m_log->Save(file, fromMaximaOnly)))
+      wxMessageBox(_("Cannot write to ") + file, _("Error"), wxOK | wxICON_ERROR);
+    break;
+  }
+  }
 }
+
+BEGIN_EVENT_TABLE(XmlInspector, wxVListBox)
+                EVT_CONTEXT_MENU(XmlInspector::OnContextMenu)
+                EVT_MENU(popid_copy, XmlInspector::OnMenu)
+                EVT_MENU(popid_save_log, XmlInspector::OnMenu)
+                EVT_MENU(popid_save_output, XmlInspector::OnMenu)
+END_EVENT_TABLE()
@@ -24,9 +24,9 @@
   table of contents pane.
  */
 #include <wx/wx.h>
-#include <wx/richtext/richtextctrl.h>
-#include <vector>
-#include "GroupCell.h"
+#include <wx/vlbox.h>
+#include <deque>
+#include "ProtocolLog.h"
 
 #ifndef XMLINSPECTOR_H
 #define XMLINSPECTOR_H
@@ -34,36 +34,45 @@
 /*! This class generates a pane displaying the communication between maxima and wxMaxima.
   
   The display of this data is only actually updated on calling XmlInspector::Update().
+
+  The ProtocolLog of the communication with maxima can be saved from here. The
+  display is split into lines of which only the visible ones are drawn. It
+  holds at most m_maxLines lines: The oldest ones are dropped first.
  */
-class XmlInspector : public wxRichTextCtrl
+class XmlInspector : public wxVListBox
 {
 public:
-  XmlInspector(wxWindow *parent, int id);
+  //! \param log The log the context menu allows to save
+  XmlInspector(wxWindow *parent, int id, ProtocolLog *log);
 
   /*! The destructor
    */
   ~XmlInspector();
 
-  //! Remove all text from the editor.
-  virtual void Clear();
+  //! Remove all text from the display. The log isn't cleared.
+  void Clear();
 
-  //! Add some text we sent to maxima.
+  //! Add some text we sent to maxima to the display.
   void Add_ToMaxima(wxString text);
-  //! Add some text we have received from maxima.
+  //! Add some text we have received from maxima to the display.
   void Add_FromMaxima(wxString text);
   //! Actually draw the updates
   void Update();
   //! Do we need to update the XmlInspector's display?
   bool UpdateNeeded(){return m_updateNeeded;}
+
+protected:
+  //! Draws a line of the display. wxVListBox calls this for the visible lines only.
+  virtual void OnDrawItem(wxDC &dc, const wxRect &rect, size_t n) const;
+  //! The height of a line of the display
+  virtual wxCoord OnMeasureItem(size_t n) const;
+
 private:
-  bool m_updateNeeded;
-  wxString m_fromMaxima;
-  wxString m_toMaxima;
-  bool m_clear;
   enum xmlInspectorIDs
   {
-    XmlInspector_ctrl_id = 4,
-    XmlInspector_regex_id
+    popid_copy = wxID_HIGHEST + 1600,
+    popid_save_log,
+    popid_save_output
   };
   enum monitorState
   {
@@ -73,10 +82,58 @@ private:
   };
   monitorState m_state;
 
+  //! The maximum number of chars m_pending holds
+  static const size_t m_maxPendingLength = 1024 * 1024;
+  //! The maximum number of lines m_lines holds
+  static const size_t m_maxLines = 50000;
+  //! Longer lines are wrapped
+  static const size_t m_maxLineLength = 250;
+
+  //! A piece of text that still has to be added to the display
+  struct PendingChunk
+  {
+    monitorState direction;
+    wxString text;
+  };
+  //! A line of the display. Headings have the direction "clear".
+  struct Line
+  {
+    monitorState direction;
+    wxString text;
+  };
+
+  //! The log of the communication with maxima
+  ProtocolLog *m_log;
+  //! The text that has been added since the last Update()
+  std::deque<PendingChunk> m_pending;
+  //! The number of chars in m_pending
+  size_t m_pendingLength;
+  //! The number of chars that were dropped from m_pending before it was displayed
+  size_t m_pendingDropped;
+  //! The lines that are displayed
+  std::deque<Line> m_lines;
+  //! Can the last line in m_lines still be continued?
+  bool m_lineOpen;
+  //! The height of a line of text
+  wxCoord m_lineHeight;
+
+  bool m_updateNeeded;
+  bool m_clear;
+
   wxChar m_lastChar;
   int m_indentLevel;
 
+  //! Adds text to m_pending
+  void Add(monitorState direction, const wxString &text);
+  //! Adds text to m_lines, continuing the last line if it is still open.
+  void AddText(monitorState direction, const wxString &text);
+  //! Adds a heading to m_lines
+  void AddHeading(const wxString &text);
   wxString IndentString(int level);
+
+  void OnContextMenu(wxContextMenuEvent &event);
+  void OnMenu(wxCommandEvent &event);
+  DECLARE_EVENT_TABLE()
 };
 
 #endif // XMLINSPECTOR_H
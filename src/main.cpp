@@ -33,6 +33,7 @@
 #include <wx/cmdline.h>
 #include <wx/fileconf.h>
 #include "Dirstructure.h"
+#include "StartupTrace.h"
 #include <iostream>
 
 #include "wxMaxima.h"
@@ -60,11 +61,15 @@ void MyApp::Cleanup_Static()
 bool MyApp::OnInit()
 {
   m_frame = NULL;
+  m_exitCode = 0;
 //  atexit(Cleanup_Static);
   int lang = wxLANGUAGE_UNKNOWN;
 
   bool exitAfterEval = false;
   bool evalOnStartup = false;
+  bool headless = false;
+  wxString timingReport;
+  wxString recordProtocol, replayProtocol;
 
   wxCmdLineParser cmdLineParser(argc, argv);
 
@@ -80,6 +85,27 @@ bool MyApp::OnInit()
                    "evaluate the file after opening it.", wxCMD_LINE_VAL_NONE , 0},
                   {wxCMD_LINE_SWITCH, "b", "batch",
                    "run the file and exit afterwards. Halts on questions and stops on errors.",  wxCMD_LINE_VAL_NONE, 0},
+                  {wxCMD_LINE_SWITCH, NULL, "headless",
+                   "like --batch, but without ever showing a window or laying out the output.",
+                   wxCMD_LINE_VAL_NONE, 0},
+                  {wxCMD_LINE_OPTION, NULL, "timing-report",
+                   "write the wall-clock and maxima cpu time of each cell to this file (JSON)",
+                   wxCMD_LINE_VAL_STRING, 0},
+                  {wxCMD_LINE_SWITCH, NULL, "trace-startup",
+                   "print how long each phase of the startup took to stderr",
+                   wxCMD_LINE_VAL_NONE, 0},
+                  {wxCMD_LINE_OPTION, NULL, "record-protocol",
+                   "record the communication with maxima to this file",
+                   wxCMD_LINE_VAL_STRING, 0},
+                  {wxCMD_LINE_OPTION, NULL, "replay-protocol",
+                   "play back a file from --record-protocol instead of starting maxima and print how long handling it took to stderr",
+                   wxCMD_LINE_VAL_STRING, 0},
+                  {wxCMD_LINE_SWITCH, NULL, "replay-realtime",
+                   "keep the timing of the recording when playing it back",
+                   wxCMD_LINE_VAL_NONE, 0},
+                  {wxCMD_LINE_OPTION, NULL, "replay-timeout",
+                   "how many milliseconds the playback waits for a command to be sent (default: 30000)",
+                   wxCMD_LINE_VAL_NUMBER, 0},
                   { wxCMD_LINE_OPTION, "f", "ini", "allows to specify a file to store the configuration in", wxCMD_LINE_VAL_STRING , 0},
                   {wxCMD_LINE_PARAM, NULL, NULL, "input file", wxCMD_LINE_VAL_STRING, wxCMD_LINE_PARAM_OPTIONAL | wxCMD_LINE_PARAM_MULTIPLE},
             {wxCMD_LINE_NONE, "", "", "", wxCMD_LINE_VAL_NONE, 0}
@@ -87,6 +113,9 @@ bool MyApp::OnInit()
 
   cmdLineParser.SetDesc(cmdLineDesc);
   cmdLineParser.Parse();
+  if (cmdLineParser.Found(wxT("trace-startup")))
+    StartupTrace::Enable();
+  StartupTrace::Phase(wxT("command line parsed"));
   wxString ini, file;
   // Attention: The config file is changed by wxMaximaFrame::wxMaximaFrame::ReReadConfig
   if (cmdLineParser.Found(wxT("f"),&ini))
@@ -152,6 +181,7 @@ bool MyApp::OnInit()
   m_locale.AddCatalogLookupPathPrefix(wxT("/usr/local/share/locale"));
   m_locale.AddCatalog(wxT("wxMaxima"));
   m_locale.AddCatalog(wxT("wxMaxima-wxstd"));
+  StartupTrace::Phase(wxT("translations loaded"));
 
 #if defined __WXMAC__
   wxString path;
@@ -191,6 +221,38 @@ bool MyApp::OnInit()
     exitAfterEval = true;
   }
   
+  if (cmdLineParser.Found(wxT("headless")))
+  {
+    headless = true;
+    evalOnStartup = true;
+    exitAfterEval = true;
+  }
+
+  if (cmdLineParser.Found(wxT("timing-report"), &timingReport))
+  {
+    wxFileName reportFileName = timingReport;
+    reportFileName.MakeAbsolute();
+    timingReport = reportFileName.GetFullPath();
+  }
+
+  if (cmdLineParser.Found(wxT("record-protocol"), &recordProtocol))
+  {
+    wxFileName recordFileName = recordProtocol;
+    recordFileName.MakeAbsolute();
+    recordProtocol = recordFileName.GetFullPath();
+  }
+
+  if (cmdLineParser.Found(wxT("replay-protocol"), &replayProtocol))
+  {
+    wxFileName replayFileName = replayProtocol;
+    replayFileName.MakeAbsolute();
+    replayProtocol = replayFileName.GetFullPath();
+  }
+  bool replayRealTime = cmdLineParser.Found(wxT("replay-realtime"));
+  long replayTimeout = 30000;
+  if (cmdLineParser.Found(wxT("replay-timeout"), &replayTimeout) && (replayTimeout < 0))
+    replayTimeout = 30000;
+
   if (cmdLineParser.Found(wxT("e")))
     evalOnStartup = true;
 
@@ -199,7 +261,8 @@ bool MyApp::OnInit()
     wxFileName FileName = file;
     FileName.MakeAbsolute();
     wxString CanonicalFilename = FileName.GetFullPath();
-    NewWindow(wxString(CanonicalFilename), evalOnStartup, exitAfterEval);
+    NewWindow(wxString(CanonicalFilename), evalOnStartup, exitAfterEval, headless, timingReport,
+              recordProtocol, replayProtocol, replayRealTime, replayTimeout);
     return true;
   }
 
@@ -211,15 +274,25 @@ bool MyApp::OnInit()
       FileName.MakeAbsolute();
       
       wxString CanonicalFilename = FileName.GetFullPath();
-      NewWindow(CanonicalFilename, evalOnStartup, exitAfterEval);
+      NewWindow(CanonicalFilename, evalOnStartup, exitAfterEval, headless, timingReport,
+                recordProtocol, replayProtocol, replayRealTime, replayTimeout);
     }
   }
   else
-    NewWindow();
+    NewWindow(wxEmptyString, false, false, false, wxEmptyString,
+              recordProtocol, replayProtocol, replayRealTime, replayTimeout);
 
   return true;
 }
 
+int MyApp::OnRun()
+{
+  int exitCode = wxApp::OnRun();
+  if (exitCode == 0)
+    exitCode = m_exitCode;
+  return exitCode;
+}
+
 #if defined (__WXMSW__)
 int MyApp::OnExit()
 {
@@ -247,7 +320,9 @@ int MyApp::OnExit()
 
 int window_counter = 0;
 
-void MyApp::NewWindow(wxString file, bool evalOnStartup, bool exitAfterEval)
+void MyApp::NewWindow(wxString file, bool evalOnStartup, bool exitAfterEval, bool headless,
+                      wxString timingReport, wxString recordProtocol, wxString replayProtocol,
+                      bool replayRealTime, long replayTimeout)
 {
   int x = 40, y = 40, h = 650, w = 950, m = 0;
   int rs = 0;
@@ -280,6 +355,7 @@ void MyApp::NewWindow(wxString file, bool evalOnStartup, bool exitAfterEval)
 
   m_frame = new wxMaxima((wxFrame *) NULL, -1, _("wxMaxima"), m_configFileName,
                          wxPoint(x, y), wxSize(w, h));
+  StartupTrace::Phase(wxT("main window created"));
 
   if (m == 1)
     m_frame->Maximize(true);
@@ -291,14 +367,31 @@ void MyApp::NewWindow(wxString file, bool evalOnStartup, bool exitAfterEval)
 
   m_frame->ExitAfterEval(exitAfterEval);
   m_frame->EvalOnStartup(evalOnStartup);
+  m_frame->Headless(headless);
+  m_frame->SetTimingReport(timingReport);
+  if (recordProtocol != wxEmptyString)
+    m_frame->RecordProtocol(recordProtocol);
+  if (replayProtocol != wxEmptyString)
+    m_frame->ReplayProtocol(replayProtocol, replayRealTime, replayTimeout);
   topLevelWindows.Append(m_frame);
   if (topLevelWindows.GetCount() > 1)
     m_frame->SetTitle(wxString::Format(_("untitled %d"), ++window_counter));
 
   SetTopWindow(m_frame);
-  m_frame->Show(true);
+
+  // Maxima needs longer to start than anything else => we start it first and
+  // let it boot while the window is laid out and drawn.
   m_frame->InitSession();
-  m_frame->ShowTip(false);
+
+  // In headless mode we create the worksheet, but never show it: Saves all the drawing.
+  if (headless)
+    return;
+  m_frame->Show(true);
+  StartupTrace::Phase(wxT("main window shown"));
+
+  // The tip of the day is a modal dialog => show it only after the window
+  // has been drawn.
+  m_frame->CallAfter(&wxMaxima::ShowTip, false);
 }
 
 void MyApp::OnFileMenu(wxCommandEvent &ev)
@@ -52,11 +52,14 @@
 #include "TipOfTheDay.h"
 #include "EditorCell.h"
 #include "SlideShowCell.h"
+#include "MatrCell.h"
 #include "PlotFormatWiz.h"
 #include "Dirstructure.h"
 #include "ActualValuesStorageWiz.h"
 #include "MaxSizeChooser.h"
 #include "ListSortWiz.h"
+#include "StartupTrace.h"
+#include "StageTimer.h"
 
 #include <wx/clipbrd.h>
 #include <wx/filedlg.h>
@@ -83,6 +86,11 @@
 #include <wx/url.h>
 #include <wx/sstream.h>
 #include <list>
+#include <map>
+#include <iostream>
+#ifndef __WXMSW__
+#include <unistd.h>
+#endif
 
 #if defined __WXMAC__
 #define MACPREFIX "wxMaxima.app/Contents/Resources/"
@@ -126,6 +134,8 @@ void wxMaxima::ConfigChanged()
   m_autoSaveInterval = 3;
   config->Read(wxT("autoSaveInterval"), &m_autoSaveInterval);
   m_autoSaveInterval *= 60000;
+  m_autoSaveInBackground = true;
+  config->Read(wxT("autoSaveInBackground"), &m_autoSaveInBackground);
   m_console->UpdateConfig();
   // UpdateUserSymbols();
 }
@@ -136,9 +146,6 @@ wxMaxima::wxMaxima(wxWindow *parent, int id, const wxString title, const wxStrin
                    const wxPoint pos, const wxSize size) :
   wxMaximaFrame(parent, id, title, configFile, pos, size)
 {
-  m_maximaJiffies_old = 0;
-  m_cpuTotalJiffies_old = 0;
-
   m_updateControls = true;
   m_commandIndex = -1;
   m_isActive = true;
@@ -155,6 +162,9 @@ wxMaxima::wxMaxima(wxWindow *parent, int id, const wxString title, const wxStrin
   m_maximaStdout = NULL;
   m_maximaStderr = NULL;
   m_ready = false;
+  m_headless = false;
+  m_batchFinished = false;
+  m_batchStatus = wxT("ok");
   m_inLispMode = false;
   m_first = true;
   m_isRunning = false;
@@ -165,9 +175,16 @@ wxMaxima::wxMaxima(wxWindow *parent, int id, const wxString title, const wxStrin
   m_symbolsPrefix = wxT("<wxxml-symbols>");
   m_symbolsSuffix = wxT("</wxxml-symbols>");
   m_firstPrompt = wxT("(%i1) ");
+  m_useFramedProtocol = false;
 
   m_client = NULL;
   m_server = NULL;
+  m_spareProcess = NULL;
+  m_spareClient = NULL;
+  m_spareVerified = false;
+  m_protocolReplay = NULL;
+  m_protocolReplayRealTime = false;
+  m_protocolReplayTimeout = 30000;
 
   config->Read(wxT("lastPath"), &m_lastPath);
   m_lastPrompt = wxEmptyString;
@@ -180,6 +197,7 @@ wxMaxima::wxMaxima(wxWindow *parent, int id, const wxString title, const wxStrin
   m_variablesOK = false;
 
   m_htmlHelpInitialized = false;
+  m_helpPending = false;
   m_chmhelpFile = wxEmptyString;
 
   m_isConnected = false;
@@ -224,6 +242,8 @@ wxMaxima::wxMaxima(wxWindow *parent, int id, const wxString title, const wxStrin
 
 wxMaxima::~wxMaxima()
 {
+  m_console->WaitForBackgroundSave();
+
   if (m_client != NULL)
     m_client->Destroy();
   m_client = NULL;
@@ -318,6 +338,8 @@ void wxMaxima::InitSession()
     }
   }
 
+  StartupTrace::Phase(wxT("server started"));
+
   if (!server)
     SetStatusText(_("Starting server failed"));
   else if (!StartMaxima())
@@ -332,8 +354,6 @@ void wxMaxima::InitSession()
 
 void wxMaxima::FirstOutput(wxString s)
 {
-  Dirstructure dirstructure;
-
   int startMaxima = s.find(wxT("Maxima"), 5); // The first in s is wxMaxima version - skip it
   int startHTTP = s.find(wxT("http"), startMaxima);
   m_maximaVersion = s.SubString(startMaxima + 7, startHTTP - 1);
@@ -344,8 +364,7 @@ void wxMaxima::FirstOutput(wxString s)
 
   m_lastPrompt = wxT("(%i1) ");
 
-  /// READ FUNCTIONS FOR AUTOCOMPLETION
-  m_console->LoadSymbols(dirstructure.AutocompleteFile());
+  UpdateHelpIndex();
 
   m_console->SetFocus();
 }
@@ -502,7 +521,10 @@ void wxMaxima::DoConsoleAppend(wxString s, int type, bool newLine,
 
   MathParser mParser(&m_console->m_configuration, &m_console->m_cellPointers);
   mParser.SetUserLabel(userLabel);
-  cell = mParser.ParseLine(s, type);
+  {
+    StageTimer::Scope timer(StageTimer::parse);
+    cell = mParser.ParseLine(s, type);
+  }
 
   wxASSERT_MSG(cell != NULL, _("There was an error in generated XML!\n\n"
                                        "Please report this as a bug."));
@@ -512,6 +534,7 @@ void wxMaxima::DoConsoleAppend(wxString s, int type, bool newLine,
   }
 
   cell->SetSkip(bigSkip);
+  StageTimer::Scope timer(StageTimer::insert);
   m_console->InsertLine(cell, newLine || cell->BreakLineHere());
 }
 
@@ -631,16 +654,19 @@ void wxMaxima::StripComments(wxString &s)
     m_blankStatementRegEx.Replace(&s, wxT(";"));
 }
 
-void wxMaxima::SendMaxima(wxString s, bool addToHistory)
+void wxMaxima::SendMaxima(wxString s, bool addToHistory, bool checkParenthesis)
 {
-  if (m_xmlInspector)
+  // Like maxima's replies our commands are only displayed while the pane is shown.
+  if ((m_xmlInspector != NULL) && IsPaneDisplayed(menu_pane_xmlInspector))
     m_xmlInspector->Add_ToMaxima(s);
 
   // Normally we catch parenthesis errors before adding cells to the
   // evaluation queue. But if the error is introduced only after the
   // cell is placed in the evaluation queue we need to catch it here.
-  int index;
-  wxString parenthesisError = GetUnmatchedParenthesisState(s,index);
+  int index = 0;
+  wxString parenthesisError;
+  if (checkParenthesis)
+    parenthesisError = GetUnmatchedParenthesisState(s,index);
   if (parenthesisError == wxEmptyString)
   {
 
@@ -714,6 +740,8 @@ void wxMaxima::SendMaxima(wxString s, bool addToHistory)
     if (m_client)
     {
       wxScopedCharBuffer const data_raw = s.utf8_str();
+      m_protocolRecorder.Sent(data_raw.data(), data_raw.length());
+      m_protocolLog.Add(ProtocolLog::toMaxima, data_raw.data(), data_raw.length());
       m_client->Write(data_raw.data(), data_raw.length());
       m_statusBar->NetworkStatus(StatusBar::transmit);
     }
@@ -733,6 +761,144 @@ void wxMaxima::SendMaxima(wxString s, bool addToHistory)
 ///  Socket stuff
 ///--------------------------------------------------------------------------------
 
+void wxMaxima::InterpretTaggedOutput(const wxString &newChars)
+{
+  // This way we can avoid searching the whole string for a
+  // ending tag if we have received only a few bytes of the
+  // data between 2 tags
+  if(m_currentOutput != wxEmptyString)
+    m_currentOutputEnd = m_currentOutput.Right(MIN(30,m_currentOutput.Length())) + newChars;
+  else
+    m_currentOutputEnd = wxEmptyString;
+  
+  m_currentOutput += newChars;
+  
+  if (!m_dispReadOut &&
+      (m_currentOutput != wxT("\n")) &&
+      (m_currentOutput != wxT("<wxxml-symbols></wxxml-symbols>")))
+  {
+    StatusMaximaBusy(transferring);
+    m_dispReadOut = true;
+  }
+  
+  size_t length_old = -1;
+  
+  while (length_old != m_currentOutput.Length())
+  {
+    if (m_currentOutput.StartsWith("\n<"))
+      m_currentOutput = m_currentOutput.Right(m_currentOutput.Length() - 1);
+    
+    length_old = m_currentOutput.Length();
+    
+    
+    // First read the prompt that tells us that maxima awaits the next command:
+    // If that is the case ReadPrompt() sends the next command to maxima and
+    // maxima can work while we interpret its output.
+    GroupCell *oldActiveCell = m_console->GetWorkingGroup();
+    ReadPrompt(m_currentOutput);
+    GroupCell *newActiveCell = m_console->GetWorkingGroup();
+    
+    // Temporarily switch to the WorkingGroup the output we don't have interpreted yet
+    // was for. If commands are sent to maxima in advance everything that follows
+    // a prompt already belongs to the next command, instead.
+    bool pipelined = (m_console->m_configuration->PipelineDepth() > 1);
+    if((newActiveCell != oldActiveCell) && !pipelined)
+      m_console->m_cellPointers.SetWorkingGroup(oldActiveCell);
+    // Handle the <mth> tag that contains math output and sometimes text.
+    ReadMath(m_currentOutput);
+    
+    // The following function calls each extract and remove one type of XML tag
+    // information from the beginning of the data string we got - but only do so
+    // after the closing tag has been transferred, as well.
+    ReadLoadSymbols(m_currentOutput);
+    
+    // Handle the XML tag that contains Status bar updates
+    ReadStatusBar(m_currentOutput);
+    
+    // Handle text that isn't wrapped in a known tag
+    if (!m_first)
+      // Handle text that isn't XML output: Mostly Error messages or warnings.
+      ReadMiscText(m_currentOutput);
+    else
+      // This function determines the port maxima is running on from  the text
+      // maxima outputs at startup. This piece of text is afterwards discarded.
+      ReadFirstPrompt(m_currentOutput);
+    
+    // Switch to the WorkingGroup the next bunch of data is for.
+    if((newActiveCell != oldActiveCell) && !pipelined)
+      m_console->m_cellPointers.SetWorkingGroup(newActiveCell);
+  }
+}
+
+void wxMaxima::InterpretFrame(FramedProtocol::MessageType type, wxString &payload)
+{
+  m_console->m_cellPointers.m_currentTextCell = NULL;
+  switch (type)
+  {
+    case FramedProtocol::math:
+      if (!m_dispReadOut)
+      {
+        StatusMaximaBusy(transferring);
+        m_dispReadOut = true;
+      }
+      AppendMath(payload);
+      break;
+    case FramedProtocol::statusbar:
+      SetStatusText(payload, 0);
+      break;
+    case FramedProtocol::symbols:
+      AddSymbols(payload);
+      break;
+    default:
+      break;
+  }
+}
+
+void wxMaxima::InterpretDataFromMaxima(char *data, long length)
+{
+  StageTimer::Scope timer(StageTimer::interpret);
+  StageTimer::Received(length);
+  m_protocolRecorder.Received(data, length);
+  m_protocolLog.Add(ProtocolLog::fromMaxima, data, length);
+
+  for(long int i = 0;i < length; i++)
+  {
+    if (data[i] == '\0')
+      data[i] = ' ';
+  }
+
+  // Don't open an assert window every single time maxima mixes UTF8 and the current
+  // codepage. 
+  wxLogStderr logStderr;
+  wxString newChars = wxString::FromUTF8(data, length);
+
+  if ((m_xmlInspector != NULL) && IsPaneDisplayed(menu_pane_xmlInspector))
+    m_xmlInspector->Add_FromMaxima(newChars);
+  
+  if (!m_useFramedProtocol)
+    InterpretTaggedOutput(newChars);
+  else
+  {
+    m_framedInput.Append(data, length);
+    InterpretFramedInput();
+  }
+}
+
+void wxMaxima::InterpretFramedInput()
+{
+  // Frames are handed over as soon as they are complete. Only the text
+  // between them still needs to be searched for tags.
+  FramedProtocol::MessageType type;
+  wxString payload;
+  while (m_framedInput.GetMessage(type, payload))
+  {
+    if (type == FramedProtocol::text)
+      InterpretTaggedOutput(payload);
+    else
+      InterpretFrame(type, payload);
+  }
+}
+
 void wxMaxima::ClientEvent(wxSocketEvent &event)
 {
   switch (event.GetSocketEvent())
@@ -754,8 +920,6 @@ void wxMaxima::ClientEvent(wxSocketEvent &event)
 
     // Read all data we can get from maxima
     int charsRead = 1;
-    // The memory we store new chars we receive from maxima in
-    wxString newChars;
     // while((m_client != NULL) && (m_client->IsOk()) &&
     //       (m_client->IsData()) && (charsRead > 0))
     //   {
@@ -768,15 +932,12 @@ void wxMaxima::ClientEvent(wxSocketEvent &event)
         // Read a data packet from maxima
 //        m_client->Read(&(m_packetFromMaxima[m_uncompletedChars.GetDataLen()]),
 //                       SOCKET_SIZE - m_uncompletedChars.GetDataLen());
-        m_client->Read(m_packetFromMaxima, SOCKET_SIZE - 1);
-
-        charsRead = m_client->LastCount();
-          
-        for(long int i = 0;i < charsRead; i++)
         {
-          if (m_packetFromMaxima[i] == '\0')
-            m_packetFromMaxima[i] = ' ';
+          StageTimer::Scope timer(StageTimer::receive);
+          m_client->Read(m_packetFromMaxima, SOCKET_SIZE - 1);
         }
+
+        charsRead = m_client->LastCount();
         
         //         + m_uncompletedChars.GetDataLen();
         
@@ -841,89 +1002,51 @@ void wxMaxima::ClientEvent(wxSocketEvent &event)
         //     m_uncompletedChars.AppendData(&(m_uncompletedChars[charsRead]),bytesForLastChar);
         // }
 
-        // Don't open an assert window every single time maxima mixes UTF8 and the current
-        // codepage. 
-        wxLogStderr logStderr;
-        wxString packet = wxString::FromUTF8((char *)m_packetFromMaxima, charsRead);
-        newChars += packet;
-
-        if (IsPaneDisplayed(menu_pane_xmlInspector))
-          m_xmlInspector->Add_FromMaxima(newChars);
-        
-        // This way we can avoid searching the whole string for a
-        // ending tag if we have received only a few bytes of the
-        // data between 2 tags
-        if(m_currentOutput != wxEmptyString)
-          m_currentOutputEnd = m_currentOutput.Right(MIN(30,m_currentOutput.Length())) + newChars;
-        else
-          m_currentOutputEnd = wxEmptyString;
-        
-        m_currentOutput += newChars;
-        
-        if (!m_dispReadOut &&
-            (m_currentOutput != wxT("\n")) &&
-            (m_currentOutput != wxT("<wxxml-symbols></wxxml-symbols>")))
-        {
-          StatusMaximaBusy(transferring);
-          m_dispReadOut = true;
-        }
-        
-        size_t length_old = -1;
-        
-        while (length_old != m_currentOutput.Length())
-        {
-          if (m_currentOutput.StartsWith("\n<"))
-            m_currentOutput = m_currentOutput.Right(m_currentOutput.Length() - 1);
-          
-          length_old = m_currentOutput.Length();
-          
-          
-          // First read the prompt that tells us that maxima awaits the next command:
-          // If that is the case ReadPrompt() sends the next command to maxima and
-          // maxima can work while we interpret its output.
-          GroupCell *oldActiveCell = m_console->GetWorkingGroup();
-          ReadPrompt(m_currentOutput);
-          GroupCell *newActiveCell = m_console->GetWorkingGroup();
-          
-          // Temporarily switch to the WorkingGroup the output we don't have interpreted yet
-          // was for
-          if(newActiveCell != oldActiveCell)
-            m_console->m_cellPointers.SetWorkingGroup(oldActiveCell);
-          // Handle the <mth> tag that contains math output and sometimes text.
-          ReadMath(m_currentOutput);
-          
-          // The following function calls each extract and remove one type of XML tag
-          // information from the beginning of the data string we got - but only do so
-          // after the closing tag has been transferred, as well.
-          ReadLoadSymbols(m_currentOutput);
-          
-          // Handle the XML tag that contains Status bar updates
-          ReadStatusBar(m_currentOutput);
-          
-          // Handle text that isn't wrapped in a known tag
-          if (!m_first)
-            // Handle text that isn't XML output: Mostly Error messages or warnings.
-            ReadMiscText(m_currentOutput);
-          else
-            // This function determines the port maxima is running on from  the text
-            // maxima outputs at startup. This piece of text is afterwards discarded.
-            ReadFirstPrompt(m_currentOutput);
-          
-          // Switch to the WorkingGroup the next bunch of data is for.
-          if(newActiveCell != oldActiveCell)
-            m_console->m_cellPointers.SetWorkingGroup(newActiveCell);
-//        }
-      }
+        InterpretDataFromMaxima((char *)m_packetFromMaxima, charsRead);
     break;
   }
   case wxSOCKET_LOST:
   {
+    if (m_protocolReplay != NULL)
+    {
+      // The replay has sent everything => interpret what is still unread
+      // and tell how long all this took.
+      while ((m_client != NULL) && (m_client->IsData()))
+      {
+        {
+          StageTimer::Scope timer(StageTimer::receive);
+          m_client->Read(m_packetFromMaxima, SOCKET_SIZE - 1);
+        }
+        if (m_client->LastCount() == 0)
+          break;
+        InterpretDataFromMaxima((char *)m_packetFromMaxima, m_client->LastCount());
+      }
+      bool timedOut = EndProtocolReplay();
+      m_statusBar->NetworkStatus(StatusBar::offline);
+      StatusMaximaBusy(disconnected);
+      if (m_client != NULL)
+        m_client->Destroy();
+      m_client = NULL;
+      m_isConnected = false;
+      m_currentOutput = wxEmptyString;
+      m_framedInput.Clear();
+      if (m_exitAfterEval)
+      {
+        if (timedOut)
+          FinishBatch(wxT("replay timed out"));
+        else
+          FinishBatch();
+      }
+      break;
+    }
+
     m_statusBar->NetworkStatus(StatusBar::offline);
     ExitAfterEval(false);
     m_console->m_cellPointers.SetWorkingGroup(NULL);
     m_console->SetSelection(NULL);
     m_console->SetActiveCell(NULL);
     m_pid = -1;
+    m_processMonitor.SetPid(-1);
     if (m_client != NULL)
       m_client->Destroy();
     m_client = NULL;
@@ -937,7 +1060,15 @@ void wxMaxima::ClientEvent(wxSocketEvent &event)
     }
     m_isConnected = false;
     m_currentOutput = wxEmptyString;
+    m_framedInput.Clear();
     m_console->QuestionAnswered();
+    if (m_headless && !m_closing)
+    {
+      if (!m_cellTimings.empty())
+        m_cellTimings.back().status = wxT("connection lost");
+      FinishBatch(wxT("connection lost"));
+      break;
+    }
     if (!m_closing)
     {
       if (m_unsuccessfullConnectionAttempts > 0)
@@ -953,14 +1084,46 @@ void wxMaxima::ClientEvent(wxSocketEvent &event)
         m_console->m_evaluationQueue.Clear();
         StartMaxima(true);
       }
-      m_console->m_evaluationQueue.Clear();
-      StartMaxima(true);
     }
     m_console->m_evaluationQueue.Clear();
     // Inform the user that the evaluation queue is empty.
     EvaluationQueueLength(0);
+    // If we haven't restarted maxima a spare that connects now would be
+    // mistaken for the main one.
+    if ((!m_isConnected) && (m_spareProcess != NULL) && (m_spareClient == NULL))
+      DiscardSpareMaxima();
+    break;
+  }
+  default:
+    break;
+  }
+}
+
+void wxMaxima::SpareClientEvent(wxSocketEvent &event)
+{
+  // Events that were issued before the spare maxima was swapped in
+  if (event.GetSocket() == m_client)
+  {
+    ClientEvent(event);
+    return;
+  }
+  if ((m_spareClient == NULL) || (event.GetSocket() != m_spareClient))
+    return;
+
+  switch (event.GetSocketEvent())
+  {
+  case wxSOCKET_INPUT:
+  {
+    // Keep everything the spare maxima says until it is swapped in.
+    m_spareClient->Read(m_packetFromMaxima, SOCKET_SIZE - 1);
+    m_spareOutput.AppendData(m_packetFromMaxima, m_spareClient->LastCount());
+    if (!m_spareVerified)
+      VerifySpareClient();
     break;
   }
+  case wxSOCKET_LOST:
+    DiscardSpareMaxima();
+    break;
   default:
     break;
   }
@@ -979,12 +1142,26 @@ void wxMaxima::ServerEvent(wxSocketEvent &event)
       if (m_isConnected)
       {
         wxSocketBase *tmp = m_server->Accept(false);
-        tmp->Close();
+        if ((m_spareProcess != NULL) && (m_spareClient == NULL) && (tmp != NULL))
+        {
+          // This might be the spare maxima. VerifySpareClient() finds out as
+          // soon as it has sent its banner.
+          m_spareClient = tmp;
+          m_spareVerified = false;
+          m_spareOutput = wxMemoryBuffer();
+          m_spareClient->SetEventHandler(*this, socket_spare_client_id);
+          m_spareClient->SetNotify(wxSOCKET_INPUT_FLAG | wxSOCKET_LOST_FLAG);
+          m_spareClient->Notify(true);
+          return;
+        }
+        if (tmp != NULL)
+          tmp->Destroy();
         return;
       }
       m_statusBar->NetworkStatus(StatusBar::idle);
       m_console->QuestionAnswered();
       m_currentOutput = wxEmptyString;
+      m_framedInput.Clear();
       m_isConnected = true;
       m_client = m_server->Accept(false);
       m_client->SetEventHandler(*this, socket_client_id);
@@ -1003,6 +1180,7 @@ void wxMaxima::ServerEvent(wxSocketEvent &event)
       ExitAfterEval(false);
       ReadStdErr();
       m_pid = -1;
+      m_processMonitor.SetPid(-1);
       m_isConnected = false;
       if (!m_closing)
       {
@@ -1086,15 +1264,30 @@ bool wxMaxima::StartMaxima(bool force)
       KillMaxima();
       m_closing = true;
       m_currentOutput = wxEmptyString;
+      m_framedInput.Clear();
     }
 
     m_console->QuestionAnswered();
     m_console->m_cellPointers.SetWorkingGroup(NULL);
+    m_console->m_evaluationQueue.ForgetCommandsInFlight();
 
     m_variablesOK = false;
     wxString command = GetCommand();
 
-    if (command.Length() > 0)
+    // When benchmarking a recording of maxima's output stands in for maxima.
+    if (m_protocolReplayFile != wxEmptyString)
+    {
+      if (!StartProtocolReplay())
+      {
+        m_statusBar->NetworkStatus(StatusBar::offline);
+        return false;
+      }
+    }
+    // A maxima that has been started in the background saves us waiting
+    // for a new one to start up.
+    else if (UseSpareMaxima())
+      StartupTrace::Phase(wxT("spare maxima swapped in"));
+    else if (command.Length() > 0)
     {
 
       command.Append(wxString::Format(wxT(" -s %d "), m_port));
@@ -1107,6 +1300,7 @@ bool wxMaxima::StartMaxima(bool force)
       m_process->Redirect();
       m_first = true;
       m_pid = -1;
+      m_processMonitor.SetPid(-1);
       m_newStatusText = _("Starting Maxima...");
       if (wxExecute(command, wxEXEC_ASYNC, m_process) < 0)
       {
@@ -1122,6 +1316,12 @@ bool wxMaxima::StartMaxima(bool force)
       m_maximaStderr = m_process->GetErrorStream();
       m_lastPrompt = wxT("(%i1) ");
       StatusMaximaBusy(wait_for_start);
+      StartupTrace::Phase(wxT("maxima process launched"));
+
+      // Maxima needs a while to start up => we can read the autocompletion
+      // symbols in the meantime.
+      if (!m_headless)
+        m_console->LoadSymbolsInBackground();
     }
     else
     {
@@ -1189,11 +1389,237 @@ void wxMaxima::KillMaxima()
   m_maximaStdout = NULL;
   m_maximaStderr = NULL;
   m_currentOutput = wxEmptyString;
+  m_framedInput.Clear();
   m_console->QuestionAnswered();
 }
 
-void wxMaxima::OnProcessEvent(wxProcessEvent& WXUNUSED(event))
+bool wxMaxima::StartProtocolReplay()
+{
+  if (m_protocolReplay != NULL)
+  {
+    m_protocolReplay->Delete();
+    wxDELETE(m_protocolReplay);
+  }
+
+  // Else the server would refuse the connection of the new replay.
+  if (m_client != NULL)
+  {
+    m_client->Notify(false);
+    m_client->Destroy();
+    m_client = NULL;
+  }
+  m_isConnected = false;
+  m_currentOutput = wxEmptyString;
+  m_framedInput.Clear();
+
+  m_first = true;
+  m_pid = -1;
+  m_processMonitor.SetPid(-1);
+  m_lastPrompt = wxT("(%i1) ");
+
+  m_protocolReplay = new ProtocolReplay(m_protocolReplayFile, m_port, m_protocolReplayRealTime,
+                                         m_protocolReplayTimeout);
+  if ((!m_protocolReplay->IsOk()) || (m_protocolReplay->Run() != wxTHREAD_NO_ERROR))
+  {
+    wxLogError(_("Cannot replay the protocol recording %s"), m_protocolReplayFile);
+    wxDELETE(m_protocolReplay);
+    StatusMaximaBusy(process_wont_start);
+    return false;
+  }
+  StageTimer::Enable();
+  StatusMaximaBusy(wait_for_start);
+  return true;
+}
+
+bool wxMaxima::EndProtocolReplay()
+{
+  if (m_protocolReplay == NULL)
+    return false;
+
+  m_protocolReplay->Delete();
+  bool timedOut = m_protocolReplay->TimedOut();
+  size_t timeouts = m_protocolReplay->Timeouts();
+  long timeout = m_protocolReplay->Timeout();
+  wxDELETE(m_protocolReplay);
+  StageTimer::Report();
+
+  // A replay that had to give up waiting for wxMaxima measured the timeout,
+  // not wxMaxima => the numbers above are worthless then.
+  if (timedOut)
+    std::cerr << wxString::Format(wxT("replay: timed out %lu times waiting %ld ms for "
+                                      "wxMaxima to send a command\n"),
+                                  (unsigned long) timeouts, timeout).mb_str();
+
+  // Shows how much the CellPool and moving rarely used data to the ColdData save
+  if (StageTimer::IsEnabled())
+    std::cerr << wxString::Format(wxT("replay: %lu cells, %lu bytes per cell, "
+                                      "%lu cells with cold data of %lu bytes\n"),
+                                  (unsigned long) CellPool::CellsAllocated(),
+                                  (unsigned long) MathCell::MemoryPerCell(),
+                                  (unsigned long) MathCell::CellsWithColdData(),
+                                  (unsigned long) MathCell::ColdDataBytes()).mb_str();
+  return timedOut;
+}
+
+void wxMaxima::StartSpareMaxima()
 {
+  if ((m_spareProcess != NULL) || m_headless || !m_isRunning ||
+      (m_protocolReplayFile != wxEmptyString))
+    return;
+
+  bool warmSpareMaxima = false;
+  wxConfig::Get()->Read(wxT("warmSpareMaxima"), &warmSpareMaxima);
+  if (!warmSpareMaxima)
+    return;
+
+  wxString command = GetCommand();
+  if (command.Length() == 0)
+    return;
+  command.Append(wxString::Format(wxT(" -s %d "), m_port));
+
+  m_spareOutput = wxMemoryBuffer();
+  m_spareProcess = new wxProcess(this, maxima_process_id);
+  m_spareProcess->Redirect();
+  // Making the spare a group leader allows to kill the lisp it starts, too.
+  if (wxExecute(command, wxEXEC_ASYNC | wxEXEC_MAKE_GROUP_LEADER, m_spareProcess) <= 0)
+    wxDELETE(m_spareProcess);
+}
+
+bool wxMaxima::UseSpareMaxima()
+{
+  if (m_spareProcess == NULL)
+    return false;
+
+  // We don't want to hear anything from the old maxima any more.
+  if (m_client != NULL)
+  {
+    m_client->Notify(false);
+    m_client->Destroy();
+    m_client = NULL;
+  }
+  m_isConnected = false;
+
+  m_process = m_spareProcess;
+  m_spareProcess = NULL;
+  m_maximaStdout = m_process->GetInputStream();
+  m_maximaStderr = m_process->GetErrorStream();
+  m_first = true;
+  m_pid = -1;
+  m_processMonitor.SetPid(-1);
+  m_currentOutput = wxEmptyString;
+  m_framedInput.Clear();
+  m_lastPrompt = wxT("(%i1) ");
+  StatusMaximaBusy(wait_for_start);
+
+  // If the spare hasn't connected yet ServerEvent() handles its connection
+  // like the one of any other maxima we have started.
+  if (m_spareClient == NULL)
+    return true;
+
+  // If it has it already has read the commands from MaximaSetupCommands().
+  m_statusBar->NetworkStatus(StatusBar::idle);
+  m_isConnected = true;
+  m_client = m_spareClient;
+  m_spareClient = NULL;
+  m_client->SetEventHandler(*this, socket_client_id);
+#ifndef __WXMSW__
+  ReadProcessOutput();
+#endif
+  if (m_spareVerified)
+  {
+    m_variablesOK = true;
+    SetupSession();
+  }
+  else
+    // It hasn't sent its banner yet and therefore hasn't got its setup commands.
+    SetupVariables();
+
+  // Interpret everything the spare has said so far, including the first prompt.
+  wxMemoryBuffer output = m_spareOutput;
+  m_spareOutput = wxMemoryBuffer();
+  if (output.GetDataLen() > 0)
+    InterpretDataFromMaxima((char *)output.GetData(), output.GetDataLen());
+  return true;
+}
+
+void wxMaxima::VerifySpareClient()
+{
+  if ((m_spareClient == NULL) || (m_spareProcess == NULL))
+    return;
+
+  // Wait for the line maxima tells us its process id in.
+  std::string output((const char *) m_spareOutput.GetData(), m_spareOutput.GetDataLen());
+  size_t start = output.find("pid=");
+  if ((start == std::string::npos) || (output.find('\n', start) == std::string::npos))
+    return;
+  long pid = strtol(output.c_str() + start + 4, NULL, 10);
+
+  long sparePid = m_spareProcess->GetPid();
+  bool isSpare = (pid > 0) && (pid == sparePid);
+#ifndef __WXMSW__
+  // The spare is the leader of the process group of the lisp it has started.
+  if ((pid > 0) && !isSpare)
+    isSpare = (getpgid(pid) == sparePid);
+#else
+  // On MS Windows the lisp doesn't belong to a process group of the spare:
+  // A client that has sent a maxima banner is all we can check for.
+  isSpare = (pid > 0);
+#endif
+
+  if (!isSpare)
+  {
+    m_spareClient->Notify(false);
+    m_spareClient->Destroy();
+    m_spareClient = NULL;
+    m_spareOutput = wxMemoryBuffer();
+    return;
+  }
+
+  // The spare maxima reads its setup commands now so it is ready as
+  // soon as we need it.
+  m_spareVerified = true;
+  wxArrayString commands = MaximaSetupCommands();
+  for (size_t i = 0; i < commands.GetCount(); i++)
+  {
+    wxScopedCharBuffer const data_raw = m_console->UnicodeToMaxima(commands[i]).utf8_str();
+    m_spareClient->Write(data_raw.data(), data_raw.length());
+  }
+}
+
+void wxMaxima::DiscardSpareMaxima()
+{
+  if (m_spareClient != NULL)
+  {
+    m_spareClient->Notify(false);
+    m_spareClient->Destroy();
+    m_spareClient = NULL;
+  }
+  m_spareVerified = false;
+  if (m_spareProcess != NULL)
+  {
+    long pid = m_spareProcess->GetPid();
+    m_spareProcess->Detach();
+    m_spareProcess = NULL;
+    if (pid > 0)
+      wxProcess::Kill(pid, wxSIGKILL, wxKILL_CHILDREN);
+  }
+  m_spareOutput = wxMemoryBuffer();
+}
+
+void wxMaxima::OnProcessEvent(wxProcessEvent& event)
+{
+  if ((m_spareProcess != NULL) && (event.GetPid() == m_spareProcess->GetPid()))
+  {
+    // The spare maxima has exited before we needed it. Whoever handles the
+    // event of a wxProcess is responsible for deleting it, but not before
+    // wxWidgets has finished dispatching the event.
+    wxProcess *process = m_spareProcess;
+    m_spareProcess = NULL;
+    DiscardSpareMaxima();
+    wxTheApp->ScheduleForDestruction(process);
+    return;
+  }
+
   m_statusBar->NetworkStatus(StatusBar::offline);
   if (!m_closing)
   {
@@ -1218,8 +1644,11 @@ void wxMaxima::OnProcessEvent(wxProcessEvent& WXUNUSED(event))
 
 void wxMaxima::CleanUp()
 {
+  DiscardSpareMaxima();
+  EndProtocolReplay();
   m_console->QuestionAnswered();
   m_currentOutput = wxEmptyString;
+  m_framedInput.Clear();
   if (m_isConnected)
     KillMaxima();
   if (m_client)
@@ -1267,9 +1696,11 @@ void wxMaxima::ReadFirstPrompt(wxString &data)
   int s = data.Find(wxT("pid=")) + 4;
   int t = s + data.SubString(s, data.Length()).Find(wxT("\n")) - 1;
 
-  // Read this pid
-  if (s < t)
+  // Read this pid. A replayed recording contains the pid of a maxima that 
+  // no more exists.
+  if ((s < t) && (m_protocolReplay == NULL))
     data.SubString(s, t).ToLong(&m_pid);
+  m_processMonitor.SetPid(m_pid);
 
   if (m_pid > 0)
     GetMenuBar()->Enable(menu_interrupt_id, true);
@@ -1278,6 +1709,10 @@ void wxMaxima::ReadFirstPrompt(wxString &data)
   m_inLispMode = false;
   StatusMaximaBusy(waiting);
   m_closing = false; // when restarting maxima this is temporarily true
+  StartupTrace::Phase(wxT("first prompt received"));
+
+  // Now that this maxima is up we can prepare the one for the next restart.
+  StartSpareMaxima();
 
   data = data.Right(data.Length() - end - m_firstPrompt.Length());
 
@@ -1287,6 +1722,9 @@ void wxMaxima::ReadFirstPrompt(wxString &data)
     EvaluationQueueLength(0);
     if ((m_console->m_configuration->GetOpenHCaret()) && (m_console->GetActiveCell() == NULL))
       m_console->OpenNextOrCreateCell();
+    // A document without anything to evaluate
+    if (m_headless)
+      FinishBatch();
   }
   else
   {
@@ -1484,19 +1922,24 @@ void wxMaxima::ReadMath(wxString &data)
   {
     wxString o = data.Left(end + mthend.Length());
     data = data.Right(data.Length()-end-mthend.Length());
-    o.Trim(true);
-    o.Trim(false);
+    AppendMath(o);
+  }
+}
 
-    if (o.Length() > 0)
+void wxMaxima::AppendMath(wxString &o)
+{
+  o.Trim(true);
+  o.Trim(false);
+
+  if (o.Length() > 0)
+  {
+    if (m_console->m_configuration->UseUserLabels())
     {
-      if (m_console->m_configuration->UseUserLabels())
-      {
-        ConsoleAppend(o, MC_TYPE_DEFAULT,m_console->m_evaluationQueue.GetUserLabel());
-      }
-      else
-      {
-        ConsoleAppend(o, MC_TYPE_DEFAULT);
-      }
+      ConsoleAppend(o, MC_TYPE_DEFAULT,m_console->m_evaluationQueue.GetUserLabel());
+    }
+    else
+    {
+      ConsoleAppend(o, MC_TYPE_DEFAULT);
     }
   }
 }
@@ -1514,17 +1957,21 @@ void wxMaxima::ReadLoadSymbols(wxString &data)
   {
     // Put the symbols into a separate string
     wxString symbols = data.SubString(m_symbolsPrefix.Length(), end - 1);
+    AddSymbols(symbols);
 
-    // Send each symbol to the console
-    wxStringTokenizer templates(symbols, wxT("$"));
-    while (templates.HasMoreTokens())
-      m_console->AddSymbol(templates.GetNextToken());
-    
     // Remove the symbols from the data string
     data = data.Right(data.Length()-end-m_symbolsSuffix.Length());
   }
 }
 
+void wxMaxima::AddSymbols(const wxString &symbols)
+{
+  // Send each symbol to the console
+  wxStringTokenizer templates(symbols, wxT("$"));
+  while (templates.HasMoreTokens())
+    m_console->AddSymbol(templates.GetNextToken());
+}
+
 /***
  * Checks if maxima displayed a new prompt.
  */
@@ -1576,11 +2023,20 @@ void wxMaxima::ReadPrompt(wxString &data)
     //m_lastPrompt = o.Mid(1,o.Length()-1);
     //m_lastPrompt.Replace(wxT(")"), wxT(":"), false);
     m_lastPrompt = o;
-    // remove the event maxima has just processed from the evaluation queue
-    m_console->m_evaluationQueue.RemoveFirst();
     // if we remove a command from the evaluation queue the next output line will be the
     // first from the next command.
     m_outputCellsFromCurrentCommand = 0;
+    // remove the event maxima has just processed from the evaluation queue.
+    if (m_console->m_evaluationQueue.PromptReceived())
+      m_console->m_evaluationQueue.RemoveFirst();
+    else
+    {
+      // The command has been removed from the queue after it had been sent to
+      // maxima, for example since an earlier command has caused an error. The
+      // queue only can continue after maxima has answered all of these.
+      if (m_console->m_evaluationQueue.CommandsInFlight() > 0)
+        return;
+    }
     if (m_console->m_evaluationQueue.Empty())
     { // queue empty.
       StatusMaximaBusy(waiting);
@@ -1594,10 +2050,7 @@ void wxMaxima::ReadPrompt(wxString &data)
       }
       m_console->FollowEvaluation(false);
       if (m_exitAfterEval)
-      {
-        SaveFile(false);
-        Close();
-      }
+        FinishBatch();
       // Inform the user that the evaluation queue is empty.
       EvaluationQueueLength(0);
       m_console->m_cellPointers.SetWorkingGroup(NULL);
@@ -1623,10 +2076,24 @@ void wxMaxima::ReadPrompt(wxString &data)
   {  // We have a question
     m_console->QuestionAnswered();
     m_console->QuestionPending(true);
+    if (m_console->m_evaluationQueue.CommandsInFlight() > 1)
+    {
+      // Maxima reads the commands that have been sent in advance as the answer.
+      // Sending them again might evaluate them twice => stop the evaluation.
+      m_console->m_evaluationQueue.StopAfterCurrentCommand();
+      EvaluationQueueLength(m_console->m_evaluationQueue.Size(),
+                            m_console->m_evaluationQueue.CommandsLeftInCell());
+      ConsoleAppend(_("Maxima asks a question but the commands that follow have already been sent to it. "
+                      "They might have been read as the answer. The evaluation therefore stops after this command."),
+                    MC_TYPE_WARNING);
+    }
     // If the user answers a question additional output might be required even
     // if the question has been preceded by many lines.
     m_outputCellsFromCurrentCommand = 0;
     m_console->SetNotification(_("Maxima asks a question!"),wxICON_INFORMATION);
+    GroupCell *questionGroup = m_console->GetWorkingGroup(true);
+    bool canAutoAnswer = (questionGroup != NULL) && questionGroup->AutoAnswer() &&
+      (!m_console->m_evaluationQueue.AnswersEmpty());
     if (!o.IsEmpty())
     {
       m_console->m_configuration->SetDefaultMathCellToolTip(
@@ -1648,6 +2115,14 @@ void wxMaxima::ReadPrompt(wxString &data)
       m_console->OpenQuestionCaret();
     }
     StatusMaximaBusy(userinput);
+
+    // Without a window nobody can answer questions we don't know the answer to.
+    if (m_headless && !canAutoAnswer)
+    {
+      if (!m_cellTimings.empty())
+        m_cellTimings.back().status = wxT("question");
+      FinishBatch(wxT("question"));
+    }
   }
 
   if (o.StartsWith(wxT("\nMAXIMA>")))
@@ -1666,6 +2141,9 @@ void wxMaxima::SetCWD(wxString file)
   MathParser mParser(&m_console->m_configuration, &m_console->m_cellPointers);
   m_console->m_configuration->SetWorkingDirectory(wxFileName(file).GetPath());
 
+  // The user will most probably want to load() files from this directory.
+  m_console->IndexDirectoryInBackground(wxFileName(file).GetPath(wxPATH_GET_VOLUME));
+
 #if defined __WXMSW__
   file.Replace(wxT("\\"), wxT("/"));
 #endif
@@ -2130,86 +2608,40 @@ bool wxMaxima::OpenWXMXFile(wxString file, MathCtrl *document, bool clearDocumen
   // open wxmx file
   wxXmlDocument xmldoc;
 
-  // We get only absolute paths so the path should start with a "/"
-  //if(!file.StartsWith(wxT("/")))
-  //  file = wxT("/") + file;
-
-  wxFileSystem fs;
-  wxString wxmxURI = wxURI(wxT("file://") + file).BuildURI();
-  // wxURI doesn't know that a "#" in a file name is a literal "#" and
-  // not an anchor within the file so we have to care about url-encoding
-  // this char by hand.
-  wxmxURI.Replace("#", "%23");
-
-#ifdef  __WXMSW__
-  // Fixes a missing "///" after the "file:". This works because we always get absolute
-  // file names.
-  wxRegEx uriCorector1("^file:([a-zA-Z]):");
-  wxRegEx uriCorector2("^file:([a-zA-Z][a-zA-Z]):");
-
-  uriCorector1.ReplaceFirst(&wxmxURI,wxT("file:///\\1:"));
-  uriCorector2.ReplaceFirst(&wxmxURI,wxT("file:///\\1:"));
-#endif
-  // The URI of the wxm code contained within the .wxmx file
-  wxString filename = wxmxURI + wxT("#zip:content.xml");
-
-  // Open the file
-  wxFSFile *fsfile = fs.OpenFile(filename);
-  if (!fsfile)
-  {
-    filename = wxmxURI + wxT("#zip:/content.xml");
-    fsfile = fs.OpenFile(filename);
-  }
-
-  // Did we succeed in opening the file?
-  if (fsfile)
-  {
-    // Let's see if we can load the XML contained in this file.
-    if (!xmldoc.Load(*(fsfile->GetStream()), wxT("UTF-8"), wxXMLDOC_KEEP_WHITESPACE_NODES))
-    {
-      // If we cannot read the file a typical error in old wxMaxima versions was to include
-      // a letter of ascii code 27 in content.xml. Let's filter this char out.
-
-      // Re-open the file.
-      wxDELETE(fsfile);
-      fsfile = fs.OpenFile(filename);
-      if (fsfile)
-      {
-        // Read the file into a string
-        wxString s;
-        wxTextInputStream istream1(*fsfile->GetStream(), wxT('\t'), wxConvAuto(wxFONTENCODING_UTF8));
-        while (!fsfile->GetStream()->Eof())
-          s += istream1.ReadLine() + wxT("\n");
-
-        // Remove the illegal character
-        s.Replace(wxT('\x1b'), wxT("|"));
-
-        {
-          // Write the string into a memory buffer
-          wxMemoryOutputStream ostream;
-          wxTextOutputStream txtstrm(ostream);
-          txtstrm.WriteString(s);
-          wxMemoryInputStream istream(ostream);
-
-          // Try to load the file from the memory buffer.
-          xmldoc.Load(istream, wxT("UTF-8"), wxXMLDOC_KEEP_WHITESPACE_NODES);
-        }
-      }
-    }
-  }
-  else
+  // Map the archive into memory and read its table of contents.
+  WXMXArchive archive;
+  char *content = NULL;
+  size_t contentLength = 0;
+  if ((!archive.Open(file)) || (!archive.GetEntry(wxT("content.xml"), content, contentLength)))
   {
     document->Thaw();
-    wxMessageBox(_("wxMaxima cannot open content.xml in the .wxmx zip archive ") + file +
-                 wxT(", URI=") + filename, _("Error"),
+    wxMessageBox(_("wxMaxima cannot open content.xml in the .wxmx zip archive ") + file, _("Error"),
                  wxOK | wxICON_EXCLAMATION);
     StatusMaximaBusy(waiting);
     m_newStatusText = _("File could not be opened");
     return false;
   }
 
+  // Let's see if we can load the XML contained in this file.
+  {
+    wxMemoryInputStream istream(content, contentLength);
+    xmldoc.Load(istream, wxT("UTF-8"), wxXMLDOC_KEEP_WHITESPACE_NODES);
+  }
+  if (!xmldoc.IsOk())
+  {
+    // If we cannot read the file a typical error in old wxMaxima versions was to include
+    // a letter of ascii code 27 in content.xml. Let's filter this char out.
+    //
+    // In UTF-8 a byte below 128 is always a character of its own so we can
+    // replace it directly in our (private) copy of the file's data.
+    for (size_t i = 0; i < contentLength; i++)
+      if (content[i] == '\x1b')
+        content[i] = '|';
 
-  wxDELETE(fsfile);
+    // Try to load the file again.
+    wxMemoryInputStream istream(content, contentLength);
+    xmldoc.Load(istream, wxT("UTF-8"), wxXMLDOC_KEEP_WHITESPACE_NODES);
+  }
 
   if (!xmldoc.IsOk())
   {
@@ -2252,7 +2684,7 @@ bool wxMaxima::OpenWXMXFile(wxString file, MathCtrl *document, bool clearDocumen
 
   // Read the worksheet's contents.
   wxXmlNode *xmlcells = xmldoc.GetRoot();
-  GroupCell *tree = CreateTreeFromXMLNode(xmlcells, wxmxURI);
+  GroupCell *tree = CreateTreeFromXMLNode(xmlcells, &archive);
 
   // from here on code is identical for wxm and wxmx
   if (clearDocument)
@@ -2374,7 +2806,11 @@ bool wxMaxima::OpenXML(wxString file, MathCtrl *document)
 
   // Read the worksheet's contents.
   wxXmlNode *xmlcells = xmldoc.GetRoot();
-  GroupCell *tree = CreateTreeFromXMLNode(xmlcells, file);
+  // The images belonging to an extracted content.xml aren't part of an archive.
+  // Looking for them in an empty archive makes sure we never delete any
+  // file the user has extracted.
+  WXMXArchive noArchive;
+  GroupCell *tree = CreateTreeFromXMLNode(xmlcells, &noArchive);
 
   document->ClearDocument();
   document->InsertGroupCells(tree); // this also recalculates
@@ -2391,9 +2827,9 @@ bool wxMaxima::OpenXML(wxString file, MathCtrl *document)
   return true;
 }
 
-GroupCell *wxMaxima::CreateTreeFromXMLNode(wxXmlNode *xmlcells, wxString wxmxfilename)
+GroupCell *wxMaxima::CreateTreeFromXMLNode(wxXmlNode *xmlcells, WXMXArchive *archive)
 {
-  MathParser mp(&m_console->m_configuration, &m_console->m_cellPointers, wxmxfilename);
+  MathParser mp(&m_console->m_configuration, &m_console->m_cellPointers, archive);
   GroupCell *tree = NULL;
   GroupCell *last = NULL;
 
@@ -2468,14 +2904,23 @@ void wxMaxima::ReadProcessOutput()
 
 void wxMaxima::SetupVariables()
 {
-  SendMaxima(wxT(":lisp-quiet (setf *prompt-suffix* \"") +
-             m_promptSuffix +
-             wxT("\")\n"));
-  SendMaxima(wxT(":lisp-quiet (setf *prompt-prefix* \"") +
-             m_promptPrefix +
-             wxT("\")\n"));
-  SendMaxima(wxT(":lisp-quiet (setf $in_netmath nil)\n"));
-  SendMaxima(wxT(":lisp-quiet (setf $show_openplot t)\n"));
+  wxArrayString commands = MaximaSetupCommands();
+  for (size_t i = 0; i < commands.GetCount(); i++)
+    SendMaxima(commands[i]);
+  SetupSession();
+}
+
+wxArrayString wxMaxima::MaximaSetupCommands()
+{
+  wxArrayString commands;
+  commands.Add(wxT(":lisp-quiet (setf *prompt-suffix* \"") +
+               m_promptSuffix +
+               wxT("\")\n"));
+  commands.Add(wxT(":lisp-quiet (setf *prompt-prefix* \"") +
+               m_promptPrefix +
+               wxT("\")\n"));
+  commands.Add(wxT(":lisp-quiet (setf $in_netmath nil)\n"));
+  commands.Add(wxT(":lisp-quiet (setf $show_openplot t)\n"));
 
   wxConfigBase *config = wxConfig::Get();
 
@@ -2487,11 +2932,11 @@ void wxMaxima::SetupVariables()
 
   if (wxcd)
   {
-    SendMaxima(wxT(":lisp-quiet (defparameter $wxchangedir t)\n"));
+    commands.Add(wxT(":lisp-quiet (defparameter $wxchangedir t)\n"));
   }
   else
   {
-    SendMaxima(wxT(":lisp-quiet (defparameter $wxchangedir nil)\n"));
+    commands.Add(wxT(":lisp-quiet (defparameter $wxchangedir nil)\n"));
   }
 
 #if defined (__WXMAC__)
@@ -2501,9 +2946,9 @@ void wxMaxima::SetupVariables()
 #endif
   config->Read(wxT("usepngCairo"), &usepngCairo);
   if (usepngCairo)
-    SendMaxima(wxT(":lisp-quiet (defparameter $wxplot_pngcairo t)\n"));
+    commands.Add(wxT(":lisp-quiet (defparameter $wxplot_pngcairo t)\n"));
   else
-    SendMaxima(wxT(":lisp-quiet (defparameter $wxplot_pngcairo nil)\n"));
+    commands.Add(wxT(":lisp-quiet (defparameter $wxplot_pngcairo nil)\n"));
 
   int autosubscript = 1;
   config->Read(wxT("autosubscript"), &autosubscript);
@@ -2520,14 +2965,14 @@ void wxMaxima::SetupVariables()
       subscriptval = "'all";
       break;
   }
-  SendMaxima(wxT(":lisp-quiet (defparameter $wxsubscripts ") + subscriptval + wxT(")\n"));
+  commands.Add(wxT(":lisp-quiet (defparameter $wxsubscripts ") + subscriptval + wxT(")\n"));
 
   int defaultPlotWidth = 600;
   config->Read(wxT("defaultPlotWidth"), &defaultPlotWidth);
   int defaultPlotHeight = 400;
   config->Read(wxT("defaultPlotHeight"), &defaultPlotHeight);
-  SendMaxima(wxString::Format(wxT(":lisp-quiet (defparameter $wxplot_size '((mlist simp) %i %i))\n"), defaultPlotWidth,
-                              defaultPlotHeight));
+  commands.Add(wxString::Format(wxT(":lisp-quiet (defparameter $wxplot_size '((mlist simp) %i %i))\n"), defaultPlotWidth,
+                                defaultPlotHeight));
 
   wxString cmd;
   Dirstructure dirstruct;
@@ -2541,7 +2986,32 @@ void wxMaxima::SetupVariables()
     cmd += wxT("\n:lisp-quiet (setf $gnuplot_command \"") + gnuplotbin + wxT("\")\n");
 #endif
   cmd.Replace(wxT("\\"),wxT("/"));
-  SendMaxima(cmd);
+  commands.Add(cmd);
+
+  // Ask wxmathml.lisp to send its output as length-prefixed frames. Until
+  // maxima has read this everything still arrives as tagged text which the
+  // framed parser handles, too.
+  bool framedProtocol = false;
+  config->Read(wxT("framedProtocol"), &framedProtocol);
+  if (framedProtocol)
+    commands.Add(wxT(":lisp-quiet (setq *wx-framed-output* t)\n"));
+
+  // Big matrices of plain numbers can be sent without a tag per entry.
+  bool packedMatrices = true;
+  config->Read(wxT("packedMatrices"), &packedMatrices);
+  if (packedMatrices)
+    commands.Add(wxString::Format(wxT(":lisp-quiet (setq *wx-packed-matrix-min-entries* %i)\n"),
+                                  MatrCell::m_minNumericEntries));
+
+  return commands;
+}
+
+void wxMaxima::SetupSession()
+{
+  // MaximaSetupCommands() has asked maxima to use frames if this is set.
+  m_useFramedProtocol = false;
+  wxConfig::Get()->Read(wxT("framedProtocol"), &m_useFramedProtocol);
+  m_framedInput.Clear();
 
   if (m_console->m_currentFile != wxEmptyString)
   {
@@ -2625,6 +3095,20 @@ void wxMaxima::ShowTip(bool force)
 }
 
 wxString wxMaxima::GetHelpFile()
+{
+  if (!m_helpIndex.IsStarted())
+    UpdateHelpIndex();
+  return m_helpIndex.GetHelpFile();
+}
+
+void wxMaxima::UpdateHelpIndex()
+{
+  Dirstructure dirstructure;
+  wxString helpFile = FindHelpFile();
+  m_helpIndex.Update(this, dirstructure.HelpIndexCacheFile(), GetCommand(), m_maximaVersion, helpFile);
+}
+
+wxString wxMaxima::FindHelpFile()
 {
 #if defined __WXMSW__
   wxFileName command;
@@ -2661,51 +3145,8 @@ wxString wxMaxima::GetHelpFile()
 
   return wxEmptyString;
 #else
-  wxString headerFile;
-  wxConfig::Get()->Read(wxT("helpFile"), &headerFile);
-
-  if (headerFile.Length() && wxFileExists(headerFile))
-    return headerFile;
-  else
-    headerFile = wxEmptyString;
-
-  wxString command = GetCommand();
-  command += wxT(" -d");
-  wxArrayString output;
-  wxExecute(command, output, wxEXEC_ASYNC);
-
-  wxString line;
-  wxString docdir;
-  wxString langsubdir;
-
-  for (unsigned int i = 0; i < output.GetCount(); i++)
-  {
-    line = output[i];
-    if (line.StartsWith(wxT("maxima-htmldir")))
-      docdir = line.Mid(15);
-    else if (line.StartsWith(wxT("maxima-lang-subdir")))
-    {
-      langsubdir = line.Mid(19);
-      if (langsubdir == wxT("NIL"))
-        langsubdir = wxEmptyString;
-    }
-  }
-
-  if (docdir.Length() == 0)
-    return wxEmptyString;
-
-  headerFile = docdir + wxT("/");
-  if (langsubdir.Length())
-    headerFile += langsubdir + wxT("/");
-  headerFile += wxT("header.hhp");
-
-  if (!wxFileExists(headerFile))
-    headerFile = docdir + wxT("/header.hhp");
-
-  if (wxFileExists(headerFile))
-    wxConfig::Get()->Write(wxT("helpFile"), headerFile);
-
-  return headerFile;
+  // HelpIndex asks maxima where its manual is.
+  return wxEmptyString;
 #endif
 }
 
@@ -2735,7 +3176,14 @@ void wxMaxima::ShowHTMLHelp(wxString helpfile, wxString otherhelpfile, wxString
       (keyword == wxT(" << Graphics >> ")))
     m_htmlhelpCtrl.DisplayContents();
   else
-    m_htmlhelpCtrl.KeywordSearch(keyword, wxHELP_SEARCH_INDEX);
+  {
+    // Jumping to the page the index points to directly avoids searching the
+    // whole index. If the keyword isn't in our index we still let the help
+    // controller search for it.
+    wxString anchor = m_helpIndex.GetAnchor(keyword);
+    if (anchor.IsEmpty() || !m_htmlhelpCtrl.Display(anchor))
+      m_htmlhelpCtrl.KeywordSearch(keyword, wxHELP_SEARCH_INDEX);
+  }
 }
 
 #if defined (__WXMSW__)
@@ -2774,14 +3222,38 @@ void wxMaxima::ShowWxMaximaHelp()
     helpfile[1]=helpfile[2];
     helpfile[2]=wxT(':');
   }
-#endif // __WXMSW__
-  wxLaunchDefaultBrowser(wxT("file:///") + helpfile);
-#endif // CHM=false
+#endif // __WXMSW__
+  wxLaunchDefaultBrowser(wxT("file:///") + helpfile);
+#endif // CHM=false
+}
+
+void wxMaxima::OnHelpIndexReady(wxThreadEvent &WXUNUSED(event))
+{
+  // Show the help the user has asked for while maxima's manual was searched for
+  if (m_helpPending && m_helpIndex.IsReady())
+  {
+    m_newStatusText = _("Maxima's manual found");
+    ShowMaximaHelp(m_pendingHelpKeyword);
+  }
 }
 
 void wxMaxima::ShowMaximaHelp(wxString keyword)
 {
   wxLogNull disableWarnings;
+  if (!m_helpIndex.IsStarted())
+    UpdateHelpIndex();
+
+  // Don't freeze the GUI while the manual is searched for: OnHelpIndexReady()
+  // shows the help as soon as the background thread has finished.
+  if (!m_helpIndex.IsReady())
+  {
+    m_helpPending = true;
+    m_pendingHelpKeyword = keyword;
+    m_newStatusText = _("Looking for maxima's manual...");
+    return;
+  }
+  m_helpPending = false;
+
   wxString MaximaHelpFile = GetHelpFile();
   if (MaximaHelpFile.Length() == 0)
   {
@@ -2827,6 +3299,7 @@ void wxMaxima::OnIdle(wxIdleEvent &event)
     wxString file = m_openFile;
     m_openFile = wxEmptyString;
     OpenFile(file);
+    StartupTrace::Phase(wxT("file opened"));
 
     // After doing such big a thing we should end our idle event and request
     // a new one to be issued once the computer has time for doing real
@@ -2900,6 +3373,8 @@ void wxMaxima::OnIdle(wxIdleEvent &event)
                                      m_findData.GetFlags() & wxFR_DOWN,
                                      !(m_findData.GetFlags() & wxFR_MATCHCASE));
         }
+        m_console->StartCountingMatches(m_findData.GetFindString(),
+                                        !(m_findData.GetFlags() & wxFR_MATCHCASE));
         
         m_console->RequestRedraw();
         event.RequestMore();
@@ -2908,6 +3383,24 @@ void wxMaxima::OnIdle(wxIdleEvent &event)
   }
 
   
+  // While the find dialog is open we count the matches and build the search index
+  // in the background.
+  if (m_console->m_findDialog != NULL)
+  {
+    if (m_console->CountingMatches())
+    {
+      if (m_console->CountMatches(200))
+        m_newStatusText = wxString::Format(_("%li matches"), m_console->MatchCount());
+      event.RequestMore();
+      return;
+    }
+    if (m_console->UpdateSearchIndex(50))
+    {
+      event.RequestMore();
+      return;
+    }
+  }
+
   if(m_console->RedrawIfRequested())
   {
     m_updateControls = true;
@@ -3419,13 +3912,9 @@ bool wxMaxima::SaveFile(bool forceSave)
         m_isNamed = true;
     }
 
-    AddRecentDocument(file);
-    SetCWD(file);
-
     if (m_autoSaveInterval > 10000)
       m_autoSaveTimer.StartOnce(m_autoSaveInterval);
-    StatusSaveFinished();
-    RemoveTempAutosavefile();
+    FileSaved(file);
     return true;
   }
 
@@ -3435,6 +3924,29 @@ bool wxMaxima::SaveFile(bool forceSave)
   return false;
 }
 
+void wxMaxima::FileSaved(const wxString &file)
+{
+  AddRecentDocument(file);
+  SetCWD(file);
+  StatusSaveFinished();
+  RemoveTempAutosavefile();
+}
+
+void wxMaxima::OnBackgroundSaveFinished(wxThreadEvent &event)
+{
+  m_console->WaitForBackgroundSave();
+
+  // Autosaves of files that haven't been given a name yet don't show up in the
+  // status bar.
+  if (event.GetString() != m_console->m_currentFile)
+    return;
+
+  if (event.GetInt())
+    FileSaved(event.GetString());
+  else
+    StatusSaveFailed();
+}
+
 void wxMaxima::ReadStdErr()
 {
   // Maxima will never send us any data via stderr after it has finished
@@ -3495,8 +4007,20 @@ bool wxMaxima::AbortOnError()
   // The question is now if we want to try to send it something new to evaluate.
   bool abortOnError = false;
   wxConfig::Get()->Read(wxT("abortOnError"), &abortOnError);
-  ExitAfterEval(false);
-  EvalOnStartup(false);
+  if (m_headless)
+  {
+    // Without a window nobody can react to the error: Stop evaluating and let
+    // ReadPrompt() end the batch evaluation once maxima is idle again.
+    abortOnError = true;
+    m_batchStatus = wxT("error");
+    if (!m_cellTimings.empty())
+      m_cellTimings.back().status = wxT("error");
+  }
+  else
+  {
+    ExitAfterEval(false);
+    EvalOnStartup(false);
+  }
 
   if (m_console->m_notificationMessage != NULL)
   {
@@ -3506,9 +4030,12 @@ bool wxMaxima::AbortOnError()
     m_console->m_notificationMessage->m_errorNotificationCell = m_console->GetWorkingGroup(true);
   }
 
-  m_exitAfterEval = false;
+  if (!m_headless)
+    m_exitAfterEval = false;
   if (abortOnError)
   {
+    // Commands that have been sent to maxima in advance are evaluated nonetheless:
+    // The queue keeps waiting for their prompts.
     m_console->m_evaluationQueue.Clear();
     // Inform the user that the evaluation queue is empty.
     EvaluationQueueLength(0);
@@ -3519,136 +4046,28 @@ bool wxMaxima::AbortOnError()
     return false;
 }
 
-long long wxMaxima::GetTotalCpuTime()
-{
-#ifdef __WXMSW__
-  FILETIME systemtime;
-  GetSystemTimeAsFileTime(&systemtime);
-  return (long long) systemtime.dwLowDateTime +
-        2^32*((long long) systemtime.dwHighDateTime);
-#else
-  int CpuJiffies = 0;
-  if(wxFileExists("/proc/stat"))
-  {
-    wxFileInputStream input("/proc/stat");
-    if(input.IsOk())
-    {
-      wxTextInputStream text(input, wxT('\t'), wxConvAuto(wxFONTENCODING_UTF8));
-      wxString line;
-      while((!input.Eof()) && (!line.StartsWith("cpu ")))
-        line = text.ReadLine();
-      
-      // Strip the "cpu" from the line
-      line = line.Right(line.Length() - 4);
-      line.Trim(false);
-      wxStringTokenizer tokens(line,wxT(" "));
-      for(int i = 0; i < 3; i++)
-      {
-        if(tokens.HasMoreTokens())
-        {
-          long additionalJiffies;
-          if(!tokens.GetNextToken().ToLong(&additionalJiffies))
-            return -1;
-          CpuJiffies += additionalJiffies;
-        }
-        else
-          return -1;
-      }
-    }
-  }
-  return CpuJiffies;
-#endif
-}
-
 long long wxMaxima::GetMaximaCpuTime()
 {
-  #ifdef __WXMSW__
-  HANDLE maximaHandle = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, false, m_pid);
-  if(maximaHandle != NULL)
-  {
-    FILETIME creationTime, exitTime, kernelTime, userTime;
-    if(GetProcessTimes(maximaHandle, &creationTime, &exitTime, &kernelTime, &userTime))
-    {
-      long long retval =
-        (long long)kernelTime.dwLowDateTime + userTime.dwLowDateTime +
-        2^32*((long long)kernelTime.dwHighDateTime + userTime.dwHighDateTime);
-      CloseHandle(maximaHandle);
-      
-      return retval;
-    }
-  }
-  #endif
-  int maximaJiffies = 0;
-  wxString statFileName = wxString::Format("/proc/%li/stat",m_pid);
-  if(wxFileExists(statFileName))
-  {
-    wxFileInputStream input(statFileName);
-    if(input.IsOk())
-    {
-      wxTextInputStream text(input, wxT('\t'), wxConvAuto(wxFONTENCODING_UTF8));
-      wxString line = text.ReadLine();
-      
-      wxStringTokenizer tokens(line,wxT(" "));
-      for(int i = 0; i < 13; i++)
-      {
-        if(tokens.HasMoreTokens())
-          tokens.GetNextToken();
-        else return -1;
-      }
-
-      for(int i = 0; i < 4; i++)
-      {
-        {
-          if(tokens.HasMoreTokens())
-          {
-            long additionalJiffies;
-            if(!tokens.GetNextToken().ToLong(&additionalJiffies))
-            {
-              maximaJiffies = -1;
-              break;
-            }
-            maximaJiffies += additionalJiffies;
-          }
-          else return -1;
-        }
-      }
-    }
-  }
-  return maximaJiffies;
+  m_processMonitor.Update();
+  return m_processMonitor.CpuTime();
 }
 
 double wxMaxima::GetMaximaCPUPercentage()
 {
-
-  int CpuJiffies = GetTotalCpuTime();
-  if(CpuJiffies < 0)
+  if (!m_processMonitor.Update())
     return -1;
+  m_processMonitor.UpdateCpuPercentage();
 
-  // If no time has passed since the last call to this function the number of CPU cycles
-  // per timespan is infinite - and this function will cause an error if we don't abort
-  // it now.
-  if(CpuJiffies == m_cpuTotalJiffies_old)
-    return -1;
-
-  // GetTickCount() might wrap around once every (month? few days? longer?) -
-  // but at least is supported on XP that isn't supported anymore in 2017 but
-  // still is in use.
-  if(CpuJiffies <= m_cpuTotalJiffies_old)
-  {
-    m_cpuTotalJiffies_old = CpuJiffies;
-    return -1;
-  }
-  
-  int maximaJiffies = GetMaximaCpuTime();
-  if(maximaJiffies < 0)
-    return -1;
-  
-  double retval =
-    (double)(maximaJiffies - m_maximaJiffies_old)/(CpuJiffies - m_cpuTotalJiffies_old) * 100;
+  m_statusBar->SetMaximaResources(m_processMonitor.ResidentBytes(),
+                                  m_processMonitor.BytesRead(),
+                                  m_processMonitor.BytesWritten(),
+                                  m_processMonitor.Processes());
+  return m_processMonitor.CpuPercentage();
+}
 
-  m_maximaJiffies_old = maximaJiffies;
-  m_cpuTotalJiffies_old = CpuJiffies;
-  return retval;
+double wxMaxima::CpuTimeUnitsPerSecond()
+{
+  return ProcessMonitor::CpuTimeUnitsPerSecond();
 }
 
 void wxMaxima::OnTimerEvent(wxTimerEvent &event)
@@ -3658,6 +4077,11 @@ void wxMaxima::OnTimerEvent(wxTimerEvent &event)
     case MAXIMA_STDOUT_POLL_ID:
       ReadStdErr();
 
+      // If maxima has sent a frame that is shorter than it claimed we won't
+      // receive the data that would make us look at it again.
+      if (m_useFramedProtocol && m_framedInput.IsStalled())
+        InterpretFramedInput();
+
       if (m_process != NULL)
       {
         // The atexit() of maxima informs us if the process dies. But it sometimes doesn't do
@@ -3689,7 +4113,13 @@ void wxMaxima::OnTimerEvent(wxTimerEvent &event)
             {
               // Automatically safe the file for the user making it seem like the file
               // is always saved - 
-              SaveFile(false);
+              if (m_autoSaveInBackground && m_console->m_currentFile.EndsWith(wxT(".wxmx")))
+              {
+                if (m_console->ExportToWXMXInBackground(m_console->m_currentFile))
+                  StatusSaveStart();
+              }
+              else
+                SaveFile(false);
             }
             else
             {
@@ -3701,7 +4131,10 @@ void wxMaxima::OnTimerEvent(wxTimerEvent &event)
 
               // Save the file and remember the file name.
               wxString name = GetTempAutosavefileName();
-              m_console->ExportToWXMX(name);
+              if (m_autoSaveInBackground)
+                m_console->ExportToWXMXInBackground(name);
+              else
+                m_console->ExportToWXMX(name);
               RegisterAutoSaveFile();
               m_fileSaved = false;
             }
@@ -3714,6 +4147,176 @@ void wxMaxima::OnTimerEvent(wxTimerEvent &event)
   }
 }
 
+void wxMaxima::RecordProtocol(wxString file)
+{
+  if (!m_protocolRecorder.Start(file))
+    wxLogError(_("Cannot write the protocol recording to %s"), file);
+}
+
+void wxMaxima::ReplayProtocol(wxString file, bool realTime, long timeout)
+{
+  m_protocolReplayFile = file;
+  m_protocolReplayRealTime = realTime;
+  m_protocolReplayTimeout = timeout;
+}
+
+void wxMaxima::Headless(bool headless)
+{
+  m_headless = headless;
+  m_console->SuspendLayout(headless);
+  // In headless mode the autosave would only slow down the evaluation.
+  if (headless)
+    m_autoSaveTimer.Stop();
+}
+
+void wxMaxima::CellTimingStart(GroupCell *cell)
+{
+  CellTimingEnd();
+
+  CellTiming timing;
+  timing.cell = cell;
+  if (cell->GetEditable())
+    timing.input = cell->GetEditable()->GetValue();
+  timing.wallStart = wxGetLocalTimeMillis();
+  timing.wallTime = -1;
+  timing.cpuStart = GetMaximaCpuTime();
+  timing.cpuTime = -1;
+  timing.residentBytes = -1;
+  timing.status = wxT("ok");
+  m_cellTimings.push_back(timing);
+}
+
+void wxMaxima::CellTimingEnd()
+{
+  if (m_cellTimings.empty())
+    return;
+
+  CellTiming &timing = m_cellTimings.back();
+  if (timing.wallTime >= 0)
+    return;
+
+  timing.wallTime = wxGetLocalTimeMillis() - timing.wallStart;
+  long long cpuEnd = GetMaximaCpuTime();
+  if ((timing.cpuStart >= 0) && (cpuEnd >= timing.cpuStart))
+    timing.cpuTime = cpuEnd - timing.cpuStart;
+  timing.residentBytes = m_processMonitor.ResidentBytes();
+}
+
+//! Escapes a string so it can be used as a JSON string literal
+static wxString JSONEscape(const wxString &str)
+{
+  wxString retval;
+  retval.Alloc(str.Length() + 2);
+  for (wxString::const_iterator it = str.begin(); it != str.end(); ++it)
+  {
+    wxChar c = *it;
+    switch (c)
+    {
+    case wxT('\"'):
+      retval += wxT("\\\"");
+      break;
+    case wxT('\\'):
+      retval += wxT("\\\\");
+      break;
+    case wxT('\n'):
+      retval += wxT("\\n");
+      break;
+    case wxT('\r'):
+      retval += wxT("\\r");
+      break;
+    case wxT('\t'):
+      retval += wxT("\\t");
+      break;
+    default:
+      if (c < wxT(' '))
+        retval += wxString::Format(wxT("\\u%04x"), (int) c);
+      else
+        retval += c;
+    }
+  }
+  return retval;
+}
+
+bool wxMaxima::WriteTimingReport(wxString status)
+{
+  if (m_timingReportFile == wxEmptyString)
+    return true;
+
+  wxFFileOutputStream out(m_timingReportFile);
+  if (!out.IsOk())
+    return false;
+  wxTextOutputStream output(out);
+
+  double unitsPerSecond = CpuTimeUnitsPerSecond();
+  wxLongLong totalWallTime = 0;
+  double totalCpuTime = 0;
+
+  // Number the cells in a single pass through the worksheet.
+  std::map<GroupCell *, long> cellNumbers;
+  long cellNumber = 1;
+  for (GroupCell *tmp = m_console->GetTree(); tmp != NULL; tmp = dynamic_cast<GroupCell *>(tmp->m_next))
+    cellNumbers[tmp] = cellNumber++;
+
+  output << wxT("{\n");
+  output << wxT("  \"file\": \"") << JSONEscape(m_console->m_currentFile) << wxT("\",\n");
+  output << wxT("  \"wxmaxima_version\": \"") << JSONEscape(wxT(GITVERSION)) << wxT("\",\n");
+  output << wxT("  \"maxima_version\": \"") << JSONEscape(m_maximaVersion) << wxT("\",\n");
+  output << wxT("  \"lisp_version\": \"") << JSONEscape(m_lispVersion) << wxT("\",\n");
+  output << wxT("  \"status\": \"") << JSONEscape(status) << wxT("\",\n");
+  output << wxT("  \"cells\": [");
+  for (std::list<CellTiming>::iterator it = m_cellTimings.begin(); it != m_cellTimings.end(); ++it)
+  {
+    if (it != m_cellTimings.begin())
+      output << wxT(",");
+    std::map<GroupCell *, long>::iterator number = cellNumbers.find(it->cell);
+    if (number != cellNumbers.end())
+      output << wxT("\n    {\"cell\": ") << number->second;
+    else
+      output << wxT("\n    {\"cell\": null");
+    output << wxT(", \"status\": \"") << JSONEscape(it->status) << wxT("\"");
+    output << wxString::Format(wxT(", \"wall_s\": %.3f"), it->wallTime.ToDouble() / 1000.0);
+    if (it->cpuTime >= 0)
+    {
+      output << wxString::Format(wxT(", \"maxima_cpu_s\": %.3f"), it->cpuTime / unitsPerSecond);
+      totalCpuTime += it->cpuTime / unitsPerSecond;
+    }
+    else
+      output << wxT(", \"maxima_cpu_s\": null");
+    if (it->residentBytes >= 0)
+      output << wxString::Format(wxT(", \"maxima_rss_mb\": %.1f"), it->residentBytes / 1048576.0);
+    else
+      output << wxT(", \"maxima_rss_mb\": null");
+    output << wxT(", \"input\": \"") << JSONEscape(it->input) << wxT("\"}");
+    totalWallTime += it->wallTime;
+  }
+  output << wxT("\n  ],\n");
+  output << wxString::Format(wxT("  \"wall_s\": %.3f,\n"), totalWallTime.ToDouble() / 1000.0);
+  output << wxString::Format(wxT("  \"maxima_cpu_s\": %.3f\n"), totalCpuTime);
+  output << wxT("}\n");
+  return out.Close();
+}
+
+void wxMaxima::FinishBatch(wxString status)
+{
+  if (m_batchFinished)
+    return;
+  m_batchFinished = true;
+
+  if (status != wxEmptyString)
+    m_batchStatus = status;
+  CellTimingEnd();
+  if (!WriteTimingReport(m_batchStatus))
+    wxLogError(_("Cannot write the timing report to %s"), m_timingReportFile);
+  EndProtocolReplay();
+
+  // Allows scripts to detect that the evaluation has failed.
+  if (m_headless && (m_batchStatus != wxT("ok")))
+    wxGetApp().SetExitCode(1);
+
+  SaveFile(false);
+  Close();
+}
+
 void wxMaxima::FileMenu(wxCommandEvent &event)
 {
   if(m_console != NULL)
@@ -3982,6 +4585,10 @@ void wxMaxima::EditMenu(wxCommandEvent &event)
         m_console->RecalculateForce();
         m_console->RequestRedraw();
         ConfigChanged();
+        // The spare maxima might have been set up with the old settings.
+        DiscardSpareMaxima();
+        if (m_isConnected && !m_first)
+          StartSpareMaxima();
       }
 
       configW->Destroy();
@@ -6053,6 +6660,9 @@ void wxMaxima::HelpMenu(wxCommandEvent &event)
         description += _("\nNot connected.");
       if (m_lispVersion != wxEmptyString)
         description += _("\nLisp: ") + m_lispVersion;
+      if (CellPool::CellsAllocated() > 0)
+        description += wxString::Format(_("\nMemory per cell: %li bytes"),
+                                        (long) MathCell::MemoryPerCell());
 
       Dirstructure dirstruct;
       
@@ -6124,6 +6734,9 @@ void wxMaxima::HelpMenu(wxCommandEvent &event)
         description += _("Not connected.");
       if (m_lispVersion != wxEmptyString)
         description += _("<br>Lisp: ") + m_lispVersion;
+      if (CellPool::CellsAllocated() > 0)
+        description += wxString::Format(_("<br>Memory per cell: %li bytes"),
+                                        (long) MathCell::MemoryPerCell());
 
       MyAboutDialog dlg(this, wxID_ANY, wxString(_("About")), description);
       dlg.Center();
@@ -7076,207 +7689,27 @@ void wxMaxima::EvaluateEvent(wxCommandEvent &WXUNUSED(event))
 
 wxString wxMaxima::GetUnmatchedParenthesisState(wxString text,int &index)
 {
-  index = 0;
-  
-  std::list<wxChar> delimiters;
-
-  if (text.Right(1) == wxT("\\"))
-  {
-    index = text.Length() - 1;
-    return (_("Cell ends in a backslash"));
-  }
-
-  bool lisp = m_inLispMode;
+  return EditorCell::AnalyzeParenthesis(text, m_inLispMode, index);
+}
 
-  wxChar lastC = wxT(';');
-  wxChar lastnonWhitespace = wxT(',');
+wxString wxMaxima::GetCommandError(const wxString &command, int &index)
+{
+  std::vector<long> statementEnds;
+  wxString error = EditorCell::AnalyzeParenthesis(command, m_inLispMode, index, NULL, &statementEnds);
+  if (error != wxEmptyString)
+    return error;
 
-  wxString::const_iterator it = text.begin();
-  while (it != text.end())
+  // If the queue has split the cell in a different place than maxima would
+  // the rest of the command would be sent as part of it.
+  for (size_t i = 0; i < statementEnds.size(); i++)
   {
-    wxChar c = *it;
-
-    switch (c)
-    {
-      // Opening parenthesis
-    case wxT('('):
-      delimiters.push_back(wxT(')'));
-      lastC = c;
-      break;
-    case wxT('['):
-      delimiters.push_back(wxT(']'));
-      lastC = c;
-      break;
-    case wxT('{'):
-      delimiters.push_back(wxT('}'));
-      lastC = c;
-      break;
-        
-      // Closing parenthesis
-    case wxT(')'):
-    case wxT(']'):
-    case wxT('}'):
-      if (delimiters.empty()) return (_("Mismatched parenthesis"));
-    if (c != delimiters.back()) return (_("Mismatched parenthesis"));
-    delimiters.pop_back();
-    lastC = c;
-    if (lastnonWhitespace == wxT(','))
-      return (_("Comma directly followed by a closing parenthesis"));
-    break;
-
-    // Escaped characters
-    case wxT('\\'):
-      ++it;++index;
-      lastC = c;
-      break;
-
-      // Strings
-    case wxT('\"'):
-      ++it;++index;
-      while ((it != text.end()) && (c = *it) != wxT('\"'))
-      {
-        if (c == wxT('\\'))
-        {++it;++index;}
-          
-        if(it != text.end())
-        {++it;++index;}
-      }
-      if ((it != text.end()) && (*it != wxT('\"'))) return (_("Unterminated string."));
-      lastC = c;
-      break;
-        
-    // a to_lisp command
-    case wxT('t'):
-    {
-      // Extract 7 chars of the string.
-      wxString command;
-      wxString::const_iterator it2(it);
-      if(it2 != text.end())
-      {
-        command += wxString(*it2);          
-        ++it2;
-      }
-      while((it2 != text.end()) && (wxIsalpha(*it2)))
-      {
-        command += wxString(*it2);
-        ++it2;
-      }
-      if(command.StartsWith(wxT("to_lisp")))
-         lisp = true;
-      break;
-    }
-
-    // An eventual :lisp command
-    case wxT(':'):
-    {
-      // Extract 5 chars of the string.
-      wxString command;
-      wxString::const_iterator it2(it);
-      if(it2 != text.end())
-      {
-        command += wxString(*it2);          
-        ++it2;
-      }
-      while((it2 != text.end()) && (wxIsalpha(*it2)))
-      {
-        command += wxString(*it2);
-        ++it2;
-      }
-      
-      // Let's see if this is a :lisp-quiet or a :lisp
-      if ((command == wxT(":lisp")) || (command == wxT(":lisp-quiet")))
-        lisp = true;
-      lastC = c;
-      break;
-    }
-    case wxT(';'):
-    case wxT('$'):
-      if ((!lisp) && (!delimiters.empty()))
-      {
-        return _("Un-closed parenthesis on encountering ; or $");
-      }
-        lastC = c;
-        break;
-        
-        // Comments
-    case wxT('/'):
-          if (it != text.end())
-          {
-            wxString::const_iterator it2(it);
-            ++it2;
-            if (*it2 == wxT('*'))
-            {
-              // Comment start. Let's search for the comment end.
-
-              if (it != text.end())
-              {++it;++index;}
-              while(it != text.end())
-              {
-                wxChar last;
-                last = *it;
-                ++it;++index;
-
-                // We reached the end of the string without finding a comment end.
-                if(it == text.end())
-                  return (_("Unterminated comment."));
-
-                // A comment end.
-                if((last == wxT('*')) && (*it == wxT('/')))
-                  break;
-              }
-            }
-            else lastC = c;
-          }
-          else lastC = c;
-          break;
-        
-          default:
-            if ((c != wxT('\n')) && (c != wxT(' ')) && (c != wxT('\t')))
-              lastC = c;
-    }
-
-    if (
-      (c != wxT(' ')) &&
-      (c != wxT('\t')) &&
-      (c != wxT('\n')) &&
-      (c != wxT('\r'))
-      )
-      lastnonWhitespace = c;
-
-    ++it;++index;
-    }
-    if (!delimiters.empty())
-    {
-      return _("Un-closed parenthesis");
-    }
-
-    if ((!lisp))
+    if (statementEnds[i] < (long) command.Length() - 1)
     {
-
-      bool endingNeeded = true;
-      text.Trim(true);
-      text.Trim(false);
-    
-      // Cells ending in ";" or in "$" don't require us to add an ending.
-      if (lastC == wxT(';'))
-        endingNeeded = false;
-      if (lastC == wxT('$'))
-        endingNeeded = false;
-    
-      // Cells ending in "(to-maxima)" (with optional spaces around the "to-maxima")
-      // don't require us to add an ending, neither.
-      if(text.EndsWith(wxT(")")))
-      {
-        text = text.SubString(0,text.Length()-2);
-        text.Trim();
-        if (text.EndsWith(wxT("to-maxima")))
-          endingNeeded = false;
-      }
-
-      if(endingNeeded)
-        return _("No dollar ($) or semicolon (;) at the end of command");
+      index = statementEnds[i];
+      return _("More than one command in what should be a single one");
     }
-    return wxEmptyString;
+  }
+  return wxEmptyString;
 }
 
 //! Tries to evaluate next group cell in queue
@@ -7358,14 +7791,30 @@ void wxMaxima::TryEvaluateNextInQueue()
     tmp->RemoveOutput();
     m_console->Recalculate(tmp);
     m_console->RequestRedraw();
+    if (m_timingReportFile != wxEmptyString)
+      CellTimingStart(tmp);
   }
 
   wxString text = m_console->m_evaluationQueue.GetCommand();
   m_commandIndex = m_console->m_evaluationQueue.GetIndex();
   if ((text != wxEmptyString) && (text != wxT(";")) && (text != wxT("$")))
   {
-    int index;
-    wxString parenthesisError = GetUnmatchedParenthesisState(tmp->GetEditable()->ToString(true),index);
+    // If this command has been sent to maxima in advance we only need to
+    // prepare the worksheet for its output.
+    bool alreadySent = m_console->m_evaluationQueue.CurrentCommandSent();
+    int index = 0;
+    wxString parenthesisError;
+    if (!alreadySent)
+    {
+      parenthesisError = tmp->GetEditable()->GetUnmatchedParenthesisState(m_inLispMode, index);
+      if (parenthesisError == wxEmptyString)
+      {
+        parenthesisError = GetCommandError(text, index);
+        // Point at the end of the command in the cell.
+        if (parenthesisError != wxEmptyString)
+          index = m_commandIndex;
+      }
+    }
     if (parenthesisError == wxEmptyString)
     {
       if (m_console->FollowEvaluation())
@@ -7385,7 +7834,13 @@ void wxMaxima::TryEvaluateNextInQueue()
       if (m_xmlInspector)
         m_xmlInspector->Clear();
 
-      SendMaxima(text, true);
+      if (!alreadySent)
+      {
+        // The cell and the command have just been checked for syntax errors.
+        SendMaxima(text, true, false);
+        m_console->m_evaluationQueue.CommandSent();
+      }
+      SendCommandsAhead();
       EvaluationQueueLength(m_console->m_evaluationQueue.Size(),
                             m_console->m_evaluationQueue.CommandsLeftInCell()
       );
@@ -7447,6 +7902,56 @@ void wxMaxima::TryEvaluateNextInQueue()
 
 }
 
+void wxMaxima::SendCommandsAhead()
+{
+  int pipelineDepth = m_console->m_configuration->PipelineDepth();
+  if ((pipelineDepth < 2) || m_inLispMode || m_console->QuestionPending())
+    return;
+
+  EvaluationQueue &queue = m_console->m_evaluationQueue;
+  if ((queue.GetCell() != NULL) && (!queue.GetCell()->m_knownAnswers.empty()))
+    return;
+
+  GroupCell *checkedCell = NULL;
+  while (queue.CommandsInFlight() < pipelineDepth)
+  {
+    // If maxima asks a question it reads the commands that follow as the answer.
+    if (queue.QuestionMightBeAsked())
+      return;
+
+    GroupCell *cell = NULL;
+    wxString text = queue.GetNextUnsentCommand(&cell);
+    if ((text == wxEmptyString) || (cell == NULL))
+      return;
+
+    // If maxima asks a question the commands that follow are read as the answer.
+    // Don't send anything in advance that might be mistaken for one.
+    if (!cell->m_knownAnswers.empty())
+      return;
+
+    // Lisp mode changes the way maxima's prompts look like.
+    wxString trimmed = text;
+    trimmed.Trim(false);
+    if (trimmed.StartsWith(wxT(":lisp")) || trimmed.Contains(wxT("to_lisp")))
+      return;
+
+    // Cells and commands containing a syntax error are handled by
+    // TryEvaluateNextInQueue() once they are reached.
+    int index;
+    if (cell != checkedCell)
+    {
+      if (cell->GetEditable()->GetUnmatchedParenthesisState(m_inLispMode, index) != wxEmptyString)
+        return;
+      checkedCell = cell;
+    }
+    if (GetCommandError(text, index) != wxEmptyString)
+      return;
+
+    SendMaxima(text, true, false);
+    queue.CommandSent();
+  }
+}
+
 void wxMaxima::InsertMenu(wxCommandEvent &event)
 {
   if(m_console != NULL)
@@ -8173,6 +8678,7 @@ BEGIN_EVENT_TABLE(wxMaxima, wxFrame)
                 EVT_TOOL(ToolBar::tb_follow, wxMaxima::OnFollow)
                 EVT_SOCKET(socket_server_id, wxMaxima::ServerEvent)
                 EVT_SOCKET(socket_client_id, wxMaxima::ClientEvent)
+                EVT_SOCKET(socket_spare_client_id, wxMaxima::SpareClientEvent)
 /* These commands somehow caused the menu to be updated six times on every
    keypress and the tool bar to be updated six times on every menu update
 
@@ -8218,6 +8724,8 @@ EVT_UPDATE_UI(menu_show_toolbar, wxMaxima::UpdateMenus)
 */
                 EVT_CLOSE(wxMaxima::OnClose)
                 EVT_END_PROCESS(maxima_process_id, wxMaxima::OnProcessEvent)
+                EVT_THREAD(background_save_finished_id, wxMaxima::OnBackgroundSaveFinished)
+                EVT_THREAD(help_index_ready_id, wxMaxima::OnHelpIndexReady)
                 EVT_MENU(MathCtrl::popid_edit, wxMaxima::EditInputMenu)
                 EVT_MENU(menu_evaluate, wxMaxima::EvaluateEvent)
                 EVT_MENU(menu_add_comment, wxMaxima::InsertMenu)
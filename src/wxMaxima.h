@@ -32,6 +32,10 @@
 
 #include "wxMaximaFrame.h"
 #include "MathParser.h"
+#include "ProcessMonitor.h"
+#include "FramedProtocol.h"
+#include "HelpIndex.h"
+#include "ProtocolRecording.h"
 
 #include <wx/socket.h>
 #include <wx/config.h>
@@ -138,14 +142,38 @@ public:
   */
   long int m_autoSaveInterval;
 
+  //! Compress and write autosaves in a background thread?
+  bool m_autoSaveInBackground;
+
+  //! Is called when a save started by MathCtrl::ExportToWXMXInBackground() has finished
+  void OnBackgroundSaveFinished(wxThreadEvent &event);
+
+  //! Is called when the HelpIndex has found maxima's manual and read its index
+  void OnHelpIndexReady(wxThreadEvent &event);
+
   void ShowTip(bool force);
 
   /*! Get the name of the help file
 
+    wxEmptyString, if the HelpIndex hasn't found it yet.
+   */
+  wxString GetHelpFile();
+
+  /*! Start finding maxima's manual and reading its index in the background
+
+    Uses the cached result instead if the cache is for the maxima version
+    we are connected to.
+   */
+  void UpdateHelpIndex();
+
+  /*! The help file we can find without asking maxima
+
+    On MSW this searches the directory maxima is installed in.
+
     \todo We probably should use the help files from the newest maxima version
     installed instead of the ones from the alphabetically first installation we find.
    */
-  wxString GetHelpFile();
+  wxString FindHelpFile();
 
   void ShowMaximaHelp(wxString keyword = wxEmptyString);
 
@@ -169,10 +197,48 @@ public:
     {
       m_exitAfterEval = exitaftereval;
     }
+
+  /*! Run the batch mode without ever showing the worksheet
+
+    In this mode the worksheet isn't laid out and questions or errors
+    end the evaluation instead of waiting for the user.
+   */
+  void Headless(bool headless);
+
+  /*! Write the time each cell needed to evaluate to a file
+
+    The report is written in JSON once the batch evaluation has ended.
+   */
+  void SetTimingReport(wxString file)
+    {
+      m_timingReportFile = file;
+    }
+
+  //! Record the communication with maxima to a file, see ProtocolRecorder
+  void RecordProtocol(wxString file);
+
+  /*! Play back a recording made by RecordProtocol() instead of starting maxima
+
+    Once the recording has been played back how long wxMaxima needed for 
+    each stage of handling it is printed to stderr, see StageTimer.
+    \param file The recording
+    \param realTime true = keep the timing of the recording. false = send all 
+           data as fast as wxMaxima can handle it.
+    \param timeout How many milliseconds the replay waits for wxMaxima to send
+           a command before it continues anyway.
+   */
+  void ReplayProtocol(wxString file, bool realTime, long timeout);
   
   void StripComments(wxString &s);
 
-  void SendMaxima(wxString s, bool history = false);
+  /*! Sends a string to maxima
+
+    \param s The string to send
+    \param history true = add the string to the history sidebar
+    \param checkParenthesis false = the caller has already made sure that s
+           doesn't contain unmatched parenthesis or similar.
+   */
+  void SendMaxima(wxString s, bool history = false, bool checkParenthesis = true);
 
   //! Open a file
   void OpenFile(wxString file,
@@ -187,10 +253,8 @@ public:
   { m_console->OpenHCaret(file, GC_TYPE_IMAGE); }
 
 private:
-  //! The number of Jiffies Maxima had used the last time we asked
-  long long m_maximaJiffies_old;
-  //! The number of Jiffies the CPU had made the last time
-  long long m_cpuTotalJiffies_old;
+  //! Measures the CPU time, memory and disk I/O of maxima and its child processes
+  ProcessMonitor m_processMonitor;
   //! Do we need to update the menus + toolbars?
   bool m_updateControls;
   //! A RegEx that matches gnuplot errors.
@@ -219,12 +283,66 @@ private:
   bool m_exitAfterEval;
   //! Can we display the "ready" prompt right now?
   bool m_ready;
+  //! Are we running in batch mode without a window? See Headless()
+  bool m_headless;
+  //! Has the batch evaluation already ended?
+  bool m_batchFinished;
+  //! "ok" or the reason the batch evaluation has failed. See FinishBatch()
+  wxString m_batchStatus;
+  //! The file the time each cell needed is written to. See SetTimingReport()
+  wxString m_timingReportFile;
+
+  //! The time one cell needed to evaluate
+  struct CellTiming
+  {
+    //! The cell that was evaluated. Is numbered only when the report is written.
+    GroupCell *cell;
+    //! The contents of the cell's input
+    wxString input;
+    //! The time [in milliseconds since the epoch] evaluation of the cell has started at
+    wxLongLong wallStart;
+    //! The wall-clock time [in milliseconds] the cell needed
+    wxLongLong wallTime;
+    //! The CPU time maxima had used when evaluation of the cell started. See GetMaximaCpuTime()
+    long long cpuStart;
+    //! The CPU time maxima needed for the cell or -1, if unknown.
+    long long cpuTime;
+    //! The resident memory of maxima and its child processes after the cell or -1, if unknown.
+    long long residentBytes;
+    //! "ok", "error", "question" or "connection lost"
+    wxString status;
+  };
+  //! The timing of all cells evaluated in batch mode
+  std::list<CellTiming> m_cellTimings;
+  //! Remember that the evaluation of a new cell has started
+  void CellTimingStart(GroupCell *cell);
+  //! Remember that the cell that was evaluated last has finished
+  void CellTimingEnd();
+  //! Write m_cellTimings to m_timingReportFile
+  bool WriteTimingReport(wxString status);
+  /*! End a batch evaluation
+
+    Writes the timing report, saves the file and closes the window. In headless
+    mode the program's exit code is 1 if the evaluation hasn't succeeded.
+    \param status The reason the evaluation has ended. wxEmptyString means:
+                  ok, unless a cell has caused an error.
+   */
+  void FinishBatch(wxString status = wxEmptyString);
 
   /*! A human-readable presentation of eventual unmatched-parenthesis type errors
 
     If text doesn't contain any error this function returns wxEmptyString
   */
   wxString GetUnmatchedParenthesisState(wxString text,int &index);
+
+  /*! Checks a command from the evaluation queue before it is sent to maxima
+
+    The queue splits a cell into commands when the cell is queued: The
+    command text is what is sent, even if the cell has been edited since.
+    \param index Is set to the position the error was found at
+    \return A description of the error or wxEmptyString if the command is OK
+   */
+  wxString GetCommandError(const wxString &command, int &index);
   //! The buffer all data from maxima is temporarily stored in.
   unsigned char *m_packetFromMaxima;
   //! The buffer all text from maxima is stored in before converting it to a wxString.
@@ -337,6 +455,10 @@ protected:
     a line of text.
    */
   void ClientEvent(wxSocketEvent &event);
+  //! Is triggered on input or disconnect from the spare maxima, see StartSpareMaxima()
+  void SpareClientEvent(wxSocketEvent &event);
+  //! Interprets a chunk of data maxima has sent. Replaces '\0' chars in data.
+  void InterpretDataFromMaxima(char *data, long length);
   //! Triggered when we get new chars from maxima.
   void OnNewChars();
 
@@ -384,6 +506,15 @@ protected:
   //! Try to evaluate the next command for maxima that is in the evaluation queue
   void TryEvaluateNextInQueue();
 
+  /*! Send the commands that follow the current one to maxima in advance
+
+    Only does something if Configuration::PipelineDepth() allows more than one
+    command to be on its way to maxima at a time. Commands that switch maxima to 
+    lisp mode, commands from cells we know to ask questions, cells that
+    contain syntax errors and commands that might ask a question stop the pipeline.
+   */
+  void SendCommandsAhead();
+
   void TryUpdateInspector();
 
   wxString ExtractFirstExpression(wxString entry);
@@ -402,6 +533,37 @@ protected:
    */
   bool StartMaxima(bool force = false);
 
+  /*! Starts a spare maxima in the background, if this is enabled in the config
+
+    The spare connects to our server and is sent the commands from 
+    MaximaSetupCommands() at once. Everything it says is kept in m_spareOutput 
+    so StartMaxima() can swap it in instead of waiting for a new maxima to 
+    start up.
+   */
+  void StartSpareMaxima();
+  /*! Makes the spare maxima the one that is used, if there is one
+
+    \return false, if there was no spare maxima.
+   */
+  bool UseSpareMaxima();
+  //! Kills the spare maxima
+  void DiscardSpareMaxima();
+  /*! Sends the setup commands to m_spareClient, if it is m_spareProcess
+
+    Whatever connects to our port while we wait for the spare maxima needs to
+    tell the process id maxima's banner contains first. A connection from
+    another process is closed.
+   */
+  void VerifySpareClient();
+  //! Starts playing back m_protocolReplayFile instead of starting maxima
+  bool StartProtocolReplay();
+  /*! Stops the protocol replay and prints how long wxMaxima needed for it
+
+    \return true, if the replay had to give up waiting for wxMaxima to send
+    the commands the recording expects.
+   */
+  bool EndProtocolReplay();
+
   void OnClose(wxCloseEvent &event);               //!< close wxMaxima window
   wxString GetCommand(bool params = true);         //!< returns the command to start maxima
   //    (uses guessConfiguration)
@@ -432,6 +594,18 @@ protected:
   //! Find the end of a tag in wxMaxima's output.
   int FindTagEnd(wxString &data, const wxString &tag);
 
+  /*! Interprets text from maxima by searching it for tags
+
+    The text is appended to m_currentOutput and every message that is complete
+    is removed from there.
+   */
+  void InterpretTaggedOutput(const wxString &newChars);
+
+  //! Interprets a message maxima has sent as a frame of the framed protocol
+  void InterpretFrame(FramedProtocol::MessageType type, wxString &payload);
+  //! Interpret all messages m_framedInput has completely received
+  void InterpretFramedInput();
+
   /*! Reads text that isn't enclosed between xml tags.
 
      Some commands provide status messages before the math output or the command has finished.
@@ -464,12 +638,18 @@ protected:
    */
   void ReadMath(wxString &data);
 
+  //! Appends a complete <mth> tag from maxima to the console
+  void AppendMath(wxString &o);
+
   /*! Reads autocompletion templates we get on definition of a function or variable
 
     After processing the templates they are removed from data.
    */
   void ReadLoadSymbols(wxString &data);
 
+  //! Makes a list of autocompletion symbols separated by "$" known to the console
+  void AddSymbols(const wxString &symbols);
+
 #ifndef __WXMSW__
 
   //! reads the output the maxima command sends to stdout
@@ -477,23 +657,18 @@ protected:
 
 #endif
 
-  /*! How much CPU time has been used by the system until now? Used by GetMaximaCPUPercentage.
-
-    \return The CPU time elapsed in the same unit as GetMaximaCpuTime(); -1 means: Unable to determine this value.
-
-    \todo MSW: Is GetTickCount() * 10000 really milliseconds on all systems?
-   */
-  long long GetTotalCpuTime();
-
-  /*! How much CPU time has maxima used till now? Used by GetMaximaCPUPercentage.
-
-    \return The CPU time maxima has used in the same unit as GetTotalCpuTime(); -1 means: Unable to determine this value.
+  /*! How much CPU time have maxima and its child processes used till now?
 
+    \return The CPU time in units of CpuTimeUnitsPerSecond(); -1 means: Unable to determine this value.
    */
   long long GetMaximaCpuTime();
 
+  //! The number of units per second GetMaximaCpuTime() counts in
+  double CpuTimeUnitsPerSecond();
+
   /*! How much CPU horsepower is maxima using currently?
 
+    Also informs the status bar about the memory and disk I/O of maxima.
     \return The percentage of the CPU horsepower maxima is using or -1, if this value is unknown.
    */
   double GetMaximaCPUPercentage();
@@ -510,6 +685,10 @@ protected:
     supports it.
  */
   void SetupVariables();
+  //! The commands SetupVariables() sends to maxima
+  wxArrayString MaximaSetupCommands();
+  //! The part of SetupVariables() that concerns wxMaxima and the current document
+  void SetupSession();
 
   void KillMaxima();                 //!< kills the maxima process
   /*! Update the title
@@ -542,8 +721,12 @@ protected:
   //! Opens a wxmx file
   bool OpenWXMXFile(wxString file, MathCtrl *document, bool clearDocument = true);
 
-  //! Loads a wxmx description
-  GroupCell *CreateTreeFromXMLNode(wxXmlNode *xmlcells, wxString wxmxfilename = wxEmptyString);
+  /*! Loads a wxmx description
+
+    \param archive The .wxmx archive the images are read from.
+                   NULL = read them from the operating system's filesystem
+   */
+  GroupCell *CreateTreeFromXMLNode(wxXmlNode *xmlcells, WXMXArchive *archive = NULL);
 
   /*! Saves the current file
 
@@ -551,6 +734,13 @@ protected:
    */
   bool SaveFile(bool forceSave = false);
 
+  /*! The bookkeeping after file has been saved successfully
+
+    Used by SaveFile() and by OnBackgroundSaveFinished() so a save in the
+    background has the same effects as one in the foreground.
+   */
+  void FileSaved(const wxString &file);
+
   int SaveDocumentP();
 
   //! Set the current working directory file I/O from maxima is relative to.
@@ -569,6 +759,24 @@ protected:
   //! Is maxima running?
   bool m_isRunning;
   wxProcess *m_process;
+  //! A maxima that is started in advance for the next restart or NULL
+  wxProcess *m_spareProcess;
+  //! The connection to m_spareProcess or NULL, if it hasn't connected yet
+  wxSocketBase *m_spareClient;
+  //! Everything m_spareProcess has sent till now
+  wxMemoryBuffer m_spareOutput;
+  //! Has m_spareClient told us the process id of m_spareProcess? See VerifySpareClient().
+  bool m_spareVerified;
+  //! Records the communication with maxima, if requested by RecordProtocol()
+  ProtocolRecorder m_protocolRecorder;
+  //! The recording that is played back instead of starting maxima, see ReplayProtocol()
+  wxString m_protocolReplayFile;
+  //! Keep the timing of m_protocolReplayFile?
+  bool m_protocolReplayRealTime;
+  //! How long the replay waits for a command [in milliseconds]
+  long m_protocolReplayTimeout;
+  //! The thread that plays back m_protocolReplayFile or NULL
+  ProtocolReplay *m_protocolReplay;
   //! The stdout of the maxima process
   wxInputStream *m_maximaStdout;
   //! The stderr of the maxima process
@@ -585,6 +793,10 @@ protected:
   wxString m_currentOutputEnd;
   //! All from maxima's current output we still haven't interpreted
   wxString m_currentOutput;
+  //! Do we ask maxima to send its output as length-prefixed frames?
+  bool m_useFramedProtocol;
+  //! Splits maxima's output into frames if m_useFramedProtocol is set
+  FramedProtocol m_framedInput;
   //! The marker for the start of a input prompt
   wxString m_promptPrefix;
   //! The marker for the end of a input prompt
@@ -605,6 +817,12 @@ protected:
   bool m_variablesOK;
   wxString m_chmhelpFile;
   bool m_htmlHelpInitialized;
+  //! Where maxima's manual is and which page documents which keyword
+  HelpIndex m_helpIndex;
+  //! Has the user asked for help before m_helpIndex was ready? See OnHelpIndexReady().
+  bool m_helpPending;
+  //! The keyword to show the help for as soon as m_helpIndex is ready
+  wxString m_pendingHelpKeyword;
   wxString m_maximaVersion;
   wxString m_lispVersion;
   //! The Char the current command starts at in the current WorkingGroup
@@ -646,6 +864,13 @@ class MyApp : public wxApp
 public:
   virtual bool OnInit();
 
+  //! Runs the main loop and returns the exit code set by SetExitCode()
+  virtual int OnRun();
+
+  //! Set the exit code the program returns if the main loop ends normally
+  void SetExitCode(int exitCode)
+  { m_exitCode = exitCode; }
+
 #if defined (__WXMSW__)
   virtual int OnExit();
 #endif
@@ -661,8 +886,17 @@ public:
     \param file The file name
     \param evalOnStartup Do we want to execute the file automatically, but halt on error?
     \param exitAfterEval Do we want to close the window after the file has been evaluated?
+    \param headless Evaluate the file without showing a window?
+    \param timingReport The file the time each cell needed is written to in batch mode.
+    \param recordProtocol The file the communication with maxima is recorded to.
+    \param replayProtocol The recording to play back instead of starting maxima.
+    \param replayRealTime Keep the timing of the recording when playing it back?
+    \param replayTimeout How long the replay waits for a command [in milliseconds].
    */
-  void NewWindow(wxString file = wxEmptyString, bool evalOnStartup = false, bool exitAfterEval = false);
+  void NewWindow(wxString file = wxEmptyString, bool evalOnStartup = false, bool exitAfterEval = false,
+                 bool headless = false, wxString timingReport = wxEmptyString,
+                 wxString recordProtocol = wxEmptyString, wxString replayProtocol = wxEmptyString,
+                 bool replayRealTime = false, long replayTimeout = 30000);
 
   //! Is called by atExit and tries to close down the maxima process if wxMaxima has crashed.
   static void Cleanup_Static();
@@ -680,6 +914,8 @@ public:
 private:
   //! The name of the config file. Empty = Use the default one.
   wxString m_configFileName;
+  //! The exit code the program returns. See SetExitCode()
+  int m_exitCode;
   DECLARE_EVENT_TABLE()
 };
 
@@ -61,7 +61,9 @@ wxMaximaFrame::wxMaximaFrame(wxWindow *parent, int id, const wxString &title,
   // The table of contents
   m_console->m_tableOfContents = new TableOfContents(this, -1, &m_console->m_configuration);
 
-  m_xmlInspector = new XmlInspector(this, -1);
+  m_xmlInspector = NULL;
+  m_xmlInspectorPane = new wxPanel(this, -1);
+  m_xmlInspectorPane->SetSizer(new wxBoxSizer(wxVERTICAL));
   SetupMenu();
 
   m_statusBar = new StatusBar(this, -1);
@@ -280,7 +282,7 @@ void wxMaximaFrame::do_layout()
                             PaneBorder(true).
                             Right());
 
-  m_manager.AddPane(m_xmlInspector,
+  m_manager.AddPane(m_xmlInspectorPane,
                     wxAuiPaneInfo().Name(wxT("XmlInspector")).
                             Show(false).
                             TopDockable(true).
@@ -387,6 +389,9 @@ void wxMaximaFrame::do_layout()
   // basically useless => force it to be enabled.
   m_manager.GetPane(wxT("console")).Show(true);
 
+  if (m_manager.GetPane(wxT("XmlInspector")).IsShown())
+    CreateXmlInspector();
+
   // LoadPerspective overwrites the pane names with the saved ones -which can
   // belong to a translation different to the one selected currently =>
   // let's overwrite the names here.
@@ -1361,6 +1366,16 @@ bool wxMaximaFrame::IsPaneDisplayed(Event id)
   return displayed;
 }
 
+void wxMaximaFrame::CreateXmlInspector()
+{
+  if (m_xmlInspector != NULL)
+    return;
+
+  m_xmlInspector = new XmlInspector(m_xmlInspectorPane, -1, &m_protocolLog);
+  m_xmlInspectorPane->GetSizer()->Add(m_xmlInspector, wxSizerFlags(1).Expand());
+  m_xmlInspectorPane->Layout();
+}
+
 void wxMaximaFrame::ShowPane(Event id, bool show)
 {
   switch (id)
@@ -1376,6 +1391,8 @@ void wxMaximaFrame::ShowPane(Event id, bool show)
       m_console->m_tableOfContents->UpdateTableOfContents(m_console->GetTree(), m_console->GetHCaret());
       break;
     case menu_pane_xmlInspector:
+      if (show)
+        CreateXmlInspector();
       m_manager.GetPane(wxT("XmlInspector")).Show(show);
       break;
     case menu_pane_stats:
@@ -111,6 +111,7 @@ public:
 
     socket_client_id,
     socket_server_id,
+    socket_spare_client_id,
     input_line_id,
     refresh_id,
     menu_new_id,
@@ -418,7 +419,9 @@ public:
     menu_edit_find,
     menu_history_previous,
     menu_history_next,
-    menu_check_updates
+    menu_check_updates,
+    background_save_finished_id,
+    help_index_ready_id
   };
 
   /*! Update the recent documents list
@@ -642,8 +645,21 @@ protected:
   void SaveRecentDocuments();
 
   wxAuiManager m_manager;
-  //! A XmlInspector-like xml monitor
+  /*! A XmlInspector-like xml monitor
+
+    Is NULL until the pane is shown for the first time.
+   */
   XmlInspector *m_xmlInspector;
+  //! The communication with maxima; kept even if m_xmlInspector hasn't been created
+  ProtocolLog m_protocolLog;
+  //! The pane m_xmlInspector is placed in once it is created
+  wxPanel *m_xmlInspectorPane;
+
+  /*! Create m_xmlInspector, if that hasn't happened yet
+
+    The raw XML monitor is rarely used => we only create it on demand.
+   */
+  void CreateXmlInspector();
   //! true=force an update of the status bar at the next call of StatusMaximaBusy()
   bool m_forceStatusbarUpdate;
   //! The worksheet itself
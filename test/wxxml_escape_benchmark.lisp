@@ -0,0 +1,69 @@
+;; Micro-benchmark for the XML escaping wxmathml.lisp applies to strings
+;; maxima sends to wxMaxima.
+;;
+;; Needs a maxima that runs inside wxMaxima (so wxxml-fix-string is
+;; defined). Run it by entering
+;;   load("<path to this directory>/wxxml_escape_benchmark.lisp")$
+;; into a worksheet. It compares the old implementation, which called
+;; string-substitute once per character it replaced, with the current
+;; single-pass one, and checks that both produce the same result.
+
+(in-package :maxima)
+
+(defun wxxml-benchmark-string-substitute (newstring oldchar x &aux matchpos)
+  (setq matchpos (position oldchar x))
+  (if (null matchpos) x
+      (concatenate 'string
+		   (subseq x 0 matchpos)
+		   newstring
+		   (wxxml-benchmark-string-substitute newstring oldchar
+						      (subseq x (1+ matchpos))))))
+
+(defun wxxml-benchmark-old-fix-string (x)
+  (let* ((tmp-x (wxxml-benchmark-string-substitute "&amp;" #\& x))
+	 (tmp-x (wxxml-benchmark-string-substitute "&lt;" #\< tmp-x))
+	 (tmp-x (wxxml-benchmark-string-substitute "&gt;" #\> tmp-x))
+	 (tmp-x (wxxml-benchmark-string-substitute "&#13;" #\Return tmp-x))
+	 (tmp-x (wxxml-benchmark-string-substitute "&#13;" #\Linefeed tmp-x))
+	 (tmp-x (wxxml-benchmark-string-substitute "&#13;" #\Newline tmp-x)))
+    tmp-x))
+
+;;; A string of the given length one character in eight of which needs
+;;; escaping - roughly what printing a big matrix or an XML document to a
+;;; string produces.
+(defun wxxml-benchmark-make-string (len)
+  (let ((s (make-string len))
+	(pattern (concatenate 'string "abc<def" (string #\Newline)
+			      "ghijklm&" "nopqrst>")))
+    (dotimes (i len s)
+      (setf (char s i) (char pattern (mod i (length pattern)))))))
+
+;;; The seconds it takes to call fn on x repeats times.
+(defun wxxml-benchmark-time (fn x repeats)
+  (let ((start (get-internal-real-time)))
+    (dotimes (i repeats)
+      (funcall fn x))
+    (/ (float (- (get-internal-real-time) start))
+       internal-time-units-per-second)))
+
+(defun wxxml-benchmark ()
+  (dolist (len '(1000 10000 100000 1000000))
+    (let* ((x (wxxml-benchmark-make-string len))
+	   (repeats (max 1 (floor 100000 len)))
+	   ;; The old implementation recurses once per match and needs
+	   ;; quadratic time: Don't wait for it on the biggest strings.
+	   (old-p (<= len 10000)))
+      (when (and old-p
+		 (string/= (wxxml-benchmark-old-fix-string x)
+			   (wxxml-fix-string x)))
+	(error "wxxml-fix-string gives a different result for ~d chars" len))
+      (format t "~8d chars, ~4d runs: old ~a, new ~,3fs~%"
+	      len repeats
+	      (if old-p
+		  (format nil "~,3fs"
+			  (wxxml-benchmark-time #'wxxml-benchmark-old-fix-string
+						x repeats))
+		  "skipped")
+	      (wxxml-benchmark-time #'wxxml-fix-string x repeats)))))
+
+(wxxml-benchmark)